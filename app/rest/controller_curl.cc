@@ -34,6 +34,7 @@ ControllerCurl::ControllerCurl(TransportCurl* transport,
       is_paused_(false),
       response_(response),
       transferring_(false),
+      transfer_id_(0),
       bytes_transferred_(0),
       transfer_size_(0),
       this_handle_(nullptr),
@@ -57,6 +58,7 @@ ControllerCurl& ControllerCurl::operator=(ControllerCurl&& other) noexcept {
   is_paused_ = other.is_paused_;
   response_ = other.response_;
   transferring_ = other.transferring_;
+  transfer_id_ = other.transfer_id_;
   bytes_transferred_ = other.bytes_transferred_;
   transfer_size_ = other.transfer_size_;
   this_handle_ = other.this_handle_;
@@ -107,10 +109,16 @@ bool ControllerCurl::Cancel() {
   if (this_handle_mutex_) {
     MutexLock lock(*this_handle_mutex_);
     if (transferring_) {
-      transport_->CancelRequest(response_);
+      transport_->CancelRequest(response_, transfer_id_);
       transferring_ = false;
       return true;
     }
+  } else if (transferring_) {
+    // The transfer is waiting for the curl thread to start it, which fails it
+    // instead.
+    transport_->CancelRequest(response_, transfer_id_);
+    transferring_ = false;
+    return true;
   }
   return false;
 }
@@ -88,6 +88,11 @@ class ControllerCurl : public Controller {
   // Set whether a transfer is active.
   void set_transferring(bool transferring) { transferring_ = transferring; }
 
+  // Set the identifier of the transfer this controls.
+  void set_transfer_id(uint64_t transfer_id) { transfer_id_ = transfer_id; }
+  // Identifier of the transfer this controls.
+  uint64_t transfer_id() const { return transfer_id_; }
+
   // Set the current number of bytes transferred.
   void set_bytes_transferred(int64_t bytes_transferred);
 
@@ -120,6 +125,8 @@ class ControllerCurl : public Controller {
 
   // Whether the transfer is running.
   bool transferring_;
+  // Identifies the transfer, as the response may be reused by a later one.
+  uint64_t transfer_id_;
   // Number of bytes transferred.
   int64_t bytes_transferred_;
   // Total size of the transfer.
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "app/rest/json_schema_cache.h"
+
+#include <map>
+#include <vector>
+
+#include "app/src/assert.h"
+#include "app/src/include/firebase/internal/mutex.h"
+
+namespace firebase {
+namespace rest {
+
+namespace {
+
+// Maximum number of idle parsers kept for each response schema.
+const size_t kMaxPooledParsers = 8;
+
+Mutex* g_schemas_mutex = new Mutex();
+
+}  // namespace
+
+// A compiled schema and the parsers that use it.
+class JsonSchema {
+ public:
+  JsonSchema(const char* schema, const flatbuffers::IDLOptions& options)
+      : schema_(schema), options_(options) {}
+
+  // Create a parser that has compiled the schema.
+  flatbuffers::Parser* Compile() const {
+    flatbuffers::Parser* parser = new flatbuffers::Parser(options_);
+    bool parse_status = parser->Parse(schema_);
+    FIREBASE_ASSERT_MESSAGE(parse_status, parser->error_.c_str());
+    return parser;
+  }
+
+  // Get the parser shared by every user of the schema.
+  const flatbuffers::Parser& shared_parser() {
+    MutexLock lock(mutex_);
+    if (!shared_parser_) shared_parser_.reset(Compile());
+    return *shared_parser_;
+  }
+
+  // Take an idle parser or compile a new one if there are none.
+  flatbuffers::Parser* Acquire() {
+    {
+      MutexLock lock(mutex_);
+      if (!idle_parsers_.empty()) {
+        flatbuffers::Parser* parser = idle_parsers_.back();
+        idle_parsers_.pop_back();
+        return parser;
+      }
+    }
+    return Compile();
+  }
+
+  // Make a parser available to later users of the schema.
+  void Release(flatbuffers::Parser* parser) {
+    // A parser that failed may have been left part way through the JSON, so
+    // it's not reused.
+    if (parser->error_.empty()) {
+      // Keep the memory of the builder for the next response.
+      parser->builder_.Clear();
+      MutexLock lock(mutex_);
+      if (idle_parsers_.size() < kMaxPooledParsers) {
+        idle_parsers_.push_back(parser);
+        return;
+      }
+    }
+    delete parser;
+  }
+
+ private:
+  const char* schema_;
+  flatbuffers::IDLOptions options_;
+  Mutex mutex_;
+  std::unique_ptr<flatbuffers::Parser> shared_parser_;
+  std::vector<flatbuffers::Parser*> idle_parsers_;
+};
+
+namespace {
+
+// Get the schema with options, which are the same for every use of the
+// schemas in the map.
+JsonSchema* GetSchema(std::map<const char*, JsonSchema*>* schemas,
+                      const char* schema,
+                      const flatbuffers::IDLOptions& options) {
+  MutexLock lock(*g_schemas_mutex);
+  JsonSchema*& json_schema = (*schemas)[schema];
+  if (!json_schema) json_schema = new JsonSchema(schema, options);
+  return json_schema;
+}
+
+}  // namespace
+
+void PooledParserDeleter::operator()(flatbuffers::Parser* parser) const {
+  if (schema) {
+    schema->Release(parser);
+  } else {
+    delete parser;
+  }
+}
+
+const flatbuffers::Parser& GetRequestJsonParser(const char* schema) {
+  static std::map<const char*, JsonSchema*>* schemas =
+      new std::map<const char*, JsonSchema*>();
+  flatbuffers::IDLOptions options;
+  options.skip_unexpected_fields_in_json = true;
+  options.strict_json = true;
+  return GetSchema(schemas, schema, options)->shared_parser();
+}
+
+PooledParser AcquireResponseJsonParser(const char* schema) {
+  static std::map<const char*, JsonSchema*>* schemas =
+      new std::map<const char*, JsonSchema*>();
+  flatbuffers::IDLOptions options;
+  options.skip_unexpected_fields_in_json = true;
+  JsonSchema* json_schema = GetSchema(schemas, schema, options);
+  return PooledParser(json_schema->Acquire(), PooledParserDeleter(json_schema));
+}
+
+}  // namespace rest
+}  // namespace firebase
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIREBASE_APP_REST_JSON_SCHEMA_CACHE_H_
+#define FIREBASE_APP_REST_JSON_SCHEMA_CACHE_H_
+
+#include <memory>
+
+#include "flatbuffers/idl.h"
+
+namespace firebase {
+namespace rest {
+
+// Compiling a FlatBuffers schema is far more expensive than converting a
+// request or response between JSON and a FlatBuffer, so RequestJson and
+// ResponseJson share parsers that have compiled their schema. Schemas are
+// compiled the first time they're used and kept for the life of the process.
+//
+// Schemas are identified by their address, so they must be strings with
+// static storage duration such as the schema resources embedded in the SDK.
+
+class JsonSchema;
+
+// Returns a pooled response parser to the pool of its schema.
+struct PooledParserDeleter {
+  PooledParserDeleter() : schema(nullptr) {}
+  explicit PooledParserDeleter(JsonSchema* schema_to_return_to)
+      : schema(schema_to_return_to) {}
+
+  void operator()(flatbuffers::Parser* parser) const;
+
+  JsonSchema* schema;
+};
+
+// Parser borrowed from the pool of a schema.
+typedef std::unique_ptr<flatbuffers::Parser, PooledParserDeleter> PooledParser;
+
+// Get the parser used by every request with schema to generate the JSON of
+// a request. The parser is shared between threads, so it must only be used
+// in ways that don't modify it, such as flatbuffers::GenerateText().
+const flatbuffers::Parser& GetRequestJsonParser(const char* schema);
+
+// Borrow a parser that has compiled schema to parse the JSON of a response.
+// Parsers are reused by later responses once they are returned to the pool
+// by destroying the PooledParser.
+PooledParser AcquireResponseJsonParser(const char* schema);
+
+}  // namespace rest
+}  // namespace firebase
+
+#endif  // FIREBASE_APP_REST_JSON_SCHEMA_CACHE_H_
@@ -20,6 +20,7 @@
 #include <cassert>
 #include <string>
 
+#include "app/rest/json_schema_cache.h"
 #include "app/rest/request.h"
 #include "app/rest/util.h"
 #include "app/src/assert.h"
@@ -38,16 +39,11 @@ namespace rest {
 template <typename FbsType, typename FbsTypeT>
 class RequestJson : public Request {
  public:
-  // Constructs from a FlatBuffer schema, which should match FbsType.
-  explicit RequestJson(const char* schema) : application_data_(new FbsTypeT()) {
-    flatbuffers::IDLOptions fbs_options;
-    fbs_options.skip_unexpected_fields_in_json = true;
-    fbs_options.strict_json = true;
-    parser_.reset(new flatbuffers::Parser(fbs_options));
-
-    bool parse_status = parser_->Parse(schema);
-    FIREBASE_ASSERT_MESSAGE(parse_status, parser_->error_.c_str());
-
+  // Constructs from a FlatBuffer schema, which should match FbsType. The
+  // schema is compiled by the first request that uses it.
+  explicit RequestJson(const char* schema)
+      : parser_(&GetRequestJsonParser(schema)),
+        application_data_(new FbsTypeT()) {
     set_method(util::kPost);
     add_header(util::kContentType, util::kApplicationJson);
   }
@@ -72,8 +68,9 @@ class RequestJson : public Request {
     set_post_fields(json.c_str());
   }
 
-  // The FlatBuffer parser used to prepare the request JSON string.
-  flatbuffers::unique_ptr<flatbuffers::Parser> parser_;
+  // The FlatBuffer parser used to prepare the request JSON string, which is
+  // shared by every request with the same schema.
+  const flatbuffers::Parser* parser_;
 
   // The application data in a request is stored here.
   flatbuffers::unique_ptr<FbsTypeT> application_data_;
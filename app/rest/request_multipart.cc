@@ -0,0 +1,111 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "app/rest/request_multipart.h"
+
+#include <cassert>
+#include <cstring>
+#include <random>
+
+#include "app/rest/util.h"
+
+namespace firebase {
+namespace rest {
+
+namespace {
+
+const char kDefaultContentType[] = "application/octet-stream";
+const char kJsonContentType[] = "application/json; charset=utf-8";
+
+// Generate a boundary that is very unlikely to occur in the content.
+std::string GenerateBoundary() {
+  static const char kDigits[] = "0123456789abcdef";
+  std::random_device device;
+  std::mt19937 generator(device());
+  std::uniform_int_distribution<int> digit(0, 15);
+  std::string boundary("firebase-");
+  for (int i = 0; i < 32; ++i) boundary += kDigits[digit(generator)];
+  return boundary;
+}
+
+}  // namespace
+
+RequestMultipart::RequestMultipart(const std::string& json,
+                                   const char* content_type, Request* content)
+    : boundary_(GenerateBoundary()),
+      content_(content),
+      header_offset_(0),
+      trailer_offset_(0),
+      content_complete_(false) {
+  if (!content_type || *content_type == '\0') {
+    content_type = kDefaultContentType;
+  }
+  header_ = "--" + boundary_ + util::kCrLf;
+  header_ += std::string("Content-Type: ") + kJsonContentType + util::kCrLf;
+  header_ += util::kCrLf;
+  header_ += json;
+  header_ += util::kCrLf;
+  header_ += "--" + boundary_ + util::kCrLf;
+  header_ += std::string("Content-Type: ") + content_type + util::kCrLf;
+  header_ += util::kCrLf;
+  trailer_ = util::kCrLf;
+  trailer_ += "--" + boundary_ + "--";
+  options_.stream_post_fields = true;
+}
+
+// This object will assert if post fields are set.
+void RequestMultipart::set_post_fields(const char* /*data*/,
+                                       size_t /*size*/) {
+  assert(false);
+}
+
+void RequestMultipart::set_post_fields(const char* /*data*/) { assert(false); }
+
+size_t RequestMultipart::GetPostFieldsSize() const {
+  size_t content_size = content_->GetPostFieldsSize();
+  if (content_size == ~static_cast<size_t>(0)) return content_size;
+  return header_.size() + content_size + trailer_.size();
+}
+
+size_t RequestMultipart::ReadBody(char* buffer, size_t length, bool* abort) {
+  *abort = false;
+  size_t read_size = ReadPart(header_, &header_offset_, buffer, length);
+  if (read_size) return read_size;
+  if (!content_complete_) {
+    if (content_->GetPostFieldsSize() != 0) {
+      read_size = content_->ReadBody(buffer, length, abort);
+      if (read_size || *abort) return read_size;
+    }
+    content_complete_ = true;
+  }
+  return ReadPart(trailer_, &trailer_offset_, buffer, length);
+}
+
+std::string RequestMultipart::GetContentType() const {
+  return "multipart/related; boundary=" + boundary_;
+}
+
+size_t RequestMultipart::ReadPart(const std::string& part, size_t* part_offset,
+                                  char* buffer, size_t length) {
+  size_t read_size = part.size() - *part_offset;
+  if (read_size > length) read_size = length;
+  if (read_size) memcpy(buffer, part.data() + *part_offset, read_size);
+  *part_offset += read_size;
+  return read_size;
+}
+
+}  // namespace rest
+}  // namespace firebase
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIREBASE_APP_REST_REQUEST_MULTIPART_H_
+#define FIREBASE_APP_REST_REQUEST_MULTIPART_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "app/rest/request.h"
+
+namespace firebase {
+namespace rest {
+
+// Request whose body is a multipart/related document with two parts, a JSON
+// document followed by the body of another request. The content is streamed
+// from the other request rather than copied.
+class RequestMultipart : public Request {
+ public:
+  // Create a request that sends json followed by the body of content, which
+  // has the MIME type content_type. Takes ownership of content.
+  RequestMultipart(const std::string& json, const char* content_type,
+                   Request* content);
+
+  // This object will assert if post fields are set.
+  void set_post_fields(const char* data, size_t size) override;
+  void set_post_fields(const char* data) override;
+
+  // Get the size of the body, or ~0 if the size of the content is unknown.
+  size_t GetPostFieldsSize() const override;
+
+  // Read the next part of the body.
+  size_t ReadBody(char* buffer, size_t length, bool* abort) override;
+
+  // Value of the Content-Type header for this request.
+  std::string GetContentType() const;
+
+  // Boundary that separates the parts of the body.
+  const std::string& boundary() const { return boundary_; }
+
+ private:
+  // Copy from part starting at *part_offset into buffer.
+  static size_t ReadPart(const std::string& part, size_t* part_offset,
+                         char* buffer, size_t length);
+
+  std::string boundary_;
+  // Everything in the body before the content.
+  std::string header_;
+  // Everything in the body after the content.
+  std::string trailer_;
+  std::unique_ptr<Request> content_;
+  size_t header_offset_;
+  size_t trailer_offset_;
+  bool content_complete_;
+};
+
+}  // namespace rest
+}  // namespace firebase
+
+#endif  // FIREBASE_APP_REST_REQUEST_MULTIPART_H_
@@ -22,6 +22,8 @@
 #include <map>
 #include <string>
 
+#include "app/rest/transfer_timing.h"
+
 namespace firebase {
 namespace rest {
 
@@ -33,7 +35,8 @@ struct RequestOptions {
       : method("GET"),
         stream_post_fields(false),
         timeout_ms(300000),  // Same timeout used by Chromium.
-        verbose(false) {}
+        verbose(false),
+        category(kTransferCategoryOther) {}
 
   // The URL to use in the request.
   std::string url;
@@ -54,6 +57,9 @@ struct RequestOptions {
   // Set true to make the library display more verbose info to help debug. Does
   // not really affect the connection.
   bool verbose;
+
+  // Product issuing the request, used to aggregate transfer timing.
+  TransferCategory category;
 };
 
 }  // namespace rest
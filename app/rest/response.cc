@@ -68,6 +68,18 @@ bool Response::ProcessBody(const char* buffer, size_t length) {
   return true;
 }
 
+void Response::Clear() {
+  status_ = 0;
+  header_completed_ = false;
+  body_completed_ = false;
+  sdk_error_code_ = 0;
+  fetch_time_ = 0;
+  header_.clear();
+  body_.clear();
+  body_cache_.clear();
+  timing_ = TransferTiming();
+}
+
 const char* Response::GetHeader(const char* name) {
   auto iter = header_.find(name);
   if (iter == header_.end()) {
@@ -25,6 +25,7 @@
 #include <vector>
 
 #include "app/rest/transfer_interface.h"
+#include "app/rest/transfer_timing.h"
 #include "app/rest/util.h"
 
 namespace firebase {
@@ -50,7 +51,8 @@ class Response : public Transfer {
         fetch_time_(std::move(rhs.fetch_time_)),              // NOLINT
         header_(std::move(rhs.header_)),
         body_(std::move(rhs.body_)),
-        body_cache_(std::move(rhs.body_cache_)) {}
+        body_cache_(std::move(rhs.body_cache_)),
+        timing_(std::move(rhs.timing_)) {}
 
   // Process headers. Return false when it fails and will interrupt the request.
   virtual bool ProcessHeader(const char* buffer, size_t length);
@@ -76,12 +78,19 @@ class Response : public Transfer {
     body_completed_ = false;
   }
 
+  // Reset the response so it can be used for another transfer. The memory of
+  // the body is kept for the next transfer.
+  void Clear();
+
   // Getters.
   int status() const { return status_; }
   bool header_completed() const { return header_completed_; }
   bool body_completed() const { return body_completed_; }
   int sdk_error_code() const { return sdk_error_code_; }
   std::time_t fetch_time() const { return fetch_time_; }
+  // Timing of the transfer that produced this response, valid once the
+  // transfer is complete.
+  const TransferTiming& timing() const { return timing_; }
 
   // Setters.
   void set_status(int status) { status_ = status; }
@@ -90,6 +99,8 @@ class Response : public Transfer {
     sdk_error_code_ = sdk_error_code;
   }
 
+  void set_timing(const TransferTiming& timing) { timing_ = timing; }
+
   // Get the field value for the specific field name in header. If no such field
   // is found in the header, return nullptr.
   const char* GetHeader(const char* name);
@@ -116,6 +127,8 @@ class Response : public Transfer {
   // Stores body in pieces and as a whole.
   std::vector<std::string> body_;
   mutable std::string body_cache_;
+  // Timing of the transfer.
+  TransferTiming timing_;
 };
 
 }  // namespace rest
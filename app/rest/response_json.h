@@ -22,6 +22,7 @@
 #include <string>
 #include <utility>
 
+#include "app/rest/json_schema_cache.h"
 #include "app/rest/response.h"
 #include "app/src/assert.h"
 #include "app/src/log.h"
@@ -39,15 +40,10 @@ namespace rest {
 template <typename FbsType, typename FbsTypeT>
 class ResponseJson : public Response {
  public:
-  // Constructs from a FlatBuffer schema, which should match FbsType.
-  explicit ResponseJson(const char* schema) {
-    flatbuffers::IDLOptions fbs_options;
-    fbs_options.skip_unexpected_fields_in_json = true;
-    parser_.reset(new flatbuffers::Parser(fbs_options));
-
-    bool parse_status = parser_->Parse(schema);
-    FIREBASE_ASSERT_MESSAGE(parse_status, parser_->error_.c_str());
-  }
+  // Constructs from a FlatBuffer schema, which should match FbsType. The
+  // schema is compiled by the first response that uses it.
+  explicit ResponseJson(const char* schema)
+      : parser_(AcquireResponseJsonParser(schema)) {}
 
   // Constructs from a FlatBuffer schema, which should match FbsType.
   explicit ResponseJson(const unsigned char* schema)
@@ -111,8 +107,9 @@ class ResponseJson : public Response {
   }
 
  protected:
-  // The FlatBuffer parser used to parse the response JSON string.
-  flatbuffers::unique_ptr<flatbuffers::Parser> parser_;
+  // The FlatBuffer parser used to parse the response JSON string, which is
+  // returned to the pool of its schema when the response is destroyed.
+  PooledParser parser_;
 
   // The application data in a response is stored here.
   flatbuffers::unique_ptr<FbsTypeT> application_data_;
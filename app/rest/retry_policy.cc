@@ -0,0 +1,277 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "app/rest/retry_policy.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "app/rest/util.h"
+#include "app/src/time.h"
+#include "curl/curl.h"
+
+namespace firebase {
+namespace rest {
+
+namespace {
+
+// Guards g_random_engine.
+Mutex* g_random_mutex = new Mutex();
+std::minstd_rand* g_random_engine = nullptr;
+
+// Get a uniformly distributed value in [0, 1).
+double RandomUnit() {
+  MutexLock lock(*g_random_mutex);
+  if (!g_random_engine) {
+    g_random_engine = new std::minstd_rand(std::random_device()());
+  }
+  return std::uniform_real_distribution<double>(0.0, 1.0)(*g_random_engine);
+}
+
+// Cancel a scheduled callback, if one was scheduled.
+void CancelTimer(scheduler::RequestHandle* handle) {
+  if (handle->IsValid()) handle->Cancel();
+}
+
+}  // namespace
+
+bool IsRetryableHttpStatus(int http_status) {
+  return http_status == util::HttpInvalid ||
+         http_status == util::HttpRequestTimeout ||
+         http_status == util::HttpTooManyRequests ||
+         (http_status >= 500 && http_status < 600);
+}
+
+int64_t ParseRetryAfterMilliseconds(const char* value, std::time_t now) {
+  if (!value) return -1;
+  while (isspace(*value)) value++;
+  if (!*value) return -1;
+  if (isdigit(*value)) {
+    char* end = nullptr;
+    long long seconds = strtoll(value, &end, 10);  // NOLINT
+    while (isspace(*end)) end++;
+    if (*end) return -1;
+    return static_cast<int64_t>(seconds) * 1000;
+  }
+  std::time_t retry_time = curl_getdate(value, nullptr /* unused */);
+  if (retry_time < 0) return -1;
+  return retry_time > now ? static_cast<int64_t>(retry_time - now) * 1000 : 0;
+}
+
+int64_t RetryPolicy::GetBackoffMilliseconds(int retry, double random) const {
+  double backoff = static_cast<double>(initial_backoff_ms);
+  for (int i = 1; i < retry && backoff < max_backoff_ms; ++i) {
+    backoff *= backoff_multiplier;
+  }
+  backoff = (std::min)(backoff, static_cast<double>(max_backoff_ms));
+  backoff *= 1.0 - jitter + 2.0 * jitter * random;
+  return backoff > 0 ? static_cast<int64_t>(backoff) : 0;
+}
+
+const int RetryCall::kAbortedAttempt;
+
+RetryScheduler::RetryScheduler() : shut_down_(false) {}
+
+RetryScheduler::~RetryScheduler() { Shutdown(); }
+
+void RetryScheduler::Shutdown() {
+  std::vector<std::shared_ptr<RetryCall>> calls;
+  {
+    MutexLock lock(mutex_);
+    if (shut_down_) return;
+    shut_down_ = true;
+    for (auto& entry : calls_) calls.push_back(entry.second);
+  }
+  scheduler_.CancelAllAndShutdownWorkerThread();
+  // Each call removes itself from calls_ as it's aborted.
+  for (auto& call : calls) call->Abort();
+}
+
+bool RetryScheduler::Register(const std::shared_ptr<RetryCall>& call) {
+  MutexLock lock(mutex_);
+  if (shut_down_) return false;
+  calls_[call.get()] = call;
+  return true;
+}
+
+void RetryScheduler::Unregister(RetryCall* call) {
+  std::shared_ptr<RetryCall> released;
+  {
+    MutexLock lock(mutex_);
+    auto it = calls_.find(call);
+    if (it == calls_.end()) return;
+    // The call may be destroyed when this reference is released, which must
+    // happen without holding mutex_.
+    released = std::move(it->second);
+    calls_.erase(it);
+  }
+}
+
+RetryCall::RetryCall(const RetryPolicy& policy,
+                     std::shared_ptr<RetryScheduler> scheduler,
+                     StartAttemptFunction start_attempt,
+                     CompleteFunction complete,
+                     CancelAttemptFunction cancel_attempt)
+    : policy_(policy),
+      scheduler_(std::move(scheduler)),
+      start_attempt_(std::move(start_attempt)),
+      complete_(std::move(complete)),
+      cancel_attempt_(std::move(cancel_attempt)),
+      start_time_ms_(internal::GetTimestamp()),
+      attempts_started_(0),
+      in_flight_attempt_(-1),
+      retries_(0),
+      complete_called_(false),
+      canceled_(false) {
+  assert(scheduler_);
+  assert(start_attempt_);
+}
+
+std::shared_ptr<RetryCall> RetryCall::Start(
+    const RetryPolicy& policy, std::shared_ptr<RetryScheduler> scheduler,
+    StartAttemptFunction start_attempt, CompleteFunction complete,
+    CancelAttemptFunction cancel_attempt) {
+  std::shared_ptr<RetryCall> call(
+      new RetryCall(policy, std::move(scheduler), std::move(start_attempt),
+                    std::move(complete), std::move(cancel_attempt)));
+  if (call->scheduler_->Register(call)) {
+    call->StartAttempt();
+  } else {
+    call->Abort();
+  }
+  return call;
+}
+
+void RetryCall::StartAttempt() {
+  int attempt;
+  {
+    MutexLock lock(mutex_);
+    // The scheduler holds a lock on a timer while it runs, so the handle of a
+    // timer that has fired is discarded rather than canceled later.
+    retry_timer_ = scheduler::RequestHandle();
+    if (complete_called_ || canceled_) return;
+    attempt = attempts_started_++;
+    in_flight_attempt_ = attempt;
+  }
+  start_attempt_(shared_from_this(), attempt);
+}
+
+void RetryCall::AttemptComplete(int attempt, int http_status,
+                                const char* retry_after) {
+  scheduler::RequestHandle timer;
+  {
+    MutexLock lock(mutex_);
+    if (complete_called_ || canceled_ || attempt != in_flight_attempt_) return;
+    in_flight_attempt_ = -1;
+
+    if (policy_.is_retryable(http_status)) {
+      int64_t delay_ms =
+          policy_.GetBackoffMilliseconds(retries_ + 1, RandomUnit());
+      if (policy_.honor_retry_after && retry_after) {
+        int64_t retry_after_ms =
+            ParseRetryAfterMilliseconds(retry_after, std::time(nullptr));
+        delay_ms = (std::max)(delay_ms, retry_after_ms);
+      }
+      int64_t elapsed_ms =
+          static_cast<int64_t>(internal::GetTimestamp() - start_time_ms_);
+      if ((!policy_.max_attempts ||
+           attempts_started_ < policy_.max_attempts) &&
+          elapsed_ms + delay_ms <= policy_.max_retry_time_ms) {
+        retries_++;
+        retry_timer_ = ScheduleAttempt(delay_ms);
+        return;
+      }
+    }
+    FinishLocked(&timer);
+  }
+  Finished(-1, &timer);
+  if (complete_) complete_(attempt, http_status);
+}
+
+int RetryCall::FinishLocked(scheduler::RequestHandle* timer) {
+  complete_called_ = true;
+  *timer = retry_timer_;
+  retry_timer_ = scheduler::RequestHandle();
+  int attempt_to_cancel = in_flight_attempt_;
+  in_flight_attempt_ = -1;
+  return attempt_to_cancel;
+}
+
+void RetryCall::Finished(int attempt_to_cancel,
+                         scheduler::RequestHandle* timer) {
+  // Keep the call alive until this returns, as the scheduler may hold the
+  // last reference to it.
+  std::shared_ptr<RetryCall> self = shared_from_this();
+  CancelTimer(timer);
+  if (cancel_attempt_ && attempt_to_cancel >= 0) {
+    cancel_attempt_(attempt_to_cancel);
+  }
+  scheduler_->Unregister(this);
+}
+
+scheduler::RequestHandle RetryCall::ScheduleAttempt(int64_t delay_ms) {
+  // The timer doesn't keep the call alive, since the call is kept alive by its
+  // scheduler until it finishes.
+  std::weak_ptr<RetryCall> weak_self = shared_from_this();
+  return scheduler_->scheduler_.Schedule(
+      [weak_self]() {
+        std::shared_ptr<RetryCall> self = weak_self.lock();
+        if (self) self->StartAttempt();
+      },
+      static_cast<scheduler::ScheduleTimeMs>(delay_ms));
+}
+
+void RetryCall::Cancel() {
+  int attempt_to_cancel;
+  scheduler::RequestHandle timer;
+  {
+    MutexLock lock(mutex_);
+    if (complete_called_ || canceled_) return;
+    attempt_to_cancel = FinishLocked(&timer);
+    canceled_ = true;
+  }
+  Finished(attempt_to_cancel, &timer);
+}
+
+void RetryCall::Abort() {
+  int attempt_to_cancel;
+  scheduler::RequestHandle timer;
+  {
+    MutexLock lock(mutex_);
+    if (complete_called_ || canceled_) return;
+    attempt_to_cancel = FinishLocked(&timer);
+  }
+  Finished(attempt_to_cancel, &timer);
+  if (complete_) complete_(kAbortedAttempt, util::HttpInvalid);
+}
+
+bool RetryCall::is_complete() const {
+  MutexLock lock(mutex_);
+  return complete_called_ || canceled_;
+}
+
+int RetryCall::attempt_count() const {
+  MutexLock lock(mutex_);
+  return attempts_started_;
+}
+
+}  // namespace rest
+}  // namespace firebase
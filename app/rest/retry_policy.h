@@ -0,0 +1,207 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIREBASE_APP_REST_RETRY_POLICY_H_
+#define FIREBASE_APP_REST_RETRY_POLICY_H_
+
+#include <stdint.h>
+
+#include <ctime>
+#include <functional>
+#include <map>
+#include <memory>
+
+#include "app/src/include/firebase/internal/mutex.h"
+#include "app/src/scheduler.h"
+
+namespace firebase {
+namespace rest {
+
+// Returns whether a HTTP status indicates a transient failure that may succeed
+// if the request is sent again. Status 0 (no response) is retryable.
+bool IsRetryableHttpStatus(int http_status);
+
+// Parse the value of a Retry-After header, which is either a number of seconds
+// or a HTTP date, into a delay in milliseconds relative to now.
+// Returns -1 if the value can't be parsed.
+int64_t ParseRetryAfterMilliseconds(const char* value, std::time_t now);
+
+// Describes how a REST call is retried.
+struct RetryPolicy {
+  RetryPolicy()
+      : max_attempts(0),
+        initial_backoff_ms(1000),
+        max_backoff_ms(30000),
+        backoff_multiplier(2.0),
+        jitter(0.5),
+        max_retry_time_ms(120000),
+        honor_retry_after(true),
+        is_retryable(IsRetryableHttpStatus) {}
+
+  // Get the delay before a retry, where retry is 1 for the first retry and
+  // random is a uniformly distributed value in [0, 1).
+  // With a jitter of J the delay is scaled by a factor in [1 - J, 1 + J).
+  int64_t GetBackoffMilliseconds(int retry, double random) const;
+
+  // Maximum number of attempts, including the first, or 0 for no limit other
+  // than max_retry_time_ms.
+  int max_attempts;
+  // Delay before the first retry.
+  int64_t initial_backoff_ms;
+  // Upper bound of the delay between retries.
+  int64_t max_backoff_ms;
+  // Factor the delay grows by after each retry.
+  double backoff_multiplier;
+  // Fraction of the delay to randomize, in [0, 1].
+  double jitter;
+  // No retry is scheduled that would start after this much time has passed
+  // since the call started.
+  int64_t max_retry_time_ms;
+  // Whether to wait for the delay requested by a Retry-After header, when it
+  // is longer than the backoff.
+  bool honor_retry_after;
+  // Determines whether a HTTP status should be retried.
+  bool (*is_retryable)(int http_status);
+};
+
+class RetryCall;
+
+// Times the retries of RetryCalls. Each call keeps its
+// scheduler alive, and the scheduler keeps each call alive until it finishes.
+// Shutting down the scheduler aborts the calls that haven't finished, so that
+// none is left waiting for a timer that will never fire.
+class RetryScheduler {
+ public:
+  RetryScheduler();
+  // Shuts down the scheduler.
+  ~RetryScheduler();
+
+  RetryScheduler(const RetryScheduler&) = delete;
+  RetryScheduler& operator=(const RetryScheduler&) = delete;
+
+  // Stop running timers and abort every call that hasn't finished. Calls
+  // started afterwards are aborted as soon as they start.
+  void Shutdown();
+
+ private:
+  friend class RetryCall;
+
+  // Track call until it finishes. Returns false if the scheduler has been
+  // shut down.
+  bool Register(const std::shared_ptr<RetryCall>& call);
+  void Unregister(RetryCall* call);
+
+  Mutex mutex_;
+  scheduler::Scheduler scheduler_;
+  bool shut_down_;
+  // Calls that haven't finished.
+  std::map<RetryCall*, std::shared_ptr<RetryCall>> calls_;
+};
+
+// Drives the attempts of one REST call according to a RetryPolicy.
+// Retries are started from a scheduler rather than by blocking a thread.
+//
+// The owner supplies a function to start an attempt, which must eventually
+// report its outcome through AttemptComplete() from any thread. Once the call
+// finishes the complete function is called exactly once with the winning
+// attempt, or with kAbortedAttempt if the call is aborted, unless the call is
+// canceled.
+class RetryCall : public std::enable_shared_from_this<RetryCall> {
+ public:
+  // Passed to the complete function in place of an attempt when the call is
+  // aborted.
+  static const int kAbortedAttempt = -1;
+
+  // Starts attempt number attempt (0 for the first attempt) of call.
+  typedef std::function<void(const std::shared_ptr<RetryCall>& call,
+                             int attempt)>
+      StartAttemptFunction;
+  // Cancels an attempt that is still in flight when the call is canceled or
+  // aborted.
+  typedef std::function<void(int attempt)> CancelAttemptFunction;
+  // Called when the call finishes with the attempt whose result should be used
+  // and its HTTP status.
+  typedef std::function<void(int attempt, int http_status)> CompleteFunction;
+
+  // Create a call and start the first attempt.
+  static std::shared_ptr<RetryCall> Start(
+      const RetryPolicy& policy, std::shared_ptr<RetryScheduler> scheduler,
+      StartAttemptFunction start_attempt,
+      CompleteFunction complete,
+      CancelAttemptFunction cancel_attempt = CancelAttemptFunction());
+
+  // Report the outcome of an attempt. retry_after is the value of the
+  // Retry-After response header or nullptr.
+  void AttemptComplete(int attempt, int http_status, const char* retry_after);
+
+  // Stop the call, canceling pending retries without calling complete.
+  void Cancel();
+
+  // Stop the call like Cancel(), but call complete with kAbortedAttempt if the
+  // call hadn't finished.
+  void Abort();
+
+  // Whether the call has finished or was canceled.
+  bool is_complete() const;
+
+  // Number of attempts started so far.
+  int attempt_count() const;
+
+ private:
+  RetryCall(const RetryPolicy& policy,
+            std::shared_ptr<RetryScheduler> scheduler,
+            StartAttemptFunction start_attempt, CompleteFunction complete,
+            CancelAttemptFunction cancel_attempt);
+
+  // Start the next attempt. Must be called without holding mutex_.
+  void StartAttempt();
+
+  // Mark the call finished, returning the attempt still in flight that should
+  // be canceled or -1, and the pending retry timer. The timer must be canceled
+  // after releasing mutex_ as the scheduler holds a lock on a timer while
+  // running it.
+  int FinishLocked(scheduler::RequestHandle* timer);
+
+  // Cancel the timer and attempt returned by FinishLocked() and stop tracking
+  // the call. Must be called without holding mutex_.
+  void Finished(int attempt_to_cancel, scheduler::RequestHandle* timer);
+
+  // Schedule StartAttempt() after delay_ms.
+  scheduler::RequestHandle ScheduleAttempt(int64_t delay_ms);
+
+  mutable Mutex mutex_;
+  RetryPolicy policy_;
+  std::shared_ptr<RetryScheduler> scheduler_;
+  StartAttemptFunction start_attempt_;
+  CompleteFunction complete_;
+  CancelAttemptFunction cancel_attempt_;
+  // Time the call started in milliseconds.
+  uint64_t start_time_ms_;
+  // Number of attempts started.
+  int attempts_started_;
+  // Attempt that has been started but not completed or -1.
+  int in_flight_attempt_;
+  // Number of retries (attempts started after a failure).
+  int retries_;
+  bool complete_called_;
+  bool canceled_;
+  scheduler::RequestHandle retry_timer_;
+};
+
+}  // namespace rest
+}  // namespace firebase
+
+#endif  // FIREBASE_APP_REST_RETRY_POLICY_H_
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "app/rest/json_schema_cache.h"
+
+#include <string>
+#include <vector>
+
+#include "app/rest/sample_generated.h"
+#include "app/rest/sample_resource.h"
+#include "app/src/thread.h"
+#include "flatbuffers/idl.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace rest {
+namespace {
+
+// Parse a Sample response with parser, returning its number or -1 on failure.
+int ParseSampleNumber(flatbuffers::Parser* parser, int number) {
+  std::string json = "{\"token\": \"abc\", \"number\": " +
+                     std::to_string(number) + "}";
+  if (!parser->Parse(json.c_str())) return -1;
+  const Sample* sample =
+      flatbuffers::GetRoot<Sample>(parser->builder_.GetBufferPointer());
+  return sample->token()->str() == "abc" ? sample->number() : -1;
+}
+
+}  // namespace
+
+TEST(JsonSchemaCacheTest, RequestsShareParser) {
+  const flatbuffers::Parser& parser =
+      GetRequestJsonParser(sample_resource_data);
+  EXPECT_EQ(&parser, &GetRequestJsonParser(sample_resource_data));
+}
+
+TEST(JsonSchemaCacheTest, ResponseParserIsReused) {
+  flatbuffers::Parser* first;
+  {
+    PooledParser parser = AcquireResponseJsonParser(sample_resource_data);
+    first = parser.get();
+    EXPECT_EQ(1, ParseSampleNumber(parser.get(), 1));
+  }
+  PooledParser parser = AcquireResponseJsonParser(sample_resource_data);
+  EXPECT_EQ(first, parser.get());
+  // The parser is returned without the previous response.
+  EXPECT_EQ(0u, parser->builder_.GetSize());
+  EXPECT_EQ(2, ParseSampleNumber(parser.get(), 2));
+}
+
+TEST(JsonSchemaCacheTest, ResponsesInProgressUseDifferentParsers) {
+  PooledParser parser1 = AcquireResponseJsonParser(sample_resource_data);
+  PooledParser parser2 = AcquireResponseJsonParser(sample_resource_data);
+  EXPECT_NE(parser1.get(), parser2.get());
+  EXPECT_EQ(1, ParseSampleNumber(parser1.get(), 1));
+  EXPECT_EQ(2, ParseSampleNumber(parser2.get(), 2));
+}
+
+TEST(JsonSchemaCacheTest, FailedParserIsNotReused) {
+  PooledParser failed = AcquireResponseJsonParser(sample_resource_data);
+  PooledParser succeeded = AcquireResponseJsonParser(sample_resource_data);
+  EXPECT_FALSE(failed->Parse("{\"token\": "));
+  EXPECT_EQ(1, ParseSampleNumber(succeeded.get(), 1));
+  flatbuffers::Parser* succeeded_parser = succeeded.get();
+  succeeded.reset();
+  failed.reset();
+  // Only the parser that succeeded went back to the pool.
+  PooledParser parser = AcquireResponseJsonParser(sample_resource_data);
+  EXPECT_EQ(succeeded_parser, parser.get());
+  EXPECT_EQ(2, ParseSampleNumber(parser.get(), 2));
+}
+
+TEST(JsonSchemaCacheTest, ConcurrentResponses) {
+  const int kNumThreads = 8;
+  const int kResponsesPerThread = 200;
+  struct ThreadContext {
+    int thread_index;
+    int parsed;
+  } contexts[kNumThreads];
+  std::vector<Thread*> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    contexts[i].thread_index = i;
+    contexts[i].parsed = 0;
+    threads.push_back(new Thread(
+        [](ThreadContext* context) {
+          for (int j = 0; j < kResponsesPerThread; ++j) {
+            int number = context->thread_index * kResponsesPerThread + j;
+            PooledParser parser =
+                AcquireResponseJsonParser(sample_resource_data);
+            if (ParseSampleNumber(parser.get(), number) == number) {
+              context->parsed++;
+            }
+          }
+        },
+        &contexts[i]));
+  }
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads[i]->Join();
+    delete threads[i];
+    EXPECT_EQ(kResponsesPerThread, contexts[i].parsed);
+  }
+}
+
+}  // namespace rest
+}  // namespace firebase
@@ -70,5 +70,23 @@ TEST(RequestJsonTest, UpdatePostFields) {
       request.options().post_fields);
 }
 
+// Test that requests with the same schema generate JSON independently.
+TEST(RequestJsonTest, RequestsShareSchema) {
+  RequestSample first;
+  RequestSample second;
+  first.set_token("abc");
+  second.set_number(456);
+  EXPECT_EQ(
+      "{\n"
+      "  \"token\": \"abc\"\n"
+      "}\n",
+      first.options().post_fields);
+  EXPECT_EQ(
+      "{\n"
+      "  \"number\": 456\n"
+      "}\n",
+      second.options().post_fields);
+}
+
 }  // namespace rest
 }  // namespace firebase
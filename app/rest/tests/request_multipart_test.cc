@@ -0,0 +1,80 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "app/rest/request_multipart.h"
+
+#include <string>
+
+#include "app/rest/request_binary.h"
+#include "app/rest/tests/request_test.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace rest {
+namespace test {
+
+const char kJson[] = "{\"name\":\"object\"}";
+
+// Build the body expected for a request with the specified boundary.
+std::string ExpectedBody(const std::string& boundary,
+                         const std::string& content_type,
+                         const std::string& content) {
+  return "--" + boundary + "\r\n" +
+         "Content-Type: application/json; charset=utf-8\r\n\r\n" + kJson +
+         "\r\n--" + boundary + "\r\n" + "Content-Type: " + content_type +
+         "\r\n\r\n" + content + "\r\n--" + boundary + "--";
+}
+
+TEST(RequestMultipartTest, ReadBody) {
+  std::string content(kSmallBinary, sizeof(kSmallBinary));
+  RequestMultipart request(kJson, "image/png",
+                           new RequestBinary(content.data(), content.size()));
+  std::string expected =
+      ExpectedBody(request.boundary(), "image/png", content);
+  EXPECT_TRUE(request.options().stream_post_fields);
+  EXPECT_EQ(expected.size(), request.GetPostFieldsSize());
+  EXPECT_EQ(expected, ReadRequestBody(&request));
+}
+
+TEST(RequestMultipartTest, ReadLargeBody) {
+  std::string content = CreateLargeBinaryData();
+  RequestMultipart request(kJson, nullptr,
+                           new RequestBinary(content.data(), content.size()));
+  std::string expected =
+      ExpectedBody(request.boundary(), "application/octet-stream", content);
+  EXPECT_EQ(expected.size(), request.GetPostFieldsSize());
+  EXPECT_EQ(expected, ReadRequestBody(&request));
+}
+
+TEST(RequestMultipartTest, ReadEmptyContent) {
+  RequestMultipart request(kJson, "text/plain", new RequestBinary());
+  std::string expected = ExpectedBody(request.boundary(), "text/plain", "");
+  EXPECT_EQ(expected.size(), request.GetPostFieldsSize());
+  EXPECT_EQ(expected, ReadRequestBody(&request));
+}
+
+TEST(RequestMultipartTest, ContentType) {
+  RequestMultipart request(kJson, nullptr, new RequestBinary());
+  RequestMultipart other_request(kJson, nullptr, new RequestBinary());
+  EXPECT_NE(request.boundary(), other_request.boundary());
+  EXPECT_EQ("multipart/related; boundary=" + request.boundary(),
+            request.GetContentType());
+}
+
+}  // namespace test
+}  // namespace rest
+}  // namespace firebase
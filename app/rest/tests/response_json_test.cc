@@ -16,6 +16,7 @@
 
 #include "app/rest/response_json.h"
 
+#include <cstring>
 #include <utility>
 
 #include "app/rest/sample_generated.h"
@@ -128,5 +129,39 @@ TEST(ResponseJsonTest, NonStandardJsonResponse) {
   EXPECT_EQ(123, response.number());
 }
 
+// Test that responses with the same schema can reuse a parser, including one
+// that was used by a response that failed to parse.
+TEST(ResponseJsonTest, ReusesParsers) {
+  const char* bodies[] = {
+      "{ \"token\": \"abc\", \"number\": 1 }",
+      "{ \"token\": \"def\" }",
+      "{ \"token\": ",
+      "{ \"number\": 3 }",
+  };
+  for (int i = 0; i < 2; ++i) {
+    for (const char* body : bodies) {
+      ResponseSample response;
+      response.ProcessBody(body, strlen(body));
+      response.MarkCompleted();
+      EXPECT_TRUE(response.body_completed());
+    }
+  }
+  ResponseSample response;
+  const char body[] = "{ \"token\": \"ghi\", \"number\": 4 }";
+  response.ProcessBody(body, sizeof(body));
+  response.MarkCompleted();
+  EXPECT_EQ("ghi", response.token());
+  EXPECT_EQ(4, response.number());
+
+  // Parsers in use aren't shared.
+  ResponseSample other;
+  const char other_body[] = "{ \"token\": \"jkl\" }";
+  other.ProcessBody(other_body, sizeof(other_body));
+  other.MarkCompleted();
+  EXPECT_EQ("jkl", other.token());
+  EXPECT_EQ(0, other.number());
+  EXPECT_EQ("ghi", response.token());
+}
+
 }  // namespace rest
 }  // namespace firebase
@@ -98,5 +98,25 @@ TEST(ResponseTest, ProcessDateHeaderMissing) {
   EXPECT_LT(1499270119, response.fetch_time());
 }
 
+TEST(ResponseTest, Clear) {
+  Response response;
+  ProcessHeader("HTTP/1.1 200 OK\r\n", &response);
+  ProcessHeader("key: value\r\n", &response);
+  response.ProcessBody("body", 4);
+  response.MarkCompleted();
+  EXPECT_STREQ("body", response.GetBody());
+
+  response.Clear();
+  EXPECT_EQ(0, response.status());
+  EXPECT_EQ(0, response.fetch_time());
+  EXPECT_FALSE(response.header_completed());
+  EXPECT_FALSE(response.body_completed());
+  EXPECT_STREQ(nullptr, response.GetHeader("key"));
+  EXPECT_STREQ("", response.GetBody());
+
+  response.ProcessBody("other", 5);
+  EXPECT_STREQ("other", response.GetBody());
+}
+
 }  // namespace rest
 }  // namespace firebase
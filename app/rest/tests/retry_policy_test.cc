@@ -0,0 +1,209 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "app/rest/retry_policy.h"
+
+#include <memory>
+#include <vector>
+
+#include "app/src/include/firebase/internal/mutex.h"
+#include "app/src/scheduler.h"
+#include "app/src/semaphore.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace rest {
+
+TEST(RetryPolicyTest, IsRetryableHttpStatus) {
+  EXPECT_TRUE(IsRetryableHttpStatus(0));
+  EXPECT_TRUE(IsRetryableHttpStatus(408));
+  EXPECT_TRUE(IsRetryableHttpStatus(429));
+  EXPECT_TRUE(IsRetryableHttpStatus(500));
+  EXPECT_TRUE(IsRetryableHttpStatus(503));
+  EXPECT_FALSE(IsRetryableHttpStatus(200));
+  EXPECT_FALSE(IsRetryableHttpStatus(304));
+  EXPECT_FALSE(IsRetryableHttpStatus(404));
+}
+
+TEST(RetryPolicyTest, ParseRetryAfterSeconds) {
+  EXPECT_EQ(120000, ParseRetryAfterMilliseconds("120", 0));
+  EXPECT_EQ(5000, ParseRetryAfterMilliseconds(" 5 ", 0));
+  EXPECT_EQ(-1, ParseRetryAfterMilliseconds("5s", 0));
+  EXPECT_EQ(-1, ParseRetryAfterMilliseconds("", 0));
+  EXPECT_EQ(-1, ParseRetryAfterMilliseconds(nullptr, 0));
+}
+
+TEST(RetryPolicyTest, Backoff) {
+  RetryPolicy policy;
+  policy.initial_backoff_ms = 100;
+  policy.max_backoff_ms = 1000;
+  policy.backoff_multiplier = 2.0;
+  policy.jitter = 0.0;
+  EXPECT_EQ(100, policy.GetBackoffMilliseconds(1, 0.5));
+  EXPECT_EQ(200, policy.GetBackoffMilliseconds(2, 0.5));
+  EXPECT_EQ(800, policy.GetBackoffMilliseconds(4, 0.5));
+  EXPECT_EQ(1000, policy.GetBackoffMilliseconds(5, 0.5));
+  EXPECT_EQ(1000, policy.GetBackoffMilliseconds(100, 0.5));
+}
+
+TEST(RetryPolicyTest, BackoffJitter) {
+  RetryPolicy policy;
+  policy.initial_backoff_ms = 1000;
+  policy.jitter = 0.5;
+  EXPECT_EQ(500, policy.GetBackoffMilliseconds(1, 0.0));
+  EXPECT_EQ(1000, policy.GetBackoffMilliseconds(1, 0.5));
+  EXPECT_EQ(1499, policy.GetBackoffMilliseconds(1, 0.999));
+}
+
+class RetryCallTest : public ::testing::Test {
+ protected:
+  RetryCallTest()
+      : complete_semaphore_(0), completed_attempt_(-1), completed_status_(-1) {
+    policy_.initial_backoff_ms = 1;
+    policy_.max_backoff_ms = 10;
+    policy_.max_retry_time_ms = 10000;
+  }
+
+  // Abort unfinished calls while the state they complete into is still alive.
+  ~RetryCallTest() override { scheduler_->Shutdown(); }
+
+  // Start a call that completes each attempt with the next status from
+  // statuses. Attempts beyond the end of statuses are left in flight.
+  std::shared_ptr<RetryCall> StartCall(const std::vector<int>& statuses) {
+    statuses_ = statuses;
+    return RetryCall::Start(
+        policy_, scheduler_,
+        [this](const std::shared_ptr<RetryCall>& call, int attempt) {
+          {
+            MutexLock lock(mutex_);
+            started_.push_back(attempt);
+          }
+          if (attempt < static_cast<int>(statuses_.size())) {
+            call->AttemptComplete(attempt, statuses_[attempt], nullptr);
+          }
+        },
+        [this](int attempt, int status) {
+          completed_attempt_ = attempt;
+          completed_status_ = status;
+          complete_semaphore_.Post();
+        },
+        [this](int attempt) {
+          MutexLock lock(mutex_);
+          canceled_.push_back(attempt);
+        });
+  }
+
+  RetryPolicy policy_;
+  std::shared_ptr<RetryScheduler> scheduler_ =
+      std::make_shared<RetryScheduler>();
+  Semaphore complete_semaphore_;
+  Mutex mutex_;
+  std::vector<int> statuses_;
+  std::vector<int> started_;
+  std::vector<int> canceled_;
+  int completed_attempt_;
+  int completed_status_;
+};
+
+TEST_F(RetryCallTest, SucceedsWithoutRetry) {
+  auto call = StartCall({200});
+  EXPECT_TRUE(complete_semaphore_.TimedWait(1000));
+  EXPECT_TRUE(call->is_complete());
+  EXPECT_EQ(1, call->attempt_count());
+  EXPECT_EQ(0, completed_attempt_);
+  EXPECT_EQ(200, completed_status_);
+}
+
+TEST_F(RetryCallTest, RetriesTransientFailures) {
+  auto call = StartCall({503, 429, 200});
+  EXPECT_TRUE(complete_semaphore_.TimedWait(1000));
+  EXPECT_EQ(3, call->attempt_count());
+  EXPECT_EQ(2, completed_attempt_);
+  EXPECT_EQ(200, completed_status_);
+}
+
+TEST_F(RetryCallTest, DoesNotRetryPermanentFailures) {
+  auto call = StartCall({404, 200});
+  EXPECT_TRUE(complete_semaphore_.TimedWait(1000));
+  EXPECT_EQ(1, call->attempt_count());
+  EXPECT_EQ(404, completed_status_);
+}
+
+TEST_F(RetryCallTest, StopsAtMaxAttempts) {
+  policy_.max_attempts = 2;
+  auto call = StartCall({500, 500, 200});
+  EXPECT_TRUE(complete_semaphore_.TimedWait(1000));
+  EXPECT_EQ(2, call->attempt_count());
+  EXPECT_EQ(1, completed_attempt_);
+  EXPECT_EQ(500, completed_status_);
+}
+
+TEST_F(RetryCallTest, StopsAtMaxRetryTime) {
+  policy_.initial_backoff_ms = 1000;
+  policy_.max_backoff_ms = 1000;
+  policy_.jitter = 0;
+  policy_.max_retry_time_ms = 500;
+  auto call = StartCall({500, 200});
+  EXPECT_TRUE(complete_semaphore_.TimedWait(1000));
+  EXPECT_EQ(1, call->attempt_count());
+  EXPECT_EQ(500, completed_status_);
+}
+
+TEST_F(RetryCallTest, Cancel) {
+  policy_.initial_backoff_ms = 10000;
+  auto call = StartCall({500});
+  call->Cancel();
+  EXPECT_TRUE(call->is_complete());
+  EXPECT_FALSE(complete_semaphore_.TimedWait(100));
+  EXPECT_EQ(1, call->attempt_count());
+}
+
+TEST_F(RetryCallTest, ShutdownAbortsPendingRetry) {
+  policy_.initial_backoff_ms = 10000;
+  auto call = StartCall({500});
+  scheduler_->Shutdown();
+  EXPECT_TRUE(complete_semaphore_.TimedWait(1000));
+  EXPECT_TRUE(call->is_complete());
+  EXPECT_EQ(RetryCall::kAbortedAttempt, completed_attempt_);
+  EXPECT_EQ(1, call->attempt_count());
+}
+
+TEST_F(RetryCallTest, ShutdownAbortsInFlightAttempt) {
+  auto call = StartCall({});
+  scheduler_->Shutdown();
+  EXPECT_TRUE(complete_semaphore_.TimedWait(1000));
+  EXPECT_EQ(RetryCall::kAbortedAttempt, completed_attempt_);
+  MutexLock lock(mutex_);
+  EXPECT_THAT(canceled_, ::testing::ElementsAre(0));
+}
+
+TEST_F(RetryCallTest, StartAfterShutdownAborts) {
+  scheduler_->Shutdown();
+  auto call = StartCall({200});
+  EXPECT_TRUE(complete_semaphore_.TimedWait(1000));
+  EXPECT_EQ(RetryCall::kAbortedAttempt, completed_attempt_);
+  EXPECT_EQ(0, call->attempt_count());
+}
+
+TEST_F(RetryCallTest, CompletedCallIsReleased) {
+  std::weak_ptr<RetryCall> weak_call = StartCall({200});
+  EXPECT_TRUE(complete_semaphore_.TimedWait(1000));
+  EXPECT_TRUE(weak_call.expired());
+}
+
+}  // namespace rest
+}  // namespace firebase
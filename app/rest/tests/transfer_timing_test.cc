@@ -0,0 +1,154 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "app/rest/transfer_timing.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace rest {
+
+namespace {
+
+TransferTiming MakeTiming() {
+  TransferTiming timing;
+  timing.name_lookup_us = 1000;
+  timing.connect_us = 3000;
+  timing.tls_handshake_us = 10000;
+  timing.pre_transfer_us = 10100;
+  timing.first_byte_us = 50100;
+  timing.total_us = 60100;
+  timing.bytes_uploaded = 10;
+  timing.bytes_downloaded = 200;
+  return timing;
+}
+
+}  // namespace
+
+TEST(TransferTimingTest, PhaseDuration) {
+  TransferTiming timing = MakeTiming();
+  EXPECT_TRUE(timing.is_valid());
+  EXPECT_EQ(1000, timing.PhaseDuration(kTransferPhaseNameLookup));
+  EXPECT_EQ(2000, timing.PhaseDuration(kTransferPhaseConnect));
+  EXPECT_EQ(7000, timing.PhaseDuration(kTransferPhaseTlsHandshake));
+  EXPECT_EQ(40000, timing.PhaseDuration(kTransferPhaseFirstByte));
+  EXPECT_EQ(10000, timing.PhaseDuration(kTransferPhaseTransfer));
+  EXPECT_EQ(60100, timing.PhaseDuration(kTransferPhaseTotal));
+}
+
+TEST(TransferTimingTest, PhaseDurationWithoutTls) {
+  TransferTiming timing = MakeTiming();
+  timing.tls_handshake_us = 0;
+  EXPECT_EQ(-1, timing.PhaseDuration(kTransferPhaseTlsHandshake));
+}
+
+TEST(TransferTimingTest, PhaseDurationNotReached) {
+  TransferTiming timing;
+  EXPECT_FALSE(timing.is_valid());
+  for (int i = 0; i < kTransferPhaseCount; ++i) {
+    EXPECT_EQ(-1, timing.PhaseDuration(static_cast<TransferPhase>(i)));
+  }
+}
+
+TEST(TransferTimingHistogramTest, Empty) {
+  TransferTimingHistogram histogram;
+  EXPECT_EQ(0, histogram.count);
+  EXPECT_EQ(0, histogram.Mean());
+  EXPECT_EQ(0, histogram.Percentile(50));
+}
+
+TEST(TransferTimingHistogramTest, Add) {
+  TransferTimingHistogram histogram;
+  histogram.Add(-1);
+  histogram.Add(0);
+  histogram.Add(1);
+  histogram.Add(3);
+  histogram.Add(1000);
+  EXPECT_EQ(4, histogram.count);
+  EXPECT_EQ(1, histogram.buckets[0]);
+  EXPECT_EQ(1, histogram.buckets[1]);
+  EXPECT_EQ(1, histogram.buckets[2]);
+  EXPECT_EQ(1, histogram.buckets[10]);
+  EXPECT_EQ(1004, histogram.sum_us);
+  EXPECT_EQ(1000, histogram.max_us);
+  EXPECT_EQ(251, histogram.Mean());
+}
+
+TEST(TransferTimingHistogramTest, Percentile) {
+  TransferTimingHistogram histogram;
+  for (int i = 0; i < 90; ++i) histogram.Add(100);
+  for (int i = 0; i < 10; ++i) histogram.Add(5000);
+  EXPECT_EQ(128, histogram.Percentile(50));
+  EXPECT_EQ(128, histogram.Percentile(90));
+  EXPECT_EQ(5000, histogram.Percentile(99));
+  EXPECT_EQ(5000, histogram.Percentile(100));
+}
+
+TEST(TransferTimingStatsTest, RecordAndReset) {
+  ResetTransferTimingStats();
+  TransferTiming timing = MakeTiming();
+  RecordTransferTiming(kTransferCategoryStorage, timing);
+  timing.failed = true;
+  RecordTransferTiming(kTransferCategoryStorage, timing);
+  // Transfers that never started are not recorded.
+  RecordTransferTiming(kTransferCategoryStorage, TransferTiming());
+
+  TransferTimingStats stats = GetTransferTimingStats(kTransferCategoryStorage);
+  EXPECT_EQ(2, stats.transfer_count);
+  EXPECT_EQ(1, stats.failed_count);
+  EXPECT_EQ(20, stats.bytes_uploaded);
+  EXPECT_EQ(400, stats.bytes_downloaded);
+  EXPECT_EQ(2, stats.phases[kTransferPhaseTotal].count);
+  EXPECT_EQ(0, GetTransferTimingStats(kTransferCategoryAuth).transfer_count);
+
+  ResetTransferTimingStats();
+  EXPECT_EQ(0, GetTransferTimingStats(kTransferCategoryStorage).transfer_count);
+}
+
+TEST(TransferTimingStatsTest, Sink) {
+  struct Recorded {
+    TransferCategory category;
+    int64_t total_us;
+  };
+  std::vector<Recorded> recorded;
+  SetTransferTimingSink(
+      [](TransferCategory category, const TransferTiming& timing,
+         void* user_data) {
+        static_cast<std::vector<Recorded>*>(user_data)->push_back(
+            {category, timing.total_us});
+      },
+      &recorded);
+  RecordTransferTiming(kTransferCategoryFunctions, MakeTiming());
+  SetTransferTimingSink(nullptr, nullptr);
+  RecordTransferTiming(kTransferCategoryFunctions, MakeTiming());
+
+  ASSERT_EQ(1, recorded.size());
+  EXPECT_EQ(kTransferCategoryFunctions, recorded[0].category);
+  EXPECT_EQ(60100, recorded[0].total_us);
+  ResetTransferTimingStats();
+}
+
+TEST(TransferTimingStatsTest, CategoryName) {
+  EXPECT_STREQ("storage", TransferCategoryName(kTransferCategoryStorage));
+  EXPECT_STREQ("remote_config",
+               TransferCategoryName(kTransferCategoryRemoteConfig));
+}
+
+}  // namespace rest
+}  // namespace firebase
@@ -0,0 +1,267 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tests canceling transfers of transport_curl with a local http server.
+
+#include <atomic>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+
+#include "app/rest/controller_curl.h"
+#include "app/rest/request.h"
+#include "app/rest/response.h"
+#include "app/rest/transport_curl.h"
+#include "app/rest/util.h"
+#include "gtest/gtest.h"
+#include "testing/fake_http_server.h"
+
+namespace firebase {
+namespace rest {
+namespace {
+
+#ifndef _WIN32
+
+using ::firebase::testing::cppsdk::FakeHttpServer;
+
+const std::chrono::seconds kTimeout(10);
+
+// Response that records how and on which thread it was completed.
+class TestResponse : public Response {
+ public:
+  TestResponse() : completed_(false), failed_(false) {}
+
+  void MarkCompleted() override {
+    Response::MarkCompleted();
+    Finish(false);
+  }
+
+  void MarkFailed() override {
+    Response::MarkFailed();
+    Finish(true);
+  }
+
+  // Wait for the transfer to complete, returns false if it doesn't.
+  bool Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return condition_.wait_for(lock, kTimeout,
+                               [this]() { return completed_ || failed_; });
+  }
+
+  // Prepare for another transfer.
+  void Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Clear();
+    completed_ = false;
+    failed_ = false;
+  }
+
+  bool completed() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return completed_;
+  }
+  bool failed() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return failed_;
+  }
+  std::thread::id thread_id() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return thread_id_;
+  }
+
+ private:
+  void Finish(bool failed) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    completed_ = !failed;
+    failed_ = failed;
+    thread_id_ = std::this_thread::get_id();
+    condition_.notify_all();
+  }
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool completed_;
+  bool failed_;
+  std::thread::id thread_id_;
+};
+
+// Response that holds the thread that completes it until Unblock() is called.
+class BlockingResponse : public TestResponse {
+ public:
+  BlockingResponse() : blocked_(false), unblocked_(false) {}
+
+  void MarkCompleted() override {
+    TestResponse::MarkCompleted();
+    std::unique_lock<std::mutex> lock(mutex_);
+    blocked_ = true;
+    condition_.notify_all();
+    condition_.wait(lock, [this]() { return unblocked_; });
+  }
+
+  // Wait until the response is completed, returns false if it isn't.
+  bool WaitUntilBlocked() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return condition_.wait_for(lock, kTimeout, [this]() { return blocked_; });
+  }
+
+  void Unblock() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    unblocked_ = true;
+    condition_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool blocked_;
+  bool unblocked_;
+};
+
+class TransportCurlCancelTest : public ::testing::Test {
+ protected:
+  TransportCurlCancelTest()
+      : released_(false),
+        server_([this](const FakeHttpServer::Request& request,
+                       int connection) {
+          // Hold the requests the test doesn't answer straight away.
+          if (request.index >= first_held_request_) {
+            while (!released_) {
+              std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+          }
+          FakeHttpServer::Send(
+              connection, FakeHttpServer::Response(
+                              200, "text/plain",
+                              "response " + std::to_string(request.index)));
+          return true;
+        }),
+        first_held_request_(0) {
+    InitTransportCurl();
+    transport_.set_is_async(true);
+    request_.set_url(server_.url("/").c_str());
+  }
+
+  ~TransportCurlCancelTest() override {
+    Release();
+    CleanupTransportCurl();
+  }
+
+  // Let the server answer the requests it holds.
+  void Release() { released_ = true; }
+
+  // Wait until the server received count requests.
+  bool WaitForRequests(int count) {
+    auto deadline = std::chrono::steady_clock::now() + kTimeout;
+    while (server_.requests() < count) {
+      if (std::chrono::steady_clock::now() > deadline) return false;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+  }
+
+  std::atomic<bool> released_;
+  FakeHttpServer server_;
+  std::atomic<int> first_held_request_;
+  TransportCurl transport_;
+  Request request_;
+};
+
+TEST_F(TransportCurlCancelTest, CancelBeforeTransferStarts) {
+  TestResponse response;
+  flatbuffers::unique_ptr<Controller> controller;
+  transport_.Perform(request_, &response, &controller);
+  EXPECT_TRUE(controller->Cancel());
+  ASSERT_TRUE(response.Wait());
+  EXPECT_TRUE(response.failed());
+  EXPECT_EQ(response.status(), util::HttpNoContent);
+  // The response is failed by the curl thread, not the caller.
+  EXPECT_NE(response.thread_id(), std::this_thread::get_id());
+  EXPECT_FALSE(controller->Cancel());
+}
+
+TEST_F(TransportCurlCancelTest, CancelBeforeTransferStartsHasNoTiming) {
+  first_held_request_ = 1;
+  BlockingResponse first_response;
+  flatbuffers::unique_ptr<Controller> first_controller;
+  transport_.Perform(request_, &first_response, &first_controller);
+  // Hold the curl thread as it completes the first transfer, so the next one
+  // is canceled while it waits in the queue.
+  ASSERT_TRUE(first_response.WaitUntilBlocked());
+  EXPECT_TRUE(first_response.timing().is_valid());
+
+  TestResponse response;
+  flatbuffers::unique_ptr<Controller> controller;
+  transport_.Perform(request_, &response, &controller);
+  EXPECT_TRUE(controller->Cancel());
+  first_response.Unblock();
+  ASSERT_TRUE(response.Wait());
+  EXPECT_TRUE(response.failed());
+  // The transfer reuses the first transfer's curl handle but never started,
+  // so it must not report the first transfer's timing.
+  EXPECT_FALSE(response.timing().is_valid());
+  EXPECT_EQ(server_.requests(), 1);
+}
+
+TEST_F(TransportCurlCancelTest, CancelRunningTransfer) {
+  TestResponse response;
+  flatbuffers::unique_ptr<Controller> controller;
+  transport_.Perform(request_, &response, &controller);
+  ASSERT_TRUE(WaitForRequests(1));
+  EXPECT_TRUE(controller->Cancel());
+  ASSERT_TRUE(response.Wait());
+  EXPECT_TRUE(response.failed());
+  EXPECT_EQ(response.status(), util::HttpNoContent);
+  EXPECT_NE(response.thread_id(), std::this_thread::get_id());
+}
+
+TEST_F(TransportCurlCancelTest, StaleCancelDoesNotAffectNextTransfer) {
+  first_held_request_ = 1;
+  TestResponse response;
+  flatbuffers::unique_ptr<Controller> first_controller;
+  transport_.Perform(request_, &response, &first_controller);
+  ASSERT_TRUE(response.Wait());
+  ASSERT_TRUE(response.completed());
+  uint64_t first_transfer_id =
+      static_cast<ControllerCurl*>(first_controller.get())->transfer_id();
+
+  // Reuse the response for another transfer, which the server holds.
+  response.Reset();
+  flatbuffers::unique_ptr<Controller> second_controller;
+  transport_.Perform(request_, &response, &second_controller);
+  ASSERT_TRUE(WaitForRequests(2));
+
+  // Cancel the first transfer, which is already complete.
+  ControllerCurl stale_controller(&transport_, kTransferDirectionDownload,
+                                  &response);
+  stale_controller.set_transfer_id(first_transfer_id);
+  stale_controller.set_transferring(true);
+  EXPECT_TRUE(stale_controller.Cancel());
+
+  Release();
+  ASSERT_TRUE(response.Wait());
+  EXPECT_TRUE(response.completed());
+  EXPECT_EQ(response.status(), util::HttpSuccess);
+  EXPECT_STREQ(response.GetBody(), "response 1");
+}
+
+#endif  // !_WIN32
+
+}  // namespace
+}  // namespace rest
+}  // namespace firebase
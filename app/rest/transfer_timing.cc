@@ -0,0 +1,164 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "app/rest/transfer_timing.h"
+
+#include <cassert>
+#include <cstring>
+
+#include "app/src/include/firebase/internal/mutex.h"
+
+namespace firebase {
+namespace rest {
+
+namespace {
+
+// Guards g_stats and the sink.
+Mutex* g_timing_mutex = new Mutex();
+TransferTimingStats g_stats[kTransferCategoryCount];
+TransferTimingSink g_sink = nullptr;
+void* g_sink_user_data = nullptr;
+
+// Get the duration between two milestones or -1 if either was not reached.
+int64_t Elapsed(int64_t start_us, int64_t end_us) {
+  if (start_us < 0 || end_us < 0) return -1;
+  return end_us > start_us ? end_us - start_us : 0;
+}
+
+}  // namespace
+
+int64_t TransferTiming::PhaseDuration(TransferPhase phase) const {
+  switch (phase) {
+    case kTransferPhaseNameLookup:
+      return name_lookup_us;
+    case kTransferPhaseConnect:
+      return Elapsed(name_lookup_us, connect_us);
+    case kTransferPhaseTlsHandshake:
+      // Connections without TLS report a handshake time of 0.
+      return tls_handshake_us > 0 ? Elapsed(connect_us, tls_handshake_us)
+                                  : -1;
+    case kTransferPhaseFirstByte:
+      return Elapsed(pre_transfer_us, first_byte_us);
+    case kTransferPhaseTransfer:
+      return Elapsed(first_byte_us, total_us);
+    case kTransferPhaseTotal:
+      return total_us;
+    case kTransferPhaseCount:
+      break;
+  }
+  return -1;
+}
+
+TransferTimingHistogram::TransferTimingHistogram()
+    : count(0), sum_us(0), max_us(0) {
+  memset(buckets, 0, sizeof(buckets));
+}
+
+void TransferTimingHistogram::Add(int64_t duration_us) {
+  if (duration_us < 0) return;
+  int bucket = 0;
+  for (uint64_t value = static_cast<uint64_t>(duration_us);
+       value && bucket < kBucketCount - 1; value >>= 1) {
+    bucket++;
+  }
+  buckets[bucket]++;
+  count++;
+  sum_us += duration_us;
+  if (duration_us > max_us) max_us = duration_us;
+}
+
+int64_t TransferTimingHistogram::Percentile(double percentile) const {
+  if (!count) return 0;
+  uint64_t rank = static_cast<uint64_t>(
+      (percentile / 100.0) * static_cast<double>(count) + 0.5);
+  if (rank < 1) rank = 1;
+  uint64_t seen = 0;
+  for (int i = 0; i < kBucketCount; ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      int64_t upper_bound = static_cast<int64_t>(1) << i;
+      return upper_bound < max_us ? upper_bound : max_us;
+    }
+  }
+  return max_us;
+}
+
+void TransferTimingStats::Add(const TransferTiming& timing) {
+  transfer_count++;
+  if (timing.failed) failed_count++;
+  bytes_uploaded += timing.bytes_uploaded;
+  bytes_downloaded += timing.bytes_downloaded;
+  for (int i = 0; i < kTransferPhaseCount; ++i) {
+    phases[i].Add(timing.PhaseDuration(static_cast<TransferPhase>(i)));
+  }
+}
+
+void RecordTransferTiming(TransferCategory category,
+                          const TransferTiming& timing) {
+  assert(category >= 0 && category < kTransferCategoryCount);
+  if (!timing.is_valid()) return;
+  TransferTimingSink sink;
+  void* sink_user_data;
+  {
+    MutexLock lock(*g_timing_mutex);
+    g_stats[category].Add(timing);
+    sink = g_sink;
+    sink_user_data = g_sink_user_data;
+  }
+  if (sink) sink(category, timing, sink_user_data);
+}
+
+TransferTimingStats GetTransferTimingStats(TransferCategory category) {
+  assert(category >= 0 && category < kTransferCategoryCount);
+  MutexLock lock(*g_timing_mutex);
+  return g_stats[category];
+}
+
+void ResetTransferTimingStats() {
+  MutexLock lock(*g_timing_mutex);
+  for (int i = 0; i < kTransferCategoryCount; ++i) {
+    g_stats[i] = TransferTimingStats();
+  }
+}
+
+void SetTransferTimingSink(TransferTimingSink sink, void* user_data) {
+  MutexLock lock(*g_timing_mutex);
+  g_sink = sink;
+  g_sink_user_data = user_data;
+}
+
+const char* TransferCategoryName(TransferCategory category) {
+  switch (category) {
+    case kTransferCategoryOther:
+      return "other";
+    case kTransferCategoryStorage:
+      return "storage";
+    case kTransferCategoryFunctions:
+      return "functions";
+    case kTransferCategoryRemoteConfig:
+      return "remote_config";
+    case kTransferCategoryAuth:
+      return "auth";
+    case kTransferCategoryAppCheck:
+      return "app_check";
+    case kTransferCategoryCount:
+      break;
+  }
+  return "unknown";
+}
+
+}  // namespace rest
+}  // namespace firebase
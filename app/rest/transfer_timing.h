@@ -0,0 +1,162 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIREBASE_APP_REST_TRANSFER_TIMING_H_
+#define FIREBASE_APP_REST_TRANSFER_TIMING_H_
+
+#include <stdint.h>
+
+namespace firebase {
+namespace rest {
+
+// Product that issued a transfer, used to aggregate timing statistics.
+enum TransferCategory {
+  kTransferCategoryOther = 0,
+  kTransferCategoryStorage,
+  kTransferCategoryFunctions,
+  kTransferCategoryRemoteConfig,
+  kTransferCategoryAuth,
+  kTransferCategoryAppCheck,
+  kTransferCategoryCount,
+};
+
+// Phases of a transfer that are tracked by TransferTimingStats.
+enum TransferPhase {
+  // Resolving the host name.
+  kTransferPhaseNameLookup = 0,
+  // Establishing the TCP connection, after name lookup.
+  kTransferPhaseConnect,
+  // Performing the TLS handshake, after the TCP connection is established.
+  kTransferPhaseTlsHandshake,
+  // Waiting for the first byte of the response, after the request is sent.
+  kTransferPhaseFirstByte,
+  // Receiving the response, after the first byte.
+  kTransferPhaseTransfer,
+  // The entire transfer.
+  kTransferPhaseTotal,
+  kTransferPhaseCount,
+};
+
+// Time at which each milestone of a transfer was reached, in microseconds
+// since the transfer started.  A value of -1 indicates the milestone was never
+// reached, e.g the transfer failed before it connected.
+struct TransferTiming {
+  TransferTiming()
+      : name_lookup_us(-1),
+        connect_us(-1),
+        tls_handshake_us(-1),
+        pre_transfer_us(-1),
+        first_byte_us(-1),
+        total_us(-1),
+        bytes_uploaded(0),
+        bytes_downloaded(0),
+        failed(false) {}
+
+  // Whether timing information was collected for the transfer.
+  bool is_valid() const { return total_us >= 0; }
+
+  // Get the time spent in the specified phase of the transfer or -1 if the
+  // phase was not reached.
+  int64_t PhaseDuration(TransferPhase phase) const;
+
+  // Name lookup complete.
+  int64_t name_lookup_us;
+  // TCP connection established.
+  int64_t connect_us;
+  // TLS handshake complete, 0 if the connection does not use TLS.
+  int64_t tls_handshake_us;
+  // About to send the request.
+  int64_t pre_transfer_us;
+  // First byte of the response received.
+  int64_t first_byte_us;
+  // Transfer complete.
+  int64_t total_us;
+  // Number of bytes sent and received.
+  int64_t bytes_uploaded;
+  int64_t bytes_downloaded;
+  // Whether the transfer was canceled or timed out.
+  bool failed;
+};
+
+// Histogram of durations using power of two buckets, bucket N counts
+// durations in the range [2^(N-1), 2^N) microseconds with bucket 0 counting
+// durations less than a microsecond.
+struct TransferTimingHistogram {
+  static const int kBucketCount = 36;
+
+  TransferTimingHistogram();
+
+  // Add a duration to the histogram, negative durations are ignored.
+  void Add(int64_t duration_us);
+
+  // Get an upper bound of the specified percentile (0..100) in microseconds
+  // or 0 if the histogram is empty.
+  int64_t Percentile(double percentile) const;
+
+  // Get the mean duration in microseconds or 0 if the histogram is empty.
+  int64_t Mean() const { return count ? sum_us / count : 0; }
+
+  uint64_t buckets[kBucketCount];
+  uint64_t count;
+  int64_t sum_us;
+  int64_t max_us;
+};
+
+// Aggregated timing of all transfers in a category.
+struct TransferTimingStats {
+  TransferTimingStats()
+      : transfer_count(0),
+        failed_count(0),
+        bytes_uploaded(0),
+        bytes_downloaded(0) {}
+
+  // Add a transfer to the statistics.
+  void Add(const TransferTiming& timing);
+
+  uint64_t transfer_count;
+  uint64_t failed_count;
+  int64_t bytes_uploaded;
+  int64_t bytes_downloaded;
+  TransferTimingHistogram phases[kTransferPhaseCount];
+};
+
+// Called on the transport thread when each transfer completes.  This must not
+// block or start another transfer.
+typedef void (*TransferTimingSink)(TransferCategory category,
+                                   const TransferTiming& timing,
+                                   void* user_data);
+
+// Add a completed transfer to the statistics for the category and forward it
+// to the sink, if one is set.
+void RecordTransferTiming(TransferCategory category,
+                          const TransferTiming& timing);
+
+// Get a copy of the statistics aggregated for a category.
+TransferTimingStats GetTransferTimingStats(TransferCategory category);
+
+// Clear statistics for all categories.
+void ResetTransferTimingStats();
+
+// Set the sink notified of each completed transfer, or nullptr to remove it.
+void SetTransferTimingSink(TransferTimingSink sink, void* user_data);
+
+// Get the name of a category, e.g "storage".
+const char* TransferCategoryName(TransferCategory category);
+
+}  // namespace rest
+}  // namespace firebase
+
+#endif  // FIREBASE_APP_REST_TRANSFER_TIMING_H_
@@ -16,12 +16,14 @@
 
 #include "app/rest/transport_curl.h"
 
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <deque>
 #include <map>
 
 #include "app/rest/controller_curl.h"
+#include "app/rest/transfer_timing.h"
 #include "app/rest/util.h"
 #include "app/src/assert.h"
 #include "app/src/include/firebase/internal/mutex.h"
@@ -62,7 +64,9 @@ struct TransportCurlActionData {
         curl(nullptr),
         request(nullptr),
         response(nullptr),
-        controller(nullptr) {}
+        controller(nullptr),
+        transfer_id(0),
+        canceled(false) {}
   // Transport that scheduled this request.
   // Required by:
   // * kRequestedActionPerform
@@ -92,6 +96,16 @@ struct TransportCurlActionData {
   // Pointer to the controller.
   // Optionally used by kRequestedActionPerform.
   ControllerCurl* controller;
+  // Identifies the transfer, so an action meant for a transfer doesn't apply
+  // to a later one that uses the same response.
+  // Required by:
+  // * kRequestedActionPerform
+  // * kRequestedActionCancel
+  uint64_t transfer_id;
+  // Whether the transfer was canceled before it started, so it's failed
+  // rather than performed.
+  // Used by kRequestedActionPerform.
+  bool canceled;
 
   // Create a quit action.
   static TransportCurlActionData Quit() {
@@ -103,7 +117,7 @@ struct TransportCurlActionData {
   // Create a perform action.
   static TransportCurlActionData Perform(TransportCurl* transport_curl,
                                          Request* request, Response* response,
-                                         CURL* curl,
+                                         CURL* curl, uint64_t transfer_id,
                                          ControllerCurl* controller = nullptr) {
     TransportCurlActionData transport_action;
     transport_action.transport = transport_curl;
@@ -112,14 +126,18 @@ struct TransportCurlActionData {
     transport_action.request = request;
     transport_action.response = response;
     transport_action.controller = controller;
+    transport_action.transfer_id = transfer_id;
     return transport_action;
   }
 
   // Create a cancellation action.
   static TransportCurlActionData Cancel(TransportCurl* transport_curl,
-                                        Response* response, CURL* curl) {
-    return ResponseAction(transport_curl, kRequestedActionCancel, response,
-                          curl);
+                                        Response* response, CURL* curl,
+                                        uint64_t transfer_id) {
+    TransportCurlActionData transport_action = ResponseAction(
+        transport_curl, kRequestedActionCancel, response, curl);
+    transport_action.transfer_id = transfer_id;
+    return transport_action;
   }
 
   // Create a pause action.
@@ -161,8 +179,8 @@ class BackgroundTransportCurl {
 
  public:
   BackgroundTransportCurl(CURLM* curl_multi, CURL* curl, Request* request,
-                          Response* response, Mutex* controller_mutex,
-                          ControllerCurl* controller,
+                          Response* response, uint64_t transfer_id,
+                          Mutex* controller_mutex, ControllerCurl* controller,
                           TransportCurl* transport_curl,
                           CompleteFunction complete, void* complete_data);
   ~BackgroundTransportCurl();
@@ -170,6 +188,7 @@ class BackgroundTransportCurl {
 
   CURL* curl() const { return curl_; }
   Response* response() const { return response_; }
+  uint64_t transfer_id() const { return transfer_id_; }
   void set_canceled(bool canceled) { canceled_ = canceled; }
   void set_timed_out(bool timed_out) { timed_out_ = timed_out; }
   ControllerCurl* controller() const { return controller_; }
@@ -178,6 +197,9 @@ class BackgroundTransportCurl {
  private:
   void CheckOk(CURLcode code, const char* msg);
   void CompleteOperation();
+  // Read transfer timing from the curl handle into the response and record
+  // it in the statistics for the request's category.
+  void RecordTiming();
 
  private:
   CURLM* curl_multi_;
@@ -193,6 +215,8 @@ class BackgroundTransportCurl {
   Request* request_;
   // The response that needs to be completed.
   Response* response_;
+  // Identifies the transfer.
+  uint64_t transfer_id_;
   // Guards controller_.
   Mutex* controller_mutex_;
   // Controller associated with the transfer.
@@ -208,6 +232,9 @@ class BackgroundTransportCurl {
   bool canceled_;
   // Whether the operation timed out.
   bool timed_out_;
+  // Whether the easy handle was added to the multi handle. The handle may be
+  // reused, so until then it holds the previous transfer's timing.
+  bool started_;
 };
 
 // The data common to both threads. This is used to communicate when the
@@ -221,9 +248,12 @@ class CurlThread {
   // Schedule an action on the ProcessRequests thread.
   void ScheduleAction(const TransportCurlActionData& action_data);
 
-  // Cancel a request or flush scheduled matching requests.
-  int CancelRequest(TransportCurl* transport_curl, Response* response,
-                    CURL* curl);
+  // Cancel the transfer identified by transfer_id. A transfer that hasn't
+  // started is failed when the thread takes it from the queue, a running
+  // transfer is canceled by the thread and a complete transfer is left alone,
+  // so the response is always completed on the thread.
+  void CancelRequest(TransportCurl* transport_curl, Response* response,
+                     CURL* curl, uint64_t transfer_id);
 
  private:
   // Pull the next request from the queue, optionally blocking if the queue
@@ -236,8 +266,9 @@ class CurlThread {
   void AddTransfer(BackgroundTransportCurl* transport);
   // Remove a response from the set of running responses.
   // Returns a transport if the response is found in the set of running
-  // requests.
-  BackgroundTransportCurl* RemoveTransfer(Response* response);
+  // requests and its transfer is identified by transfer_id.
+  BackgroundTransportCurl* RemoveTransfer(Response* response,
+                                          uint64_t transfer_id);
 
   // Cancel all outstanding requests.
   void CancelAllTransfers();
@@ -309,6 +340,9 @@ size_t CurlReadCallback(char* buffer, size_t size, size_t nitems,
 // Data accessible by both threads.
 CurlThread* g_curl_thread = nullptr;
 
+// Identifier of the last transfer scheduled.
+std::atomic<uint64_t> g_last_transfer_id(0);
+
 // Count initializations that multiple libraries can use this simultaneously.
 int g_initialize_count = 0;
 
@@ -349,7 +383,7 @@ void CleanupTransportCurl() {
 
 BackgroundTransportCurl::BackgroundTransportCurl(
     CURLM* curl_multi, CURL* curl, Request* request, Response* response,
-    Mutex* controller_mutex, ControllerCurl* controller,
+    uint64_t transfer_id, Mutex* controller_mutex, ControllerCurl* controller,
     TransportCurl* transport_curl, CompleteFunction complete,
     void* complete_data)
     : curl_multi_(curl_multi),
@@ -358,13 +392,15 @@ BackgroundTransportCurl::BackgroundTransportCurl(
       request_header_(nullptr),
       request_(request),
       response_(response),
+      transfer_id_(transfer_id),
       controller_mutex_(controller_mutex),
       controller_(controller),
       transport_curl_(transport_curl),
       complete_(complete),
       complete_data_(complete_data),
       canceled_(false),
-      timed_out_(false) {
+      timed_out_(false),
+      started_(false) {
   assert(curl_multi_);
   assert(curl_);
   assert(transport_curl);
@@ -412,6 +448,7 @@ BackgroundTransportCurl::~BackgroundTransportCurl() {
 
 void BackgroundTransportCurl::CompleteOperation() {
   if (complete_) complete_(this, complete_data_);
+  RecordTiming();
   if (canceled_) {
     response_->set_status(rest::util::HttpNoContent);
     request_->MarkFailed();
@@ -426,6 +463,36 @@ void BackgroundTransportCurl::CompleteOperation() {
   }
 }
 
+void BackgroundTransportCurl::RecordTiming() {
+  static const struct {
+    CURLINFO info;
+    int64_t TransferTiming::*field;
+  } kTimingFields[] = {
+      {CURLINFO_NAMELOOKUP_TIME_T, &TransferTiming::name_lookup_us},
+      {CURLINFO_CONNECT_TIME_T, &TransferTiming::connect_us},
+      {CURLINFO_APPCONNECT_TIME_T, &TransferTiming::tls_handshake_us},
+      {CURLINFO_PRETRANSFER_TIME_T, &TransferTiming::pre_transfer_us},
+      {CURLINFO_STARTTRANSFER_TIME_T, &TransferTiming::first_byte_us},
+      {CURLINFO_TOTAL_TIME_T, &TransferTiming::total_us},
+      {CURLINFO_SIZE_UPLOAD_T, &TransferTiming::bytes_uploaded},
+      {CURLINFO_SIZE_DOWNLOAD_T, &TransferTiming::bytes_downloaded},
+  };
+  TransferTiming timing;
+  for (size_t i = 0; started_ && i < FIREBASE_ARRAYSIZE(kTimingFields); ++i) {
+    curl_off_t value = 0;
+    if (curl_easy_getinfo(curl_, kTimingFields[i].info, &value) == CURLE_OK) {
+      timing.*kTimingFields[i].field = static_cast<int64_t>(value);
+    }
+  }
+  // A transfer that never started reports 0 for every milestone.
+  if (timing.total_us == 0 && timing.pre_transfer_us == 0) {
+    timing.total_us = -1;
+  }
+  timing.failed = canceled_ || timed_out_;
+  response_->set_timing(timing);
+  RecordTransferTiming(request_->options().category, timing);
+}
+
 void BackgroundTransportCurl::CheckOk(CURLcode code, const char* msg) {
   if (code == CURLE_OK) {
     return;
@@ -573,7 +640,8 @@ bool BackgroundTransportCurl::PerformBackground(Request* request) {
 
   if (err_code_ == CURLE_OK) {
     // Add the easy handle to the multi handle to prepare operation.
-    return curl_multi_add_handle(curl_multi_, curl_) == CURLM_OK;
+    started_ = curl_multi_add_handle(curl_multi_, curl_) == CURLM_OK;
+    return started_;
   } else {
     // If any error happens during the setup, we do not perform http request and
     // return immediately instead.
@@ -616,52 +684,23 @@ void CurlThread::ScheduleAction(const TransportCurlActionData& action_data) {
   action_data_signal_.Post();
 }
 
-int CurlThread::CancelRequest(TransportCurl* transport_curl, Response* response,
-                              CURL* curl) {
-  int removed_from_queue = 0;
+void CurlThread::CancelRequest(TransportCurl* transport_curl,
+                               Response* response, CURL* curl,
+                               uint64_t transfer_id) {
   MutexLock lock(mutex_);
-  // Remove any actions that are queued for this transfer before scheduling
-  // the cancellation.
-  auto it = action_data_queue_.begin();
-  while (it != action_data_queue_.end()) {
-    if (!(it->transport == transport_curl && it->response == response &&
-          it->curl == curl)) {
-      it++;
-      continue;
-    }
-    switch (it->action) {
-      case kRequestedActionPerform:
-        removed_from_queue++;
-        FIREBASE_CASE_FALLTHROUGH;
-      case kRequestedActionPause:
-        FIREBASE_CASE_FALLTHROUGH;
-      case kRequestedActionCancel:
-        FIREBASE_CASE_FALLTHROUGH;
-      case kRequestedActionResume:
-        action_data_queue_.erase(it);
-        it = action_data_queue_.begin();
-        break;
-      default:
-        it++;
-        break;
-    }
-  }
-  // Make sure the transfer is currently running.
-  bool transferring = false;
-  for (auto it = transport_by_response_.begin();
-       it != transport_by_response_.end(); ++it) {
-    BackgroundTransportCurl* transport = it->second;
-    if (it->first == response &&
-        transport->transport_curl() == transport_curl &&
-        transport->curl() == curl) {
-      transferring = true;
+  for (TransportCurlActionData& action_data : action_data_queue_) {
+    if (action_data.action == kRequestedActionPerform &&
+        action_data.transfer_id == transfer_id) {
+      action_data.canceled = true;
+      return;
     }
   }
-  if (transferring) {
-    ScheduleAction(
-        TransportCurlActionData::Cancel(transport_curl, response, curl));
+  auto it = transport_by_response_.find(response);
+  if (it != transport_by_response_.end() &&
+      it->second->transfer_id() == transfer_id) {
+    ScheduleAction(TransportCurlActionData::Cancel(transport_curl, response,
+                                                   curl, transfer_id));
   }
-  return removed_from_queue;
 }
 
 bool CurlThread::GetNextAction(TransportCurlActionData* data,
@@ -691,10 +730,14 @@ void CurlThread::AddTransfer(BackgroundTransportCurl* transport) {
   transport_by_response_[transport->response()] = transport;
 }
 
-BackgroundTransportCurl* CurlThread::RemoveTransfer(Response* response) {
+BackgroundTransportCurl* CurlThread::RemoveTransfer(Response* response,
+                                                    uint64_t transfer_id) {
   MutexLock lock(mutex_);
   auto it = transport_by_response_.find(response);
-  if (it == transport_by_response_.end()) return nullptr;
+  if (it == transport_by_response_.end() ||
+      it->second->transfer_id() != transfer_id) {
+    return nullptr;
+  }
   BackgroundTransportCurl* transport = it->second;
   transport_by_response_.erase(it);
   return transport;
@@ -706,7 +749,7 @@ void CurlThread::CancelAllTransfers() {
        it != transport_by_response_.end(); ++it) {
     BackgroundTransportCurl* transport = it->second;
     CancelRequest(transport->transport_curl(), transport->response(),
-                  transport->curl());
+                  transport->curl(), transport->transfer_id());
   }
 }
 
@@ -774,19 +817,27 @@ void CurlThread::ProcessRequests() {
         case kRequestedActionPerform: {
           BackgroundTransportCurl* transport;
           {
+            // The transfer is added while the controller is attached, so a
+            // cancellation through the controller always finds it.
             MutexLock lock(mutex_);
             transport = new BackgroundTransportCurl(
                 curl_multi, action_data.curl, action_data.request,
-                action_data.response, &mutex_, action_data.controller,
-                action_data.transport,
+                action_data.response, action_data.transfer_id, &mutex_,
+                action_data.controller, action_data.transport,
                 [](BackgroundTransportCurl* background_transport, void* data) {
                   reinterpret_cast<CurlThread*>(data)->RemoveTransfer(
-                      background_transport->response());
+                      background_transport->response(),
+                      background_transport->transfer_id());
                 },
                 this);
+            AddTransfer(transport);
           }
-          AddTransfer(transport);
-          if (transport->PerformBackground(action_data.request)) {
+          if (action_data.canceled) {
+            // Canceled before it started, fail it without contacting the
+            // server.
+            transport->set_canceled(true);
+            delete transport;
+          } else if (transport->PerformBackground(action_data.request)) {
             expected_running_handles++;
           } else {
             delete transport;
@@ -794,8 +845,8 @@ void CurlThread::ProcessRequests() {
           break;
         }
         case kRequestedActionCancel: {
-          BackgroundTransportCurl* transport =
-              RemoveTransfer(action_data.response);
+          BackgroundTransportCurl* transport = RemoveTransfer(
+              action_data.response, action_data.transfer_id);
           if (transport) {
             transport->set_canceled(true);
             delete transport;
@@ -936,13 +987,18 @@ void TransportCurl::PerformInternal(
                                    : kTransferDirectionUpload,
                                response)
           : nullptr;
-  if (controller) controller->set_transferring(true);
+  uint64_t transfer_id = ++g_last_transfer_id;
+  if (controller) {
+    controller->set_transfer_id(transfer_id);
+    controller->set_transferring(true);
+  }
   {
     MutexLock lock(running_transfers_mutex_);
     running_transfers_++;
   }
   g_curl_thread->ScheduleAction(TransportCurlActionData::Perform(
-      this, request, response, reinterpret_cast<CURL*>(curl_), controller));
+      this, request, response, reinterpret_cast<CURL*>(curl_), transfer_id,
+      controller));
   if (controller_out) {
     // Normally we would use make_new() here, but this is not a std::unique_ptr
     // and make_new() isn't supported by all targets we build for
@@ -954,10 +1010,9 @@ void TransportCurl::PerformInternal(
   if (!is_async_) WaitForAllTransfersToComplete();
 }
 
-void TransportCurl::CancelRequest(Response* response) {
-  int removed_from_queue = g_curl_thread->CancelRequest(
-      this, response, reinterpret_cast<CURL*>(curl_));
-  while (removed_from_queue--) SignalTransferComplete();
+void TransportCurl::CancelRequest(Response* response, uint64_t transfer_id) {
+  g_curl_thread->CancelRequest(this, response, reinterpret_cast<CURL*>(curl_),
+                               transfer_id);
 }
 
 void TransportCurl::PauseRequest(Response* response) {
@@ -75,8 +75,9 @@ class TransportCurl : public Transport {
   friend class ControllerCurl;
   friend class BackgroundTransportCurl;
 
-  // Used by the ControllerCurl to cancel a running transfer.
-  void CancelRequest(Response* response);
+  // Used by the ControllerCurl to cancel the transfer identified by
+  // transfer_id, whether it's running or waiting to start.
+  void CancelRequest(Response* response, uint64_t transfer_id);
   // Used by the ControllerCurl to pause a running transfer.
   void PauseRequest(Response* response);
   // Used by the ControllerCurl to resumt a running transfer.
@@ -52,7 +52,8 @@ enum HttpStatusCode {
   HttpUnauthorized = 401,
   HttpForbidden = 403,
   HttpNotFound = 404,
-  HttpRequestTimeout = 408
+  HttpRequestTimeout = 408,
+  HttpTooManyRequests = 429
 };
 
 // Initialize utilities.  This must be called before any functions that
@@ -16,9 +16,10 @@
 
 #include "app/src/callback.h"
 
-#include <list>
-#include <memory>
+#include <atomic>
+#include <cstdint>
 
+#include "app/src/assert.h"
 #include "app/src/include/firebase/internal/mutex.h"
 #include "app/src/log.h"
 #include "app/src/semaphore.h"
@@ -27,106 +28,140 @@
 namespace firebase {
 namespace callback {
 
-class CallbackEntry;
-
-class CallbackQueue : public std::list<std::shared_ptr<CallbackEntry>> {
- public:
-  CallbackQueue() {}
-  ~CallbackQueue() {}
-
-  // Get the mutex that controls access to this queue.
-  Mutex* mutex() { return &mutex_; }
-
- private:
-  Mutex mutex_;
-};
+// A callback reference returned by AddCallback() holds the index of its entry
+// in the low kIndexBits bits and the generation of the entry in the rest, so
+// that a reference to a callback that has already been dispatched doesn't
+// match the entry once it's reused.
+static const int kIndexBits = sizeof(void*) >= 8 ? 24 : 20;
+static const uintptr_t kIndexMask =
+    (static_cast<uintptr_t>(1) << kIndexBits) - 1;
+static const uintptr_t kMaxGeneration =
+    ~static_cast<uintptr_t>(0) >> kIndexBits;
 
 // Entry within the callback queue.
 class CallbackEntry {
  public:
-  // Construct a entry with a reference to the specified callback object.
-  // callback_mutex_ is used to enforce a critical section for callback
-  // execution and destruction.
-  CallbackEntry(Callback* callback, Mutex* callback_mutex)
-      : callback_(callback), mutex_(callback_mutex), executing_(false) {}
-
-  // Destroy the callback.  This blocks if the callback is currently
-  // executing.
-  ~CallbackEntry() { DisableCallback(); }
+  CallbackEntry()
+      : next(nullptr),
+        next_free(0),
+        index(0),
+        callback_(nullptr),
+        state_(kStateFree) {}
+
+  // Associate the entry with a callback to be executed, starting a new
+  // generation of the entry. Returns the generation.
+  uintptr_t Reset(Callback* callback) {
+    uintptr_t generation =
+        (state_.load(std::memory_order_relaxed) >> kStateBits) + 1;
+    if (generation > kMaxGeneration) generation = 1;
+    callback_.store(callback, std::memory_order_relaxed);
+    state_.store(MakeState(generation, kStatePending),
+                 std::memory_order_release);
+    return generation;
+  }
 
   // Execute the callback associated with this entry.
   // Returns true if a callback was associated with this entry and was executed,
   // false otherwise.
   bool Execute() {
-    {
-      MutexLock lock(*mutex_);
-      if (!callback_) return false;
-      executing_ = true;
+    uintptr_t state = state_.load(std::memory_order_acquire);
+    if ((state & kStateMask) != kStatePending ||
+        !state_.compare_exchange_strong(state,
+                                        WithState(state, kStateExecuting),
+                                        std::memory_order_acq_rel)) {
+      return false;
     }
 
-    callback_->Run();
-
-    {
-      MutexLock lock(*mutex_);
-      executing_ = false;
-    }
+    Callback* callback = callback_.load(std::memory_order_relaxed);
+    callback->Run();
 
     // Note: The implementation of BlockingCallback below relies on the
-    // callback being disabled after being run. If that changes, please
+    // callback being deleted after being run. If that changes, please
     // make sure to also update BlockingCallback.
-    DisableCallback();
-
+    delete callback;
+    callback_.store(nullptr, std::memory_order_relaxed);
+    state_.store(WithState(state, kStateComplete), std::memory_order_release);
     return true;
   }
 
-  // Remove the callback method from this entry.
-  bool DisableCallback() {
-    Callback* callback_to_delete = nullptr;
-    {
-      MutexLock lock(*mutex_);
-      if (executing_ || !callback_) return false;
-      callback_to_delete = callback_;
-      callback_ = nullptr;
+  // Remove the callback from this entry if it's still pending in the given
+  // generation, so that the entry is skipped when dispatched.
+  bool DisableCallback(uintptr_t generation) {
+    uintptr_t pending = MakeState(generation, kStatePending);
+    if (state_.load(std::memory_order_acquire) != pending) return false;
+    // Read before the entry leaves the pending state, after which it may be
+    // released and reused. If that happened meanwhile the exchange fails.
+    Callback* callback = callback_.load(std::memory_order_relaxed);
+    if (!state_.compare_exchange_strong(
+            pending, MakeState(generation, kStateDisabled),
+            std::memory_order_acq_rel)) {
+      return false;
     }
-    delete callback_to_delete;
+    delete callback;
     return true;
   }
 
+  // Remove the callback from this entry whatever its generation.
+  bool DisableCallback() {
+    return DisableCallback(state_.load(std::memory_order_acquire) >>
+                           kStateBits);
+  }
+
+  // Next entry in the queue.
+  std::atomic<CallbackEntry*> next;
+  // Index of the next entry in the dispatcher's free list.
+  std::atomic<uint32_t> next_free;
+  // Index of this entry in the dispatcher.
+  uint32_t index;
+
  private:
+  enum State {
+    kStateFree,
+    kStatePending,
+    kStateExecuting,
+    kStateComplete,
+    kStateDisabled,
+  };
+  static const int kStateBits = 3;
+  static const uintptr_t kStateMask = (1 << kStateBits) - 1;
+
+  static uintptr_t MakeState(uintptr_t generation, State state) {
+    return (generation << kStateBits) | state;
+  }
+  static uintptr_t WithState(uintptr_t current, State state) {
+    return (current & ~kStateMask) | state;
+  }
+
   // Callback to call from PollCallbacks().
-  Callback* callback_;
-  // Mutex that is held when modifying callback_ and executing_.
-  Mutex* mutex_;
-  // A flag set to true when callback_ is about to be called.
-  bool executing_;
+  std::atomic<Callback*> callback_;
+  // Generation of the entry in the upper bits and its State in the lower
+  // kStateBits. Only the thread that moves the entry out of kStatePending may
+  // delete callback_.
+  std::atomic<uintptr_t> state_;
 };
 
 // Dispatches a queue of callbacks.
+//
+// Callbacks are added to an intrusive multi-producer single-consumer queue
+// without taking a lock. Entries are allocated in chunks that are reused
+// through a free list and never deleted, so adding a callback doesn't
+// allocate in the common case and a stale callback reference never points
+// at freed memory.
 class CallbackDispatcher {
  public:
-  CallbackDispatcher() {}
-
-  ~CallbackDispatcher() {
-    MutexLock lock(*queue_.mutex());
-    // Destroy all callbacks in this dispatcher's queue.
-    size_t remaining_callbacks = queue_.size();
-    if (remaining_callbacks) {
-      LogWarning("Callback dispatcher shut down with %d pending callbacks",
-                 remaining_callbacks);
-    }
-    while (!queue_.empty()) {
-      queue_.back().reset();
-      queue_.pop_back();
-    }
+  CallbackDispatcher()
+      : head_(&stub_), tail_(&stub_), free_head_(kNoEntry), chunk_count_(0) {
+    for (uint32_t i = 0; i < kMaxChunks; ++i) chunks_[i].store(nullptr);
+    Grow();
   }
 
   // Add a callback to the dispatch queue returning a reference
   // to the entry which can be optionally be removed prior to dispatch.
   void* AddCallback(Callback* callback) {
-    auto entry = std::make_shared<CallbackEntry>(callback, &execution_mutex_);
-    MutexLock lock(*queue_.mutex());
-    queue_.push_back(entry);
-    return entry.get();
+    CallbackEntry* entry = AllocateEntry();
+    uintptr_t generation = entry->Reset(callback);
+    Push(entry);
+    return reinterpret_cast<void*>((generation << kIndexBits) | entry->index);
   }
 
   // Remove the callback reference from the specified entry.
@@ -135,123 +170,291 @@ class CallbackDispatcher {
   // NOTE: This does not remove the callback from the execution queue.
   // The queue is flushed on a call to DispatchCallbacks().
   bool DisableCallback(void* callback_reference) {
-    MutexLock lock(*queue_.mutex());
-    CallbackEntry* callback_entry =
-        static_cast<CallbackEntry*>(callback_reference);
-    return callback_entry->DisableCallback();
+    uintptr_t reference = reinterpret_cast<uintptr_t>(callback_reference);
+    uint32_t index = static_cast<uint32_t>(reference & kIndexMask);
+    if (index / kChunkSize >= kMaxChunks) return false;
+    CallbackEntry* chunk =
+        chunks_[index / kChunkSize].load(std::memory_order_acquire);
+    if (!chunk) return false;
+    return chunk[index % kChunkSize].DisableCallback(reference >> kIndexBits);
   }
-
   // Dispatch queued callbacks returning the number of callbacks that were
   // dispatched and removed from the queue.
   int DispatchCallbacks() {
     int dispatched = 0;
-    Mutex* queue_mutex = queue_.mutex();
-    queue_mutex->Acquire();
-    while (!queue_.empty()) {
-      // Make a copy of the std::shared_ptr in case FlushCallbacks() is called
-      // currently.
-      std::shared_ptr<CallbackEntry> callback_entry = queue_.front();
-      queue_.pop_front();
-      queue_mutex->Release();
-      callback_entry->Execute();
-      dispatched++;
-      queue_mutex->Acquire();
-      callback_entry.reset();
+    while (true) {
+      // Take all queued entries at once then run them without holding the
+      // lock, so that callbacks don't contend with FlushCallbacks().
+      CallbackEntry* batch;
+      {
+        MutexLock lock(consumer_mutex_);
+        batch = PopAll();
+      }
+      if (!batch) break;
+      while (batch) {
+        CallbackEntry* entry = batch;
+        batch = entry->next.load(std::memory_order_relaxed);
+        entry->Execute();
+        ReleaseEntry(entry);
+        dispatched++;
+      }
     }
-    queue_mutex->Release();
     return dispatched;
   }
 
   // Flush pending callbacks from the queue without executing them.
   int FlushCallbacks() {
+    CallbackEntry* batch;
+    {
+      MutexLock lock(consumer_mutex_);
+      batch = PopAll();
+    }
     int flushed = 0;
-    MutexLock lock(*queue_.mutex());
-    while (!queue_.empty()) {
-      queue_.front().reset();
-      queue_.pop_front();
+    while (batch) {
+      CallbackEntry* entry = batch;
+      batch = entry->next.load(std::memory_order_relaxed);
+      entry->DisableCallback();
+      ReleaseEntry(entry);
       flushed++;
     }
     return flushed;
   }
 
  private:
-  CallbackQueue queue_;
-  // Mutex that is held for the duration of each callback.  This prevents the
-  // destruction of a callback until execution is complete.
-  Mutex execution_mutex_;
+  static const uint32_t kChunkSize = 1024;
+  static const uint32_t kMaxChunks =
+      static_cast<uint32_t>((kIndexMask + 1) / kChunkSize);
+  static const uint32_t kNoEntry = UINT32_MAX;
+
+  CallbackEntry* GetEntry(uint32_t index) {
+    return chunks_[index / kChunkSize].load(std::memory_order_acquire) +
+           index % kChunkSize;
+  }
+
+  // Add an entry to the back of the queue.
+  void Push(CallbackEntry* entry) {
+    entry->next.store(nullptr, std::memory_order_relaxed);
+    CallbackEntry* previous = head_.exchange(entry, std::memory_order_acq_rel);
+    // Until this store the entry can't be reached from tail_, so the consumer
+    // treats it as not yet added.
+    previous->next.store(entry, std::memory_order_release);
+  }
+
+  // Remove the entries that have been added to the queue, returning them as a
+  // list linked through CallbackEntry::next. consumer_mutex_ must be held.
+  CallbackEntry* PopAll() {
+    CallbackEntry* first = nullptr;
+    CallbackEntry* last = nullptr;
+    while (CallbackEntry* entry = Pop()) {
+      entry->next.store(nullptr, std::memory_order_relaxed);
+      if (last) {
+        last->next.store(entry, std::memory_order_relaxed);
+      } else {
+        first = entry;
+      }
+      last = entry;
+    }
+    return first;
+  }
+
+  // Remove the entry at the front of the queue, returns nullptr if the queue
+  // is empty or the next entry is still being added.
+  CallbackEntry* Pop() {
+    CallbackEntry* tail = tail_;
+    CallbackEntry* next = tail->next.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (!next) return nullptr;
+      tail_ = next;
+      tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next) {
+      tail_ = next;
+      return tail;
+    }
+    if (tail != head_.load(std::memory_order_acquire)) return nullptr;
+    // tail is the last entry, requeue the stub behind it so that it can be
+    // removed.
+    Push(&stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next) {
+      tail_ = next;
+      return tail;
+    }
+    return nullptr;
+  }
+
+  // Get an unused entry, adding a chunk of entries if none is free.
+  CallbackEntry* AllocateEntry() {
+    uint64_t head = free_head_.load(std::memory_order_acquire);
+    while (true) {
+      uint32_t index = static_cast<uint32_t>(head);
+      if (index == kNoEntry) {
+        Grow();
+        head = free_head_.load(std::memory_order_acquire);
+        continue;
+      }
+      // The tag in the upper half of free_head_ changes on every update so
+      // that an entry that was taken and returned meanwhile isn't mistaken
+      // for an unchanged list.
+      uint64_t next =
+          (((head >> 32) + 1) << 32) |
+          GetEntry(index)->next_free.load(std::memory_order_relaxed);
+      if (free_head_.compare_exchange_weak(head, next,
+                                           std::memory_order_acq_rel)) {
+        return GetEntry(index);
+      }
+    }
+  }
+
+  // Add a chunk of entries to the free list, unless another thread added
+  // entries meanwhile.
+  void Grow() {
+    MutexLock lock(grow_mutex_);
+    if (static_cast<uint32_t>(free_head_.load(std::memory_order_acquire)) !=
+        kNoEntry) {
+      return;
+    }
+    FIREBASE_ASSERT_MESSAGE(chunk_count_ < kMaxChunks,
+                            "Too many pending callbacks");
+    CallbackEntry* chunk = new CallbackEntry[kChunkSize];
+    for (uint32_t i = 0; i < kChunkSize; ++i) {
+      chunk[i].index = chunk_count_ * kChunkSize + i;
+    }
+    chunks_[chunk_count_++].store(chunk, std::memory_order_release);
+    for (uint32_t i = kChunkSize; i > 0; --i) ReleaseEntry(&chunk[i - 1]);
+  }
+
+  // Return an entry to the free list.
+  void ReleaseEntry(CallbackEntry* entry) {
+    uint32_t index = entry->index;
+    uint64_t head = free_head_.load(std::memory_order_relaxed);
+    do {
+      entry->next_free.store(static_cast<uint32_t>(head),
+                             std::memory_order_relaxed);
+    } while (!free_head_.compare_exchange_weak(
+        head, (((head >> 32) + 1) << 32) | index, std::memory_order_acq_rel));
+  }
+
+  // Most recently added entry.
+  std::atomic<CallbackEntry*> head_;
+  // Oldest entry in the queue, only accessed by the consumer.
+  CallbackEntry* tail_;
+  // Placeholder that keeps the queue non-empty.
+  CallbackEntry stub_;
+  // Held while removing entries from the queue, since callbacks can be
+  // flushed from any thread.
+  Mutex consumer_mutex_;
+  // Tag in the upper 32 bits and the index of the first free entry in the
+  // lower 32 bits.
+  std::atomic<uint64_t> free_head_;
+  // Held while adding a chunk.
+  Mutex grow_mutex_;
+  // Chunks of kChunkSize entries, entry i is in chunk i / kChunkSize.
+  std::atomic<CallbackEntry*> chunks_[kMaxChunks];
+  uint32_t chunk_count_;
 };
 
-static CallbackDispatcher* g_callback_dispatcher = nullptr;
-// Mutex that controls access to g_callback_dispatcher and g_callback_ref_count.
+// The dispatcher is never destroyed so that callbacks can be added without
+// taking a lock to keep it alive.
+static CallbackDispatcher* GetCallbackDispatcher() {
+  static CallbackDispatcher* dispatcher = new CallbackDispatcher();
+  return dispatcher;
+}
+
+// Number of references to the module: pending callbacks, initializations and
+// active calls to PollCallbacks() or RemoveCallback().
+static std::atomic<int> g_callback_ref_count(0);
+// Mutex that is held while the reference count moves away from or to 0, so
+// that callbacks discarded when the module shuts down can't race with new
+// callbacks. Other updates of the reference count don't take the lock.
 static Mutex* g_callback_mutex = new Mutex();
-static int g_callback_ref_count = 0;
 static Thread::Id g_callback_thread_id;
 static bool g_callback_thread_id_initialized = false;
 
-void Initialize() {
-  MutexLock lock(*g_callback_mutex);
-  if (g_callback_ref_count == 0) {
-    g_callback_dispatcher = new CallbackDispatcher();
-  }
-  ++g_callback_ref_count;
-}
-
 // Add a reference to the module if it's already initialized.
 static bool InitializeIfInitialized() {
-  MutexLock lock(*g_callback_mutex);
-  if (IsInitialized()) {
-    Initialize();
-    return true;
+  int ref_count = g_callback_ref_count.load(std::memory_order_acquire);
+  while (ref_count > 0) {
+    if (g_callback_ref_count.compare_exchange_weak(ref_count, ref_count + 1,
+                                                   std::memory_order_acq_rel)) {
+      return true;
+    }
   }
   return false;
 }
 
-bool IsInitialized() { return g_callback_ref_count > 0; }
+void Initialize() {
+  if (!InitializeIfInitialized()) {
+    MutexLock lock(*g_callback_mutex);
+    g_callback_ref_count.fetch_add(1, std::memory_order_acq_rel);
+  }
+}
+
+bool IsInitialized() {
+  return g_callback_ref_count.load(std::memory_order_acquire) > 0;
+}
 
 // Remove number_of_references_to_remove from the module, clean up if the
 // reference count reaches 0, do nothing if the reference count is already 0.
 static void Terminate(int number_of_references_to_remove) {
-  CallbackDispatcher* dispatcher_to_destroy = nullptr;
-  {
-    MutexLock lock(*g_callback_mutex);
-    if (!g_callback_ref_count) {
+  int ref_count = g_callback_ref_count.load(std::memory_order_acquire);
+  while (ref_count > number_of_references_to_remove) {
+    if (g_callback_ref_count.compare_exchange_weak(
+            ref_count, ref_count - number_of_references_to_remove,
+            std::memory_order_acq_rel)) {
+      return;
+    }
+  }
+
+  MutexLock lock(*g_callback_mutex);
+  int new_ref_count;
+  ref_count = g_callback_ref_count.load(std::memory_order_acquire);
+  do {
+    if (!ref_count) {
       LogWarning("Callback module already shut down");
       return;
     }
-    g_callback_ref_count =
-        g_callback_ref_count - number_of_references_to_remove;
-    if (g_callback_ref_count < 0) {
-      LogDebug("WARNING: Callback module ref count = %d", g_callback_ref_count);
+    new_ref_count = ref_count - number_of_references_to_remove;
+    if (new_ref_count < 0) {
+      LogDebug("WARNING: Callback module ref count = %d", new_ref_count);
+      new_ref_count = 0;
     }
-    g_callback_ref_count = g_callback_ref_count < 0 ? 0 : g_callback_ref_count;
-    if (g_callback_ref_count == 0) {
-      dispatcher_to_destroy = g_callback_dispatcher;
-      g_callback_dispatcher = nullptr;
+  } while (!g_callback_ref_count.compare_exchange_weak(
+      ref_count, new_ref_count, std::memory_order_acq_rel));
+  if (new_ref_count == 0) {
+    // Destroy all callbacks in the queue.
+    int remaining_callbacks = GetCallbackDispatcher()->FlushCallbacks();
+    if (remaining_callbacks) {
+      LogWarning("Callback dispatcher shut down with %d pending callbacks",
+                 remaining_callbacks);
     }
   }
-  // This method can be called a "lot" so only call delete if we really have
-  // something to delete.
-  if (dispatcher_to_destroy) delete dispatcher_to_destroy;
 }
 
 void Terminate(bool flush_all) {
   MutexLock lock(*g_callback_mutex);
   int ref_count = 1;
   // g_callback_ref_count is used to track the number of current references to
-  // g_callback_dispatcher so we need to decrement the reference count by just
+  // the dispatcher so we need to decrement the reference count by just
   // the outstanding number of items in the queue.  In particular,
   // PollDispatcher() could be executing at this point since g_callback_mutex
   // isn't held by the ref count is > 0 for the duration of the function.
-  if (flush_all && g_callback_dispatcher) {
-    ref_count += g_callback_dispatcher->FlushCallbacks();
+  if (flush_all && IsInitialized()) {
+    ref_count += GetCallbackDispatcher()->FlushCallbacks();
   }
   Terminate(ref_count);
 }
 
 void* AddCallback(Callback* callback) {
+  if (InitializeIfInitialized()) {
+    return GetCallbackDispatcher()->AddCallback(callback);
+  }
+  // Add the first reference with the lock held so the callback isn't
+  // discarded by a concurrent shut down.
   MutexLock lock(*g_callback_mutex);
   Initialize();
-  return g_callback_dispatcher->AddCallback(callback);
+  return GetCallbackDispatcher()->AddCallback(callback);
 }
 
 // TODO(chkuang): remove this once we properly implement C++->C# log callback.
@@ -310,7 +513,7 @@ void RemoveCallback(void* callback_reference) {
     // remove the CallbackEntry from the queue so we don't need an additional
     // Terminate() here to decrement the reference count that was added by
     // AddCallback().
-    g_callback_dispatcher->DisableCallback(callback_reference);
+    GetCallbackDispatcher()->DisableCallback(callback_reference);
     Terminate(false);
   }
 }
@@ -326,7 +529,7 @@ void PollCallbacks() {
     g_callback_thread_id = Thread::CurrentId();
     g_callback_thread_id_initialized = true;
     // Execute callbacks.
-    int dispatched = g_callback_dispatcher->DispatchCallbacks();
+    int dispatched = GetCallbackDispatcher()->DispatchCallbacks();
     // +1 added to the references to remove as we added a reference in
     // InitializeIfInitialized().
     Terminate(dispatched + 1);
@@ -385,6 +385,7 @@ void AddBlockingCallback(Callback* callback);
 
 /// Removes a Callback, using the reference returned by AddCallback(), from
 /// the queue to be called from PollCallbacks().
+/// Does nothing if the callback has already been executed or removed.
 void RemoveCallback(void* callback_reference);
 
 /// Calls all pending callbacks added using AddCallback() since the last call.
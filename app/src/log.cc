@@ -19,12 +19,18 @@
 #include <stdarg.h>
 #include <stdio.h>
 
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 
 #include "app/src/assert.h"
 #include "app/src/include/firebase/internal/mutex.h"
 #include "app/src/include/firebase/internal/platform.h"
+#include "app/src/semaphore.h"
+#include "app/src/thread.h"
+#include "app/src/time.h"
 
 #if !defined(FIREBASE_LOG_DEBUG)
 #define FIREBASE_LOG_DEBUG 0
@@ -49,13 +55,17 @@ const LogLevel kDefaultLogLevel = kLogLevelDebug;
 const LogLevel kDefaultLogLevel = kLogLevelInfo;
 #endif  // FIREBASE_LOG_DEBUG
 
-LogLevel g_log_level = kDefaultLogLevel;
+// Read without a lock so that filtered messages are discarded without
+// contention.
+std::atomic<LogLevel> g_log_level(kDefaultLogLevel);
 LogCallback g_log_callback = DefaultLogCallback;
 void* g_log_callback_data = nullptr;
-// Mutex which controls access to the log buffer used to format callback
-// log messages.
+// Mutex which serializes calls to the log callback.
 Mutex* g_log_mutex = nullptr;
 
+// Size of the buffer each message is formatted into.
+static const size_t kLogMessageSize = 512;
+
 // Initialize g_log_mutex when static constructors are called.
 // This class makes sure g_log_mutex is initialized typically initialized
 // before the first log function is called.
@@ -129,36 +139,225 @@ static void LogToFile(LogLevel log_level, const char* format, va_list args) {
 }
 #endif  // FIREBASE_LOG_TO_FILE
 
+namespace {
+
+// Bounded queue of formatted messages that are delivered to the log callback
+// by a background thread. Any thread can add a message without taking a lock.
+// The sink is never destroyed as threads may be adding messages when
+// asynchronous logging is disabled.
+class AsyncLogSink {
+ public:
+  AsyncLogSink()
+      : enqueue_position_(0),
+        dequeue_position_(0),
+        dropped_(0),
+        pending_(0),
+        running_(false),
+        wake_(0),
+        thread_(nullptr) {
+    for (size_t i = 0; i < kQueueSize; ++i) {
+      queue_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Start the thread that delivers messages.
+  void Start() {
+    running_.store(true, std::memory_order_release);
+    thread_ = new Thread(ThreadRoutine, this);
+  }
+
+  // Stop the thread after delivering the queued messages.
+  void Stop() {
+    running_.store(false, std::memory_order_release);
+    wake_.Post();
+    thread_->Join();
+    delete thread_;
+    thread_ = nullptr;
+    // Deliver messages added while the thread was stopping.
+    DeliverQueued();
+  }
+
+  // Queue a message returning false, and counting the message as dropped, if
+  // the queue is full.
+  bool Add(LogLevel log_level, const char* message) {
+    size_t position = enqueue_position_.load(std::memory_order_relaxed);
+    Message* entry;
+    while (true) {
+      entry = &queue_[position % kQueueSize];
+      size_t sequence = entry->sequence.load(std::memory_order_acquire);
+      intptr_t difference =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      if (difference == 0) {
+        if (enqueue_position_.compare_exchange_weak(
+                position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      } else {
+        position = enqueue_position_.load(std::memory_order_relaxed);
+      }
+    }
+    entry->log_level = log_level;
+    strncpy(entry->text, message, sizeof(entry->text) - 1);
+    entry->text[sizeof(entry->text) - 1] = '\0';
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    entry->sequence.store(position + 1, std::memory_order_release);
+    wake_.Post();
+    return true;
+  }
+
+  // Wait until all queued messages have been delivered.
+  void Flush() {
+    while (running_.load(std::memory_order_acquire) &&
+           pending_.load(std::memory_order_acquire) > 0) {
+      wake_.Post();
+      internal::Sleep(1);
+    }
+  }
+
+ private:
+  struct Message {
+    std::atomic<size_t> sequence;
+    LogLevel log_level;
+    char text[kLogMessageSize];
+  };
+
+  static const size_t kQueueSize = 256;
+
+  static void ThreadRoutine(void* data) {
+    static_cast<AsyncLogSink*>(data)->Run();
+  }
+
+  void Run() {
+    while (true) {
+      wake_.Wait();
+      DeliverQueued();
+      if (!running_.load(std::memory_order_acquire)) {
+        DeliverQueued();
+        return;
+      }
+    }
+  }
+
+  // Deliver queued messages. Must only be called by one thread at a time.
+  void DeliverQueued() {
+    while (true) {
+      Message* entry = &queue_[dequeue_position_ % kQueueSize];
+      size_t sequence = entry->sequence.load(std::memory_order_acquire);
+      if (sequence != dequeue_position_ + 1) break;
+      {
+        MutexLock lock(*g_log_mutex);
+        g_log_callback(entry->log_level, entry->text, g_log_callback_data);
+      }
+      entry->sequence.store(dequeue_position_ + kQueueSize,
+                            std::memory_order_release);
+      dequeue_position_++;
+      pending_.fetch_sub(1, std::memory_order_release);
+    }
+    int dropped = dropped_.exchange(0, std::memory_order_relaxed);
+    if (dropped) {
+      char message[64];
+      snprintf(message, sizeof(message), "%d log messages dropped", dropped);
+      MutexLock lock(*g_log_mutex);
+      g_log_callback(kLogLevelWarning, message, g_log_callback_data);
+    }
+  }
+
+  Message queue_[kQueueSize];
+  std::atomic<size_t> enqueue_position_;
+  // Only accessed by the sink thread.
+  size_t dequeue_position_;
+  std::atomic<int> dropped_;
+  std::atomic<int> pending_;
+  std::atomic<bool> running_;
+  Semaphore wake_;
+  Thread* thread_;
+};
+
+// Set while messages are delivered from a background thread.
+std::atomic<bool> g_log_asynchronous(false);
+AsyncLogSink* g_async_log_sink = nullptr;
+
+}  // namespace
+
 // Log a firebase message (implemented by the platform specific logger).
 void LogMessageWithCallbackV(LogLevel log_level, const char* format,
                              va_list args) {
+#if !FIREBASE_LOG_TO_FILE
+  // Discard filtered messages before formatting or taking a lock.
+  if (log_level < GetLogLevel()) return;
+#endif  // !FIREBASE_LOG_TO_FILE
+
   // We create the mutex on the heap as this can be called before the C++
   // runtime is initialized on iOS.  This ensures the Mutex class is
   // constructed before we attempt to use it.  Of course, this isn't thread
   // safe but the first time this is called on any platform it will be from
   // a single thread to initialize the API.
   if (!g_log_mutex) g_log_mutex = new Mutex();
-  MutexLock lock(*g_log_mutex);
 
-  LogInitialize();
 #if FIREBASE_LOG_TO_FILE
-  va_list log_to_file_args;
-  va_copy(log_to_file_args, args);
-  LogToFile(log_level, format, log_to_file_args);
-#endif  // FIREBASE_LOG_TO_FILE
+  {
+    MutexLock lock(*g_log_mutex);
+    LogInitialize();
+    va_list log_to_file_args;
+    va_copy(log_to_file_args, args);
+    LogToFile(log_level, format, log_to_file_args);
+  }
   if (log_level < GetLogLevel()) return;
+#endif  // FIREBASE_LOG_TO_FILE
 
-  static char log_buffer[512] = {0};
+  // Each thread formats messages into its own buffer.
+  static thread_local char log_buffer[kLogMessageSize];
   vsnprintf(log_buffer, sizeof(log_buffer) - 1, format, args);
+
+  // Asserts are delivered synchronously as the default callback aborts.
+  // Other messages are dropped, and counted by the sink, if its queue is full,
+  // as delivering them here would put them ahead of queued messages.
+  if (log_level != kLogLevelAssert &&
+      g_log_asynchronous.load(std::memory_order_acquire)) {
+    g_async_log_sink->Add(log_level, log_buffer);
+    return;
+  }
+
+  MutexLock lock(*g_log_mutex);
+#if !FIREBASE_LOG_TO_FILE
+  LogInitialize();
+#endif  // !FIREBASE_LOG_TO_FILE
   g_log_callback(log_level, log_buffer, g_log_callback_data);
 }
 
+void LogSetAsynchronous(bool asynchronous) {
+  if (!g_log_mutex) g_log_mutex = new Mutex();
+  static Mutex* async_mutex = new Mutex();
+  MutexLock lock(*async_mutex);
+  if (asynchronous == g_log_asynchronous.load(std::memory_order_acquire)) {
+    return;
+  }
+  if (asynchronous) {
+    LogInitialize();
+    if (!g_async_log_sink) g_async_log_sink = new AsyncLogSink();
+    g_async_log_sink->Start();
+    g_log_asynchronous.store(true, std::memory_order_release);
+  } else {
+    g_log_asynchronous.store(false, std::memory_order_release);
+    g_async_log_sink->Stop();
+  }
+}
+
+void LogFlush() {
+  if (g_log_asynchronous.load(std::memory_order_acquire)) {
+    g_async_log_sink->Flush();
+  }
+}
+
 void SetLogLevel(LogLevel level) {
   g_log_level = level;
   LogSetPlatformLevel(level);
 }
 
-LogLevel GetLogLevel() { return g_log_level; }
+LogLevel GetLogLevel() { return g_log_level.load(std::memory_order_relaxed); }
 
 void LogSetLevel(LogLevel level) { SetLogLevel(level); }
 
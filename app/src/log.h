@@ -62,6 +62,14 @@ typedef void (*LogCallback)(LogLevel log_level, const char* log_message,
                             void* callback_data);
 // Set the log callback.
 void LogSetCallback(LogCallback callback, void* callback_data);
+// Deliver messages to the log callback from a background thread so that
+// logging doesn't wait for the callback. Messages are dropped if they're
+// logged faster than the callback handles them, and the number dropped is
+// then logged as a warning. Asserts are always delivered synchronously.
+// Disabled by default.
+void LogSetAsynchronous(bool asynchronous);
+// Wait until messages logged asynchronously have been delivered.
+void LogFlush();
 // Get the log callback.
 LogCallback LogGetCallback(void** callback_data);
 
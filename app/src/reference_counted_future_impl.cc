@@ -19,7 +19,9 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <new>
 #include <string>
+#include <type_traits>
 
 #include "app/src/assert.h"
 #include "app/src/include/firebase/future.h"
@@ -45,7 +47,6 @@ static_assert(sizeof(FutureBase) == sizeof(Future<int>),
               "Future should not introduce virtual functions or data members.");
 
 typedef void DataDeleteFn(void* data_to_delete);
-typedef std::pair<FutureHandleId, FutureBackingData*> BackingPair;
 
 // NOLINTNEXTLINE
 const FutureHandle ReferenceCountedFutureImpl::kInvalidHandle(
@@ -214,7 +215,7 @@ struct FutureBackingData {
 
   // Number of outstanding futures referencing this asynchronous call.
   // When this count reaches zero, this class is removed from the `backings_`
-  // map and deleted.
+  // table and deleted.
   uint32_t reference_count;
 
   // The call-specific result that is returned in Future<T>,
@@ -318,6 +319,154 @@ void FutureBackingData::SetSingleCallbackData(
   (*field_to_set) = callback;
 }
 
+// Holds FutureBackingData in fixed size chunks of slots that are reused as
+// Futures are released, so allocating a Future does not allocate a backing
+// from the heap once the table has grown to the number of Futures in flight.
+//
+// A FutureHandleId encodes the index of a slot (plus one, so that no id is
+// kInvalidFutureHandle) in the low bits and the generation of the slot in the
+// high bits. The generation is incremented each time a slot is freed so ids of
+// released Futures are not found when the slot is reused.
+//
+// This class is not thread-safe, it's guarded by
+// ReferenceCountedFutureImpl::mutex_.
+class FutureBackingTable {
+ public:
+  FutureBackingTable() : free_slot_(kNoSlot) {}
+  ~FutureBackingTable();
+
+  // Construct a backing in a free slot and return its id.
+  FutureHandleId Insert(void* data, DataDeleteFn* delete_data_fn);
+
+  // Get the backing for an id or nullptr if it has been removed.
+  FutureBackingData* Find(FutureHandleId id) const;
+
+  // Remove the backing from the table so that its id is no longer found.
+  // The backing remains allocated until it's passed to Recycle().
+  FutureBackingData* Remove(FutureHandleId id);
+
+  // Make the slot of a removed and destroyed backing available for reuse.
+  void Recycle(FutureBackingData* backing);
+
+  // Call fn(id, backing) for each backing in the table.
+  template <typename F>
+  void ForEach(const F& fn) const {
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+      for (uint32_t j = 0; j < kChunkSize; ++j) {
+        const Slot& slot = chunks_[i][j];
+        if (slot.in_use) {
+          fn(MakeId(static_cast<uint32_t>(i * kChunkSize + j), slot.generation),
+             slot.backing());
+        }
+      }
+    }
+  }
+
+ private:
+  struct Slot {
+    FutureBackingData* backing() const {
+      return reinterpret_cast<FutureBackingData*>(
+          const_cast<StorageType*>(&storage));
+    }
+
+    typedef std::aligned_storage<sizeof(FutureBackingData),
+                                 alignof(FutureBackingData)>::type StorageType;
+    // Must be the first member, see SlotFromBacking().
+    StorageType storage;
+    FutureHandleId generation;
+    // Index of this slot in the table.
+    uint32_t index;
+    // Next slot in the free list, if this slot is free.
+    uint32_t next_free;
+    // Whether storage holds a backing that can be found by id.
+    bool in_use;
+  };
+
+  static const uint32_t kChunkSize = 64;
+  static const uint32_t kNoSlot = UINT32_MAX;
+  // Half of the id holds the slot index on 64-bit platforms. 32-bit
+  // platforms use 20 bits, allowing a million Futures to be in flight at a
+  // time.
+  static const int kSlotBits = sizeof(FutureHandleId) >= 8 ? 32 : 20;
+  static const FutureHandleId kSlotMask =
+      (static_cast<FutureHandleId>(1) << kSlotBits) - 1;
+  static const FutureHandleId kGenerationMask =
+      static_cast<FutureHandleId>(-1) >> kSlotBits;
+
+  static FutureHandleId MakeId(uint32_t index, FutureHandleId generation) {
+    return (generation << kSlotBits) | (static_cast<FutureHandleId>(index) + 1);
+  }
+
+  static Slot* SlotFromBacking(FutureBackingData* backing) {
+    static_assert(std::is_standard_layout<Slot>::value,
+                  "Slot::storage must be at the start of Slot");
+    return reinterpret_cast<Slot*>(backing);
+  }
+
+  Slot* SlotFromId(FutureHandleId id) const;
+
+  std::vector<Slot*> chunks_;
+  uint32_t free_slot_;
+};
+
+FutureBackingTable::~FutureBackingTable() {
+  // Backings are destroyed by the owner before the table.
+  for (Slot* chunk : chunks_) delete[] chunk;
+}
+
+FutureHandleId FutureBackingTable::Insert(void* data,
+                                          DataDeleteFn* delete_data_fn) {
+  if (free_slot_ == kNoSlot) {
+    uint32_t first = static_cast<uint32_t>(chunks_.size() * kChunkSize);
+    FIREBASE_ASSERT(first + kChunkSize - 1 <= kSlotMask);
+    Slot* chunk = new Slot[kChunkSize];
+    for (uint32_t i = 0; i < kChunkSize; ++i) {
+      chunk[i].generation = 0;
+      chunk[i].index = first + i;
+      chunk[i].next_free = i + 1 < kChunkSize ? first + i + 1 : kNoSlot;
+      chunk[i].in_use = false;
+    }
+    chunks_.push_back(chunk);
+    free_slot_ = first;
+  }
+  uint32_t index = free_slot_;
+  Slot& slot = chunks_[index / kChunkSize][index % kChunkSize];
+  free_slot_ = slot.next_free;
+  new (&slot.storage) FutureBackingData(data, delete_data_fn);
+  slot.in_use = true;
+  return MakeId(index, slot.generation);
+}
+
+FutureBackingTable::Slot* FutureBackingTable::SlotFromId(
+    FutureHandleId id) const {
+  if ((id & kSlotMask) == 0) return nullptr;
+  FutureHandleId index = (id & kSlotMask) - 1;
+  if (index / kChunkSize >= chunks_.size()) return nullptr;
+  Slot* slot = &chunks_[index / kChunkSize][index % kChunkSize];
+  return slot->in_use && slot->generation == (id >> kSlotBits) ? slot
+                                                                : nullptr;
+}
+
+FutureBackingData* FutureBackingTable::Find(FutureHandleId id) const {
+  Slot* slot = SlotFromId(id);
+  return slot ? slot->backing() : nullptr;
+}
+
+FutureBackingData* FutureBackingTable::Remove(FutureHandleId id) {
+  Slot* slot = SlotFromId(id);
+  if (!slot) return nullptr;
+  slot->in_use = false;
+  slot->generation = (slot->generation + 1) & kGenerationMask;
+  return slot->backing();
+}
+
+void FutureBackingTable::Recycle(FutureBackingData* backing) {
+  Slot* slot = SlotFromBacking(backing);
+  FIREBASE_ASSERT(!slot->in_use);
+  slot->next_free = free_slot_;
+  free_slot_ = slot->index;
+}
+
 namespace detail {
 
 // Non-inline implementation of FutureApiInterface's virtual destructor
@@ -329,6 +478,10 @@ FutureApiInterface::~FutureApiInterface() {}
 const char ReferenceCountedFutureImpl::kErrorMessageFutureIsNoLongerValid[] =
     "Invalid Future";
 
+ReferenceCountedFutureImpl::ReferenceCountedFutureImpl(
+    size_t last_result_count)
+    : backings_(new FutureBackingTable()), last_results_(last_result_count) {}
+
 ReferenceCountedFutureImpl::~ReferenceCountedFutureImpl() {
   // All futures should be released before we destroy ourselves.
   for (size_t i = 0; i < last_results_.size(); ++i) {
@@ -339,34 +492,31 @@ ReferenceCountedFutureImpl::~ReferenceCountedFutureImpl() {
   cleanup_.CleanupAll();
   cleanup_handles_.CleanupAll();
 
-  // TODO(jsanmiya): Change this to use unique_ptr so deletion is automatic.
-  while (!backings_.empty()) {
-    auto it = backings_.begin();
+  std::vector<FutureHandleId> remaining;
+  backings_->ForEach([&remaining](FutureHandleId id, FutureBackingData*) {
+    remaining.push_back(id);
+  });
+  for (FutureHandleId id : remaining) {
+    // Deleting a backing can release others, e.g. the clients of a proxy.
+    FutureBackingData* backing = backings_->Remove(id);
+    if (backing == nullptr) continue;
     LogWarning(
         "Future with handle %d still exists though its backing API"
         " 0x%X is being deleted. Please call Future::Release() before"
         " deleting the backing API.",
-        it->first, static_cast<int>(reinterpret_cast<uintptr_t>(this)));
-
-    FutureBackingData* backing = it->second;
-    backings_.erase(it);
-    delete backing;
+        static_cast<int>(id),
+        static_cast<int>(reinterpret_cast<uintptr_t>(this)));
+    backing->~FutureBackingData();
+    backings_->Recycle(backing);
   }
 }
 
 FutureHandle ReferenceCountedFutureImpl::AllocInternal(
     int fn_idx, void* data, void (*delete_data_fn)(void* data_to_delete)) {
   // Backings get deleted in ReleaseFuture() and ~ReferenceCountedFutureImpl().
-  FutureBackingData* backing = new FutureBackingData(data, delete_data_fn);
-
-  // Allocate a unique handle and insert the new backing into the map.
-  // Note that it's theoretically possible to have a handle collision if we
-  // allocate four billion more handles before releasing one. We ignore this
-  // possibility.
   MutexLock lock(mutex_);
-  const FutureHandleId id = AllocHandleId();
+  const FutureHandleId id = backings_->Insert(data, delete_data_fn);
   FIREBASE_FUTURE_TRACE("API: Allocated handle id %d", id);
-  backings_.insert(BackingPair(id, backing));
   const FutureHandle handle(id, this);
 
   // Update the most recent Future for this function.
@@ -487,32 +637,41 @@ void ReferenceCountedFutureImpl::ReferenceFuture(const FutureHandle& handle) {
 }
 
 void ReferenceCountedFutureImpl::ReleaseFuture(const FutureHandle& handle) {
-  MutexLock lock(mutex_);
-  FIREBASE_FUTURE_TRACE("API: Release future %d", (int)handle.id());
-
-  // If a Future exists with a handle, then the backing should still exist for
-  // it, too. However it might be possible during the deallocate phase when
-  // FutureBase and FutureHandle and FutureProxyManager are still having
-  // dependencies.
-  auto it = backings_.find(handle.id());
-  if (it == backings_.end()) {
-    return;
-  }
+  FutureBackingData* backing;
+  {
+    MutexLock lock(mutex_);
+    FIREBASE_FUTURE_TRACE("API: Release future %d", (int)handle.id());
+
+    // If a Future exists with a handle, then the backing should still exist
+    // for it, too. However it might be possible during the deallocate phase
+    // when FutureBase and FutureHandle and FutureProxyManager are still having
+    // dependencies.
+    backing = BackingFromHandle(handle.id());
+    if (backing == nullptr) {
+      return;
+    }
 
-  // Decrement the reference count.
-  FutureBackingData* backing = it->second;
-  FIREBASE_ASSERT(backing->reference_count > 0);
-  backing->reference_count--;
+    // Decrement the reference count.
+    FIREBASE_ASSERT(backing->reference_count > 0);
+    backing->reference_count--;
 
-  FIREBASE_FUTURE_TRACE("API: Release handle %d, ref count %d", handle.id(),
-                        BackingFromHandle(handle.id())->reference_count);
+    FIREBASE_FUTURE_TRACE("API: Release handle %d, ref count %d", handle.id(),
+                          backing->reference_count);
 
-  // If asynchronous call is no longer referenced, delete the backing struct.
-  if (backing->reference_count == 0) {
-    backings_.erase(it);
-    delete backing;
-    backing = nullptr;
+    // If asynchronous call is still referenced, keep the backing struct.
+    if (backing->reference_count != 0) {
+      return;
+    }
+    backings_->Remove(handle.id());
   }
+
+  // Once removed from the table the backing can't be reached by any handle,
+  // so the result, context data and callbacks are destroyed without holding
+  // the lock unless the caller holds it.
+  backing->~FutureBackingData();
+
+  MutexLock lock(mutex_);
+  backings_->Recycle(backing);
 }
 
 FutureStatus ReferenceCountedFutureImpl::GetFutureStatus(
@@ -549,8 +708,7 @@ const void* ReferenceCountedFutureImpl::GetFutureResult(
 FutureBackingData* ReferenceCountedFutureImpl::BackingFromHandle(
     FutureHandleId id) {
   MutexLock lock(mutex_);
-  auto it = backings_.find(id);
-  return it == backings_.end() ? nullptr : it->second;
+  return backings_->Find(id);
 }
 
 detail::CompletionCallbackHandle
@@ -705,10 +863,12 @@ ReferenceCountedFutureImpl::AddCompletionCallbackLambda(
 bool ReferenceCountedFutureImpl::IsSafeToDelete() const {
   MutexLock lock(mutex_);
   // Check if any Futures we have are still pending.
-  for (auto i = backings_.begin(); i != backings_.end(); ++i) {
-    // If any Future is still pending, not safe to delete.
-    if (i->second->status == kFutureStatusPending) return false;
-  }
+  bool pending = false;
+  backings_->ForEach([&pending](FutureHandleId, FutureBackingData* backing) {
+    if (backing->status == kFutureStatusPending) pending = true;
+  });
+  // If any Future is still pending, not safe to delete.
+  if (pending) return false;
 
   if (is_running_callback_) {
     return false;
@@ -727,10 +887,11 @@ bool ReferenceCountedFutureImpl::IsReferencedExternally() const {
 
   int total_references = 0;
   int internal_references = 0;
-  for (auto i = backings_.begin(); i != backings_.end(); ++i) {
-    // Count the total number of references to all valid Futures.
-    total_references += i->second->reference_count;
-  }
+  backings_->ForEach(
+      [&total_references](FutureHandleId, FutureBackingData* backing) {
+        // Count the total number of references to all valid Futures.
+        total_references += backing->reference_count;
+      });
   for (int i = 0; i < last_results_.size(); i++) {
     if (last_results_[i].status() != kFutureStatusInvalid) {
       // If the status is not invalid, this entry is using up a reference.
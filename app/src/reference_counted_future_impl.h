@@ -19,7 +19,7 @@
 
 #include <cassert>
 #include <functional>
-#include <map>
+#include <memory>
 #include <vector>
 
 #include "app/src/assert.h"
@@ -34,6 +34,9 @@ namespace firebase {
 // ReferenceCountedFutureImpl and indexed by FutureHandleId.
 struct FutureBackingData;
 
+// Slab-allocated table of FutureBackingData, indexed by FutureHandleId.
+class FutureBackingTable;
+
 // Value for an invalid future handle. Default futures (which don't reference
 // any real operation) have this handle ID.
 const FutureHandleId kInvalidFutureHandle = 0;
@@ -113,9 +116,7 @@ class ReferenceCountedFutureImpl : public detail::FutureApiInterface {
   /// function.
   static constexpr int kNoFunctionIndex = -1;
 
-  explicit ReferenceCountedFutureImpl(size_t last_result_count)
-      : next_future_handle_(kInvalidFutureHandle + 1),
-        last_results_(last_result_count) {}
+  explicit ReferenceCountedFutureImpl(size_t last_result_count);
   ~ReferenceCountedFutureImpl() override;
 
   // Implementation of detail::FutureApiInterface.
@@ -429,15 +430,6 @@ class ReferenceCountedFutureImpl : public detail::FutureApiInterface {
     delete static_cast<T*>(ptr_to_delete);
   }
 
-  /// Allocate a new handle. It's unlikely that we'll ever allocate four
-  /// billion of these to loop back to the start, but just in case, skip over
-  /// the one marked as kInvalidFutureHandle.
-  FutureHandleId AllocHandleId() {
-    const FutureHandleId id = next_future_handle_++;
-    if (next_future_handle_ == kInvalidFutureHandle) next_future_handle_++;
-    return id;
-  }
-
   /// Return the backing data for the previously allocated `handle`, if it
   /// is still valid, or nullptr otherwise.
   /// The backing data is an internal object that holds the reference count,
@@ -560,14 +552,11 @@ class ReferenceCountedFutureImpl : public detail::FutureApiInterface {
   mutable Mutex mutex_;
 
   /// Hold backing data for all Futures.
-  /// Indexed by the FutureHandle, which is a unique integer used by the
-  /// Future to access the backing data. The backing data is deleted once no
-  /// more Futures reference it.
-  // TODO(jsanmiya): Use unordered_map when available (i.e. when not stlport).
-  std::map<FutureHandleId, FutureBackingData*> backings_;
-
-  /// A unique int that is incremented by one after every call to @ref Alloc.
-  FutureHandleId next_future_handle_;
+  /// Indexed by the FutureHandle, which encodes a slot in the table and the
+  /// generation of that slot, so a handle is no longer found once its backing
+  /// is deleted even if the slot is reused. The backing data is deleted once
+  /// no more Futures reference it.
+  std::unique_ptr<FutureBackingTable> backings_;
 
   /// Optionally keep a future around for the most recent call to a function.
   /// The functions are specified in `fn_idx` of @ref Alloc.
@@ -19,6 +19,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "app/src/include/firebase/internal/mutex.h"
 #include "app/src/thread.h"
@@ -165,6 +166,19 @@ TEST_F(CallbackTest, AddRemoveCallback) {
   EXPECT_THAT(callback_void_count_, Eq(0));
 }
 
+// Removing a callback that has already run doesn't affect a callback added
+// afterwards, which may reuse its entry.
+TEST_F(CallbackTest, RemoveDispatchedCallback) {
+  void* callback_reference =
+      callback::AddCallback(new callback::CallbackVoid(CountCallbackVoid));
+  callback::PollCallbacks();
+  EXPECT_THAT(callback_void_count_, Eq(1));
+  callback::AddCallback(new callback::CallbackVoid(CountCallbackVoid));
+  callback::RemoveCallback(callback_reference);
+  callback::PollCallbacks();
+  EXPECT_THAT(callback_void_count_, Eq(2));
+}
+
 // Call a void callback.
 TEST_F(CallbackTest, CallVoidCallback) {
   callback::AddCallback(new callback::CallbackVoid(CountCallbackVoid));
@@ -460,6 +474,35 @@ TEST_F(CallbackTest, AddCallbackWithThreadCheckTest) {
   EXPECT_THAT(callback::IsInitialized(), Eq(false));
 }
 
+// Many threads add callbacks while one thread polls, and each callback is
+// run exactly once.
+TEST_F(CallbackTest, ManyProducers) {
+  const int kNumProducers = 8;
+  const int kCallbacksPerProducer = 20000;
+  const int kTotalCallbacks = kNumProducers * kCallbacksPerProducer;
+
+  callback::Initialize();
+  std::vector<Thread*> producers;
+  for (int i = 0; i < kNumProducers; ++i) {
+    producers.push_back(new Thread([]() {
+      for (int j = 0; j < kCallbacksPerProducer; ++j) {
+        callback::AddCallback(new callback::CallbackVoid(CountCallbackVoid));
+      }
+    }));
+  }
+  while (callback_void_count_ < kTotalCallbacks) {
+    callback::PollCallbacks();
+  }
+  for (Thread* producer : producers) {
+    producer->Join();
+    delete producer;
+  }
+  callback::PollCallbacks();
+  EXPECT_THAT(callback_void_count_, Eq(kTotalCallbacks));
+  callback::Terminate(false);
+  EXPECT_THAT(callback::IsInitialized(), Eq(false));
+}
+
 TEST_F(CallbackTest, CallbackDeadlockTest) {
   // This is to test the deadlock scenario when CallbackEntry::Execute() and
   // CallbackEntry::DisableCallback() are called at the same time.
@@ -235,6 +235,27 @@ TEST_F(FutureTest, TestDetachFutureHandle) {
   EXPECT_FALSE(future_impl_.ValidFuture(id));
 }
 
+// Test that the handle of a released future stays invalid when its backing
+// storage is reused.
+TEST_F(FutureTest, TestReusedBackingIsNotFoundByOldHandle) {
+  future_ = Future<TestResult>();
+  FutureHandleId released_id;
+  {
+    SafeFutureHandle<TestResult> handle = future_impl_.SafeAlloc<TestResult>();
+    released_id = handle.get().id();
+  }
+  EXPECT_FALSE(future_impl_.ValidFuture(released_id));
+
+  std::vector<SafeFutureHandle<TestResult>> handles;
+  for (int i = 0; i < 200; ++i) {
+    handles.push_back(future_impl_.SafeAlloc<TestResult>());
+    EXPECT_NE(released_id, handles.back().get().id());
+    EXPECT_TRUE(future_impl_.ValidFuture(handles.back()));
+  }
+  EXPECT_FALSE(future_impl_.ValidFuture(released_id));
+  EXPECT_FALSE(future_impl_.ValidFuture(kInvalidFutureHandle));
+}
+
 // Test that a future becomes invalid when you release it.
 TEST_F(FutureTest, TestReleasedFutureGoesInvalid) {
   EXPECT_THAT(future_.status(), Eq(kFutureStatusPending));
@@ -871,6 +892,47 @@ TEST_F(FutureTest, TestHighQps) {
   }
 }
 
+// Allocate, complete and release futures from several threads at once, which
+// all share the slot table.
+TEST_F(FutureTest, TestConcurrentAllocCompleteRelease) {
+  const int kNumThreads = 8;
+  const int kIterationsPerThread = 5000;
+
+  future_ = Future<TestResult>();
+
+  struct ThreadContext {
+    FutureTest* test;
+    int completed;
+  } contexts[kNumThreads];
+  std::vector<Thread*> children;
+  for (int i = 0; i < kNumThreads; i++) {
+    contexts[i].test = this;
+    contexts[i].completed = 0;
+    children.push_back(new Thread(
+        [](void* context_void) {
+          ThreadContext* context = static_cast<ThreadContext*>(context_void);
+          ReferenceCountedFutureImpl& impl = context->test->future_impl_;
+          for (int j = 0; j < kIterationsPerThread; j++) {
+            SafeFutureHandle<TestResult> handle =
+                impl.SafeAlloc<TestResult>();
+            Future<TestResult> future = MakeFuture(&impl, handle);
+            impl.Complete<TestResult>(
+                handle, 0, [j](TestResult* data) { data->number = j; });
+            if (future.status() == kFutureStatusComplete &&
+                future.result()->number == j) {
+              context->completed++;
+            }
+          }
+        },
+        &contexts[i]));
+  }
+  for (int i = 0; i < kNumThreads; i++) {
+    children[i]->Join();
+    delete children[i];
+    EXPECT_EQ(kIterationsPerThread, contexts[i].completed);
+  }
+}
+
 // Test that accessing a future as const compiles.
 TEST_F(FutureTest, TestConstFuture) {
   g_callback_times_called = 0;
@@ -16,6 +16,14 @@
 
 #include "app/src/log.h"
 
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "app/src/include/firebase/internal/mutex.h"
+#include "app/src/semaphore.h"
+#include "app/src/thread.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -53,4 +61,151 @@ TEST(LogTest, TestLogLevelBelowAssert) {
   LogError("error message");
 }
 
+namespace {
+
+// Records messages passed to the log callback.
+struct LoggedMessages {
+  Mutex mutex;
+  std::vector<std::string> messages;
+
+  static void Callback(LogLevel log_level, const char* message,
+                       void* callback_data) {
+    LoggedMessages* logged = static_cast<LoggedMessages*>(callback_data);
+    MutexLock lock(logged->mutex);
+    logged->messages.push_back(message);
+  }
+};
+
+}  // namespace
+
+TEST(LogTest, TestFilteredMessagesAreNotDelivered) {
+  LoggedMessages logged;
+  void* previous_data;
+  LogCallback previous_callback = LogGetCallback(&previous_data);
+  LogSetCallback(LoggedMessages::Callback, &logged);
+  SetLogLevel(kLogLevelWarning);
+  LogDebug("debug %d", 1);
+  LogInfo("info %d", 2);
+  LogWarning("warning %d", 3);
+  LogSetCallback(previous_callback, previous_data);
+  EXPECT_THAT(logged.messages, ::testing::ElementsAre("warning 3"));
+}
+
+TEST(LogTest, TestAsynchronousLogging) {
+  LoggedMessages logged;
+  void* previous_data;
+  LogCallback previous_callback = LogGetCallback(&previous_data);
+  LogSetCallback(LoggedMessages::Callback, &logged);
+  SetLogLevel(kLogLevelInfo);
+  LogSetAsynchronous(true);
+
+  const int kNumThreads = 4;
+  const int kMessagesPerThread = 50;
+  int thread_indices[kNumThreads];
+  std::vector<Thread*> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    thread_indices[i] = i;
+    threads.push_back(new Thread(
+        [](int* thread_index) {
+          for (int j = 0; j < kMessagesPerThread; ++j) {
+            LogInfo("thread %d message %d", *thread_index, j);
+          }
+        },
+        &thread_indices[i]));
+  }
+  for (Thread* thread : threads) {
+    thread->Join();
+    delete thread;
+  }
+  LogFlush();
+  LogSetAsynchronous(false);
+  LogSetCallback(previous_callback, previous_data);
+
+  MutexLock lock(logged.mutex);
+  // Every message is either delivered or counted as dropped.
+  int delivered = 0;
+  int dropped = 0;
+  for (const std::string& message : logged.messages) {
+    int count;
+    if (sscanf(message.c_str(), "%d log messages dropped", &count) == 1) {
+      dropped += count;
+    } else {
+      delivered++;
+    }
+  }
+  EXPECT_EQ(kNumThreads * kMessagesPerThread, delivered + dropped);
+  // Messages from each thread are delivered in order.
+  for (int i = 0; i < kNumThreads; ++i) {
+    std::string prefix = "thread " + std::to_string(i) + " ";
+    int previous = -1;
+    for (const std::string& message : logged.messages) {
+      if (message.compare(0, prefix.size(), prefix) == 0) {
+        int index = std::stoi(message.substr(prefix.size() + 8));
+        EXPECT_LT(previous, index) << message;
+        previous = index;
+      }
+    }
+  }
+}
+
+namespace {
+
+// Records messages, holding the log callback on the first message until
+// released so that messages logged meanwhile fill the asynchronous queue.
+struct HeldMessages {
+  HeldMessages() : held(0), release(0) {}
+
+  static void Callback(LogLevel log_level, const char* message,
+                       void* callback_data) {
+    HeldMessages* held_messages = static_cast<HeldMessages*>(callback_data);
+    bool first;
+    {
+      MutexLock lock(held_messages->logged.mutex);
+      first = held_messages->logged.messages.empty();
+      held_messages->logged.messages.push_back(message);
+    }
+    if (first) {
+      held_messages->held.Post();
+      held_messages->release.Wait();
+    }
+  }
+
+  LoggedMessages logged;
+  Semaphore held;
+  Semaphore release;
+};
+
+}  // namespace
+
+TEST(LogTest, TestAsynchronousLoggingDropsMessagesWhenFull) {
+  HeldMessages held_messages;
+  void* previous_data;
+  LogCallback previous_callback = LogGetCallback(&previous_data);
+  LogSetCallback(HeldMessages::Callback, &held_messages);
+  SetLogLevel(kLogLevelInfo);
+  LogSetAsynchronous(true);
+
+  LogInfo("first");
+  held_messages.held.Wait();
+  const int kMessages = 1000;
+  for (int i = 0; i < kMessages; ++i) LogInfo("message %d", i);
+  held_messages.release.Post();
+  LogFlush();
+  LogSetAsynchronous(false);
+  LogSetCallback(previous_callback, previous_data);
+
+  // The messages that fit in the queue are delivered in order, followed by
+  // the number of messages that didn't.
+  const std::vector<std::string>& messages = held_messages.logged.messages;
+  ASSERT_GE(messages.size(), 2u);
+  EXPECT_EQ("first", messages.front());
+  int delivered = static_cast<int>(messages.size()) - 2;
+  EXPECT_LT(delivered, kMessages);
+  for (int i = 0; i < delivered; ++i) {
+    EXPECT_EQ("message " + std::to_string(i), messages[i + 1]);
+  }
+  EXPECT_EQ(std::to_string(kMessages - delivered) + " log messages dropped",
+            messages.back());
+}
+
 }  // namespace firebase
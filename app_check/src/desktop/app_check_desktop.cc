@@ -16,8 +16,12 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstdlib>
 #include <ctime>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "app/src/function_registry.h"
 #include "app/src/log.h"
@@ -29,17 +33,52 @@ namespace internal {
 
 static AppCheckProviderFactory* g_provider_factory = nullptr;
 
+// Domain of the secure storage the cached token is saved to.
+static const char kTokenStoreDomain[] = "app_check";
+// Separates the expiration time from the token in the saved data.
+static const char kTokenStoreSeparator = ':';
+
+static int64_t CurrentTimeMillis() {
+  // Done in two lines because of x86
+  int64_t current_time = std::time(nullptr);
+  current_time *= 1000;
+  return current_time;
+}
+
 AppCheckInternal::AppCheckInternal(App* app)
+    : AppCheckInternal(app, std::unique_ptr<app::secure::UserSecureManager>(
+                                new app::secure::UserSecureManager(
+                                    kTokenStoreDomain,
+                                    app->options().app_id()))) {}
+
+AppCheckInternal::AppCheckInternal(
+    App* app, std::unique_ptr<app::secure::UserSecureManager> token_store)
     : app_(app),
-      cached_token_(),
       cached_provider_(),
-      is_token_auto_refresh_enabled_(true) {
+      cached_token_(),
+      token_request_in_flight_(false),
+      token_requests_started_(0),
+      token_request_needed_(0),
+      stored_token_load_pending_(false),
+      force_refresh_after_load_(false),
+      token_refresh_fraction_(kDefaultTokenRefreshFraction),
+      min_token_refresh_delay_millis_(kMinTokenRefreshDelayMillis),
+      token_refresh_generation_(0),
+      is_token_auto_refresh_enabled_(true),
+      token_store_(std::move(token_store)),
+      scheduler_(),
+      safe_this_(this) {
   future_manager().AllocFutureApi(this, kAppCheckFnCount);
   AddAppCheckListener(&internal_listener_);
   InitRegistryCalls();
+  LoadStoredToken();
 }
 
 AppCheckInternal::~AppCheckInternal() {
+  // Wait for callbacks that are using this, and stop later ones from doing so.
+  safe_this_.ClearReference();
+  scheduler_.CancelAllAndShutdownWorkerThread();
+  token_store_.reset();
   future_manager().ReleaseFutureApi(this);
   CleanupRegistryCalls();
   app_ = nullptr;
@@ -54,22 +93,224 @@ ReferenceCountedFutureImpl* AppCheckInternal::future() {
 }
 
 bool AppCheckInternal::HasValidCacheToken() const {
-  // Get the current time, in milliseconds (Done in two lines because of x86)
-  int64_t current_time = std::time(nullptr);
-  current_time *= 1000;
   // TODO(amaurice): Add some additional time to the check
-  return cached_token_.expire_time_millis > current_time;
+  return cached_token_.expire_time_millis > CurrentTimeMillis();
 }
 
-void AppCheckInternal::UpdateCachedToken(AppCheckToken token) {
-  cached_token_ = token;
+bool AppCheckInternal::GetValidCachedToken(AppCheckToken* token) {
+  MutexLock lock(mutex_);
+  if (!HasValidCacheToken()) return false;
+  *token = cached_token_;
+  return true;
+}
+
+void AppCheckInternal::RequestToken(bool force_refresh,
+                                    TokenCallback callback) {
+  AppCheckToken token;
+  bool use_cached_token = false;
+  {
+    MutexLock lock(mutex_);
+    if (!force_refresh && !stored_token_load_pending_ && HasValidCacheToken()) {
+      token = cached_token_;
+      use_cached_token = true;
+    } else {
+      // Share the result of the request that's already been made, unless a
+      // new token was asked for, which needs a request made after this call.
+      uint64_t request_number = token_requests_started_;
+      if (force_refresh || !token_request_in_flight_) request_number++;
+      if (callback) {
+        pending_token_callbacks_.push_back(
+            PendingTokenCallback{request_number, std::move(callback)});
+      }
+      token_request_needed_ = std::max(token_request_needed_, request_number);
+      if (stored_token_load_pending_) {
+        // The provider is only asked for a token once the saved one has been
+        // loaded, if it's still needed.
+        if (force_refresh) force_refresh_after_load_ = true;
+        return;
+      }
+      if (token_request_in_flight_) return;
+      token_request_in_flight_ = true;
+      token_requests_started_++;
+    }
+  }
+  if (!use_cached_token) {
+    StartProviderRequest();
+  } else if (callback) {
+    callback(token, kAppCheckErrorNone, "");
+  }
+}
+
+void AppCheckInternal::StartProviderRequest() {
+  AppCheckProvider* provider = GetProvider();
+  if (provider == nullptr) {
+    CompleteTokenRequest(AppCheckToken(), kAppCheckErrorInvalidConfiguration,
+                         "No AppCheckProvider installed.");
+    return;
+  }
+  ThisRef ref = safe_this_;
+  provider->GetToken([ref](AppCheckToken token, int error_code,
+                           const std::string& error_message) mutable {
+    ThisRefLock lock(&ref);
+    if (lock.GetReference()) {
+      lock.GetReference()->CompleteTokenRequest(token, error_code,
+                                                error_message);
+    }
+  });
+}
+
+void AppCheckInternal::CompleteTokenRequest(const AppCheckToken& token,
+                                            int error_code,
+                                            const std::string& error_message) {
+  std::vector<TokenCallback> callbacks;
+  bool start_request = false;
+  {
+    MutexLock lock(mutex_);
+    // Callers waiting for a later request keep waiting.
+    std::vector<PendingTokenCallback> waiting;
+    for (PendingTokenCallback& pending : pending_token_callbacks_) {
+      if (pending.request_number <= token_requests_started_) {
+        callbacks.push_back(std::move(pending.callback));
+      } else {
+        waiting.push_back(std::move(pending));
+      }
+    }
+    pending_token_callbacks_.swap(waiting);
+    if (token_request_needed_ > token_requests_started_) {
+      token_requests_started_++;
+      start_request = true;
+    } else {
+      token_request_in_flight_ = false;
+    }
+    if (error_code == kAppCheckErrorNone) cached_token_ = token;
+    // After a failure, this retries while the cached token is still valid.
+    ScheduleTokenRefresh();
+  }
+  if (error_code == kAppCheckErrorNone) {
+    StoreToken(token);
+    NotifyTokenChanged(token);
+  }
+  for (const TokenCallback& callback : callbacks) {
+    callback(token, error_code, error_message);
+  }
+  if (start_request) StartProviderRequest();
+}
+
+void AppCheckInternal::NotifyTokenChanged(const AppCheckToken& token) {
+  std::list<AppCheckListener*> listeners;
+  {
+    MutexLock lock(mutex_);
+    listeners = token_listeners_;
+  }
   // Call the token listeners
-  for (AppCheckListener* listener : token_listeners_) {
+  for (AppCheckListener* listener : listeners) {
     listener->OnAppCheckTokenChanged(token);
   }
 }
 
+void AppCheckInternal::LoadStoredToken() {
+  {
+    MutexLock lock(mutex_);
+    stored_token_load_pending_ = true;
+  }
+  ThisRef ref = safe_this_;
+  token_store_->LoadUserData(app_->name())
+      .OnCompletion([ref](const Future<std::string>& result) mutable {
+        ThisRefLock lock(&ref);
+        if (!lock.GetReference()) return;
+        lock.GetReference()->CompleteStoredTokenLoad(
+            result.error() == app::secure::kSuccess && result.result()
+                ? *result.result()
+                : std::string());
+      });
+}
+
+void AppCheckInternal::CompleteStoredTokenLoad(const std::string& data) {
+  AppCheckToken loaded_token = AppCheckToken();
+  std::string decoded;
+  if (!data.empty() &&
+      app::secure::UserSecureManager::AsciiToBinary(data, &decoded)) {
+    size_t separator = decoded.find(kTokenStoreSeparator);
+    if (separator != std::string::npos) {
+      loaded_token.expire_time_millis =
+          strtoll(decoded.c_str(), nullptr, 10);
+      loaded_token.token = decoded.substr(separator + 1);
+    } else {
+      LogWarning("AppCheck: Error reading the saved token.");
+    }
+  }
+
+  AppCheckToken token;
+  std::vector<TokenCallback> callbacks;
+  bool token_loaded = false;
+  bool start_request = false;
+  {
+    MutexLock lock(mutex_);
+    stored_token_load_pending_ = false;
+    if (loaded_token.expire_time_millis > CurrentTimeMillis() &&
+        loaded_token.expire_time_millis > cached_token_.expire_time_millis) {
+      cached_token_ = loaded_token;
+      token_loaded = true;
+    }
+    if (force_refresh_after_load_ ||
+        (!pending_token_callbacks_.empty() && !HasValidCacheToken())) {
+      token_request_in_flight_ = true;
+      token_requests_started_++;
+      start_request = true;
+    } else {
+      for (PendingTokenCallback& pending : pending_token_callbacks_) {
+        callbacks.push_back(std::move(pending.callback));
+      }
+      pending_token_callbacks_.clear();
+      token_request_needed_ = token_requests_started_;
+    }
+    force_refresh_after_load_ = false;
+    token = cached_token_;
+    ScheduleTokenRefresh();
+  }
+  if (token_loaded) NotifyTokenChanged(token);
+  for (const TokenCallback& callback : callbacks) {
+    callback(token, kAppCheckErrorNone, "");
+  }
+  if (start_request) StartProviderRequest();
+}
+
+void AppCheckInternal::StoreToken(const AppCheckToken& token) {
+  std::string data = std::to_string(token.expire_time_millis);
+  data += kTokenStoreSeparator;
+  data += token.token;
+  std::string encoded;
+  app::secure::UserSecureManager::BinaryToAscii(data, &encoded);
+  token_store_->SaveUserData(app_->name(), encoded);
+}
+
+void AppCheckInternal::ScheduleTokenRefresh() {
+  // Refreshes scheduled before are skipped rather than cancelled, since
+  // cancelling waits for a refresh that's running, which may be waiting for
+  // mutex_.
+  uint64_t generation = ++token_refresh_generation_;
+  if (!is_token_auto_refresh_enabled_ || !HasValidCacheToken()) return;
+  int64_t lifetime = cached_token_.expire_time_millis - CurrentTimeMillis();
+  int64_t delay = std::max(
+      static_cast<int64_t>(lifetime * token_refresh_fraction_),
+      min_token_refresh_delay_millis_);
+  ThisRef ref = safe_this_;
+  scheduler_.Schedule(
+      [ref, generation]() mutable {
+        ThisRefLock lock(&ref);
+        AppCheckInternal* app_check = lock.GetReference();
+        if (!app_check) return;
+        {
+          MutexLock token_lock(app_check->mutex_);
+          if (generation != app_check->token_refresh_generation_) return;
+        }
+        app_check->RequestToken(true, TokenCallback());
+      },
+      delay);
+}
+
 AppCheckProvider* AppCheckInternal::GetProvider() {
+  MutexLock lock(mutex_);
   if (!cached_provider_ && g_provider_factory && app_) {
     cached_provider_ = g_provider_factory->CreateProvider(app_);
   }
@@ -84,35 +325,38 @@ void AppCheckInternal::SetAppCheckProviderFactory(
 
 void AppCheckInternal::SetTokenAutoRefreshEnabled(
     bool is_token_auto_refresh_enabled) {
+  MutexLock lock(mutex_);
   is_token_auto_refresh_enabled_ = is_token_auto_refresh_enabled;
+  ScheduleTokenRefresh();
+}
+
+void AppCheckInternal::SetTokenRefreshFraction(double fraction) {
+  if (fraction < 0.0 || fraction > 1.0) {
+    LogWarning("AppCheck: Ignoring token refresh fraction %f.", fraction);
+    return;
+  }
+  MutexLock lock(mutex_);
+  token_refresh_fraction_ = fraction;
+  ScheduleTokenRefresh();
+}
+
+void AppCheckInternal::SetMinTokenRefreshDelay(int64_t millis) {
+  MutexLock lock(mutex_);
+  min_token_refresh_delay_millis_ = std::max(millis, static_cast<int64_t>(0));
+  ScheduleTokenRefresh();
 }
 
 Future<AppCheckToken> AppCheckInternal::GetAppCheckToken(bool force_refresh) {
   auto handle = future()->SafeAlloc<AppCheckToken>(kAppCheckFnGetAppCheckToken);
-  if (!force_refresh && HasValidCacheToken()) {
-    // If the cached token is valid, and not told to refresh, return the cache
-    future()->CompleteWithResult(handle, 0, cached_token_);
-  } else {
-    // Get a new token, and pass the result into the future.
-    AppCheckProvider* provider = GetProvider();
-    if (provider != nullptr) {
-      auto token_callback{
-          [this, handle](firebase::app_check::AppCheckToken token,
-                         int error_code, const std::string& error_message) {
-            if (error_code == firebase::app_check::kAppCheckErrorNone) {
-              UpdateCachedToken(token);
-              future()->CompleteWithResult(handle, 0, token);
-            } else {
-              future()->Complete(handle, error_code, error_message.c_str());
-            }
-          }};
-      provider->GetToken(token_callback);
+  RequestToken(force_refresh, [this, handle](const AppCheckToken& token,
+                                             int error_code,
+                                             const std::string& error_message) {
+    if (error_code == firebase::app_check::kAppCheckErrorNone) {
+      future()->CompleteWithResult(handle, 0, token);
     } else {
-      future()->Complete(
-          handle, firebase::app_check::kAppCheckErrorInvalidConfiguration,
-          "No AppCheckProvider installed.");
+      future()->Complete(handle, error_code, error_message.c_str());
     }
-  }
+  });
   return MakeFuture(future(), handle);
 }
 
@@ -154,31 +398,27 @@ Future<AppCheckToken> AppCheckInternal::GetLimitedUseAppCheckTokenLastResult() {
 Future<std::string> AppCheckInternal::GetAppCheckTokenStringInternal() {
   auto handle =
       future()->SafeAlloc<std::string>(kAppCheckFnGetAppCheckStringInternal);
-  if (HasValidCacheToken()) {
-    future()->CompleteWithResult(handle, 0, cached_token_.token);
-  } else if (is_token_auto_refresh_enabled_) {
+  bool is_token_auto_refresh_enabled;
+  {
+    MutexLock lock(mutex_);
+    is_token_auto_refresh_enabled = is_token_auto_refresh_enabled_;
+  }
+  AppCheckToken token;
+  if (is_token_auto_refresh_enabled) {
     // Only refresh the token if it is enabled
-    AppCheckProvider* provider = GetProvider();
-    if (provider != nullptr) {
-      // Get a new token, and pass the result into the future.
-      // Note that this is slightly different from the one above, as the
-      // Future result is just the string token, and not the full struct.
-      auto token_callback{
-          [this, handle](firebase::app_check::AppCheckToken token,
-                         int error_code, const std::string& error_message) {
-            if (error_code == firebase::app_check::kAppCheckErrorNone) {
-              UpdateCachedToken(token);
-              future()->CompleteWithResult(handle, 0, token.token);
-            } else {
-              future()->Complete(handle, error_code, error_message.c_str());
-            }
-          }};
-      provider->GetToken(token_callback);
-    } else {
-      future()->Complete(
-          handle, firebase::app_check::kAppCheckErrorInvalidConfiguration,
-          "No AppCheckProvider installed.");
-    }
+    // Note that this is slightly different from the one above, as the
+    // Future result is just the string token, and not the full struct.
+    RequestToken(false, [this, handle](const AppCheckToken& token,
+                                       int error_code,
+                                       const std::string& error_message) {
+      if (error_code == firebase::app_check::kAppCheckErrorNone) {
+        future()->CompleteWithResult(handle, 0, token.token);
+      } else {
+        future()->Complete(handle, error_code, error_message.c_str());
+      }
+    });
+  } else if (GetValidCachedToken(&token)) {
+    future()->CompleteWithResult(handle, 0, token.token);
   } else {
     future()->Complete(
         handle, kAppCheckErrorUnknown,
@@ -214,18 +454,23 @@ AppCheckInternal::GetLimitedUseAppCheckTokenStringInternal() {
 
 void AppCheckInternal::AddAppCheckListener(AppCheckListener* listener) {
   if (listener) {
-    token_listeners_.push_back(listener);
+    AppCheckToken token;
+    {
+      MutexLock lock(mutex_);
+      token_listeners_.push_back(listener);
+    }
 
     // Following the Android pattern, if there is a cached token, call the
     // listener. Note that the iOS implementation does not do this.
-    if (HasValidCacheToken()) {
-      listener->OnAppCheckTokenChanged(cached_token_);
+    if (GetValidCachedToken(&token)) {
+      listener->OnAppCheckTokenChanged(token);
     }
   }
 }
 
 void AppCheckInternal::RemoveAppCheckListener(AppCheckListener* listener) {
   if (listener) {
+    MutexLock lock(mutex_);
     token_listeners_.remove(listener);
   }
 }
@@ -333,8 +578,9 @@ bool AppCheckInternal::AddAppCheckListenerForRegistry(App* app, void* callback,
     app_check->internal_->internal_listener_.AddListener(typed_callback,
                                                          context);
     // If there is a cached token, pass it along to the callback
-    if (app_check->internal_->HasValidCacheToken()) {
-      typed_callback(app_check->internal_->cached_token_.token, context);
+    AppCheckToken token;
+    if (app_check->internal_->GetValidCachedToken(&token)) {
+      typed_callback(token.token, context);
     }
     return true;
   }
@@ -15,7 +15,10 @@
 #ifndef FIREBASE_APP_CHECK_SRC_DESKTOP_APP_CHECK_DESKTOP_H_
 #define FIREBASE_APP_CHECK_SRC_DESKTOP_APP_CHECK_DESKTOP_H_
 
+#include <cstdint>
+#include <functional>
 #include <list>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -23,6 +26,10 @@
 #include "app/src/future_manager.h"
 #include "app/src/include/firebase/app.h"
 #include "app/src/include/firebase/future.h"
+#include "app/src/include/firebase/internal/mutex.h"
+#include "app/src/safe_reference.h"
+#include "app/src/scheduler.h"
+#include "app/src/secure/user_secure_manager.h"
 #include "app_check/src/include/firebase/app_check.h"
 
 namespace firebase {
@@ -46,10 +53,22 @@ class FunctionRegistryAppCheckListener : public AppCheckListener {
   std::vector<Entry> callbacks_;
 };
 
+// Fraction of a token's lifetime after which it's refreshed in the background,
+// while auto refresh is enabled.
+const double kDefaultTokenRefreshFraction = 0.5;
+// Shortest delay before refreshing a token in the background, so a failing
+// provider isn't called in a tight loop.
+const int64_t kMinTokenRefreshDelayMillis = 30 * 1000;
+
 class AppCheckInternal {
  public:
   explicit AppCheckInternal(::firebase::App* app);
 
+  // Save the cached token with token_store rather than the platform's secure
+  // storage.
+  AppCheckInternal(::firebase::App* app,
+                   std::unique_ptr<app::secure::UserSecureManager> token_store);
+
   ~AppCheckInternal();
 
   App* app() const;
@@ -58,6 +77,14 @@ class AppCheckInternal {
 
   void SetTokenAutoRefreshEnabled(bool is_token_auto_refresh_enabled);
 
+  // Set the fraction of a token's lifetime after which it's refreshed in the
+  // background, between 0 and 1.
+  void SetTokenRefreshFraction(double fraction);
+
+  // Set the shortest delay before refreshing a token in the background, which
+  // is kMinTokenRefreshDelayMillis by default.
+  void SetMinTokenRefreshDelay(int64_t millis);
+
   Future<AppCheckToken> GetAppCheckToken(bool force_refresh);
 
   Future<AppCheckToken> GetAppCheckTokenLastResult();
@@ -83,11 +110,58 @@ class AppCheckInternal {
   ReferenceCountedFutureImpl* future();
 
  private:
-  // Is the cached token valid
+  // Called with the result of a token request, without mutex_ held.
+  typedef std::function<void(const AppCheckToken& token, int error_code,
+                             const std::string& error_message)>
+      TokenCallback;
+
+  // A caller waiting for the provider request numbered request_number.
+  struct PendingTokenCallback {
+    uint64_t request_number;
+    TokenCallback callback;
+  };
+
+  typedef firebase::internal::SafeReference<AppCheckInternal> ThisRef;
+  typedef firebase::internal::SafeReferenceLock<AppCheckInternal> ThisRefLock;
+
+  // Is the cached token valid. Call with mutex_ held.
   bool HasValidCacheToken() const;
 
-  // Update the cached Token, and call the listeners
-  void UpdateCachedToken(AppCheckToken token);
+  // Copy the cached token to token if it's valid, and return whether it was.
+  bool GetValidCachedToken(AppCheckToken* token);
+
+  // Call callback with the cached token, or with a token from the provider if
+  // the cached one isn't valid or force_refresh is set. Callers that need a
+  // token while one is being requested wait for that request instead of
+  // starting another one, unless force_refresh is set, as that request may
+  // have been made before this call. callback may be empty.
+  void RequestToken(bool force_refresh, TokenCallback callback);
+
+  // Ask the provider for a token. Call once for each request started.
+  void StartProviderRequest();
+
+  // Cache the token if the request succeeded, then pass the result to every
+  // caller waiting for it. Starts the next request if a caller is waiting for
+  // a later one.
+  void CompleteTokenRequest(const AppCheckToken& token, int error_code,
+                            const std::string& error_message);
+
+  // Call the listeners with a token that has just been cached.
+  void NotifyTokenChanged(const AppCheckToken& token);
+
+  // Load the token saved by a previous run of the app.
+  void LoadStoredToken();
+
+  // Use the loaded token if it's still valid, then start requests that waited
+  // for it.
+  void CompleteStoredTokenLoad(const std::string& data);
+
+  // Save the token so a later run of the app can use it until it expires.
+  void StoreToken(const AppCheckToken& token);
+
+  // Schedule the next background refresh of the cached token, if auto refresh
+  // is enabled. Call with mutex_ held.
+  void ScheduleTokenRefresh();
 
   // Get the Provider associated with the stored App used to create this.
   AppCheckProvider* GetProvider();
@@ -120,8 +194,31 @@ class AppCheckInternal {
 
   // Cached provider for the App. Use GetProvider instead of this.
   AppCheckProvider* cached_provider_;
+
+  // Guards the token state below.
+  Mutex mutex_;
   // Cached token, can be expired.
   AppCheckToken cached_token_;
+  // Whether a token has been requested from the provider and not returned.
+  bool token_request_in_flight_;
+  // Number of requests to the provider that have been started. Only one is in
+  // flight at a time, so the one in flight is the last one started.
+  uint64_t token_requests_started_;
+  // Number of the last request to the provider a caller is waiting for, which
+  // is started once the one in flight completes.
+  uint64_t token_request_needed_;
+  // Whether the saved token is still being loaded. Requests wait for it.
+  bool stored_token_load_pending_;
+  // Whether a caller asked for a new token while the saved one was loading.
+  bool force_refresh_after_load_;
+  // Callers waiting for the token being requested or loaded.
+  std::vector<PendingTokenCallback> pending_token_callbacks_;
+  double token_refresh_fraction_;
+  int64_t min_token_refresh_delay_millis_;
+  // Incremented each time a refresh is scheduled. Only the latest scheduled
+  // refresh runs.
+  uint64_t token_refresh_generation_;
+
   // List of registered listeners for Token changes.
   std::list<AppCheckListener*> token_listeners_;
   // Internal listener used by the function registry to track Token changes.
@@ -129,6 +226,14 @@ class AppCheckInternal {
   // Should it automatically get an App Check token if there is not a valid
   // cached token.
   bool is_token_auto_refresh_enabled_;
+
+  // Saves the cached token between runs of the app.
+  std::unique_ptr<app::secure::UserSecureManager> token_store_;
+  // Runs background refreshes of the cached token.
+  scheduler::Scheduler scheduler_;
+  // Cleared on destruction, so callbacks from the provider, the token store
+  // and the scheduler don't use this after it's deleted.
+  ThisRef safe_this_;
 };
 
 }  // namespace internal
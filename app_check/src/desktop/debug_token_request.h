@@ -47,6 +47,7 @@ class DebugTokenRequest
     server_url.append(app->options().app_id());
     server_url.append(":exchangeDebugToken");
     set_url(server_url.c_str());
+    options_.category = rest::kTransferCategoryAppCheck;
 
     add_header(kDebugTokenRequestHeader, app->options().api_key());
   }
@@ -0,0 +1,366 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app_check/src/desktop/app_check_desktop.h"
+
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "app/src/include/firebase/app.h"
+#include "app/src/secure/user_secure_internal.h"
+#include "app/src/secure/user_secure_manager.h"
+#include "app/src/time.h"
+#include "app/tests/include/firebase/app_for_testing.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace app_check {
+namespace internal {
+namespace {
+
+const std::chrono::seconds kTimeout(10);
+
+typedef std::function<void(AppCheckToken, int, const std::string&)>
+    ProviderCallback;
+
+// Provider whose tokens are named after the number of the request, and which
+// either returns them straight away or holds requests until the test
+// completes them.
+class FakeProvider : public AppCheckProvider {
+ public:
+  explicit FakeProvider(int64_t lifetime_millis, bool complete_immediately)
+      : lifetime_millis_(lifetime_millis),
+        complete_immediately_(complete_immediately) {}
+
+  void GetToken(ProviderCallback callback) override {
+    AppCheckToken token;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      call_times_.push_back(::firebase::internal::GetTimestamp());
+      token.token = "token " + std::to_string(call_times_.size());
+      token.expire_time_millis =
+          static_cast<int64_t>(std::time(nullptr)) * 1000 + lifetime_millis_;
+      if (!complete_immediately_) {
+        pending_.push_back(
+            [callback, token]() { callback(token, kAppCheckErrorNone, ""); });
+        condition_.notify_all();
+        return;
+      }
+    }
+    callback(token, kAppCheckErrorNone, "");
+  }
+
+  // Wait for a request and complete it, returns false if none is made.
+  bool CompleteRequest() {
+    std::function<void()> complete;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (!condition_.wait_for(lock, kTimeout,
+                               [this]() { return !pending_.empty(); })) {
+        return false;
+      }
+      complete = pending_.front();
+      pending_.erase(pending_.begin());
+    }
+    complete();
+    return true;
+  }
+
+  // Wait until the provider has been called count times, returns false if it
+  // isn't.
+  bool WaitForCalls(int count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return condition_.wait_for(lock, kTimeout, [this, count]() {
+      return static_cast<int>(call_times_.size()) >= count;
+    });
+  }
+
+  int calls() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(call_times_.size());
+  }
+
+  // Time of each call from ::firebase::internal::GetTimestamp().
+  std::vector<uint64_t> call_times() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return call_times_;
+  }
+
+ private:
+  int64_t lifetime_millis_;
+  bool complete_immediately_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::vector<uint64_t> call_times_;
+  std::vector<std::function<void()>> pending_;
+};
+
+class FakeProviderFactory : public AppCheckProviderFactory {
+ public:
+  explicit FakeProviderFactory(AppCheckProvider* provider)
+      : provider_(provider) {}
+
+  AppCheckProvider* CreateProvider(App* app) override { return provider_; }
+
+ private:
+  AppCheckProvider* provider_;
+};
+
+// Data of FakeTokenStore, which outlives the stores so a later
+// AppCheckInternal can load what an earlier one saved.
+struct FakeTokenStoreData {
+  FakeTokenStoreData() : loads_held(false) {}
+
+  // Stop loads from completing until loads_held is cleared.
+  void HoldLoads(bool hold) {
+    std::lock_guard<std::mutex> lock(mutex);
+    loads_held = hold;
+    condition.notify_all();
+  }
+
+  // Wait until data is saved for app_name.
+  bool WaitForSave(const std::string& app_name) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return condition.wait_for(lock, kTimeout, [this, &app_name]() {
+      return user_data.find(app_name) != user_data.end();
+    });
+  }
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::map<std::string, std::string> user_data;
+  bool loads_held;
+};
+
+// Secure storage kept in memory.
+class FakeTokenStore : public app::secure::UserSecureInternal {
+ public:
+  explicit FakeTokenStore(std::shared_ptr<FakeTokenStoreData> data)
+      : data_(data) {}
+
+  std::string LoadUserData(const std::string& app_name) override {
+    std::unique_lock<std::mutex> lock(data_->mutex);
+    data_->condition.wait(lock, [this]() { return !data_->loads_held; });
+    auto it = data_->user_data.find(app_name);
+    return it != data_->user_data.end() ? it->second : std::string();
+  }
+
+  void SaveUserData(const std::string& app_name,
+                    const std::string& user_data) override {
+    std::lock_guard<std::mutex> lock(data_->mutex);
+    data_->user_data[app_name] = user_data;
+    data_->condition.notify_all();
+  }
+
+  void DeleteUserData(const std::string& app_name) override {
+    std::lock_guard<std::mutex> lock(data_->mutex);
+    data_->user_data.erase(app_name);
+  }
+
+  void DeleteAllData() override {
+    std::lock_guard<std::mutex> lock(data_->mutex);
+    data_->user_data.clear();
+  }
+
+ private:
+  std::shared_ptr<FakeTokenStoreData> data_;
+};
+
+// Records the tokens it's told about.
+class TokenListener : public AppCheckListener {
+ public:
+  void OnAppCheckTokenChanged(const AppCheckToken& token) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tokens_.push_back(token.token);
+    condition_.notify_all();
+  }
+
+  // Wait until the listener is told about count tokens.
+  bool WaitForTokens(size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return condition_.wait_for(lock, kTimeout, [this, count]() {
+      return tokens_.size() >= count;
+    });
+  }
+
+  std::vector<std::string> tokens() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tokens_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::vector<std::string> tokens_;
+};
+
+class AppCheckDesktopTest : public ::testing::Test {
+ protected:
+  AppCheckDesktopTest() : store_data_(std::make_shared<FakeTokenStoreData>()) {}
+
+  void SetUp() override { app_.reset(testing::CreateApp()); }
+
+  void TearDown() override {
+    store_data_->HoldLoads(false);
+    app_check_.reset();
+    AppCheckInternal::SetAppCheckProviderFactory(nullptr);
+    factory_.reset();
+    provider_.reset();
+    app_.reset();
+  }
+
+  void UseProvider(int64_t lifetime_millis, bool complete_immediately) {
+    provider_.reset(new FakeProvider(lifetime_millis, complete_immediately));
+    factory_.reset(new FakeProviderFactory(provider_.get()));
+    AppCheckInternal::SetAppCheckProviderFactory(factory_.get());
+  }
+
+  void CreateAppCheck() {
+    app_check_.reset(new AppCheckInternal(
+        app_.get(),
+        std::unique_ptr<app::secure::UserSecureManager>(
+            new app::secure::UserSecureManager(
+                std::unique_ptr<app::secure::UserSecureInternal>(
+                    new FakeTokenStore(store_data_))))));
+  }
+
+  // Wait for future to complete and return its token.
+  static std::string WaitForToken(const Future<AppCheckToken>& future) {
+    auto deadline = std::chrono::steady_clock::now() + kTimeout;
+    while (future.status() == kFutureStatusPending &&
+           std::chrono::steady_clock::now() < deadline) {
+      ::firebase::internal::Sleep(1);
+    }
+    EXPECT_EQ(future.status(), kFutureStatusComplete);
+    if (future.status() != kFutureStatusComplete) return std::string();
+    EXPECT_EQ(future.error(), kAppCheckErrorNone) << future.error_message();
+    return future.result() ? future.result()->token : std::string();
+  }
+
+  std::unique_ptr<App> app_;
+  std::shared_ptr<FakeTokenStoreData> store_data_;
+  std::unique_ptr<FakeProvider> provider_;
+  std::unique_ptr<FakeProviderFactory> factory_;
+  std::unique_ptr<AppCheckInternal> app_check_;
+};
+
+TEST_F(AppCheckDesktopTest, ConcurrentRequestsShareProviderCall) {
+  UseProvider(60 * 60 * 1000, false);
+  CreateAppCheck();
+
+  std::vector<Future<AppCheckToken>> futures;
+  for (int i = 0; i < 5; ++i) {
+    futures.push_back(app_check_->GetAppCheckToken(false));
+  }
+  ASSERT_TRUE(provider_->CompleteRequest());
+  for (const Future<AppCheckToken>& future : futures) {
+    EXPECT_EQ(WaitForToken(future), "token 1");
+  }
+  EXPECT_EQ(provider_->calls(), 1);
+}
+
+// A forced refresh doesn't share the request that's in flight, as it may have
+// been made before the refresh was asked for.
+TEST_F(AppCheckDesktopTest, ForceRefreshWhileRequestInFlight) {
+  UseProvider(60 * 60 * 1000, false);
+  CreateAppCheck();
+
+  Future<AppCheckToken> first = app_check_->GetAppCheckToken(false);
+  ASSERT_TRUE(provider_->WaitForCalls(1));
+  Future<AppCheckToken> forced1 = app_check_->GetAppCheckToken(true);
+  Future<AppCheckToken> forced2 = app_check_->GetAppCheckToken(true);
+  Future<AppCheckToken> shared = app_check_->GetAppCheckToken(false);
+  ASSERT_TRUE(provider_->CompleteRequest());
+  EXPECT_EQ(WaitForToken(first), "token 1");
+  EXPECT_EQ(WaitForToken(shared), "token 1");
+  EXPECT_EQ(forced1.status(), kFutureStatusPending);
+  EXPECT_EQ(forced2.status(), kFutureStatusPending);
+
+  // The forced refreshes share the request made after the first one.
+  ASSERT_TRUE(provider_->CompleteRequest());
+  EXPECT_EQ(WaitForToken(forced1), "token 2");
+  EXPECT_EQ(WaitForToken(forced2), "token 2");
+  EXPECT_EQ(provider_->calls(), 2);
+}
+
+TEST_F(AppCheckDesktopTest, RefreshesAfterFractionOfLifetime) {
+  const int64_t kLifetimeMillis = 4000;
+  UseProvider(kLifetimeMillis, true);
+  CreateAppCheck();
+  app_check_->SetMinTokenRefreshDelay(0);
+  app_check_->SetTokenRefreshFraction(0.25);
+  TokenListener listener;
+  app_check_->AddAppCheckListener(&listener);
+
+  EXPECT_EQ(WaitForToken(app_check_->GetAppCheckToken(false)), "token 1");
+  ASSERT_TRUE(listener.WaitForTokens(2));
+  app_check_->SetTokenAutoRefreshEnabled(false);
+  app_check_->RemoveAppCheckListener(&listener);
+
+  EXPECT_THAT(listener.tokens(),
+              ::testing::ElementsAre("token 1", "token 2"));
+  // The token was refreshed a quarter of the way through its lifetime, which
+  // is at least half of that once the clock's whole seconds are allowed for,
+  // and well before it expired.
+  std::vector<uint64_t> call_times = provider_->call_times();
+  int64_t refresh_after = static_cast<int64_t>(call_times[1] - call_times[0]);
+  EXPECT_GE(refresh_after, kLifetimeMillis / 8);
+  EXPECT_LT(refresh_after, kLifetimeMillis);
+}
+
+TEST_F(AppCheckDesktopTest, ReusesStoredToken) {
+  UseProvider(60 * 60 * 1000, true);
+  CreateAppCheck();
+  EXPECT_EQ(WaitForToken(app_check_->GetAppCheckToken(false)), "token 1");
+  ASSERT_TRUE(store_data_->WaitForSave(app_->name()));
+
+  // A new instance, as when the app is restarted, uses the saved token.
+  app_check_.reset();
+  CreateAppCheck();
+  EXPECT_EQ(WaitForToken(app_check_->GetAppCheckToken(false)), "token 1");
+  EXPECT_EQ(provider_->calls(), 1);
+}
+
+TEST_F(AppCheckDesktopTest, ForceRefreshWhileStoredTokenLoads) {
+  UseProvider(60 * 60 * 1000, true);
+  CreateAppCheck();
+  EXPECT_EQ(WaitForToken(app_check_->GetAppCheckToken(false)), "token 1");
+  ASSERT_TRUE(store_data_->WaitForSave(app_->name()));
+  app_check_.reset();
+
+  store_data_->HoldLoads(true);
+  CreateAppCheck();
+  Future<AppCheckToken> future = app_check_->GetAppCheckToken(true);
+  // The provider isn't called until the stored token is loaded...
+  EXPECT_EQ(future.status(), kFutureStatusPending);
+  EXPECT_EQ(provider_->calls(), 1);
+  store_data_->HoldLoads(false);
+  // ...and then the stored token isn't used, as a new one was asked for.
+  EXPECT_EQ(WaitForToken(future), "token 2");
+  EXPECT_EQ(provider_->calls(), 2);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace app_check
+}  // namespace firebase
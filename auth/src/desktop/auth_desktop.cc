@@ -118,7 +118,8 @@ void LogHeartbeat(Auth* const auth) {
   }
 }
 
-IdTokenRefreshListener::IdTokenRefreshListener() : token_timestamp_(0) {}
+IdTokenRefreshListener::IdTokenRefreshListener()
+    : snapshot_(std::make_shared<IdTokenSnapshot>()) {}
 
 IdTokenRefreshListener::~IdTokenRefreshListener() {}
 
@@ -127,6 +128,7 @@ void IdTokenRefreshListener::OnIdTokenChanged(Auth* auth) {
   // to prevent deadlocks!
   MutexLock lock(mutex_);
   MutexLock future_lock(auth->auth_data_->future_impl.mutex());
+  auto snapshot = std::make_shared<IdTokenSnapshot>(*this->snapshot());
   if (auth->current_user().is_valid()) {
     ResetTokenRefreshCounter(auth->auth_data_);
 
@@ -134,30 +136,41 @@ void IdTokenRefreshListener::OnIdTokenChanged(Auth* auth) {
     {
       UserView::Reader reader = UserView::GetReader(auth->auth_data_);
       assert(reader.IsValid());
-      current_token_ = reader->id_token;
+      snapshot->token = reader->id_token;
+      snapshot->expiration_date = reader->access_token_expiration_date;
     }
-    token_timestamp_ = internal::GetTimestampEpoch();
+    snapshot->timestamp = internal::GetTimestampEpoch();
   } else {
-    current_token_ = "";
+    snapshot->token = "";
+    snapshot->expiration_date = 0;
   }
+  std::atomic_store(&snapshot_,
+                    std::shared_ptr<const IdTokenSnapshot>(std::move(snapshot)));
 }
 
 std::string IdTokenRefreshListener::GetCurrentToken() {
-  std::string current_token;
-  {
-    MutexLock lock(mutex_);
-    current_token = current_token_;
-  }
-  return current_token;
+  return snapshot()->token;
 }
 
 uint64_t IdTokenRefreshListener::GetTokenTimestamp() {
-  uint64_t token_timestamp;
-  {
-    MutexLock lock(mutex_);
-    token_timestamp = token_timestamp_;
+  return snapshot()->timestamp;
+}
+
+int64_t IdTokenRefreshListener::GetMsUntilRefresh() {
+  std::shared_ptr<const IdTokenSnapshot> snapshot = this->snapshot();
+  int64_t refresh_time =
+      static_cast<int64_t>(snapshot->timestamp) + kMsPerTokenRefresh;
+  if (snapshot->expiration_date > 0) {
+    refresh_time =
+        static_cast<int64_t>(snapshot->expiration_date) * 1000 -
+        kMsTokenRefreshBeforeExpiry;
   }
-  return token_timestamp;
+  // Don't refresh a token again right after it changed, even if the server
+  // gave it a short lifetime.
+  refresh_time = std::max(refresh_time, static_cast<int64_t>(
+                                            snapshot->timestamp) +
+                                            kMinRetryBackoffMs);
+  return refresh_time - static_cast<int64_t>(internal::GetTimestampEpoch());
 }
 
 // This is the static version of GetAuthToken, with a function signature
@@ -170,7 +183,8 @@ bool Auth::GetAuthTokenForRegistry(App* app, void* /*unused*/, void* out) {
     (void)auth->current_user();
 
     auto result = static_cast<std::string*>(out);
-    MutexLock lock(auth->auth_data_->token_listener_mutex);
+    // The token is read from a snapshot, so this doesn't wait for the token
+    // to be changed or refreshed.
     auto auth_impl = static_cast<AuthImpl*>(auth->auth_data_->auth_impl);
     *result = auth_impl->token_refresh_thread.CurrentAuthToken();
     return true;
@@ -694,11 +708,12 @@ void IdTokenRefreshThread::Initialize(AuthData* auth_data) {
             // ensures that we won't mess with the LastResult for the
             // user-facing one.
 
-            uint64_t ms_since_last_refresh =
-                internal::GetTimestampEpoch() -
-                refresh_thread->token_refresh_listener_.GetTokenTimestamp();
+            // Refresh before the token expires, so requests don't have to
+            // wait for a refresh.
+            int64_t ms_until_refresh =
+                refresh_thread->token_refresh_listener_.GetMsUntilRefresh();
 
-            if (ms_since_last_refresh >= kMsPerTokenRefresh) {
+            if (ms_until_refresh <= 0) {
               Future<std::string> future =
                   refresh_thread->auth->auth_data_->current_user
                       .GetTokenInternal(true, kInternalFn_GetTokenForRefresher);
@@ -742,15 +757,16 @@ void IdTokenRefreshThread::Initialize(AuthData* auth_data) {
                 if (refresh_thread->ref_count_ <= 0) break;
               }
 
-              ms_since_last_refresh =
-                  internal::GetTimestampEpoch() -
-                  refresh_thread->token_refresh_listener_.GetTokenTimestamp();
+              ms_until_refresh =
+                  refresh_thread->token_refresh_listener_.GetMsUntilRefresh();
+              if (ms_until_refresh <= 0) break;
 
               // If the timed-wait returns true, then it means we were
               // interrupted early - either it's time to shut down, or we
               // got a new token and should restart the clock.
               if (!refresh_thread->wakeup_sem_.TimedWait(
-                      kMsPerTokenRefresh - ms_since_last_refresh)) {
+                      static_cast<int>(std::min<int64_t>(
+                          ms_until_refresh, kMsPerTokenRefresh)))) {
                 break;
               }
             }
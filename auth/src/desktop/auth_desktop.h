@@ -16,7 +16,9 @@
 #define FIREBASE_AUTH_SRC_DESKTOP_AUTH_DESKTOP_H_
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <ctime>
 #include <memory>
 #include <string>
 
@@ -33,9 +35,22 @@
 namespace firebase {
 namespace auth {
 
+// The ID token of the signed-in user when it last changed. A snapshot never
+// changes once it's published.
+struct IdTokenSnapshot {
+  IdTokenSnapshot() : timestamp(0), expiration_date(0) {}
+
+  std::string token;
+  // When the token changed, in milliseconds since the epoch.
+  uint64_t timestamp;
+  // When the token expires, in seconds since the epoch.
+  std::time_t expiration_date;
+};
+
 // Token listener used by the IdTokenRefreshThread object.  Basically just
 // listens for changes, and when one occurs, caches the result, along with a
-// timestamp.  All functions are thread-safe and locked with the mutex.
+// timestamp.  All functions are thread-safe.  Changes are serialized by the
+// mutex and published as a new snapshot, which readers get without locking.
 class IdTokenRefreshListener : public IdTokenListener {
  public:
   IdTokenRefreshListener();
@@ -45,11 +60,19 @@ class IdTokenRefreshListener : public IdTokenListener {
   std::string GetCurrentToken();
   uint64_t GetTokenTimestamp();
 
+  // Returns how long until the token should be refreshed, in milliseconds,
+  // which is negative if it's overdue.
+  int64_t GetMsUntilRefresh();
+
  private:
-  // Guards all members of this class.
+  std::shared_ptr<const IdTokenSnapshot> snapshot() const {
+    return std::atomic_load(&snapshot_);
+  }
+
+  // Serializes changes to the snapshot.
   Mutex mutex_;
-  uint64_t token_timestamp_;
-  std::string current_token_;
+  // Only accessed with std::atomic_load() and std::atomic_store().
+  std::shared_ptr<const IdTokenSnapshot> snapshot_;
 };
 
 // This class handles the full lifecycle of the token refresh thread.  It
@@ -142,7 +165,7 @@ class FunctionRegistryAuthStateListener : public AuthStateListener {
 
 // The desktop-specific Auth implementation.
 struct AuthImpl {
-  AuthImpl() {}
+  AuthImpl() : token_refreshes_started(0), token_refresh_finished(0) {}
 
   // The application's API key.
   std::string api_key;
@@ -168,6 +191,15 @@ struct AuthImpl {
   // Synchronization primative for tracking sate of FederatedAuth futures.
   Mutex provider_mutex;
 
+  // Held while the ID token is refreshed, so callers that need a new token
+  // at the same time wait for and share a single refresh.
+  Mutex token_refresh_mutex;
+  // Number of refreshes of the ID token that have been started.
+  std::atomic<uint64_t> token_refreshes_started;
+  // Number of the last refresh of the ID token that succeeded, counting from
+  // 1 as token_refreshes_started does.
+  std::atomic<uint64_t> token_refresh_finished;
+
   // The current user language code. This can be set to the app’s current
   // language by calling SetLanguageCode.
   std::string language_code;
@@ -176,10 +208,17 @@ struct AuthImpl {
 };
 
 // Constant, describing how often we automatically fetch a new auth token.
-// Auth tokens expire after 60 minutes so we refresh slightly before.
+// Auth tokens expire after 60 minutes so we refresh slightly before.  Only
+// used when the expiration time of the token isn't known.
 const int kMinutesPerTokenRefresh = 58;
 const int kMsPerTokenRefresh =
     kMinutesPerTokenRefresh * internal::kMillisecondsPerMinute;
+// How long before a token expires it's refreshed automatically.  Tokens that
+// expire within 5 minutes are refreshed when they're requested, so this
+// leaves time to retry a failed refresh before requests have to wait for one.
+const int kMinutesTokenRefreshBeforeExpiry = 10;
+const int kMsTokenRefreshBeforeExpiry =
+    kMinutesTokenRefreshBeforeExpiry * internal::kMillisecondsPerMinute;
 // Exponential backoff parameters when token refresh fails (e.g. network
 // outage), matching Android DefaultTokenRefresher.
 const int kMinRetryBackoffMs = 30 * 1000;       // 30 seconds base delay
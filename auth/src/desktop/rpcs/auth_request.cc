@@ -42,6 +42,7 @@ const char* kHeaderFirebaseLocale = "X-Firebase-Locale";
 AuthRequest::AuthRequest(::firebase::App& app, const char* schema,
                          bool deliver_heartbeat)
     : RequestJson(schema), app(app) {
+  options_.category = rest::kTransferCategoryAuth;
   if (deliver_heartbeat) {
     std::shared_ptr<heartbeat::HeartbeatController> heartbeat_controller =
         app.GetHeartbeatController();
@@ -108,59 +108,97 @@ GetTokenResult GetTokenIfFresh(const UserView::Reader& user,
   return GetTokenResult(kAuthErrorFailure);
 }
 
+// Returns the number of refreshes of the ID token that have been started,
+// which callers read when they ask for a token to find out later whether a
+// refresh that started after that has finished. A refresh that was already
+// running doesn't count, as it may have sent the request before the caller
+// asked for a new token.
+uint64_t GetTokenRefreshCount(AuthData* const auth_data) {
+  return static_cast<AuthImpl*>(auth_data->auth_impl)->token_refreshes_started;
+}
+
 // Makes sure that calling auth->current_user().id_token() will
 // result in a token that is good for at least 5 minutes. Will fetch a new token
 // from the backend if necessary.
 //
 // If force_refresh is given, then a new token will be fetched without checking
-// the current token at all.
+// the current token at all, unless a refresh that started after refresh_count
+// was read by GetTokenRefreshCount() has succeeded. Only one refresh is made
+// at a time, so callers that need a new token together share one refresh.
 //
 // Note: this is a blocking call! The caller is supposed to call this function
 // on the appropriate thread.
 GetTokenResult EnsureFreshToken(AuthData* const auth_data,
                                 const bool force_refresh,
-                                const bool notify_listener) {
+                                const bool notify_listener,
+                                const uint64_t refresh_count) {
   FIREBASE_ASSERT_RETURN(GetTokenResult(kAuthErrorFailure), auth_data);
-
-  GetTokenResult old_token(kAuthErrorFailure);
-  std::string refresh_token;
-  const bool is_user_logged_in =
-      UserView::TryRead(auth_data, [&](const UserView::Reader& user) {
-        old_token = GetTokenIfFresh(user, force_refresh);
-        refresh_token = user->refresh_token;
-      });
-
-  if (!is_user_logged_in) {
-    return GetTokenResult(kAuthErrorNoSignedInUser);
-  }
-  if (old_token.IsValid()) {
-    return GetTokenResult(old_token.token());
-  }
-
-  const SecureTokenRequest request(*auth_data->app, GetApiKey(*auth_data),
-                                   refresh_token.c_str());
-  auto response = GetResponse<SecureTokenResponse>(request);
-  if (!response.IsSuccessful()) {
-    SignOutIfUserNoLongerValid(auth_data->auth, response.error_code());
-    return GetTokenResult(response.error_code());
-  }
+  auto auth_impl = static_cast<AuthImpl*>(auth_data->auth_impl);
 
   bool has_token_changed = false;
-  const auto token_update = TokenUpdate(response);
-  if (token_update.HasUpdate()) {
-    UserView::Writer writer = UserView::GetWriter(auth_data);
-    if (writer.IsValid()) {
-      has_token_changed =
-          UpdateUserTokensIfChanged(writer, TokenUpdate(response));
-    } else {
+  std::string id_token;
+  AuthError refresh_error = kAuthErrorNone;
+  {
+    MutexLock refresh_lock(auth_impl->token_refresh_mutex);
+    // Refreshes are numbered in the order they start, so one numbered after
+    // refresh_count started after the token was requested.
+    const bool refreshed_since_request =
+        auth_impl->token_refresh_finished > refresh_count;
+
+    GetTokenResult old_token(kAuthErrorFailure);
+    std::string refresh_token;
+    const bool is_user_logged_in =
+        UserView::TryRead(auth_data, [&](const UserView::Reader& user) {
+          old_token =
+              GetTokenIfFresh(user, force_refresh && !refreshed_since_request);
+          refresh_token = user->refresh_token;
+        });
+
+    if (!is_user_logged_in) {
       return GetTokenResult(kAuthErrorNoSignedInUser);
     }
+    if (old_token.IsValid()) {
+      return GetTokenResult(old_token.token());
+    }
+
+    const uint64_t refresh_number = ++auth_impl->token_refreshes_started;
+    const SecureTokenRequest request(*auth_data->app, GetApiKey(*auth_data),
+                                     refresh_token.c_str());
+    auto response = GetResponse<SecureTokenResponse>(request);
+    if (response.IsSuccessful()) {
+      const auto token_update = TokenUpdate(response);
+      if (token_update.HasUpdate()) {
+        UserView::Writer writer = UserView::GetWriter(auth_data);
+        if (writer.IsValid()) {
+          has_token_changed =
+              UpdateUserTokensIfChanged(writer, TokenUpdate(response));
+        } else {
+          return GetTokenResult(kAuthErrorNoSignedInUser);
+        }
+      }
+      auth_impl->token_refresh_finished = refresh_number;
+      id_token = response.id_token();
+    } else {
+      refresh_error = response.error_code();
+    }
   }
+  if (refresh_error != kAuthErrorNone) {
+    SignOutIfUserNoLongerValid(auth_data->auth, refresh_error);
+    return GetTokenResult(refresh_error);
+  }
+  // Listeners are notified once the next caller can use the new token.
   if (has_token_changed && notify_listener) {
     NotifyIdTokenListeners(auth_data);
   }
 
-  return GetTokenResult(response.id_token());
+  return GetTokenResult(id_token);
+}
+
+GetTokenResult EnsureFreshToken(AuthData* const auth_data,
+                                const bool force_refresh,
+                                const bool notify_listener) {
+  return EnsureFreshToken(auth_data, force_refresh, notify_listener,
+                          GetTokenRefreshCount(auth_data));
 }
 
 GetTokenResult EnsureFreshToken(AuthData* const auth_data,
@@ -168,6 +206,15 @@ GetTokenResult EnsureFreshToken(AuthData* const auth_data,
   return EnsureFreshToken(auth_data, force_refresh, true);
 }
 
+// Refresh of the ID token requested by User::GetToken().
+struct GetTokenRequest {
+  explicit GetTokenRequest(uint64_t refresh_count)
+      : refresh_count(refresh_count) {}
+
+  // Number of refreshes of the token started when it was requested.
+  uint64_t refresh_count;
+};
+
 // Checks whether there is a currently logged in user. If no user is signed in,
 // fails the given promise and returns false. Otherwise, doesn't touch the
 // promise and returns true.
@@ -682,9 +729,11 @@ Future<std::string> User::GetTokenInternal(const bool force_refresh,
   }
 
   const auto callback =
-      [](AuthDataHandle<std::string, rest::Request>* const handle) {
-        const GetTokenResult get_token_result =
-            EnsureFreshToken(handle->auth_data, true);
+      [](AuthDataHandle<std::string, GetTokenRequest>* const handle) {
+        // A refresh that finished after the token was requested is used
+        // instead of making another one.
+        const GetTokenResult get_token_result = EnsureFreshToken(
+            handle->auth_data, true, true, handle->request->refresh_count);
         if (!get_token_result.IsValid()) {
           FailPromise(&handle->promise, get_token_result.error());
           return;
@@ -693,9 +742,13 @@ Future<std::string> User::GetTokenInternal(const bool force_refresh,
         handle->promise.CompleteWithResult(get_token_result.token());
       };
 
-  // Note: request is deliberately null because EnsureFreshToken will create it.
-  return CallAsync(auth_data_, promise, std::unique_ptr<rest::Request>(),
-                   callback);
+  // Note: the SecureTokenRequest is created by EnsureFreshToken, if it's still
+  // needed when the callback runs.
+  return CallAsync(
+      auth_data_, promise,
+      std::unique_ptr<GetTokenRequest>(
+          new GetTokenRequest(GetTokenRefreshCount(auth_data_))),
+      callback);
 }
 
 Future<void> User::Delete() {
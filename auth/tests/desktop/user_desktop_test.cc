@@ -14,6 +14,10 @@
 
 #include "auth/src/desktop/user_desktop.h"
 
+#include <atomic>
+#include <cstring>
+#include <vector>
+
 #include "app/rest/transport_builder.h"
 #include "app/rest/transport_curl.h"
 #include "app/rest/transport_mock.h"
@@ -229,6 +233,34 @@ void InitializeSuccessfulVerifyAssertionFlow() {
   InitializeSuccessfulVerifyAssertionFlow(FakeVerifyAssertionResponse());
 }
 
+// Mock transport that counts the requests to refresh the ID token, and holds
+// them while the test wants a refresh to stay in flight.
+class TokenRefreshCountingTransport : public rest::TransportMock {
+ public:
+  static flatbuffers::unique_ptr<rest::Transport> Create() {
+    return flatbuffers::unique_ptr<rest::Transport>(
+        new TokenRefreshCountingTransport());
+  }
+
+  void PerformInternal(
+      rest::Request* request, rest::Response* response,
+      flatbuffers::unique_ptr<rest::Controller>* controller_out) override {
+    if (strstr(request->options().url.c_str(), "securetoken.googleapis.com")) {
+      refreshes++;
+      while (held) firebase::internal::Sleep(1);
+    }
+    rest::TransportMock::PerformInternal(request, response, controller_out);
+  }
+
+  // Number of refreshes requested.
+  static std::atomic<int> refreshes;
+  // Whether refreshes are held.
+  static std::atomic<bool> held;
+};
+
+std::atomic<int> TokenRefreshCountingTransport::refreshes(0);
+std::atomic<bool> TokenRefreshCountingTransport::held(false);
+
 bool WaitOnLoadPersistence(AuthData* auth_data) {
   bool load_finished = false;
   int load_wait_counter = 0;
@@ -307,6 +339,12 @@ class UserDesktopTest : public ::testing::Test {
     firebase::testing::cppsdk::ConfigReset();
   }
 
+  // Held while the ID token is refreshed.
+  Mutex& token_refresh_mutex() {
+    return static_cast<AuthImpl*>(firebase_auth_->auth_data_->auth_impl)
+        ->token_refresh_mutex;
+  }
+
   Future<AuthResult> ProcessLinkWithProviderFlow(
       FederatedOAuthProvider* provider, OAuthProviderTestHandler* handler,
       bool trigger_link) {
@@ -378,6 +416,73 @@ TEST_F(UserDesktopTest, TestGetToken) {
   EXPECT_EQ("new idtoken123", new_token);
 }
 
+// Forced refreshes requested together share the refresh that's in flight.
+TEST_F(UserDesktopTest, TestGetTokenConcurrentRefreshes) {
+  const auto api_url =
+      std::string("https://securetoken.googleapis.com/v1/token?key=") + API_KEY;
+  InitializeConfigWithAFake(
+      api_url,
+      FakeSuccessfulResponse("\"access_token\": \"new accesstoken123\","
+                             "\"expires_in\": \"3600\","
+                             "\"token_type\": \"Bearer\","
+                             "\"refresh_token\": \"new refreshtoken123\","
+                             "\"id_token\": \"new idtoken123\","
+                             "\"user_id\": \"localid123\","
+                             "\"project_id\": \"53101460582\""));
+
+  rest::SetTransportBuilder(TokenRefreshCountingTransport::Create);
+  TokenRefreshCountingTransport::refreshes = 0;
+
+  id_token_listener.ExpectChanges(1);
+  auth_state_listener.ExpectChanges(0);
+
+  std::vector<Future<std::string>> futures;
+  {
+    // Keep the refresh from starting until every token has been requested.
+    MutexLock lock(token_refresh_mutex());
+    for (int i = 0; i < 3; ++i) {
+      futures.push_back(firebase_user_.GetToken(true));
+    }
+  }
+  for (Future<std::string>& future : futures) {
+    EXPECT_EQ("new idtoken123", WaitForFuture(future));
+  }
+  EXPECT_EQ(1, TokenRefreshCountingTransport::refreshes);
+}
+
+// A forced refresh requested while another refresh is in flight doesn't
+// share it, as that refresh may have been sent before the token was
+// requested.
+TEST_F(UserDesktopTest, TestGetTokenRefreshesAgainAfterRefreshInFlight) {
+  const auto api_url =
+      std::string("https://securetoken.googleapis.com/v1/token?key=") + API_KEY;
+  InitializeConfigWithAFake(
+      api_url,
+      FakeSuccessfulResponse("\"access_token\": \"new accesstoken123\","
+                             "\"expires_in\": \"3600\","
+                             "\"token_type\": \"Bearer\","
+                             "\"refresh_token\": \"new refreshtoken123\","
+                             "\"id_token\": \"new idtoken123\","
+                             "\"user_id\": \"localid123\","
+                             "\"project_id\": \"53101460582\""));
+  rest::SetTransportBuilder(TokenRefreshCountingTransport::Create);
+  TokenRefreshCountingTransport::refreshes = 0;
+  TokenRefreshCountingTransport::held = true;
+
+  id_token_listener.ExpectChanges(1);
+  auth_state_listener.ExpectChanges(0);
+
+  Future<std::string> first = firebase_user_.GetToken(true);
+  while (TokenRefreshCountingTransport::refreshes == 0) {
+    firebase::internal::Sleep(1);
+  }
+  Future<std::string> second = firebase_user_.GetToken(true);
+  TokenRefreshCountingTransport::held = false;
+  EXPECT_EQ("new idtoken123", WaitForFuture(first));
+  EXPECT_EQ("new idtoken123", WaitForFuture(second));
+  EXPECT_EQ(2, TokenRefreshCountingTransport::refreshes);
+}
+
 TEST_F(UserDesktopTest, TestDelete) {
   InitializeConfigWithAFake(
       GetUrlForApi(API_KEY, "deleteAccount"),
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <string>
 #include <utility>
 
 #include "firebase/firestore.h"
@@ -22,6 +23,10 @@
 #if defined(__ANDROID__)
 #include "firestore/src/android/document_snapshot_android.h"
 #include "firestore/src/common/wrapper_assertions.h"
+#else
+#include "firestore/src/main/converter_main.h"
+#include "firestore/src/main/document_data_view_main.h"
+#include "firestore/src/main/document_snapshot_main.h"
 #endif  // defined(__ANDROID__)
 
 #include "gmock/gmock.h"
@@ -88,5 +93,87 @@ TEST_F(DocumentSnapshotTest, TestHashCode) {
   EXPECT_EQ(DocumentSnapshotHash(snap3), DocumentSnapshotHash(snap4));
 }
 
+#if !defined(__ANDROID__)
+
+MapFieldValue ProjectionTestData() {
+  MapFieldValue metadata{
+      {"owner", FieldValue::String("me")},
+      {"deep", FieldValue::Map({{"field", FieldValue::Integer(1)}})},
+      {"tags", FieldValue::Array({FieldValue::String("a")})},
+  };
+  return MapFieldValue{
+      {"name", FieldValue::String("doc")},
+      {"count", FieldValue::Integer(3)},
+      {"metadata", FieldValue::Map(std::move(metadata))},
+  };
+}
+
+TEST_F(DocumentSnapshotTest, GetDataReturnsOnlyRequestedFields) {
+  DocumentReference doc = Document();
+  WriteDocument(doc, ProjectionTestData());
+  DocumentSnapshot snapshot = ReadDocument(doc);
+  const DocumentSnapshotInternal* internal = GetInternal(&snapshot);
+  const auto stb = DocumentSnapshot::ServerTimestampBehavior::kDefault;
+
+  EXPECT_EQ(
+      internal->GetData({FieldPath{"name"}, FieldPath{"metadata", "owner"},
+                         FieldPath{"missing"}, FieldPath{"count", "missing"}},
+                        stb),
+      (MapFieldValue{
+          {"name", FieldValue::String("doc")},
+          {"metadata", FieldValue::Map({{"owner", FieldValue::String("me")}})},
+      }));
+  // A field requested along with one of its subfields is returned whole.
+  EXPECT_EQ(internal->GetData({FieldPath{"metadata", "deep", "field"},
+                               FieldPath{"metadata"}},
+                              stb),
+            (MapFieldValue{{"metadata", ProjectionTestData()["metadata"]}}));
+  EXPECT_TRUE(internal->GetData({FieldPath{"missing", "field"}}, stb).empty());
+}
+
+TEST_F(DocumentSnapshotTest, GetDataReturnsNothingForMissingDocument) {
+  DocumentSnapshot snapshot = ReadDocument(Document());
+  const DocumentSnapshotInternal* internal = GetInternal(&snapshot);
+  const auto stb = DocumentSnapshot::ServerTimestampBehavior::kDefault;
+
+  EXPECT_TRUE(internal->GetData({FieldPath{"name"}}, stb).empty());
+  EXPECT_TRUE(internal->GetDataView(stb).empty());
+}
+
+TEST_F(DocumentSnapshotTest, DataViewConvertsFieldsOnAccess) {
+  DocumentReference doc = Document();
+  WriteDocument(doc, ProjectionTestData());
+  DocumentDataView view;
+  {
+    // The view remains valid after its snapshot is destroyed.
+    DocumentSnapshot snapshot = ReadDocument(doc);
+    view = GetInternal(&snapshot)->GetDataView(
+        DocumentSnapshot::ServerTimestampBehavior::kDefault);
+  }
+  MapFieldValue expected = ProjectionTestData();
+
+  ASSERT_EQ(view.size(), expected.size());
+  for (std::size_t i = 0; i < view.size(); ++i) {
+    std::string key(view.key(i).data(), view.key(i).size());
+    EXPECT_EQ(view.value(i), expected[key]) << key;
+  }
+  EXPECT_TRUE(view.Contains("count"));
+  EXPECT_FALSE(view.Contains("missing"));
+  EXPECT_EQ(view.Get("count"), FieldValue::Integer(3));
+  EXPECT_FALSE(view.Get("missing").is_valid());
+  EXPECT_EQ(view.Get(FieldPath{"metadata", "deep", "field"}),
+            FieldValue::Integer(1));
+  EXPECT_FALSE(view.Get(FieldPath{"name", "field"}).is_valid());
+
+  DocumentDataView metadata = view.GetView("metadata");
+  EXPECT_EQ(metadata.size(), 3u);
+  EXPECT_EQ(metadata.Get("owner"), FieldValue::String("me"));
+  EXPECT_EQ(metadata.GetView("deep").Get("field"), FieldValue::Integer(1));
+  EXPECT_TRUE(view.GetView("name").empty());
+  EXPECT_TRUE(view.GetView("missing").empty());
+}
+
+#endif  // !defined(__ANDROID__)
+
 }  // namespace firestore
 }  // namespace firebase
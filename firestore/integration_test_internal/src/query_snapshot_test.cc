@@ -14,13 +14,20 @@
  * limitations under the License.
  */
 
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "firebase/firestore.h"
 #include "firestore/src/common/wrapper_assertions.h"
 #include "firestore_integration_test.h"
 #if defined(__ANDROID__)
 #include "firestore/src/android/query_snapshot_android.h"
+#else
+#include "firestore/src/main/converter_main.h"
+#include "firestore/src/main/document_change_main.h"
+#include "firestore/src/main/document_snapshot_main.h"
+#include "firestore/src/main/query_snapshot_main.h"
 #endif  // defined(__ANDROID__)
 
 #include "gtest/gtest.h"
@@ -185,5 +192,46 @@ TEST_F(QuerySnapshotTest, TestHashCodeNonEquality) {
   EXPECT_NE(QuerySnapshotHash(snapshot5), QuerySnapshotHash(snapshot6));
 }
 
+#if !defined(__ANDROID__)
+
+TEST_F(QuerySnapshotTest, ForEachDocumentVisitsDocumentsInOrder) {
+  CollectionReference collection =
+      Collection({{"a", {{"k", FieldValue::String("a")}}},
+                  {"b", {{"k", FieldValue::String("b")}}},
+                  {"c", {{"k", FieldValue::String("c")}}}});
+  QuerySnapshot snapshot =
+      ReadDocuments(collection.OrderBy("k", Query::Direction::kDescending));
+  const QuerySnapshotInternal* internal = GetInternal(&snapshot);
+
+  std::vector<std::string> ids;
+  internal->ForEachDocument([&ids](const DocumentSnapshotInternal& document) {
+    ids.push_back(document.id());
+  });
+  EXPECT_EQ(ids, (std::vector<std::string>{"c", "b", "a"}));
+}
+
+TEST_F(QuerySnapshotTest, ForEachChangeVisitsSameChangesAsDocumentChanges) {
+  CollectionReference collection =
+      Collection({{"a", {{"k", FieldValue::String("a")}}},
+                  {"b", {{"k", FieldValue::String("b")}}}});
+  QuerySnapshot snapshot = ReadDocuments(collection);
+  const QuerySnapshotInternal* internal = GetInternal(&snapshot);
+
+  std::vector<DocumentChange> expected = snapshot.DocumentChanges();
+  std::size_t index = 0;
+  internal->ForEachChange(
+      MetadataChanges::kExclude,
+      [&expected, &index](const DocumentChangeInternal& change) {
+        ASSERT_LT(index, expected.size());
+        EXPECT_EQ(change.type(), expected[index].type());
+        EXPECT_EQ(change.new_index(), expected[index].new_index());
+        EXPECT_EQ(change.document(), expected[index].document());
+        ++index;
+      });
+  EXPECT_EQ(index, expected.size());
+}
+
+#endif  // !defined(__ANDROID__)
+
 }  // namespace firestore
 }  // namespace firebase
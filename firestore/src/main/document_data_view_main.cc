@@ -0,0 +1,97 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "firestore/src/main/document_data_view_main.h"
+
+#include <utility>
+
+#include "Firestore/core/src/model/field_path.h"
+#include "Firestore/core/src/model/server_timestamp_util.h"
+#include "firestore/src/common/macros.h"
+#include "firestore/src/main/converter_main.h"
+#include "firestore/src/main/document_snapshot_main.h"
+
+namespace firebase {
+namespace firestore {
+
+using model::IsServerTimestamp;
+
+namespace {
+
+// Whether value is a map that can be viewed. Server timestamps are stored
+// as maps, but are converted as a single value.
+bool IsViewableMap(const google_firestore_v1_Value& value) {
+  return value.which_value_type == google_firestore_v1_Value_map_value_tag &&
+         !IsServerTimestamp(value);
+}
+
+}  // namespace
+
+DocumentDataView::DocumentDataView(
+    std::shared_ptr<const DocumentSnapshotInternal> snapshot,
+    const google_firestore_v1_MapValue& map,
+    ServerTimestampBehavior stb)
+    : snapshot_{std::move(snapshot)}, map_{map}, stb_{stb} {}
+
+absl::string_view DocumentDataView::key(std::size_t index) const {
+  SIMPLE_HARD_ASSERT(index < size(), "Field index out of range");
+  const pb_bytes_array_t* key = map_.fields[index].key;
+  if (!key) return absl::string_view();
+  return absl::string_view(reinterpret_cast<const char*>(key->bytes),
+                           key->size);
+}
+
+FieldValue DocumentDataView::value(std::size_t index) const {
+  SIMPLE_HARD_ASSERT(index < size(), "Field index out of range");
+  return snapshot_->ConvertAnyValue(map_.fields[index].value, stb_);
+}
+
+bool DocumentDataView::Contains(absl::string_view key) const {
+  return DocumentSnapshotInternal::FindField(map_, key) != nullptr;
+}
+
+FieldValue DocumentDataView::Get(absl::string_view key) const {
+  const google_firestore_v1_Value* value =
+      DocumentSnapshotInternal::FindField(map_, key);
+  if (!value) return FieldValue();
+  return snapshot_->ConvertAnyValue(*value, stb_);
+}
+
+FieldValue DocumentDataView::Get(const FieldPath& path) const {
+  const model::FieldPath& segments = GetInternal(path);
+  const google_firestore_v1_MapValue* object = &map_;
+  const google_firestore_v1_Value* value = nullptr;
+  for (std::size_t i = 0; i < segments.size(); ++i) {
+    if (value) {
+      if (!IsViewableMap(*value)) return FieldValue();
+      object = &value->map_value;
+    }
+    value = DocumentSnapshotInternal::FindField(*object, segments[i]);
+    if (!value) return FieldValue();
+  }
+  if (!value) return FieldValue();
+  return snapshot_->ConvertAnyValue(*value, stb_);
+}
+
+DocumentDataView DocumentDataView::GetView(absl::string_view key) const {
+  const google_firestore_v1_Value* value =
+      DocumentSnapshotInternal::FindField(map_, key);
+  if (!value || !IsViewableMap(*value)) return DocumentDataView();
+  return DocumentDataView(snapshot_, value->map_value, stb_);
+}
+
+}  // namespace firestore
+}  // namespace firebase
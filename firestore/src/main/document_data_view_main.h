@@ -0,0 +1,92 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIREBASE_FIRESTORE_SRC_MAIN_DOCUMENT_DATA_VIEW_MAIN_H_
+#define FIREBASE_FIRESTORE_SRC_MAIN_DOCUMENT_DATA_VIEW_MAIN_H_
+
+#include <cstddef>
+#include <memory>
+
+#include "Firestore/Protos/nanopb/google/firestore/v1/document.nanopb.h"
+#include "absl/strings/string_view.h"
+#include "firestore/src/include/firebase/firestore/document_snapshot.h"
+#include "firestore/src/include/firebase/firestore/field_path.h"
+#include "firestore/src/include/firebase/firestore/field_value.h"
+
+#if defined(__ANDROID__)
+#error "This header should not be used on Android."
+#endif
+
+namespace firebase {
+namespace firestore {
+
+class DocumentSnapshotInternal;
+
+// A read-only view of the fields of a map in a document snapshot. Fields are
+// converted to `FieldValue`s only when they're accessed, so reading a few
+// fields of a large document doesn't convert the rest.
+//
+// The view shares the snapshot's data instead of copying it, and keeps it
+// alive, so it remains valid after the snapshot it came from is destroyed.
+class DocumentDataView {
+ public:
+  // Creates an empty view.
+  DocumentDataView() = default;
+
+  // Number of fields in the map.
+  std::size_t size() const { return map_.fields_count; }
+  bool empty() const { return size() == 0; }
+
+  // Name of the field at index, which must be less than size(). Valid as
+  // long as the view.
+  absl::string_view key(std::size_t index) const;
+
+  // Converts the field at index, which must be less than size().
+  FieldValue value(std::size_t index) const;
+
+  bool Contains(absl::string_view key) const;
+
+  // Converts the field named key, or returns an invalid `FieldValue` if
+  // there's none.
+  FieldValue Get(absl::string_view key) const;
+
+  // Converts the field at path, or returns an invalid `FieldValue` if there's
+  // none.
+  FieldValue Get(const FieldPath& path) const;
+
+  // Returns a view of the map in the field named key, or an empty view if
+  // the field doesn't exist or isn't a map.
+  DocumentDataView GetView(absl::string_view key) const;
+
+ private:
+  friend class DocumentSnapshotInternal;
+
+  using ServerTimestampBehavior = DocumentSnapshot::ServerTimestampBehavior;
+
+  DocumentDataView(std::shared_ptr<const DocumentSnapshotInternal> snapshot,
+                   const google_firestore_v1_MapValue& map,
+                   ServerTimestampBehavior stb);
+
+  // Keeps the data that map_ points into alive, and converts its values.
+  std::shared_ptr<const DocumentSnapshotInternal> snapshot_;
+  google_firestore_v1_MapValue map_{};
+  ServerTimestampBehavior stb_ = ServerTimestampBehavior::kDefault;
+};
+
+}  // namespace firestore
+}  // namespace firebase
+
+#endif  // FIREBASE_FIRESTORE_SRC_MAIN_DOCUMENT_DATA_VIEW_MAIN_H_
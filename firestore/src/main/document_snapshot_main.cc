@@ -16,6 +16,8 @@
 
 #include "firestore/src/main/document_snapshot_main.h"
 
+#include <cstring>
+#include <memory>
 #include <utility>
 
 #include "Firestore/core/src/api/document_reference.h"
@@ -30,6 +32,7 @@
 #include "firestore/src/common/macros.h"
 #include "firestore/src/include/firebase/firestore.h"
 #include "firestore/src/main/converter_main.h"
+#include "firestore/src/main/document_data_view_main.h"
 #include "firestore/src/main/util_main.h"
 
 namespace firebase {
@@ -87,6 +90,39 @@ MapFieldValue DocumentSnapshotInternal::GetData(
   return result.map_value();
 }
 
+MapFieldValue DocumentSnapshotInternal::GetData(
+    const std::vector<FieldPath>& fields, ServerTimestampBehavior stb) const {
+  absl::optional<google_firestore_v1_Value> data =
+      snapshot_.GetValue(model::FieldPath::EmptyPath());
+  if (!data) return MapFieldValue{};
+
+  FieldMask mask;
+  for (const FieldPath& field : fields) {
+    FieldMask* node = &mask;
+    for (const std::string& segment : GetInternal(field)) {
+      if (node->whole) break;
+      node = &node->subfields[segment];
+    }
+    // Requesting the whole field makes requests for its subfields redundant.
+    node->whole = true;
+    node->subfields.clear();
+  }
+  if (mask.whole) return GetData(stb);
+  return ConvertMaskedObject(data->map_value, mask, stb);
+}
+
+DocumentDataView DocumentSnapshotInternal::GetDataView(
+    ServerTimestampBehavior stb) const {
+  absl::optional<google_firestore_v1_Value> data =
+      snapshot_.GetValue(model::FieldPath::EmptyPath());
+  if (!data) return DocumentDataView{};
+
+  // The view keeps its own copy of the snapshot, which shares the document
+  // with this one, so it doesn't depend on this snapshot's lifetime.
+  return DocumentDataView(std::make_shared<DocumentSnapshotInternal>(*this),
+                          data->map_value, stb);
+}
+
 FieldValue DocumentSnapshotInternal::Get(const FieldPath& field,
                                          ServerTimestampBehavior stb) const {
   return GetValue(GetInternal(field), stb);
@@ -103,6 +139,19 @@ FieldValue DocumentSnapshotInternal::GetValue(
   }
 }
 
+const google_firestore_v1_Value* DocumentSnapshotInternal::FindField(
+    const google_firestore_v1_MapValue& object, absl::string_view key) {
+  for (pb_size_t i = 0; i < object.fields_count; ++i) {
+    const pb_bytes_array_t* field_key = object.fields[i].key;
+    std::size_t size = field_key ? field_key->size : 0;
+    if (size == key.size() &&
+        (size == 0 || std::memcmp(field_key->bytes, key.data(), size) == 0)) {
+      return &object.fields[i].value;
+    }
+  }
+  return nullptr;
+}
+
 // FieldValue parsing
 
 FieldValue DocumentSnapshotInternal::ConvertAnyValue(
@@ -133,6 +182,31 @@ FieldValue DocumentSnapshotInternal::ConvertObject(
   return FieldValue::Map(std::move(result));
 }
 
+MapFieldValue DocumentSnapshotInternal::ConvertMaskedObject(
+    const google_firestore_v1_MapValue& object,
+    const FieldMask& mask,
+    ServerTimestampBehavior stb) const {
+  MapFieldValue result;
+  for (const auto& subfield : mask.subfields) {
+    const std::string& key = subfield.first;
+    const FieldMask& subfield_mask = subfield.second;
+    const google_firestore_v1_Value* value = FindField(object, key);
+    if (!value) continue;
+
+    if (subfield_mask.whole) {
+      result[key] = ConvertAnyValue(*value, stb);
+    } else if (value->which_value_type ==
+                   google_firestore_v1_Value_map_value_tag &&
+               !IsServerTimestamp(*value)) {
+      // Only include the map if any of the requested subfields exist.
+      MapFieldValue masked =
+          ConvertMaskedObject(value->map_value, subfield_mask, stb);
+      if (!masked.empty()) result[key] = FieldValue::Map(std::move(masked));
+    }
+  }
+  return result;
+}
+
 FieldValue DocumentSnapshotInternal::ConvertArray(
     const google_firestore_v1_ArrayValue& array,
     ServerTimestampBehavior stb) const {
@@ -17,12 +17,14 @@
 #ifndef FIREBASE_FIRESTORE_SRC_MAIN_DOCUMENT_SNAPSHOT_MAIN_H_
 #define FIREBASE_FIRESTORE_SRC_MAIN_DOCUMENT_SNAPSHOT_MAIN_H_
 
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "Firestore/Protos/nanopb/google/firestore/v1/document.nanopb.h"
 #include "Firestore/core/src/api/document_snapshot.h"
+#include "absl/strings/string_view.h"
 #include "firestore/src/include/firebase/firestore/document_reference.h"
 #include "firestore/src/include/firebase/firestore/document_snapshot.h"
 #include "firestore/src/include/firebase/firestore/field_value.h"
@@ -37,6 +39,7 @@
 namespace firebase {
 namespace firestore {
 
+class DocumentDataView;
 class Firestore;
 class FirestoreInternal;
 
@@ -54,6 +57,18 @@ class DocumentSnapshotInternal {
 
   MapFieldValue GetData(DocumentSnapshot::ServerTimestampBehavior stb) const;
 
+  // Returns only the given fields of the document, nested as they are in the
+  // document, converting none of the others. Fields that don't exist are
+  // left out. If both a field and one of its subfields are given, the whole
+  // field is returned.
+  MapFieldValue GetData(const std::vector<FieldPath>& fields,
+                        DocumentSnapshot::ServerTimestampBehavior stb) const;
+
+  // Returns a view of the document's fields that converts each field only
+  // when it's accessed. The view is empty if the document doesn't exist.
+  DocumentDataView GetDataView(
+      DocumentSnapshot::ServerTimestampBehavior stb) const;
+
   FieldValue Get(const FieldPath& field,
                  DocumentSnapshot::ServerTimestampBehavior stb) const;
 
@@ -69,17 +84,33 @@ class DocumentSnapshotInternal {
                          const DocumentSnapshotInternal& rhs);
 
  private:
+  friend class DocumentDataView;
+
   using ServerTimestampBehavior = DocumentSnapshot::ServerTimestampBehavior;
 
+  // Fields requested from GetData, as a tree of their path segments.
+  struct FieldMask {
+    // Whether the whole field is requested rather than some subfields.
+    bool whole = false;
+    std::map<std::string, FieldMask> subfields;
+  };
+
   FieldValue GetValue(const model::FieldPath& path,
                       ServerTimestampBehavior stb) const;
 
+  // Returns the field of object named key, or null if there's none.
+  static const google_firestore_v1_Value* FindField(
+      const google_firestore_v1_MapValue& object, absl::string_view key);
+
   // Note: these are member functions only because access to `api::Firestore`
   // is needed to create a `DocumentReferenceInternal`.
   FieldValue ConvertAnyValue(const google_firestore_v1_Value& input,
                              ServerTimestampBehavior stb) const;
   FieldValue ConvertObject(const google_firestore_v1_MapValue& object,
                            ServerTimestampBehavior stb) const;
+  MapFieldValue ConvertMaskedObject(const google_firestore_v1_MapValue& object,
+                                    const FieldMask& mask,
+                                    ServerTimestampBehavior stb) const;
   FieldValue ConvertArray(const google_firestore_v1_ArrayValue& array,
                           ServerTimestampBehavior stb) const;
   FieldValue ConvertReference(const google_firestore_v1_Value& reference) const;
@@ -51,6 +51,7 @@ std::vector<DocumentChange> QuerySnapshotInternal::DocumentChanges(
 
   if (!document_changes_ || changes_include_metadata_ != include_metadata) {
     std::vector<DocumentChange> result;
+    result.reserve(snapshot_.size());
     snapshot_.ForEachChange(include_metadata,
                             [&result](api::DocumentChange change) {
                               result.push_back(MakePublic(std::move(change)));
@@ -66,16 +67,36 @@ std::vector<DocumentChange> QuerySnapshotInternal::DocumentChanges(
 std::vector<DocumentSnapshot> QuerySnapshotInternal::documents() const {
   if (!documents_) {
     std::vector<DocumentSnapshot> result;
+    result.reserve(snapshot_.size());
     snapshot_.ForEachDocument([&result](api::DocumentSnapshot snapshot) {
       result.push_back(MakePublic(std::move(snapshot)));
     });
 
-    documents_ = result;
+    documents_ = std::move(result);
   }
 
   return documents_.value();
 }
 
+void QuerySnapshotInternal::ForEachDocument(
+    const std::function<void(const DocumentSnapshotInternal& document)>&
+        callback) const {
+  snapshot_.ForEachDocument([&callback](api::DocumentSnapshot snapshot) {
+    callback(DocumentSnapshotInternal(std::move(snapshot)));
+  });
+}
+
+void QuerySnapshotInternal::ForEachChange(
+    MetadataChanges metadata_changes,
+    const std::function<void(const DocumentChangeInternal& change)>& callback)
+    const {
+  bool include_metadata = metadata_changes == MetadataChanges::kInclude;
+  snapshot_.ForEachChange(include_metadata,
+                          [&callback](api::DocumentChange change) {
+                            callback(DocumentChangeInternal(std::move(change)));
+                          });
+}
+
 bool operator==(const QuerySnapshotInternal& lhs,
                 const QuerySnapshotInternal& rhs) {
   return lhs.snapshot_ == rhs.snapshot_;
@@ -18,6 +18,7 @@
 #define FIREBASE_FIRESTORE_SRC_MAIN_QUERY_SNAPSHOT_MAIN_H_
 
 #include <cstddef>
+#include <functional>
 #include <vector>
 
 #include "Firestore/core/src/api/query_snapshot.h"
@@ -37,6 +38,9 @@
 namespace firebase {
 namespace firestore {
 
+class DocumentChangeInternal;
+class DocumentSnapshotInternal;
+
 class QuerySnapshotInternal {
  public:
   explicit QuerySnapshotInternal(api::QuerySnapshot&& snapshot);
@@ -52,6 +56,17 @@ class QuerySnapshotInternal {
 
   std::vector<DocumentSnapshot> documents() const;
 
+  // Calls callback with each document or change in turn. Unlike documents()
+  // and DocumentChanges(), these don't create public wrappers or store them
+  // in a vector; each document or change is only valid during its call.
+  void ForEachDocument(
+      const std::function<void(const DocumentSnapshotInternal& document)>&
+          callback) const;
+  void ForEachChange(
+      MetadataChanges metadata_changes,
+      const std::function<void(const DocumentChangeInternal& change)>&
+          callback) const;
+
   std::size_t Hash() const { return snapshot_.Hash(); }
 
   friend bool operator==(const QuerySnapshotInternal& lhs,
@@ -15,6 +15,7 @@
 #include "functions/src/include/firebase/functions/callable_reference.h"
 
 #include <cassert>
+#include <utility>
 
 #include "app/src/assert.h"
 #include "app/src/include/firebase/internal/platform.h"
@@ -126,6 +127,14 @@ Future<HttpsCallableResult> HttpsCallableReference::Call(const Variant& data) {
   return internal_ ? internal_->Call(data) : Future<HttpsCallableResult>();
 }
 
+#if FIREBASE_PLATFORM_DESKTOP
+Future<HttpsCallableResult> HttpsCallableReference::Stream(
+    const Variant& data, std::function<void(const Variant& chunk)> on_chunk) {
+  return internal_ ? internal_->Stream(data, std::move(on_chunk))
+                   : Future<HttpsCallableResult>();
+}
+#endif  // FIREBASE_PLATFORM_DESKTOP
+
 bool HttpsCallableReference::is_valid() const { return internal_ != nullptr; }
 
 }  // namespace functions
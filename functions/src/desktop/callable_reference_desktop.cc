@@ -14,12 +14,13 @@
 
 #include "functions/src/desktop/callable_reference_desktop.h"
 
+#include <cstring>
 #include <string>
+#include <utility>
 
 #include "app/rest/request.h"
 #include "app/rest/util.h"
 #include "app/src/function_registry.h"
-#include "app/src/variant_util.h"
 #include "functions/src/desktop/functions_desktop.h"
 #include "functions/src/desktop/serialization.h"
 #include "functions/src/include/firebase/functions.h"
@@ -30,6 +31,7 @@ namespace internal {
 
 enum CallableReferenceFn {
   kCallableReferenceFnCall = 0,
+  kCallableReferenceFnStream,
   kCallableReferenceFnCount,
 };
 
@@ -38,21 +40,17 @@ HttpsCallableReferenceInternal::HttpsCallableReferenceInternal(
     const HttpsCallableOptions& options)
     : functions_(functions), url_(url), options_(options) {
   functions_->future_manager().AllocFutureApi(this, kCallableReferenceFnCount);
-  rest::InitTransportCurl();
-  transport_.set_is_async(true);
 }
 
 HttpsCallableReferenceInternal::~HttpsCallableReferenceInternal() {
   functions_->future_manager().ReleaseFutureApi(this);
-  rest::CleanupTransportCurl();
 }
 
 HttpsCallableReferenceInternal::HttpsCallableReferenceInternal(
     const HttpsCallableReferenceInternal& other)
     : functions_(other.functions_), url_(other.url_), options_(other.options_) {
   functions_->future_manager().AllocFutureApi(this, kCallableReferenceFnCount);
-  rest::InitTransportCurl();
-  transport_.set_is_async(true);
+  calls_.set_max_concurrent_calls(other.max_concurrent_calls());
 }
 
 HttpsCallableReferenceInternal& HttpsCallableReferenceInternal::operator=(
@@ -60,6 +58,7 @@ HttpsCallableReferenceInternal& HttpsCallableReferenceInternal::operator=(
   functions_ = other.functions_;
   url_ = other.url_;
   options_ = other.options_;
+  calls_.set_max_concurrent_calls(other.max_concurrent_calls());
   return *this;
 }
 
@@ -71,8 +70,7 @@ HttpsCallableReferenceInternal::HttpsCallableReferenceInternal(
       options_(other.options_) {
   other.functions_ = nullptr;
   functions_->future_manager().MoveFutureApi(&other, this);
-  rest::InitTransportCurl();
-  transport_.set_is_async(true);
+  calls_.set_max_concurrent_calls(other.max_concurrent_calls());
 }
 
 HttpsCallableReferenceInternal& HttpsCallableReferenceInternal::operator=(
@@ -81,6 +79,7 @@ HttpsCallableReferenceInternal& HttpsCallableReferenceInternal::operator=(
   other.functions_ = nullptr;
   url_ = std::move(other.url_);
   options_ = other.options_;
+  calls_.set_max_concurrent_calls(other.max_concurrent_calls());
   functions_->future_manager().MoveFutureApi(&other, this);
   return *this;
 }
@@ -98,16 +97,226 @@ std::string HttpsCallableReferenceInternal::GetAuthToken() const {
   return result;
 }
 
-void HttpsCallableRequest::MarkCompleted() {
-  rest::Request::MarkCompleted();
-  HttpsCallableReferenceInternal::ResolveFuture(future_impl_, future_handle_,
-                                                response_);
+HttpsCallableCall::HttpsCallableCall(HttpsCallableCallQueue* queue)
+    : queue_(queue),
+      response_(this),
+      future_impl_(nullptr),
+      event_stream_(-1) {
+  transport_.set_is_async(true);
+}
+
+void HttpsCallableCall::Reset(
+    ReferenceCountedFutureImpl* future_impl,
+    SafeFutureHandle<HttpsCallableResult> future_handle,
+    HttpsCallableChunkCallback on_chunk) {
+  request_.options().header.clear();
+  response_.Clear();
+  future_impl_ = future_impl;
+  future_handle_ = future_handle;
+  on_chunk_ = std::move(on_chunk);
+  event_stream_ = -1;
+  events_.Clear();
+  final_event_.clear();
+  body_.clear();
+}
+
+void HttpsCallableCall::Start() { queue_->Start(this); }
+
+void HttpsCallableCall::Perform() {
+  transport_.Perform(&request_, &response_, nullptr);
+}
+
+bool HttpsCallableCall::IsEventStream() {
+  if (event_stream_ < 0) {
+    const char* content_type = response_.GetHeader("Content-Type");
+    if (!content_type) content_type = response_.GetHeader("content-type");
+    event_stream_ =
+        content_type && strncmp(content_type, kEventStreamContentType,
+                                strlen(kEventStreamContentType)) == 0;
+  }
+  return event_stream_ != 0;
+}
+
+void HttpsCallableCall::HandleEvents() {
+  std::string event;
+  while (events_.Next(&event)) {
+    Variant message;
+    if (DecodeJson(event.c_str(), &message) && message.is_map()) {
+      auto message_it = message.map().find("message");
+      if (message_it != message.map().end()) {
+        on_chunk_(message_it->second);
+        continue;
+      }
+    }
+    // Any other event has the result of the call or an error, and is parsed
+    // like the body of a response that isn't streamed.
+    final_event_.swap(event);
+  }
+}
+
+void HttpsCallableCall::Complete() {
+  if (on_chunk_ && IsEventStream()) {
+    events_.Finish();
+    HandleEvents();
+    HttpsCallableReferenceInternal::ResolveFuture(
+        future_impl_, future_handle_, response_.status(), final_event_.c_str());
+  } else {
+    HttpsCallableReferenceInternal::ResolveFuture(
+        future_impl_, future_handle_, response_.status(), body_.c_str());
+  }
+  on_chunk_ = nullptr;
+  // The call may be reused or deleted once it's released.
+  queue_->Release(this, true);
+}
+
+void HttpsCallableCall::Abort(Error error, const char* error_message) {
+  future_impl_->CompleteWithResult(future_handle_, error, error_message,
+                                   HttpsCallableResult());
+  on_chunk_ = nullptr;
+  queue_->Release(this, false);
+}
+
+bool HttpsCallableCall::Response::ProcessBody(const char* buffer,
+                                              size_t length) {
+  if (!call_->on_chunk_ || !call_->IsEventStream()) {
+    call_->body_.append(buffer, length);
+    return true;
+  }
+  // Events are handled as they arrive rather than kept in the body.
+  call_->events_.Append(buffer, length);
+  call_->HandleEvents();
+  return true;
+}
+
+void HttpsCallableCall::Response::MarkCompleted() {
+  rest::Response::MarkCompleted();
+  call_->Complete();
+}
+
+void HttpsCallableCall::Response::MarkFailed() {
+  rest::Response::MarkFailed();
+  call_->Complete();
+}
+
+bool HttpsCallableRequest::SetCallData(const Variant& data) {
+  std::string* json = &options_.post_fields;
+  json->clear();
+  json->append("{\"data\":");
+  if (!EncodeJson(data, json)) {
+    json->clear();
+    return false;
+  }
+  json->push_back('}');
+  InitializeBuffer(json->c_str(), json->size());
+  return true;
+}
+
+HttpsCallableCallQueue::HttpsCallableCallQueue()
+    : max_concurrent_calls_(kDefaultMaxConcurrentCalls),
+      outstanding_calls_(0),
+      running_calls_(0),
+      shutting_down_(false),
+      outstanding_calls_semaphore_(0) {
+  rest::InitTransportCurl();
 }
 
-void HttpsCallableRequest::MarkFailed() {
-  rest::Request::MarkFailed();
-  HttpsCallableReferenceInternal::ResolveFuture(future_impl_, future_handle_,
-                                                response_);
+HttpsCallableCallQueue::~HttpsCallableCallQueue() {
+  std::deque<HttpsCallableCall*> queued_calls;
+  {
+    MutexLock lock(mutex_);
+    shutting_down_ = true;
+    queued_calls.swap(queued_calls_);
+  }
+  for (HttpsCallableCall* call : queued_calls) call->Cancel();
+  for (;;) {
+    {
+      MutexLock lock(mutex_);
+      if (outstanding_calls_ == 0) break;
+    }
+    outstanding_calls_semaphore_.Wait();
+  }
+  for (HttpsCallableCall* call : idle_calls_) delete call;
+  idle_calls_.clear();
+  rest::CleanupTransportCurl();
+}
+
+void HttpsCallableCallQueue::set_max_concurrent_calls(
+    int max_concurrent_calls) {
+  std::vector<HttpsCallableCall*> calls_to_perform;
+  {
+    MutexLock lock(mutex_);
+    max_concurrent_calls_ = max_concurrent_calls > 0 ? max_concurrent_calls : 1;
+    while (!queued_calls_.empty() && running_calls_ < max_concurrent_calls_) {
+      calls_to_perform.push_back(queued_calls_.front());
+      queued_calls_.pop_front();
+      running_calls_++;
+    }
+  }
+  for (HttpsCallableCall* call : calls_to_perform) call->Perform();
+}
+
+int HttpsCallableCallQueue::max_concurrent_calls() const {
+  MutexLock lock(mutex_);
+  return max_concurrent_calls_;
+}
+
+HttpsCallableCall* HttpsCallableCallQueue::Acquire() {
+  MutexLock lock(mutex_);
+  outstanding_calls_++;
+  if (idle_calls_.empty()) return new HttpsCallableCall(this);
+  HttpsCallableCall* call = idle_calls_.back();
+  idle_calls_.pop_back();
+  return call;
+}
+
+void HttpsCallableCallQueue::Start(HttpsCallableCall* call) {
+  bool cancel = false;
+  bool perform = false;
+  {
+    MutexLock lock(mutex_);
+    if (shutting_down_) {
+      cancel = true;
+    } else if (running_calls_ < max_concurrent_calls_) {
+      running_calls_++;
+      perform = true;
+    } else {
+      queued_calls_.push_back(call);
+    }
+  }
+  if (cancel) {
+    call->Cancel();
+  } else if (perform) {
+    call->Perform();
+  }
+}
+
+void HttpsCallableCallQueue::Release(HttpsCallableCall* call, bool performed) {
+  HttpsCallableCall* next_call = nullptr;
+  bool delete_call = false;
+  {
+    MutexLock lock(mutex_);
+    if (performed) {
+      running_calls_--;
+      if (!queued_calls_.empty() && running_calls_ < max_concurrent_calls_) {
+        next_call = queued_calls_.front();
+        queued_calls_.pop_front();
+        running_calls_++;
+      }
+    }
+    // Keep as many idle calls as can be in flight at once. Calls released
+    // while shutting down are deleted by the destructor, since it may finish
+    // as soon as the lock is released.
+    if (shutting_down_ ||
+        idle_calls_.size() < static_cast<size_t>(max_concurrent_calls_)) {
+      idle_calls_.push_back(call);
+    } else {
+      delete_call = true;
+    }
+    outstanding_calls_--;
+    if (shutting_down_) outstanding_calls_semaphore_.Post();
+  }
+  if (delete_call) delete call;
+  if (next_call) next_call->Perform();
 }
 
 // Takes an HTTP status code and returns the corresponding FUNErrorCode error
@@ -224,10 +433,10 @@ bool ErrorFromStatus(const std::string& status, Error* error) {
 /* static */
 void HttpsCallableReferenceInternal::ResolveFuture(
     ReferenceCountedFutureImpl* future_impl,
-    SafeFutureHandle<HttpsCallableResult> future_handle,
-    rest::Response* response) {
+    SafeFutureHandle<HttpsCallableResult> future_handle, int status,
+    const char* body_str) {
   // See if the HTTP status code indicates an error.
-  Error error = ErrorFromHttpStatus(response->status());
+  Error error = ErrorFromHttpStatus(status);
   bool has_error = (error != kErrorNone);
 
   // Set default values for the rest of the fields.
@@ -236,10 +445,9 @@ void HttpsCallableReferenceInternal::ResolveFuture(
   Variant data = Variant::Null();
 
   // Try to parse the body of the response.
-  std::string body_str = response->GetBody();
-  firebase::LogDebug("Cloud Function response body = %s", body_str.c_str());
-  Variant body = util::JsonToVariant(body_str.c_str());
-  if (!body.is_map()) {
+  firebase::LogDebug("Cloud Function response body = %s", body_str);
+  Variant body;
+  if (!DecodeJson(body_str, &body) || !body.is_map()) {
     has_error = true;
     error = kErrorInternal;
     error_description = "INTERNAL";
@@ -253,26 +461,26 @@ void HttpsCallableReferenceInternal::ResolveFuture(
         error = kErrorInternal;
         error_description = GetErrorMessage(error);
       }
-      Variant error_variant = error_it->second;
-      if (error_variant.is_map()) {
-        std::map<Variant, Variant> error_map = error_variant.map();
+      if (error_it->second.is_map()) {
+        std::map<Variant, Variant>& error_map = error_it->second.map();
         // Try to parse the message.
-        if (error_map.find("message") != error_map.end()) {
-          Variant message_variant = error_map["message"];
-          if (message_variant.is_string()) {
-            error_description = message_variant.string_value();
+        auto message_it = error_map.find("message");
+        if (message_it != error_map.end()) {
+          if (message_it->second.is_string()) {
+            error_description = message_it->second.string_value();
           }
         }
         // Try to parse the details.
-        if (error_map.find("details") != error_map.end()) {
-          error_details = Decode(error_map["details"]);
+        auto details_it = error_map.find("details");
+        if (details_it != error_map.end()) {
+          error_details = std::move(details_it->second);
           // TODO(klimt): Include error details in C++ future somehow.
         }
         // Try to parse the status.
-        if (error_map.find("status") != error_map.end()) {
-          Variant status_variant = error_map["status"];
-          if (status_variant.is_string()) {
-            if (!ErrorFromStatus(status_variant.string_value(), &error)) {
+        auto status_it = error_map.find("status");
+        if (status_it != error_map.end()) {
+          if (status_it->second.is_string()) {
+            if (!ErrorFromStatus(status_it->second.string_value(), &error)) {
               // The status was invalid, so clear everything.
               error = kErrorInternal;
               error_description = "INTERNAL";
@@ -288,9 +496,9 @@ void HttpsCallableReferenceInternal::ResolveFuture(
       auto result_it = body.map().find("result");
       auto data_it = body.map().find("data");
       if (result_it != body.map().end()) {
-        data = Decode(result_it->second);
+        data = std::move(result_it->second);
       } else if (data_it != body.map().end()) {
-        data = Decode(data_it->second);
+        data = std::move(data_it->second);
       } else {
         has_error = true;
         error = kErrorInternal;
@@ -299,42 +507,61 @@ void HttpsCallableReferenceInternal::ResolveFuture(
     }
   }
 
-  HttpsCallableResult callable_result(std::move(data));
-  future_impl->CompleteWithResult(future_handle, error,
-                                  error_description.c_str(), callable_result);
+  // The data is moved into the result rather than copied.
+  future_impl->Complete<HttpsCallableResult>(
+      future_handle, error, error_description.c_str(),
+      [&data](HttpsCallableResult* result) {
+        *result = HttpsCallableResult(std::move(data));
+      });
 }
 
 Future<HttpsCallableResult> HttpsCallableReferenceInternal::Call(
     const Variant& data) {
+  return CallInternal(kCallableReferenceFnCall, data, nullptr);
+}
+
+Future<HttpsCallableResult> HttpsCallableReferenceInternal::Stream(
+    const Variant& data, HttpsCallableChunkCallback on_chunk) {
+  return CallInternal(kCallableReferenceFnStream, data, std::move(on_chunk));
+}
+
+Future<HttpsCallableResult> HttpsCallableReferenceInternal::CallInternal(
+    int fn, const Variant& data, HttpsCallableChunkCallback on_chunk) {
+  // Set up the future to resolve when the call is complete.
+  ReferenceCountedFutureImpl* future_impl = future();
+  HttpsCallableResult null_result(Variant::Null());
+  SafeFutureHandle<HttpsCallableResult> handle =
+      future_impl->SafeAlloc(fn, null_result);
+  bool streaming = static_cast<bool>(on_chunk);
+  HttpsCallableCall* call = calls_.Acquire();
+  call->Reset(future_impl, handle, std::move(on_chunk));
+
   // Set up the request.
-  request_.set_url(url_.data());
-  request_.set_method(rest::util::kPost);
-  request_.add_header(rest::util::kContentType, rest::util::kApplicationJson);
+  HttpsCallableRequest& request = call->request();
+  request.set_url(url_.data());
+  request.set_method(rest::util::kPost);
+  request.options().category = rest::kTransferCategoryFunctions;
+  request.add_header(rest::util::kContentType, rest::util::kApplicationJson);
+  // Ask the function to send its result as a stream of events, which the
+  // callable protocol uses to send chunks before the result.
+  if (streaming) request.add_header("Accept", kEventStreamContentType);
 
   // Add the auth token header.
   std::string token = GetAuthToken();
   if (!token.empty()) {
     const char bearer[] = "Bearer ";
-    request_.add_header("Authorization", (std::string(bearer) + token).c_str());
+    request.add_header("Authorization", (std::string(bearer) + token).c_str());
   }
 
   // Add the params as the JSON body.
-  Variant body = Variant::EmptyMap();
-  body.map()["data"] = Encode(data);
-  std::string json = util::VariantToJson(body);
-  request_.set_post_fields(json.data());
+  if (!request.SetCallData(data)) {
+    call->Abort(kErrorInvalidArgument,
+                "Cloud Function data can't be converted to JSON.");
+    return MakeFuture(future_impl, handle);
+  }
 
   firebase::LogDebug("Calling Cloud Function with url: %s\ndata: %s",
-                     url_.c_str(), json.c_str());
-
-  // Set up the future to resolve when the request is complete.
-  ReferenceCountedFutureImpl* future_impl = future();
-  HttpsCallableResult null_result(Variant::Null());
-  SafeFutureHandle<HttpsCallableResult> handle =
-      future_impl->SafeAlloc(kCallableReferenceFnCall, null_result);
-  request_.set_future_impl(future());
-  request_.set_future_handle(handle);
-  request_.set_response(&response_);
+                     url_.c_str(), request.options().post_fields.c_str());
 
   // Check for App Check token function
   Future<std::string> app_check_future;
@@ -345,20 +572,24 @@ Future<HttpsCallableResult> HttpsCallableReferenceInternal::Call(
   bool succeeded = functions_->app()->function_registry()->CallFunction(
       token_function_id, functions_->app(), nullptr, &app_check_future);
   if (succeeded && app_check_future.status() != kFutureStatusInvalid) {
-    // Perform the transform request on a completion
-    app_check_future.OnCompletion([&](const Future<std::string>& future_token) {
-      if (future_token.result()) {
-        request_.add_header("X-Firebase-AppCheck",
-                            future_token.result()->c_str());
-      }
-      transport_.Perform(&request_, &response_, nullptr);
-    });
+    // Start the call once the token is available. The call is outstanding
+    // until then, so the queue waits for it if the reference is destroyed.
+    app_check_future.OnCompletion(
+        [call](const Future<std::string>& future_token) {
+          if (future_token.result()) {
+            call->request().add_header("X-Firebase-AppCheck",
+                                       future_token.result()->c_str());
+          }
+          call->Start();
+        });
   } else {
     // Start the request.
-    transport_.Perform(&request_, &response_, nullptr);
+    call->Start();
   }
 
-  return CallLastResult();
+  // The future of this call is returned rather than the last result, since
+  // other calls may have been made on the reference since.
+  return MakeFuture(future_impl, handle);
 }
 
 Future<HttpsCallableResult> HttpsCallableReferenceInternal::CallLastResult() {
@@ -15,12 +15,20 @@
 #ifndef FIREBASE_FUNCTIONS_SRC_DESKTOP_CALLABLE_REFERENCE_DESKTOP_H_
 #define FIREBASE_FUNCTIONS_SRC_DESKTOP_CALLABLE_REFERENCE_DESKTOP_H_
 
+#include <deque>
+#include <functional>
 #include <string>
+#include <vector>
 
+#include "app/rest/request.h"
+#include "app/rest/response.h"
 #include "app/rest/transport_curl.h"
 #include "app/rest/transport_interface.h"
+#include "app/src/include/firebase/internal/mutex.h"
 #include "app/src/include/firebase/future.h"
 #include "app/src/reference_counted_future_impl.h"
+#include "app/src/semaphore.h"
+#include "functions/src/desktop/event_stream.h"
 #include "functions/src/include/firebase/functions.h"
 #include "functions/src/include/firebase/functions/callable_reference.h"
 
@@ -28,28 +36,136 @@ namespace firebase {
 namespace functions {
 namespace internal {
 
+// Default number of calls of a reference that can be in flight at once.
+const int kDefaultMaxConcurrentCalls = 8;
+
+class HttpsCallableCallQueue;
+
+// Called with each chunk of data streamed by a function.
+typedef std::function<void(const Variant& chunk)> HttpsCallableChunkCallback;
+
+// Request of a call, with its body written in place.
 class HttpsCallableRequest : public rest::Request {
  public:
-  // Mark the transfer completed.
-  void MarkCompleted() override;
+  // Set the body to call the function with data. The JSON is written straight
+  // into the request's buffer, which keeps its capacity for later calls.
+  // Returns false if data can't be sent.
+  bool SetCallData(const Variant& data);
+};
 
-  // Mark the transfer failed.
-  void MarkFailed() override;
+// A single call of a function: the request, its response, and the transport
+// that performs them. Calls are reused by later calls on the same reference,
+// so the transport keeps its connection to the server open and the request
+// and response keep their buffers.
+class HttpsCallableCall {
+ public:
+  explicit HttpsCallableCall(HttpsCallableCallQueue* queue);
 
-  void set_future_impl(ReferenceCountedFutureImpl* impl) {
-    future_impl_ = impl;
-  }
+  // Prepare the call to be made again, resolving future_handle once it's
+  // complete. If on_chunk is set, the response is read as a stream of events
+  // as it's received, and on_chunk is called with each chunk the function
+  // sends before its result.
+  void Reset(ReferenceCountedFutureImpl* future_impl,
+             SafeFutureHandle<HttpsCallableResult> future_handle,
+             HttpsCallableChunkCallback on_chunk);
 
-  void set_future_handle(SafeFutureHandle<HttpsCallableResult> handle) {
-    future_handle_ = handle;
-  }
+  HttpsCallableRequest& request() { return request_; }
 
-  void set_response(rest::Response* response) { response_ = response; }
+  // Perform the call, or queue it until fewer calls are in flight.
+  void Start();
+
+  // Resolve the future with error instead of starting the call.
+  void Abort(Error error, const char* error_message);
 
  private:
+  friend class HttpsCallableCallQueue;
+
+  // Completes the call once the transfer is done. The response is the last
+  // part of a transfer to be marked, so the call can be reused afterwards.
+  class Response : public rest::Response {
+   public:
+    explicit Response(HttpsCallableCall* call) : call_(call) {}
+
+    bool ProcessBody(const char* buffer, size_t length) override;
+    void MarkCompleted() override;
+    void MarkFailed() override;
+
+   private:
+    HttpsCallableCall* call_;
+  };
+
+  // Send the request.
+  void Perform();
+
+  // Resolve the future from the response and return the call to the queue.
+  void Complete();
+
+  // Resolve the future as canceled without sending the request.
+  void Cancel() { Abort(kErrorCancelled, GetErrorMessage(kErrorCancelled)); }
+
+  // Whether the response is a stream of events, which is only known once
+  // its headers have been received.
+  bool IsEventStream();
+
+  // Pass the chunks in the events received so far to on_chunk_, and keep
+  // the event that ends the stream.
+  void HandleEvents();
+
+  HttpsCallableCallQueue* queue_;
+  rest::TransportCurl transport_;
+  HttpsCallableRequest request_;
+  Response response_;
+  // Body of a response that isn't streamed, kept in one buffer that's reused
+  // by later calls rather than in pieces that are joined once it's complete.
+  std::string body_;
   ReferenceCountedFutureImpl* future_impl_;
   SafeFutureHandle<HttpsCallableResult> future_handle_;
-  rest::Response* response_;
+
+  // State of a streaming call.
+  HttpsCallableChunkCallback on_chunk_;
+  // Whether the response is a stream of events, or -1 if that isn't known
+  // yet.
+  int event_stream_;
+  EventStreamParser events_;
+  // The event with the result of the call, or the error that ended it.
+  std::string final_event_;
+};
+
+// Calls made on a reference. Limits how many are in flight at once, queueing
+// the rest, and keeps idle calls to be reused.
+class HttpsCallableCallQueue {
+ public:
+  HttpsCallableCallQueue();
+  // Cancels calls that haven't been sent and waits for the rest to complete.
+  ~HttpsCallableCallQueue();
+
+  // Set how many calls can be in flight at once.
+  void set_max_concurrent_calls(int max_concurrent_calls);
+  int max_concurrent_calls() const;
+
+  // Take an idle call or create a new one. The call must be started.
+  HttpsCallableCall* Acquire();
+
+ private:
+  friend class HttpsCallableCall;
+
+  // Perform call now, or once a call in flight completes.
+  void Start(HttpsCallableCall* call);
+
+  // Called once call has completed, or been canceled if it wasn't performed.
+  void Release(HttpsCallableCall* call, bool performed);
+
+  mutable Mutex mutex_;
+  int max_concurrent_calls_;
+  // Calls that have been acquired and not released.
+  int outstanding_calls_;
+  // Calls that are being performed.
+  int running_calls_;
+  bool shutting_down_;
+  std::deque<HttpsCallableCall*> queued_calls_;
+  std::vector<HttpsCallableCall*> idle_calls_;
+  // Signaled when the last outstanding call is released while shutting down.
+  Semaphore outstanding_calls_semaphore_;
 };
 
 class HttpsCallableReferenceInternal {
@@ -89,11 +205,23 @@ class HttpsCallableReferenceInternal {
   Future<HttpsCallableResult> Call(const Variant& data);
   Future<HttpsCallableResult> CallLastResult();
 
-  // This is a static method so that the Request can construct an
+  // Asynchronously calls this CallableReference, passing each chunk the
+  // function streams to on_chunk before the future completes.
+  Future<HttpsCallableResult> Stream(const Variant& data,
+                                     HttpsCallableChunkCallback on_chunk);
+
+  // Set how many calls of this reference can be in flight at once. Calls made
+  // while that many are in flight are sent once one of them completes.
+  void set_max_concurrent_calls(int max_concurrent_calls) {
+    calls_.set_max_concurrent_calls(max_concurrent_calls);
+  }
+  int max_concurrent_calls() const { return calls_.max_concurrent_calls(); }
+
+  // This is a static method so that the call can construct an
   // HttpsCallableResult, since this is a friend class for it.
   static void ResolveFuture(ReferenceCountedFutureImpl* future_impl,
                             SafeFutureHandle<HttpsCallableResult> future_handle,
-                            rest::Response* response);
+                            int status, const char* body);
 
   // Pointer to the FunctionsInternal instance we are a part of.
   FunctionsInternal* functions_internal() const { return functions_; }
@@ -104,6 +232,10 @@ class HttpsCallableReferenceInternal {
   // Otherwise, returns an empty string.
   std::string GetAuthToken() const;
 
+  // Make a call, streaming the response if on_chunk is set.
+  Future<HttpsCallableResult> CallInternal(int fn, const Variant& data,
+                                           HttpsCallableChunkCallback on_chunk);
+
   // Get the Future for the HttpsCallableReferenceInternal.
   ReferenceCountedFutureImpl* future();
 
@@ -116,12 +248,8 @@ class HttpsCallableReferenceInternal {
   // Options for the callable reference.
   HttpsCallableOptions options_;
 
-  rest::TransportCurl transport_;
-  // For now, we only allow one request per reference at a time in C++.
-  // TODO(klimt): Figure out the lifetime issues enough to allow multiple
-  // simultaneous requests.
-  HttpsCallableRequest request_;
-  rest::Response response_;
+  // Calls made on this reference.
+  HttpsCallableCallQueue calls_;
 };
 
 }  // namespace internal
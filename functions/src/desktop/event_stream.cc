@@ -0,0 +1,79 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "functions/src/desktop/event_stream.h"
+
+#include <cstring>
+
+namespace firebase {
+namespace functions {
+namespace internal {
+
+EventStreamParser::EventStreamParser() : line_start_(0), has_data_(false) {}
+
+void EventStreamParser::Append(const char* data, size_t size) {
+  // Drop the lines that have been read so the buffer only holds the line
+  // that's being received.
+  if (line_start_ > 0) {
+    buffer_.erase(0, line_start_);
+    line_start_ = 0;
+  }
+  buffer_.append(data, size);
+}
+
+void EventStreamParser::Finish() { Append("\n\n", 2); }
+
+bool EventStreamParser::Next(std::string* data) {
+  for (;;) {
+    size_t line_end = buffer_.find('\n', line_start_);
+    if (line_end == std::string::npos) return false;
+    const char* line = buffer_.data() + line_start_;
+    size_t length = line_end - line_start_;
+    if (length > 0 && line[length - 1] == '\r') --length;
+    line_start_ = line_end + 1;
+
+    if (length == 0) {
+      // A blank line ends the event.
+      if (!has_data_) continue;
+      data->swap(data_);
+      data_.clear();
+      has_data_ = false;
+      return true;
+    }
+    // Lines starting with a colon are comments, which servers send to keep
+    // the connection open.
+    if (line[0] == ':') continue;
+
+    const char* colon = static_cast<const char*>(memchr(line, ':', length));
+    size_t name_length = colon ? colon - line : length;
+    if (name_length != 4 || strncmp(line, "data", 4) != 0) continue;
+    const char* value = colon ? colon + 1 : line + length;
+    // A single space after the colon isn't part of the value.
+    if (value < line + length && *value == ' ') ++value;
+    if (has_data_) data_ += '\n';
+    data_.append(value, line + length - value);
+    has_data_ = true;
+  }
+}
+
+void EventStreamParser::Clear() {
+  buffer_.clear();
+  line_start_ = 0;
+  data_.clear();
+  has_data_ = false;
+}
+
+}  // namespace internal
+}  // namespace functions
+}  // namespace firebase
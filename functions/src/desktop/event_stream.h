@@ -0,0 +1,68 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_FUNCTIONS_SRC_DESKTOP_EVENT_STREAM_H_
+#define FIREBASE_FUNCTIONS_SRC_DESKTOP_EVENT_STREAM_H_
+
+#include <cstddef>
+#include <string>
+
+namespace firebase {
+namespace functions {
+namespace internal {
+
+// Content type of a response made of server-sent events.
+const char* const kEventStreamContentType = "text/event-stream";
+
+// Splits a stream of server-sent events into the data of each event. Lines
+// can arrive split across or combined in chunks of the response, so events
+// are returned once the blank line that ends them has been received.
+//
+// Only the data field is used by callable functions, so other fields and
+// comments are skipped. Lines may end with "\n" or "\r\n".
+class EventStreamParser {
+ public:
+  EventStreamParser();
+
+  // Add data received from the stream.
+  void Append(const char* data, size_t size);
+
+  // Mark the end of the stream, so an event that wasn't followed by a blank
+  // line is returned by Next().
+  void Finish();
+
+  // Take the data of the next complete event and return true, or return
+  // false if there is none yet. The data of an event with several data lines
+  // is joined with "\n".
+  bool Next(std::string* data);
+
+  // Discard everything received, so the parser can be used for another
+  // stream.
+  void Clear();
+
+ private:
+  // Data that hasn't been split into lines yet.
+  std::string buffer_;
+  // Start of the first line of buffer_ that hasn't been read.
+  size_t line_start_;
+  // Data of the event being read.
+  std::string data_;
+  bool has_data_;
+};
+
+}  // namespace internal
+}  // namespace functions
+}  // namespace firebase
+
+#endif  // FIREBASE_FUNCTIONS_SRC_DESKTOP_EVENT_STREAM_H_
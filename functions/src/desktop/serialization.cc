@@ -14,70 +14,453 @@
 
 #include "functions/src/desktop/serialization.h"
 
+#include <cctype>
+#include <cerrno>
+#include <clocale>
+#include <cmath>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
 
-#include "app/src/variant_util.h"
+#include "app/src/log.h"
 
 namespace firebase {
 namespace functions {
 namespace internal {
 
-Variant Encode(const Variant& variant) {
-  if (variant.is_int64()) {
-    Variant m = Variant::EmptyMap();
-    m.map()["@type"] = "type.googleapis.com/google.protobuf.Int64Value";
-    m.map()["value"] = variant.AsString();
-    return m;
-  } else if (variant.is_map()) {
-    // Recursively encode map values.
-    Variant m = Variant::EmptyMap();
-    for (auto& entry : variant.map()) {
-      m.map()[entry.first] = Encode(entry.second);
+namespace {
+
+const char kInt64Type[] = "type.googleapis.com/google.protobuf.Int64Value";
+
+// Deepest nesting of arrays and objects that's parsed, the same limit as the
+// FlatBuffers JSON parser.
+const int kMaxDecodeDepth = 64;
+
+// Strings at least this long are moved into a Variant rather than copied.
+// Shorter strings may be stored in the Variant itself.
+const size_t kMinMovedStringSize = 64;
+
+void AppendHex4(unsigned int value, std::string* json) {
+  static const char kHexDigits[] = "0123456789abcdef";
+  json->append("\\u00");
+  json->push_back(kHexDigits[(value >> 4) & 0xf]);
+  json->push_back(kHexDigits[value & 0xf]);
+}
+
+void EncodeString(const char* str, size_t length, std::string* json) {
+  json->push_back('"');
+  const char* run_start = str;
+  const char* end = str + length;
+  for (const char* c = str; c < end; ++c) {
+    unsigned char ch = static_cast<unsigned char>(*c);
+    if (ch >= 0x20 && ch != '"' && ch != '\\') continue;
+    json->append(run_start, c - run_start);
+    run_start = c + 1;
+    switch (ch) {
+      case '"':
+        json->append("\\\"");
+        break;
+      case '\\':
+        json->append("\\\\");
+        break;
+      case '\n':
+        json->append("\\n");
+        break;
+      case '\r':
+        json->append("\\r");
+        break;
+      case '\t':
+        json->append("\\t");
+        break;
+      default:
+        AppendHex4(ch, json);
+        break;
     }
-    return m;
-  } else if (variant.is_vector()) {
-    // Recursively encode vector values.
-    Variant v = Variant::EmptyVector();
-    for (auto& entry : variant.vector()) {
-      v.vector().push_back(Encode(entry));
+  }
+  json->append(run_start, end - run_start);
+  json->push_back('"');
+}
+
+void EncodeString(const Variant& variant, std::string* json) {
+  if (variant.is_mutable_string()) {
+    const std::string& value = variant.mutable_string();
+    EncodeString(value.data(), value.size(), json);
+  } else {
+    const char* value = variant.string_value();
+    EncodeString(value, strlen(value), json);
+  }
+}
+
+bool EncodeDouble(double value, std::string* json) {
+  if (std::isnan(value) || std::isinf(value)) {
+    LogError("Cloud Function data can't contain NaN or infinite numbers.");
+    return false;
+  }
+  // 17 significant digits are enough to represent any double exactly.
+  char buffer[32];
+  int length = snprintf(buffer, sizeof(buffer), "%.17g", value);
+  // snprintf writes the current locale's decimal point, which may be more than
+  // one character, and JSON's is always '.'.
+  const char* end = buffer + length;
+  for (const char* c = buffer; c < end;) {
+    if (isdigit(static_cast<unsigned char>(*c)) || *c == '-' || *c == '+' ||
+        *c == 'e') {
+      json->push_back(*c++);
+      continue;
     }
-    return v;
+    json->push_back('.');
+    while (c < end && !isdigit(static_cast<unsigned char>(*c))) ++c;
   }
-  return variant;
+  return true;
 }
 
-Variant Decode(const Variant& variant) {
-  if (variant.is_map()) {
-    // If there's a special @type entry, try to parse it.
-    auto type_it = variant.map().find("@type");
-    if (type_it != variant.map().end() && type_it->second.is_string()) {
-      std::string type = type_it->second.string_value();
-      if (type == "type.googleapis.com/google.protobuf.Int64Value") {
-        auto value_it = variant.map().find("value");
-        if (value_it != variant.map().end() && value_it->second.is_string()) {
-          // Parse a long out of the string.
-          std::string value = value_it->second.string_value();
-          int64_t n = strtoull(value.c_str(), nullptr, 10);  // NOLINT
-          return Variant(n);
-        }
+// Parse the JSON number in [start, end) as a double, returns false if it isn't
+// one. strtod reads the current locale's decimal point, so if that isn't '.'
+// the number is copied with JSON's decimal point replaced, which also stops
+// strtod reading a following ',' as part of the number.
+bool DecodeDouble(const char* start, const char* end, double* value) {
+  const char* decimal_point = localeconv()->decimal_point;
+  char* parsed_end = nullptr;
+  if (strcmp(decimal_point, ".") == 0) {
+    *value = strtod(start, &parsed_end);
+    return parsed_end == end;
+  }
+  std::string localized;
+  for (const char* c = start; c < end; ++c) {
+    if (*c == '.') {
+      localized += decimal_point;
+    } else {
+      localized.push_back(*c);
+    }
+  }
+  *value = strtod(localized.c_str(), &parsed_end);
+  return parsed_end == localized.c_str() + localized.size();
+}
+
+// Parses JSON, building Variants in place and unwrapping typed values as
+// each object is completed.
+class JsonDecoder {
+ public:
+  explicit JsonDecoder(const char* json) : next_(json) {}
+
+  bool Decode(Variant* variant) {
+    SkipWhitespace();
+    if (!DecodeValue(variant, 0)) return false;
+    SkipWhitespace();
+    return *next_ == '\0';
+  }
+
+ private:
+  void SkipWhitespace() {
+    while (*next_ == ' ' || *next_ == '\n' || *next_ == '\r' ||
+           *next_ == '\t') {
+      ++next_;
+    }
+  }
+
+  bool Consume(char c) {
+    SkipWhitespace();
+    if (*next_ != c) return false;
+    ++next_;
+    return true;
+  }
+
+  bool DecodeValue(Variant* variant, int depth) {
+    switch (*next_) {
+      case '{':
+        return DecodeObject(variant, depth + 1);
+      case '[':
+        return DecodeArray(variant, depth + 1);
+      case '"': {
+        std::string value;
+        if (!DecodeString(&value)) return false;
+        *variant = StringVariant(&value);
+        return true;
       }
+      case 't':
+        return DecodeLiteral("true", Variant::True(), variant);
+      case 'f':
+        return DecodeLiteral("false", Variant::False(), variant);
+      case 'n':
+        return DecodeLiteral("null", Variant::Null(), variant);
+      default:
+        return DecodeNumber(variant);
     }
+  }
+
+  bool DecodeObject(Variant* variant, int depth) {
+    if (depth > kMaxDecodeDepth) return false;
+    ++next_;
+    *variant = Variant::EmptyMap();
+    std::map<Variant, Variant>& map = variant->map();
+    if (Consume('}')) return true;
+    std::string key;
+    do {
+      SkipWhitespace();
+      if (*next_ != '"' || !DecodeString(&key) || !Consume(':')) return false;
+      SkipWhitespace();
+      // Decode the value where it's stored in the map.
+      if (!DecodeValue(&map[StringVariant(&key)], depth)) return false;
+    } while (Consume(','));
+    if (!Consume('}')) return false;
+    Unwrap(variant);
+    return true;
+  }
+
+  bool DecodeArray(Variant* variant, int depth) {
+    if (depth > kMaxDecodeDepth) return false;
+    ++next_;
+    *variant = Variant::EmptyVector();
+    std::vector<Variant>& vector = variant->vector();
+    if (Consume(']')) return true;
+    do {
+      SkipWhitespace();
+      vector.emplace_back();
+      if (!DecodeValue(&vector.back(), depth)) return false;
+    } while (Consume(','));
+    return Consume(']');
+  }
 
-    // Recursively decode map values.
-    Variant m = Variant::EmptyMap();
-    for (auto& entry : variant.map()) {
-      m.map()[entry.first] = Decode(entry.second);
+  bool DecodeString(std::string* value) {
+    ++next_;
+    value->clear();
+    for (;;) {
+      const char* run_start = next_;
+      while (*next_ != '"' && *next_ != '\\' && *next_ != '\0') ++next_;
+      value->append(run_start, next_ - run_start);
+      if (*next_ == '"') {
+        ++next_;
+        return true;
+      }
+      if (*next_ == '\0') return false;
+      // Escape sequence.
+      ++next_;
+      switch (*next_++) {
+        case '"':
+          value->push_back('"');
+          break;
+        case '\\':
+          value->push_back('\\');
+          break;
+        case '/':
+          value->push_back('/');
+          break;
+        case 'b':
+          value->push_back('\b');
+          break;
+        case 'f':
+          value->push_back('\f');
+          break;
+        case 'n':
+          value->push_back('\n');
+          break;
+        case 'r':
+          value->push_back('\r');
+          break;
+        case 't':
+          value->push_back('\t');
+          break;
+        case 'u':
+          if (!DecodeCodePoint(value)) return false;
+          break;
+        default:
+          return false;
+      }
+    }
+  }
+
+  // Decode the hex digits of a \u escape, and of a second escape if the
+  // first is the high half of a surrogate pair, appending the UTF-8 encoding
+  // of the code point.
+  bool DecodeCodePoint(std::string* value) {
+    unsigned int code_point;
+    if (!DecodeHex4(&code_point)) return false;
+    if (code_point >= 0xd800 && code_point < 0xdc00) {
+      unsigned int low;
+      if (next_[0] != '\\' || next_[1] != 'u') return false;
+      next_ += 2;
+      if (!DecodeHex4(&low) || low < 0xdc00 || low >= 0xe000) return false;
+      code_point = 0x10000 + ((code_point - 0xd800) << 10) + (low - 0xdc00);
+    }
+    if (code_point < 0x80) {
+      value->push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+      value->push_back(static_cast<char>(0xc0 | (code_point >> 6)));
+      value->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    } else if (code_point < 0x10000) {
+      value->push_back(static_cast<char>(0xe0 | (code_point >> 12)));
+      value->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+      value->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    } else {
+      value->push_back(static_cast<char>(0xf0 | (code_point >> 18)));
+      value->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3f)));
+      value->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+      value->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    }
+    return true;
+  }
+
+  bool DecodeHex4(unsigned int* value) {
+    *value = 0;
+    for (int i = 0; i < 4; ++i) {
+      char c = *next_++;
+      *value <<= 4;
+      if (c >= '0' && c <= '9') {
+        *value |= c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        *value |= c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+        *value |= c - 'A' + 10;
+      } else {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool DecodeLiteral(const char* literal, const Variant& value,
+                     Variant* variant) {
+    size_t length = strlen(literal);
+    if (strncmp(next_, literal, length) != 0) return false;
+    next_ += length;
+    *variant = value;
+    return true;
+  }
+
+  bool DecodeNumber(Variant* variant) {
+    const char* start = next_;
+    if (*next_ == '-') ++next_;
+    if (!isdigit(static_cast<unsigned char>(*next_))) return false;
+    bool is_integer = true;
+    while (isdigit(static_cast<unsigned char>(*next_)) || *next_ == '.' ||
+           *next_ == 'e' || *next_ == 'E' || *next_ == '+' || *next_ == '-') {
+      if (!isdigit(static_cast<unsigned char>(*next_))) is_integer = false;
+      ++next_;
+    }
+    if (is_integer) {
+      char* end = nullptr;
+      errno = 0;
+      long long value = strtoll(start, &end, 10);  // NOLINT
+      if (end == next_ && errno != ERANGE) {
+        *variant = Variant::FromInt64(value);
+        return true;
+      }
     }
-    return m;
-  } else if (variant.is_vector()) {
-    // Recursively decode vector values.
-    Variant v = Variant::EmptyVector();
-    for (auto& entry : variant.vector()) {
-      v.vector().push_back(Decode(entry));
+    // Integers too large for an int64 are parsed as doubles.
+    double value;
+    if (!DecodeDouble(start, next_, &value)) return false;
+    *variant = Variant::FromDouble(value);
+    return true;
+  }
+
+  // Make a string Variant from value, taking its contents if it's long.
+  static Variant StringVariant(std::string* value) {
+    if (value->size() < kMinMovedStringSize) return Variant(*value);
+    Variant variant = Variant::EmptyMutableString();
+    variant.mutable_string().swap(*value);
+    return variant;
+  }
+
+  // Replace an object that wraps a value with its type with the value.
+  static void Unwrap(Variant* variant) {
+    const std::map<Variant, Variant>& map = variant->map();
+    auto type_it = map.find("@type");
+    if (type_it == map.end() || !type_it->second.is_string() ||
+        strcmp(type_it->second.string_value(), kInt64Type) != 0) {
+      return;
+    }
+    auto value_it = map.find("value");
+    if (value_it == map.end() || !value_it->second.is_string()) return;
+    int64_t value = strtoll(value_it->second.string_value(), nullptr,  // NOLINT
+                            10);
+    *variant = Variant::FromInt64(value);
+  }
+
+  const char* next_;
+};
+
+}  // namespace
+
+bool EncodeJson(const Variant& variant, std::string* json) {
+  switch (variant.type()) {
+    case Variant::kTypeNull:
+      json->append("null");
+      return true;
+    case Variant::kTypeInt64: {
+      // JSON numbers can't hold every int64, so they're sent as strings.
+      char value[24];
+      snprintf(value, sizeof(value), "%lld",
+               static_cast<long long>(variant.int64_value()));  // NOLINT
+      json->append("{\"@type\":\"");
+      json->append(kInt64Type);
+      json->append("\",\"value\":\"");
+      json->append(value);
+      json->append("\"}");
+      return true;
+    }
+    case Variant::kTypeDouble:
+      return EncodeDouble(variant.double_value(), json);
+    case Variant::kTypeBool:
+      json->append(variant.bool_value() ? "true" : "false");
+      return true;
+    case Variant::kTypeStaticString:
+    case Variant::kTypeMutableString:
+      EncodeString(variant, json);
+      return true;
+    case Variant::kTypeVector: {
+      json->push_back('[');
+      bool first = true;
+      for (const Variant& item : variant.vector()) {
+        if (!first) json->push_back(',');
+        first = false;
+        if (!EncodeJson(item, json)) return false;
+      }
+      json->push_back(']');
+      return true;
+    }
+    case Variant::kTypeMap: {
+      json->push_back('{');
+      bool first = true;
+      for (const auto& entry : variant.map()) {
+        if (!first) json->push_back(',');
+        first = false;
+        // JSON only supports string keys, so other keys are converted to
+        // strings if they're a type that can be.
+        const Variant& key = entry.first;
+        if (key.is_string()) {
+          EncodeString(key, json);
+        } else if (!key.is_null() && key.is_fundamental_type()) {
+          EncodeString(key.AsString(), json);
+        } else {
+          LogError(
+              "Variants of non-fundamental types may not be used as map "
+              "keys.");
+          return false;
+        }
+        json->push_back(':');
+        if (!EncodeJson(entry.second, json)) return false;
+      }
+      json->push_back('}');
+      return true;
     }
-    return v;
+    case Variant::kTypeStaticBlob:
+    case Variant::kTypeMutableBlob:
+      LogError("Variants containing blobs are not supported.");
+      return false;
   }
-  return variant;
+  return false;
+}
+
+bool DecodeJson(const char* json, Variant* variant) {
+  if (!json) return false;
+  JsonDecoder decoder(json);
+  if (decoder.Decode(variant)) return true;
+  *variant = Variant::Null();
+  return false;
 }
 
 }  // namespace internal
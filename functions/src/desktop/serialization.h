@@ -15,17 +15,22 @@
 #ifndef FIREBASE_FUNCTIONS_SRC_DESKTOP_SERIALIZATION_H_
 #define FIREBASE_FUNCTIONS_SRC_DESKTOP_SERIALIZATION_H_
 
+#include <string>
+
 #include "app/src/include/firebase/variant.h"
 
 namespace firebase {
 namespace functions {
 namespace internal {
 
-// Wraps the given variants with type information for special types.
-firebase::Variant Encode(const firebase::Variant& variant);
+// Append the JSON of variant to json, wrapping values that JSON can't
+// represent with their type as the callable protocol requires. Returns false
+// if variant contains a value that can't be converted, such as a blob.
+bool EncodeJson(const Variant& variant, std::string* json);
 
-// Unwraps the given Variant, stripping the type information.
-firebase::Variant Decode(const firebase::Variant& variant);
+// Parse JSON into variant, unwrapping values wrapped with their type as
+// they're parsed. Returns false if json isn't valid JSON.
+bool DecodeJson(const char* json, Variant* variant);
 
 }  // namespace internal
 }  // namespace functions
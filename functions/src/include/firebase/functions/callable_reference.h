@@ -15,11 +15,13 @@
 #ifndef FIREBASE_FUNCTIONS_SRC_INCLUDE_FIREBASE_FUNCTIONS_CALLABLE_REFERENCE_H_
 #define FIREBASE_FUNCTIONS_SRC_INCLUDE_FIREBASE_FUNCTIONS_CALLABLE_REFERENCE_H_
 
+#include <functional>
 #include <string>
 #include <vector>
 
 #include "firebase/future.h"
 #include "firebase/internal/common.h"
+#include "firebase/internal/platform.h"
 
 namespace firebase {
 class Variant;
@@ -110,6 +112,25 @@ class HttpsCallableReference {
   /// @returns The result of the call;
   Future<HttpsCallableResult> Call(const Variant& data);
 
+#if FIREBASE_PLATFORM_DESKTOP && !defined(SWIG)
+  /// @brief Calls the function, receiving the data it streams as it runs.
+  ///
+  /// Each chunk the function sends before its result, for example with
+  /// `response.sendChunk()`, is passed to on_chunk as soon as it arrives.
+  /// The returned future completes with the final result once every chunk
+  /// has been passed to on_chunk. A function that doesn't stream its
+  /// response completes the future as Call() does. Only supported on
+  /// desktop.
+  ///
+  /// @param[in] data The params to pass to the function.
+  /// @param[in] on_chunk Called with each chunk in the order they were sent.
+  /// It's called on a background thread that's shared with other transfers,
+  /// so it should return quickly.
+  /// @returns The result of the call;
+  Future<HttpsCallableResult> Stream(
+      const Variant& data, std::function<void(const Variant& chunk)> on_chunk);
+#endif  // FIREBASE_PLATFORM_DESKTOP && !defined(SWIG)
+
   /// @brief Returns true if this HttpsCallableReference is valid, false if it
   /// is not valid. An invalid HttpsCallableReference indicates that the
   /// reference is uninitialized (created with the default constructor) or that
@@ -0,0 +1,331 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "functions/src/desktop/callable_reference_desktop.h"
+
+#include <algorithm>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstdio>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "app/src/include/firebase/app.h"
+#include "app/src/time.h"
+#include "app/tests/include/firebase/app_for_testing.h"
+#include "functions/src/desktop/functions_desktop.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "testing/fake_http_server.h"
+
+namespace firebase {
+namespace functions {
+namespace internal {
+namespace {
+
+#ifndef _WIN32
+
+using ::firebase::testing::cppsdk::FakeHttpServer;
+
+// Local stand-in for a callable function. Connections are kept open between
+// requests, and each request is answered after delay_ms with the data it
+// sent as the result. Requests that accept a stream of events are answered
+// with chunks events, each delay_ms apart, and the result is held until the
+// client reports it received the chunks with ChunkReceived().
+class FakeFunctionServer {
+ public:
+  explicit FakeFunctionServer(int delay_ms, int chunks = 0)
+      : delay_ms_(delay_ms),
+        chunks_(chunks),
+        in_flight_(0),
+        max_in_flight_(0),
+        chunks_received_(0),
+        chunks_received_before_result_(false),
+        server_([this](const FakeHttpServer::Request& request, int connection) {
+          return Serve(request, connection);
+        }) {}
+
+  std::string url() const { return server_.url("/function"); }
+
+  int requests() { return server_.requests(); }
+
+  int connections() { return server_.connections(); }
+
+  int max_in_flight() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return max_in_flight_;
+  }
+
+  // Called by the client for each chunk it receives.
+  void ChunkReceived() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    chunks_received_++;
+    condition_.notify_all();
+  }
+
+  // Whether the client received every chunk while the result was held.
+  bool chunks_received_before_result() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return chunks_received_before_result_;
+  }
+
+ private:
+  bool Serve(const FakeHttpServer::Request& request, int connection) {
+    if (chunks_ > 0 &&
+        request.headers.find("text/event-stream") != std::string::npos) {
+      Stream(connection, request.body);
+      return false;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      max_in_flight_ = std::max(max_in_flight_, ++in_flight_);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms_));
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      in_flight_--;
+    }
+    FakeHttpServer::Send(connection,
+                         FakeHttpServer::Response(200, "application/json",
+                                                  Result(request.body)));
+    return true;
+  }
+
+  // Send the chunks and the result as events, closing the connection to end
+  // the response.
+  void Stream(int connection, const std::string& body) {
+    FakeHttpServer::Send(
+        connection,
+        "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+        "Connection: close\r\n\r\n");
+    for (int i = 0; i < chunks_; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms_));
+      // Split the event to check that it's put back together.
+      std::string event =
+          ": keep-alive\r\ndata: {\"message\": \"chunk " + std::to_string(i) +
+          "\"}\r\n\r\n";
+      size_t half = event.size() / 2;
+      FakeHttpServer::Send(connection, event.substr(0, half));
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      FakeHttpServer::Send(connection, event.substr(half));
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      chunks_received_before_result_ = condition_.wait_for(
+          lock, std::chrono::seconds(10),
+          [this]() { return chunks_received_ == chunks_; });
+    }
+    FakeHttpServer::Send(connection, "data: " + Result(body) + "\n\n");
+  }
+
+  // The request is {"data": ...}, so the result is {"result": ...}.
+  static std::string Result(const std::string& body) {
+    return "{\"result\"" + body.substr(body.find(':'));
+  }
+
+  int delay_ms_;
+  int chunks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  int in_flight_;
+  int max_in_flight_;
+  int chunks_received_;
+  bool chunks_received_before_result_;
+  FakeHttpServer server_;
+};
+
+class CallableReferenceDesktopTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    app_ = testing::CreateApp();
+    functions_.reset(new FunctionsInternal(app_, "us-central1"));
+  }
+
+  void TearDown() override {
+    functions_.reset();
+    delete app_;
+  }
+
+  // Wait for every future to complete, returning false if they don't within
+  // timeout_ms.
+  static bool WaitForAll(const std::vector<Future<HttpsCallableResult>>& calls,
+                         int timeout_ms) {
+    uint64_t deadline = ::firebase::internal::GetTimestamp() + timeout_ms;
+    for (const Future<HttpsCallableResult>& call : calls) {
+      while (call.status() == kFutureStatusPending) {
+        if (::firebase::internal::GetTimestamp() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+    return true;
+  }
+
+  App* app_;
+  std::unique_ptr<FunctionsInternal> functions_;
+};
+
+TEST_F(CallableReferenceDesktopTest, CallsRunConcurrently) {
+  FakeFunctionServer server(50);
+  HttpsCallableReferenceInternal reference(
+      functions_.get(), server.url().c_str(), HttpsCallableOptions());
+  reference.set_max_concurrent_calls(4);
+
+  std::vector<Future<HttpsCallableResult>> calls;
+  for (int i = 0; i < 16; ++i) {
+    calls.push_back(reference.Call(Variant(std::to_string(i))));
+  }
+  ASSERT_TRUE(WaitForAll(calls, 10000));
+  for (int i = 0; i < 16; ++i) {
+    EXPECT_EQ(calls[i].error(), kErrorNone) << calls[i].error_message();
+    ASSERT_NE(calls[i].result(), nullptr);
+    EXPECT_EQ(calls[i].result()->data(), Variant(std::to_string(i)));
+  }
+  EXPECT_EQ(server.requests(), 16);
+  EXPECT_GT(server.max_in_flight(), 1);
+  EXPECT_LE(server.max_in_flight(), 4);
+  // Calls are reused, so their connections are too.
+  EXPECT_LE(server.connections(), 4);
+}
+
+TEST_F(CallableReferenceDesktopTest, RaisingLimitStartsQueuedCalls) {
+  FakeFunctionServer server(200);
+  HttpsCallableReferenceInternal reference(
+      functions_.get(), server.url().c_str(), HttpsCallableOptions());
+  reference.set_max_concurrent_calls(1);
+
+  std::vector<Future<HttpsCallableResult>> calls;
+  for (int i = 0; i < 4; ++i) {
+    calls.push_back(reference.Call(Variant("call")));
+  }
+  reference.set_max_concurrent_calls(4);
+  ASSERT_TRUE(WaitForAll(calls, 10000));
+  for (const Future<HttpsCallableResult>& call : calls) {
+    EXPECT_EQ(call.error(), kErrorNone) << call.error_message();
+  }
+  EXPECT_GT(server.max_in_flight(), 1);
+}
+
+TEST_F(CallableReferenceDesktopTest, DestroyingReferenceCancelsQueuedCalls) {
+  FakeFunctionServer server(100);
+  std::vector<Future<HttpsCallableResult>> calls;
+  {
+    HttpsCallableReferenceInternal reference(
+        functions_.get(), server.url().c_str(), HttpsCallableOptions());
+    reference.set_max_concurrent_calls(1);
+    for (int i = 0; i < 3; ++i) {
+      calls.push_back(reference.Call(Variant("call")));
+    }
+    // Let the first call reach the server.
+    while (server.requests() == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  // The call in flight was waited for, and the rest were never sent.
+  for (const Future<HttpsCallableResult>& call : calls) {
+    EXPECT_EQ(call.status(), kFutureStatusComplete);
+  }
+  EXPECT_EQ(calls[0].error(), kErrorNone) << calls[0].error_message();
+  EXPECT_EQ(calls[1].error(), kErrorCancelled);
+  EXPECT_EQ(calls[2].error(), kErrorCancelled);
+  EXPECT_EQ(server.requests(), 1);
+}
+
+TEST_F(CallableReferenceDesktopTest, StreamPassesChunksBeforeResult) {
+  FakeFunctionServer server(100, 3);
+  HttpsCallableReferenceInternal reference(
+      functions_.get(), server.url().c_str(), HttpsCallableOptions());
+
+  std::mutex mutex;
+  std::vector<Variant> chunks;
+  Future<HttpsCallableResult> call =
+      reference.Stream(Variant("result"), [&](const Variant& chunk) {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          chunks.push_back(chunk);
+        }
+        server.ChunkReceived();
+      });
+  ASSERT_TRUE(WaitForAll({call}, 20000));
+  EXPECT_EQ(call.error(), kErrorNone) << call.error_message();
+  ASSERT_NE(call.result(), nullptr);
+  EXPECT_EQ(call.result()->data(), Variant("result"));
+
+  std::lock_guard<std::mutex> lock(mutex);
+  EXPECT_THAT(chunks, ::testing::ElementsAre(Variant("chunk 0"),
+                                             Variant("chunk 1"),
+                                             Variant("chunk 2")));
+  // The chunks are passed on as they arrive rather than with the result.
+  EXPECT_TRUE(server.chunks_received_before_result());
+}
+
+TEST_F(CallableReferenceDesktopTest, StreamOfFunctionThatDoesNotStream) {
+  FakeFunctionServer server(10);
+  HttpsCallableReferenceInternal reference(
+      functions_.get(), server.url().c_str(), HttpsCallableOptions());
+
+  int chunks = 0;
+  Future<HttpsCallableResult> call = reference.Stream(
+      Variant("result"), [&chunks](const Variant& chunk) { chunks++; });
+  ASSERT_TRUE(WaitForAll({call}, 10000));
+  EXPECT_EQ(call.error(), kErrorNone) << call.error_message();
+  ASSERT_NE(call.result(), nullptr);
+  EXPECT_EQ(call.result()->data(), Variant("result"));
+  EXPECT_EQ(chunks, 0);
+
+  // The call is reused by a call that isn't streamed.
+  call = reference.Call(Variant("again"));
+  ASSERT_TRUE(WaitForAll({call}, 10000));
+  EXPECT_EQ(call.error(), kErrorNone) << call.error_message();
+  EXPECT_EQ(call.result()->data(), Variant("again"));
+}
+
+// Benchmark of calls made on one reference to a function that takes 20ms,
+// which reports how many calls complete per second as the number of calls in
+// flight is raised. It's disabled by default; run it with
+// --gtest_also_run_disabled_tests.
+TEST_F(CallableReferenceDesktopTest, DISABLED_CallThroughput) {
+  const int kCalls = 64;
+  FakeFunctionServer server(20);
+  HttpsCallableReferenceInternal reference(
+      functions_.get(), server.url().c_str(), HttpsCallableOptions());
+  Variant data = Variant::EmptyMap();
+  data.map()["text"] = std::string(1024, 'a');
+  for (int max_concurrent_calls : {1, 4, 16}) {
+    reference.set_max_concurrent_calls(max_concurrent_calls);
+    std::vector<Future<HttpsCallableResult>> calls;
+    uint64_t start_ms = ::firebase::internal::GetTimestamp();
+    for (int i = 0; i < kCalls; ++i) calls.push_back(reference.Call(data));
+    ASSERT_TRUE(WaitForAll(calls, 30000));
+    uint64_t elapsed_ms = ::firebase::internal::GetTimestamp() - start_ms;
+    if (elapsed_ms == 0) elapsed_ms = 1;
+    for (const Future<HttpsCallableResult>& call : calls) {
+      EXPECT_EQ(call.error(), kErrorNone) << call.error_message();
+    }
+    EXPECT_LE(server.max_in_flight(), max_concurrent_calls);
+    printf("%d calls with %d in flight in %d ms (%d per second)\n", kCalls,
+           max_concurrent_calls, static_cast<int>(elapsed_ms),
+           static_cast<int>(static_cast<uint64_t>(kCalls) * 1000 /
+                            elapsed_ms));
+  }
+}
+
+#endif  // !_WIN32
+
+}  // namespace
+}  // namespace internal
+}  // namespace functions
+}  // namespace firebase
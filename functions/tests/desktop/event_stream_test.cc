@@ -0,0 +1,95 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "functions/src/desktop/event_stream.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace functions {
+namespace internal {
+namespace {
+
+std::vector<std::string> ParseAll(EventStreamParser* parser) {
+  std::vector<std::string> events;
+  std::string data;
+  while (parser->Next(&data)) events.push_back(data);
+  return events;
+}
+
+TEST(EventStreamParserTest, SplitsEvents) {
+  EventStreamParser parser;
+  std::string stream =
+      "data: {\"message\": 1}\n\n"
+      "data: {\"result\": 2}\r\n\r\n";
+  parser.Append(stream.data(), stream.size());
+  EXPECT_THAT(ParseAll(&parser),
+              ::testing::ElementsAre("{\"message\": 1}", "{\"result\": 2}"));
+}
+
+TEST(EventStreamParserTest, JoinsEventsSplitAcrossChunks) {
+  EventStreamParser parser;
+  std::string stream = "data: {\"a\": 1}\r\n\r\ndata:{\"b\": 2}\n\n";
+  std::vector<std::string> events;
+  for (char c : stream) {
+    parser.Append(&c, 1);
+    std::vector<std::string> parsed = ParseAll(&parser);
+    events.insert(events.end(), parsed.begin(), parsed.end());
+  }
+  EXPECT_THAT(events, ::testing::ElementsAre("{\"a\": 1}", "{\"b\": 2}"));
+}
+
+TEST(EventStreamParserTest, JoinsDataLines) {
+  EventStreamParser parser;
+  std::string stream = "data: {\"a\":\ndata:  1}\n\n";
+  parser.Append(stream.data(), stream.size());
+  EXPECT_THAT(ParseAll(&parser), ::testing::ElementsAre("{\"a\":\n 1}"));
+}
+
+TEST(EventStreamParserTest, SkipsCommentsAndOtherFields) {
+  EventStreamParser parser;
+  std::string stream =
+      ": keep-alive\n\n"
+      "event: message\nid: 1\nretry: 10\ndata: {}\n"
+      "database: x\n\n";
+  parser.Append(stream.data(), stream.size());
+  EXPECT_THAT(ParseAll(&parser), ::testing::ElementsAre("{}"));
+}
+
+TEST(EventStreamParserTest, FinishReturnsUnterminatedEvent) {
+  EventStreamParser parser;
+  std::string stream = "data: {\"result\": 1}";
+  parser.Append(stream.data(), stream.size());
+  EXPECT_THAT(ParseAll(&parser), ::testing::IsEmpty());
+  parser.Finish();
+  EXPECT_THAT(ParseAll(&parser), ::testing::ElementsAre("{\"result\": 1}"));
+}
+
+TEST(EventStreamParserTest, Clear) {
+  EventStreamParser parser;
+  std::string stream = "data: 1\n\ndata: 2";
+  parser.Append(stream.data(), stream.size());
+  parser.Clear();
+  parser.Finish();
+  EXPECT_THAT(ParseAll(&parser), ::testing::IsEmpty());
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace functions
+}  // namespace firebase
@@ -0,0 +1,156 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "functions/src/desktop/serialization.h"
+
+#include <clocale>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "app/src/include/firebase/variant.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace functions {
+namespace internal {
+namespace {
+
+std::string Encode(const Variant& variant) {
+  std::string json;
+  EXPECT_TRUE(EncodeJson(variant, &json));
+  return json;
+}
+
+Variant Decode(const char* json) {
+  Variant variant;
+  EXPECT_TRUE(DecodeJson(json, &variant)) << json;
+  return variant;
+}
+
+TEST(SerializationTest, EncodesScalars) {
+  EXPECT_EQ(Encode(Variant::Null()), "null");
+  EXPECT_EQ(Encode(Variant::True()), "true");
+  EXPECT_EQ(Encode(Variant::False()), "false");
+  EXPECT_EQ(Encode(Variant(1.5)), "1.5");
+  EXPECT_EQ(Encode(Variant("text")), "\"text\"");
+  EXPECT_EQ(Encode(Variant::FromInt64(-9007199254740993LL)),
+            "{\"@type\":\"type.googleapis.com/google.protobuf.Int64Value\","
+            "\"value\":\"-9007199254740993\"}");
+}
+
+TEST(SerializationTest, EncodesContainers) {
+  Variant data = Variant::EmptyMap();
+  data.map()["list"] = std::vector<Variant>{Variant(true), Variant("a")};
+  EXPECT_EQ(Encode(data), "{\"list\":[true,\"a\"]}");
+  // Keys that aren't strings are converted to strings.
+  Variant numbered = Variant::EmptyMap();
+  numbered.map()[Variant(2)] = Variant::EmptyMap();
+  EXPECT_EQ(Encode(numbered), "{\"2\":{}}");
+}
+
+TEST(SerializationTest, EscapesStrings) {
+  EXPECT_EQ(Encode(Variant(std::string("\"\\\n\t\x01\xc3\xa9", 7))),
+            "\"\\\"\\\\\\n\\t\\u0001\xc3\xa9\"");
+}
+
+TEST(SerializationTest, FailsToEncodeBlobsAndNonFiniteNumbers) {
+  std::string json;
+  EXPECT_FALSE(EncodeJson(Variant::FromStaticBlob("ab", 2), &json));
+  EXPECT_FALSE(EncodeJson(Variant(1.0 / 0.0), &json));
+}
+
+TEST(SerializationTest, DecodesValues) {
+  Variant variant = Decode(
+      " {\"a\": [1, -2.5, true, false, null], \"b\": {\"c\": \"d\"},"
+      " \"e\": 12345678901234567890} ");
+  ASSERT_TRUE(variant.is_map());
+  const std::vector<Variant>& a = variant.map()["a"].vector();
+  ASSERT_EQ(a.size(), 5);
+  EXPECT_EQ(a[0], Variant::FromInt64(1));
+  EXPECT_EQ(a[1], Variant(-2.5));
+  EXPECT_EQ(a[2], Variant::True());
+  EXPECT_EQ(a[3], Variant::False());
+  EXPECT_TRUE(a[4].is_null());
+  EXPECT_EQ(variant.map()["b"].map()["c"], Variant("d"));
+  // Integers that don't fit in an int64 are decoded as doubles.
+  EXPECT_TRUE(variant.map()["e"].is_double());
+}
+
+TEST(SerializationTest, DecodesEscapes) {
+  Variant variant = Decode("\"\\\"\\\\\\/\\n\\u00e9\\ud83d\\ude00\"");
+  EXPECT_EQ(variant.string_value(),
+            std::string("\"\\/\n\xc3\xa9\xf0\x9f\x98\x80"));
+}
+
+TEST(SerializationTest, UnwrapsInt64) {
+  Variant variant = Decode(
+      "[{\"@type\":\"type.googleapis.com/google.protobuf.Int64Value\","
+      "\"value\":\"-9007199254740993\"},"
+      "{\"@type\":\"other\",\"value\":\"1\"}]");
+  ASSERT_TRUE(variant.is_vector());
+  EXPECT_EQ(variant.vector()[0], Variant::FromInt64(-9007199254740993LL));
+  EXPECT_TRUE(variant.vector()[1].is_map());
+}
+
+TEST(SerializationTest, RejectsInvalidJson) {
+  const char* invalid[] = {
+      "",      "{",        "[1,]",  "{\"a\" 1}", "\"abc", "tru",
+      "1 2",   "{a: 1}",   "-",     "\"\\x\"",   "[1]]",  "\"\\ud83d\"",
+  };
+  for (const char* json : invalid) {
+    Variant variant;
+    EXPECT_FALSE(DecodeJson(json, &variant)) << json;
+  }
+  std::string deep(100, '[');
+  deep.append(100, ']');
+  Variant variant;
+  EXPECT_FALSE(DecodeJson(deep.c_str(), &variant));
+}
+
+TEST(SerializationTest, RoundTrips) {
+  Variant data = Variant::EmptyMap();
+  data.map()["int"] = Variant::FromInt64(INT64_MIN);
+  data.map()["double"] = Variant(0.1);
+  data.map()["long"] = std::string(1000, 'x');
+  data.map()["list"] =
+      std::vector<Variant>{Variant::Null(), Variant("\x7f\x1f")};
+  std::string json = Encode(data);
+  EXPECT_EQ(Decode(json.c_str()), data);
+}
+
+// Numbers use JSON's decimal point whatever the locale's is.
+TEST(SerializationTest, IgnoresLocaleDecimalPoint) {
+  std::string previous_locale = setlocale(LC_NUMERIC, nullptr);
+  if (!setlocale(LC_NUMERIC, "de_DE.UTF-8") &&
+      !setlocale(LC_NUMERIC, "fr_FR.UTF-8")) {
+    GTEST_SKIP() << "No locale with a comma decimal point is installed.";
+  }
+  std::string json = Encode(std::vector<Variant>{Variant(1.5), Variant(-0.25)});
+  Variant variant;
+  bool decoded = DecodeJson("[1.5,2,-0.25e1,3]", &variant);
+  setlocale(LC_NUMERIC, previous_locale.c_str());
+
+  EXPECT_EQ(json, "[1.5,-0.25]");
+  ASSERT_TRUE(decoded);
+  EXPECT_EQ(variant, Variant(std::vector<Variant>{
+                         Variant(1.5), Variant::FromInt64(2), Variant(-2.5),
+                         Variant::FromInt64(3)}));
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace functions
+}  // namespace firebase
@@ -49,8 +49,10 @@ std::string NamespacedConfigData::Serialize() const {
 }
 
 void NamespacedConfigData::Deserialize(const std::string& buffer) {
-  const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer.data());
-  size_t size = buffer.size();
+  Deserialize(reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
+}
+
+void NamespacedConfigData::Deserialize(const uint8_t* data, size_t size) {
   if (!flexbuffers::VerifyBuffer(data, size)) {
     return;
   }
@@ -71,6 +73,57 @@ void NamespacedConfigData::SetNamespace(
   config_[name_space] = map;
 }
 
+bool NamespacedConfigData::UpdateNamespace(
+    const std::map<std::string, std::string>& map,
+    const std::string& name_space) {
+  std::map<std::string, std::string>& records = config_[name_space];
+  bool changed = false;
+  // Walk both maps in key order at once.
+  auto record = records.begin();
+  auto source = map.begin();
+  while (record != records.end() || source != map.end()) {
+    if (source == map.end() ||
+        (record != records.end() && record->first < source->first)) {
+      record = records.erase(record);
+      changed = true;
+    } else if (record == records.end() || source->first < record->first) {
+      records.emplace_hint(record, *source);
+      ++source;
+      changed = true;
+    } else {
+      if (record->second != source->second) {
+        record->second = source->second;
+        changed = true;
+      }
+      ++record;
+      ++source;
+    }
+  }
+  return changed;
+}
+
+bool NamespacedConfigData::UpdateFrom(const NamespacedConfigData& source) {
+  bool changed = false;
+  for (auto it = config_.begin(); it != config_.end();) {
+    if (source.config_.count(it->first)) {
+      ++it;
+    } else {
+      it = config_.erase(it);
+      changed = true;
+    }
+  }
+  for (const auto& name_space : source.config_) {
+    if (!config_.count(name_space.first)) changed = true;
+    if (UpdateNamespace(name_space.second, name_space.first)) changed = true;
+  }
+  timestamp_ = source.timestamp_;
+  return changed;
+}
+
+void NamespacedConfigData::RemoveNamespace(const std::string& name_space) {
+  config_.erase(name_space);
+}
+
 bool NamespacedConfigData::HasValue(const std::string& key,
                                     const std::string& name_space) const {
   auto name_space_iter = config_.find(name_space);
@@ -145,16 +198,31 @@ std::string LayeredConfigs::Serialize() const {
 }
 
 void LayeredConfigs::Deserialize(const std::string& buffer) {
-  const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer.data());
-  size_t size = buffer.size();
+  Deserialize(reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
+}
+
+namespace {
+
+// Deserialize the layer stored as a string under key where it is in the
+// buffer rather than copying it out.
+template <typename T>
+void DeserializeLayer(const flexbuffers::Map& map, const char* key, T* layer) {
+  flexbuffers::String data = map[key].AsString();
+  layer->Deserialize(reinterpret_cast<const uint8_t*>(data.c_str()),
+                     data.length());
+}
+
+}  // namespace
+
+void LayeredConfigs::Deserialize(const uint8_t* data, size_t size) {
   if (!flexbuffers::VerifyBuffer(data, size)) {
     return;
   }
   auto struct_map = flexbuffers::GetRoot(data, size).AsMap();
-  fetched.Deserialize(struct_map["fetched"].AsString().str());
-  active.Deserialize(struct_map["active"].AsString().str());
-  defaults.Deserialize(struct_map["defaults"].AsString().str());
-  metadata.Deserialize(struct_map["metadata"].AsString().str());
+  DeserializeLayer(struct_map, "fetched", &fetched);
+  DeserializeLayer(struct_map, "active", &active);
+  DeserializeLayer(struct_map, "defaults", &defaults);
+  DeserializeLayer(struct_map, "metadata", &metadata);
 }
 
 bool LayeredConfigs::operator==(const LayeredConfigs& right) const {
@@ -15,6 +15,7 @@
 #ifndef FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_CONFIG_DATA_H_
 #define FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_CONFIG_DATA_H_
 
+#include <cstddef>  // for size_t
 #include <cstdint>  // for uint64_t
 #include <map>
 #include <set>
@@ -48,10 +49,24 @@ class NamespacedConfigData {
   std::string Serialize() const;
   // Deserializes a string buffer previously Serialized.
   void Deserialize(const std::string& buffer);
+  // Deserializes size bytes of data previously Serialized, in place.
+  void Deserialize(const uint8_t* data, size_t size);
 
   // Set key/value records from `map` by `namespace`.
   void SetNamespace(const std::map<std::string, std::string>& map,
                     const std::string& name_space);
+
+  // Make the records of `name_space` equal to `map`, changing only records
+  // whose value differs. Returns true if any record changed.
+  bool UpdateNamespace(const std::map<std::string, std::string>& map,
+                       const std::string& name_space);
+
+  // Make the records and timestamp equal to those of `source`, changing only
+  // records whose value differs. Returns true if any record changed.
+  bool UpdateFrom(const NamespacedConfigData& source);
+
+  // Remove the records of `name_space`.
+  void RemoveNamespace(const std::string& name_space);
   // Return true if `config` contains value by namespace and key.
   bool HasValue(const std::string& key, const std::string& name_space) const;
 
@@ -67,6 +82,7 @@ class NamespacedConfigData {
 
   const NamespaceKeyValueMap& config() const;
   uint64_t timestamp() const;
+  void set_timestamp(uint64_t timestamp) { timestamp_ = timestamp; }
 
   bool operator==(const NamespacedConfigData& right) const;
 
@@ -101,6 +117,9 @@ struct LayeredConfigs {
 
   std::string Serialize() const;
   void Deserialize(const std::string& buffer);
+  // Deserializes size bytes of data in place, such as a file mapped into
+  // memory, without copying the serialized layers.
+  void Deserialize(const uint8_t* data, size_t size);
 
   // For testing.
   bool operator==(const LayeredConfigs& right) const;
@@ -0,0 +1,147 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "remote_config/src/desktop/config_snapshot.h"
+
+#include <cstring>
+#include <thread>  // NOLINT
+#include <utility>
+
+namespace firebase {
+namespace remote_config {
+namespace internal {
+
+namespace {
+
+const size_t kMinSlotCount = 16;
+
+}  // namespace
+
+ConfigSnapshot::ConfigSnapshot() : slots_(kMinSlotCount, 0) {}
+
+uint32_t ConfigSnapshot::Hash(const char* key) {
+  // 32-bit FNV-1a.
+  uint32_t hash = 2166136261u;
+  for (; *key; ++key) {
+    hash ^= static_cast<unsigned char>(*key);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+size_t ConfigSnapshot::FindSlot(const char* key, uint32_t hash) const {
+  size_t mask = slots_.size() - 1;
+  for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+    uint32_t index = slots_[slot];
+    if (index == 0) return slot;
+    const Entry& entry = entries_[index - 1];
+    if (entry.hash == hash && strcmp(entry.key.c_str(), key) == 0) {
+      return slot;
+    }
+  }
+}
+
+void ConfigSnapshot::Add(const std::string& key, const SnapshotValue& value) {
+  uint32_t hash = Hash(key.c_str());
+  size_t slot = FindSlot(key.c_str(), hash);
+  if (slots_[slot]) {
+    entries_[slots_[slot] - 1].value = value;
+    return;
+  }
+  entries_.push_back(Entry{key, hash, value});
+  slots_[slot] = static_cast<uint32_t>(entries_.size());
+  if (entries_.size() * 2 > slots_.size()) Rehash(slots_.size() * 2);
+}
+
+bool ConfigSnapshot::Remove(const std::string& key) {
+  size_t slot = FindSlot(key.c_str(), Hash(key.c_str()));
+  uint32_t index = slots_[slot];
+  if (!index) return false;
+  // Move later entries of the probe sequence into the hole, so they can still
+  // be found, unless the hole comes before their own slot.
+  size_t mask = slots_.size() - 1;
+  size_t hole = slot;
+  for (size_t next = (hole + 1) & mask; slots_[next];
+       next = (next + 1) & mask) {
+    size_t home = entries_[slots_[next] - 1].hash & mask;
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      slots_[hole] = slots_[next];
+      hole = next;
+    }
+  }
+  slots_[hole] = 0;
+  // Fill the removed entry with the last one.
+  size_t last = entries_.size() - 1;
+  if (index - 1 != last) {
+    slots_[FindSlot(entries_[last].key.c_str(), entries_[last].hash)] = index;
+    entries_[index - 1] = std::move(entries_[last]);
+  }
+  entries_.pop_back();
+  return true;
+}
+
+void ConfigSnapshot::Rehash(size_t slot_count) {
+  slots_.assign(slot_count, 0);
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    slots_[FindSlot(entries_[i].key.c_str(), entries_[i].hash)] =
+        static_cast<uint32_t>(i + 1);
+  }
+}
+
+const SnapshotValue* ConfigSnapshot::Find(const char* key) const {
+  if (!key) return nullptr;
+  uint32_t index = slots_[FindSlot(key, Hash(key))];
+  return index ? &entries_[index - 1].value : nullptr;
+}
+
+ConfigSnapshotHolder::ReadLock::ReadLock(const ConfigSnapshotHolder& holder)
+    : holder_(holder) {
+  for (;;) {
+    uint32_t epoch = holder_.epoch_.load();
+    slot_ = epoch & 1;
+    holder_.readers_[slot_].fetch_add(1);
+    // If the epoch moved on before the reader was counted, the publisher may
+    // not wait for this reader, so count it under the new epoch instead.
+    if (holder_.epoch_.load() == epoch) break;
+    holder_.readers_[slot_].fetch_sub(1);
+  }
+  snapshot_ = holder_.current_.load();
+}
+
+ConfigSnapshotHolder::ReadLock::~ReadLock() {
+  holder_.readers_[slot_].fetch_sub(1);
+}
+
+ConfigSnapshotHolder::ConfigSnapshotHolder()
+    : current_(new ConfigSnapshot()), epoch_(0) {
+  readers_[0] = 0;
+  readers_[1] = 0;
+}
+
+ConfigSnapshotHolder::~ConfigSnapshotHolder() { delete current_.load(); }
+
+void ConfigSnapshotHolder::Publish(std::unique_ptr<ConfigSnapshot> snapshot) {
+  const ConfigSnapshot* previous = current_.exchange(snapshot.release());
+  uint32_t previous_epoch = epoch_.fetch_add(1);
+  // Readers are only ever held for a lookup and a copy, so spin rather than
+  // making every reader signal the publisher.
+  while (readers_[previous_epoch & 1].load() != 0) {
+    std::this_thread::yield();
+  }
+  delete previous;
+}
+
+}  // namespace internal
+}  // namespace remote_config
+}  // namespace firebase
@@ -0,0 +1,139 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_CONFIG_SNAPSHOT_H_
+#define FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_CONFIG_SNAPSHOT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "remote_config/src/include/firebase/remote_config.h"
+
+namespace firebase {
+namespace remote_config {
+namespace internal {
+
+// A config value along with the result of converting it to each type getters
+// return, so the conversions happen once when the value is activated rather
+// than every time it's read.
+struct SnapshotValue {
+  SnapshotValue()
+      : source(kValueSourceStaticValue),
+        bool_value(false),
+        is_bool(false),
+        long_value(0),
+        is_long(false),
+        double_value(0.0),
+        is_double(false) {}
+
+  std::string string_value;
+  ValueSource source;
+  bool bool_value;
+  bool is_bool;
+  int64_t long_value;
+  bool is_long;
+  double double_value;
+  bool is_double;
+};
+
+// The values that getters can return, keyed by a hash of their key. A
+// snapshot is built by adding values, or by copying the published snapshot
+// and changing the values that differ, and never changes once it's
+// published.
+class ConfigSnapshot {
+ public:
+  ConfigSnapshot();
+
+  // Add value for key, replacing any value already added for the key.
+  void Add(const std::string& key, const SnapshotValue& value);
+
+  // Remove the value for key. Returns false if there was none.
+  bool Remove(const std::string& key);
+
+  // Returns the value for key or nullptr if there's none. Doesn't allocate.
+  const SnapshotValue* Find(const char* key) const;
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    std::string key;
+    uint32_t hash;
+    SnapshotValue value;
+  };
+
+  static uint32_t Hash(const char* key);
+
+  // Returns the slot holding key, or the empty slot where it belongs.
+  size_t FindSlot(const char* key, uint32_t hash) const;
+
+  // Resize the table to slot_count slots, which must be a power of two.
+  void Rehash(size_t slot_count);
+
+  std::vector<Entry> entries_;
+  // Open addressed table of 1 + the index of each entry in entries_, or 0 for
+  // an empty slot. Always at most half full.
+  std::vector<uint32_t> slots_;
+};
+
+// Publishes the current snapshot to getters without making them take a lock.
+//
+// Readers announce themselves in one of two counters, picked by the parity
+// of the epoch when they start. Publishing swaps the snapshot and advances
+// the epoch, so new readers see the new snapshot, then waits for the readers
+// counted under the previous epoch before deleting the old snapshot.
+class ConfigSnapshotHolder {
+ public:
+  // Keeps the current snapshot alive while it's being read.
+  class ReadLock {
+   public:
+    explicit ReadLock(const ConfigSnapshotHolder& holder);
+    ~ReadLock();
+
+    const ConfigSnapshot& snapshot() const { return *snapshot_; }
+
+   private:
+    ReadLock(const ReadLock&) = delete;
+    ReadLock& operator=(const ReadLock&) = delete;
+
+    const ConfigSnapshotHolder& holder_;
+    uint32_t slot_;
+    const ConfigSnapshot* snapshot_;
+  };
+
+  // Starts with an empty snapshot.
+  ConfigSnapshotHolder();
+  ~ConfigSnapshotHolder();
+
+  // Replace the current snapshot, blocking until no reader can be using the
+  // previous one. Calls must be serialized by the caller.
+  void Publish(std::unique_ptr<ConfigSnapshot> snapshot);
+
+ private:
+  ConfigSnapshotHolder(const ConfigSnapshotHolder&) = delete;
+  ConfigSnapshotHolder& operator=(const ConfigSnapshotHolder&) = delete;
+
+  std::atomic<const ConfigSnapshot*> current_;
+  mutable std::atomic<uint32_t> epoch_;
+  mutable std::atomic<uint32_t> readers_[2];
+};
+
+}  // namespace internal
+}  // namespace remote_config
+}  // namespace firebase
+
+#endif  // FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_CONFIG_SNAPSHOT_H_
@@ -15,9 +15,7 @@
 #include "remote_config/src/desktop/file_manager.h"
 
 #include <cstdint>
-#include <fstream>
 #include <map>
-#include <sstream>
 #include <string>
 #include <utility>
 
@@ -26,14 +24,165 @@
 #include "remote_config/src/desktop/config_data.h"
 
 #if FIREBASE_PLATFORM_WINDOWS
+#include <windows.h>
+
 #include <codecvt>
 #include <locale>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 namespace firebase {
 namespace remote_config {
 namespace internal {
 
+namespace {
+
+const char kTempFileSuffix[] = ".tmp";
+
+#if FIREBASE_PLATFORM_WINDOWS
+
+// A file mapped read-only into memory.
+class MappedFile {
+ public:
+  MappedFile() : data_(nullptr), size_(0) {}
+  ~MappedFile() {
+    if (data_) UnmapViewOfFile(data_);
+  }
+
+  // Map the file at path. Returns false if it can't be opened.
+  bool Open(const std::wstring& path) {
+    HANDLE file =
+        CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    bool success = GetFileSizeEx(file, &size) != 0;
+    // An empty file can't be mapped, but is still opened successfully.
+    if (success && size.QuadPart > 0) {
+      HANDLE mapping =
+          CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (mapping) {
+        data_ = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        // The view keeps the mapping alive.
+        CloseHandle(mapping);
+      }
+      success = data_ != nullptr;
+      if (success) size_ = static_cast<size_t>(size.QuadPart);
+    }
+    CloseHandle(file);
+    return success;
+  }
+
+  const uint8_t* data() const { return static_cast<const uint8_t*>(data_); }
+  size_t size() const { return size_; }
+
+ private:
+  void* data_;
+  size_t size_;
+};
+
+// Write data to a new file at path and flush it to disk.
+bool WriteFileDurably(const std::wstring& path, const std::string& data) {
+  HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr,
+                            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) return false;
+  DWORD written = 0;
+  bool success = WriteFile(file, data.data(), static_cast<DWORD>(data.size()),
+                           &written, nullptr) &&
+                 written == data.size() && FlushFileBuffers(file);
+  return CloseHandle(file) && success;
+}
+
+// Replace the file at to with the file at from.
+bool RenameOver(const std::wstring& from, const std::wstring& to) {
+  return MoveFileExW(from.c_str(), to.c_str(),
+                     MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+void RemoveFile(const std::wstring& path) { DeleteFileW(path.c_str()); }
+
+#else
+
+// A file mapped read-only into memory.
+class MappedFile {
+ public:
+  MappedFile() : data_(nullptr), size_(0) {}
+  ~MappedFile() {
+    if (data_) munmap(data_, size_);
+  }
+
+  // Map the file at path. Returns false if it can't be opened.
+  bool Open(const std::string& path) {
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) return false;
+    struct stat status;
+    bool success = fstat(file, &status) == 0;
+    // An empty file can't be mapped, but is still opened successfully.
+    if (success && status.st_size > 0) {
+      void* data = mmap(nullptr, static_cast<size_t>(status.st_size),
+                        PROT_READ, MAP_PRIVATE, file, 0);
+      success = data != MAP_FAILED;
+      if (success) {
+        data_ = data;
+        size_ = static_cast<size_t>(status.st_size);
+      }
+    }
+    // The mapping stays valid once the file is closed.
+    close(file);
+    return success;
+  }
+
+  const uint8_t* data() const { return static_cast<const uint8_t*>(data_); }
+  size_t size() const { return size_; }
+
+ private:
+  void* data_;
+  size_t size_;
+};
+
+// Write data to a new file at path and flush it to disk.
+bool WriteFileDurably(const std::string& path, const std::string& data) {
+  int file = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (file < 0) return false;
+  const char* remaining = data.data();
+  size_t size = data.size();
+  while (size) {
+    ssize_t written = write(file, remaining, size);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) break;
+    remaining += written;
+    size -= written;
+  }
+  bool success = size == 0 && fsync(file) == 0;
+  return close(file) == 0 && success;
+}
+
+// Replace the file at to with the file at from.
+bool RenameOver(const std::string& from, const std::string& to) {
+  if (rename(from.c_str(), to.c_str()) != 0) return false;
+  // Flush the directory so the rename itself survives a crash.
+  std::string::size_type separator = to.find_last_of('/');
+  std::string directory =
+      separator == std::string::npos ? "." : to.substr(0, separator + 1);
+  int dir = open(directory.c_str(), O_RDONLY);
+  if (dir >= 0) {
+    fsync(dir);
+    close(dir);
+  }
+  return true;
+}
+
+void RemoveFile(const std::string& path) { unlink(path.c_str()); }
+
+#endif  // FIREBASE_PLATFORM_WINDOWS
+
+}  // namespace
+
 RemoteConfigFileManager::RemoteConfigFileManager(const std::string& filename,
                                                  const firebase::App& app) {
   const char* package_name = app.options().package_name();
@@ -45,14 +194,18 @@ RemoteConfigFileManager::RemoteConfigFileManager(const std::string& filename,
   std::string app_dir =
       AppDataDir(app_data_prefix.c_str(), /*should_create=*/true, &error);
   std::string file_path;
+  std::string temp_file_path;
   if (error.empty() && !app_dir.empty()) {
     file_path = app_dir + "/" + app.name() + "_" + filename;
+    temp_file_path = file_path + kTempFileSuffix;
   }
 #if FIREBASE_PLATFORM_WINDOWS
   std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> utf8_to_wstring;
   file_path_ = utf8_to_wstring.from_bytes(file_path);
+  temp_file_path_ = utf8_to_wstring.from_bytes(temp_file_path);
 #else
   file_path_ = file_path;
+  temp_file_path_ = temp_file_path;
 #endif
 }
 
@@ -60,13 +213,11 @@ bool RemoteConfigFileManager::Load(LayeredConfigs* configs) const {
   if (!configs || file_path_.empty()) {
     return false;
   }
-  std::fstream input(file_path_, std::ios::in | std::ios::binary);
-  if (!input) {
+  MappedFile file;
+  if (!file.Open(file_path_)) {
     return false;
   }
-  std::stringstream ss;
-  ss << input.rdbuf();
-  configs->Deserialize(ss.str());
+  configs->Deserialize(file.data(), file.size());
   return true;
 }
 
@@ -75,11 +226,11 @@ bool RemoteConfigFileManager::Save(const LayeredConfigs& configs) const {
     return false;
   }
   std::string buffer = configs.Serialize();
-  std::fstream output(file_path_, std::ios::out | std::ios::binary);
-  if (!output) {
+  if (!WriteFileDurably(temp_file_path_, buffer) ||
+      !RenameOver(temp_file_path_, file_path_)) {
+    RemoveFile(temp_file_path_);
     return false;
   }
-  output.write(buffer.c_str(), buffer.size());
   return true;
 }
 
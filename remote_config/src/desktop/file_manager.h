@@ -33,17 +33,26 @@ class RemoteConfigFileManager {
                           const firebase::App& app);
 
   // Load `configs` from file. Will return `true` if success.
+  //
+  // The file is mapped into memory and deserialized in place.
   bool Load(LayeredConfigs* configs) const;
 
   // Save `configs` to file. Will return `true` if success.
+  //
+  // The data is written to a temporary file that is flushed to disk and then
+  // renamed over the file, so a crash part way through a save leaves either
+  // the old or the new contents rather than a torn file.
   bool Save(const LayeredConfigs& configs) const;
 
  private:
-  // Path to file with data. On Windows, use a UTF-16 path string.
+  // Path to file with data, and to the temporary file saves are written to.
+  // On Windows, use a UTF-16 path string.
 #if FIREBASE_PLATFORM_WINDOWS
   std::wstring file_path_;
+  std::wstring temp_file_path_;
 #else
   std::string file_path_;
+  std::string temp_file_path_;
 #endif
 };
 
@@ -26,8 +26,15 @@ NotificationChannel::NotificationChannel()
 bool NotificationChannel::Get() {
   std::unique_lock<std::mutex> lock(mutex_);
   condition_variable_.wait(lock, [this]() { return closed_ || have_item_; });
+  bool have_item = have_item_;
+  have_item_ = false;
+  return have_item;
+}
+
+void NotificationChannel::Coalesce(std::chrono::milliseconds duration) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  condition_variable_.wait_for(lock, duration, [this]() { return closed_; });
   have_item_ = false;
-  return !closed_;
 }
 
 void NotificationChannel::Put() {
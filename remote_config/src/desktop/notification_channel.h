@@ -15,6 +15,7 @@
 #ifndef FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_NOTIFICATION_CHANNEL_H_
 #define FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_NOTIFICATION_CHANNEL_H_
 
+#include <chrono>              // NOLINT
 #include <condition_variable>  // NOLINT
 
 namespace firebase {
@@ -29,12 +30,17 @@ class NotificationChannel {
   NotificationChannel();
 
   // Blocks until Put() or Close() is called on another thread.
-  // Returns false immediately, if Close() is or has already been called,
-  // otherwise true if unblocked by a call to `Put`.
-  // If `Get` is called after `Put` but nothing was unblocked at the time, the
-  // thread will still block until `Put` is called again.
+  // Returns true if there is a notification from `Put` that hasn't been
+  // received yet, even if the channel has been closed since, so work
+  // requested before closing isn't lost. Otherwise returns false once Close()
+  // is or has already been called.
   bool Get();
 
+  // Blocks for `duration`, or until Close() is called, then discards calls
+  // to `Put` made in the meantime so they're handled along with the
+  // notification already received from `Get`.
+  void Coalesce(std::chrono::milliseconds duration);
+
   // Unblocks one thread waiting for a result from `Get`.
   // If 'Close' has already been called, 'Put' does nothing.
   void Put();
@@ -0,0 +1,392 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "remote_config/src/desktop/realtime_stream.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <utility>
+
+#include "app/rest/request.h"
+#include "app/rest/response.h"
+#include "app/rest/transport_curl.h"
+#include "app/rest/util.h"
+#include "app/src/log.h"
+#include "app/src/variant_util.h"
+
+namespace firebase {
+namespace remote_config {
+namespace internal {
+
+namespace {
+
+const char kApiKeyHeader[] = "X-Goog-Api-Key";
+const char kStreamingHeader[] = "X-Accept-Response-Streaming";
+const char kTemplateVersionField[] = "latestTemplateVersionNumber";
+const char kFeatureDisabledField[] = "featureDisabled";
+const char kRetryIntervalField[] = "retryIntervalSeconds";
+
+// Connections are reopened after this long in case the connection was
+// dropped without being closed.
+const int64_t kDefaultConnectionTimeoutMs = 10 * 60 * 1000;
+
+// Read an integer that the server may send as either a number or a string.
+bool VariantToInt64(const Variant& value, int64_t* out) {
+  if (value.is_int64()) {
+    *out = value.int64_value();
+    return true;
+  }
+  if (value.is_double()) {
+    *out = static_cast<int64_t>(value.double_value());
+    return true;
+  }
+  if (value.is_string()) {
+    const char* string = value.string_value();
+    char* end = nullptr;
+    long long parsed = strtoll(string, &end, 10);  // NOLINT
+    if (end == string || *end != '\0') return false;
+    *out = parsed;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+RealtimeMessageParser::RealtimeMessageParser()
+    : scanned_(0), depth_(0), in_string_(false), escaped_(false) {}
+
+void RealtimeMessageParser::Append(const char* data, size_t size) {
+  buffer_.append(data, size);
+}
+
+bool RealtimeMessageParser::Next(std::string* message) {
+  for (; scanned_ < buffer_.size(); ++scanned_) {
+    char c = buffer_[scanned_];
+    if (in_string_) {
+      if (escaped_) {
+        escaped_ = false;
+      } else if (c == '\\') {
+        escaped_ = true;
+      } else if (c == '"') {
+        in_string_ = false;
+      }
+    } else if (c == '"') {
+      // Only strings within an object matter, anything else between
+      // messages is skipped.
+      in_string_ = depth_ > 0;
+    } else if (c == '{') {
+      if (depth_ == 0) {
+        // Drop what came before the message, such as the "[" and "," that
+        // make the stream a JSON array.
+        buffer_.erase(0, scanned_);
+        scanned_ = 0;
+      }
+      depth_++;
+    } else if (c == '}' && depth_ > 0 && --depth_ == 0) {
+      message->assign(buffer_, 0, scanned_ + 1);
+      buffer_.erase(0, scanned_ + 1);
+      scanned_ = 0;
+      return true;
+    }
+  }
+  if (depth_ == 0) {
+    buffer_.clear();
+    scanned_ = 0;
+  }
+  return false;
+}
+
+// Passes the stream's messages to the RealtimeStream as they arrive rather
+// than collecting the body.
+class RealtimeStream::StreamResponse : public rest::Response {
+ public:
+  explicit StreamResponse(RealtimeStream* stream)
+      : stream_(stream), opened_(false) {}
+
+  bool ProcessHeader(const char* buffer, size_t length) override {
+    bool result = rest::Response::ProcessHeader(buffer, length);
+    if (status() == rest::util::HttpSuccess) opened_ = true;
+    return result;
+  }
+
+  bool ProcessBody(const char* buffer, size_t length) override {
+    // The body of a failed request is an error rather than a stream.
+    if (!opened_) return rest::Response::ProcessBody(buffer, length);
+    parser_.Append(buffer, length);
+    std::string message;
+    while (parser_.Next(&message)) stream_->OnMessage(std::move(message));
+    return true;
+  }
+
+  void MarkCompleted() override {
+    rest::Response::MarkCompleted();
+    stream_->OnConnectionComplete();
+  }
+
+  void MarkFailed() override {
+    rest::Response::MarkFailed();
+    stream_->OnConnectionComplete();
+  }
+
+  // Whether the server accepted the request and started the stream.
+  bool opened() const { return opened_; }
+
+ private:
+  RealtimeStream* stream_;
+  RealtimeMessageParser parser_;
+  bool opened_;
+};
+
+RealtimeStream::RealtimeStream(const std::string& url,
+                               const std::string& api_key,
+                               RequestBodyCallback request_body,
+                               VersionCallback on_version,
+                               ErrorCallback on_error)
+    : url_(url),
+      api_key_(api_key),
+      request_body_(std::move(request_body)),
+      on_version_(std::move(on_version)),
+      on_error_(std::move(on_error)),
+      connection_timeout_ms_(kDefaultConnectionTimeoutMs),
+      running_(false),
+      shutting_down_(false),
+      connection_complete_(false),
+      server_retry_delay_ms_(-1) {
+  retry_policy_.max_attempts = 8;
+  retry_policy_.initial_backoff_ms = 2000;
+  retry_policy_.max_backoff_ms = 5 * 60 * 1000;
+  rest::InitTransportCurl();
+}
+
+RealtimeStream::~RealtimeStream() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+  condition_.notify_all();
+  if (thread_.joinable()) thread_.join();
+  rest::CleanupTransportCurl();
+}
+
+void RealtimeStream::Start() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = true;
+    if (!thread_.joinable()) thread_ = std::thread([this]() { Run(); });
+  }
+  condition_.notify_all();
+}
+
+void RealtimeStream::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  condition_.notify_all();
+}
+
+bool RealtimeStream::running() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return running_;
+}
+
+void RealtimeStream::set_retry_policy(const rest::RetryPolicy& policy) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  retry_policy_ = policy;
+}
+
+void RealtimeStream::set_connection_timeout_ms(int64_t timeout_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  connection_timeout_ms_ = timeout_ms;
+}
+
+void RealtimeStream::Run() {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this]() { return running_ || shutting_down_; });
+      if (shutting_down_) return;
+    }
+    RunConnections();
+  }
+}
+
+void RealtimeStream::RunConnections() {
+  std::mt19937 random_engine(std::random_device{}());
+  std::uniform_real_distribution<double> random(0.0, 1.0);
+  int failures = 0;
+  for (;;) {
+    ConnectionResult result = Connect();
+    if (result == kConnectionStopped) return;
+    if (result == kConnectionFailedPermanently) break;
+    rest::RetryPolicy policy;
+    int64_t server_retry_delay_ms;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      policy = retry_policy_;
+      server_retry_delay_ms = server_retry_delay_ms_;
+    }
+    if (result == kConnectionClosed) {
+      failures = 0;
+    } else if (policy.max_attempts && ++failures >= policy.max_attempts) {
+      LogWarning("Remote Config real-time stream failed %d times, giving up.",
+                 failures);
+      on_error_(kRemoteConfigErrorConfigUpdateStreamError);
+      break;
+    }
+    // Even a stream the server closed cleanly is reopened after a delay, so
+    // a server that keeps closing it isn't flooded with requests.
+    int64_t delay_ms =
+        policy.GetBackoffMilliseconds(failures ? failures : 1,
+                                      random(random_engine));
+    if (server_retry_delay_ms >= 0) delay_ms = server_retry_delay_ms;
+    if (!WaitUnlessStopped(delay_ms)) return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  running_ = false;
+}
+
+RealtimeStream::ConnectionResult RealtimeStream::Connect() {
+  std::string body = request_body_();
+  rest::Request request;
+  request.set_url(url_.c_str());
+  request.set_method(rest::util::kPost);
+  request.add_header(rest::util::kContentType, rest::util::kApplicationJson);
+  request.add_header(rest::util::kAccept, rest::util::kApplicationJson);
+  request.add_header(kApiKeyHeader, api_key_.c_str());
+  request.add_header(kStreamingHeader, "true");
+  request.set_post_fields(body.c_str(), body.size());
+  StreamResponse response(this);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped()) return kConnectionStopped;
+    request.options().timeout_ms = connection_timeout_ms_;
+    request.options().category = rest::kTransferCategoryRemoteConfig;
+    connection_complete_ = false;
+    messages_.clear();
+    server_retry_delay_ms_ = -1;
+  }
+
+  std::unique_ptr<rest::TransportCurl> transport(new rest::TransportCurl());
+  transport->set_is_async(true);
+  flatbuffers::unique_ptr<rest::Controller> controller;
+  transport->Perform(&request, &response, &controller);
+
+  bool usable = true;
+  bool stopping = false;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      condition_.wait(lock, [this]() {
+        return stopped() || connection_complete_ || !messages_.empty();
+      });
+      if (stopped()) break;
+      if (messages_.empty()) break;  // The connection is complete.
+      std::string message = std::move(messages_.front());
+      messages_.pop_front();
+      lock.unlock();
+      usable = HandleMessage(message);
+      lock.lock();
+      if (!usable) break;
+    }
+    stopping = stopped();
+  }
+  if (stopping || !usable) controller->Cancel();
+  {
+    // The transport uses the request and response until the response is
+    // marked completed or failed, which can be after the transport is gone.
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this]() { return connection_complete_; });
+  }
+  transport.reset();
+
+  if (stopping) return kConnectionStopped;
+  if (!usable) return kConnectionFailedPermanently;
+  if (response.opened()) return kConnectionClosed;
+  if (rest::IsRetryableHttpStatus(response.status())) {
+    LogDebug("Remote Config real-time stream failed: http code %d",
+             response.status());
+    return kConnectionFailedRetryable;
+  }
+  LogError("Remote Config real-time stream failed: http code %d",
+           response.status());
+  on_error_(kRemoteConfigErrorConfigUpdateStreamError);
+  return kConnectionFailedPermanently;
+}
+
+bool RealtimeStream::HandleMessage(const std::string& message) {
+  Variant fields = util::JsonToVariant(message.c_str());
+  if (!fields.is_map()) {
+    LogWarning("Invalid Remote Config real-time message: %s",
+               message.c_str());
+    on_error_(kRemoteConfigErrorConfigUpdateMessageInvalid);
+    return true;
+  }
+  const std::map<Variant, Variant>& map = fields.map();
+  auto feature_disabled = map.find(Variant(kFeatureDisabledField));
+  if (feature_disabled != map.end() && feature_disabled->second.is_bool() &&
+      feature_disabled->second.bool_value()) {
+    on_error_(kRemoteConfigErrorConfigUpdateUnavailable);
+    return false;
+  }
+  auto retry_interval = map.find(Variant(kRetryIntervalField));
+  int64_t retry_interval_seconds;
+  if (retry_interval != map.end() &&
+      VariantToInt64(retry_interval->second, &retry_interval_seconds) &&
+      retry_interval_seconds >= 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    server_retry_delay_ms_ = retry_interval_seconds * 1000;
+  }
+  auto version = map.find(Variant(kTemplateVersionField));
+  int64_t template_version;
+  if (version != map.end()) {
+    if (VariantToInt64(version->second, &template_version)) {
+      on_version_(template_version);
+    } else {
+      on_error_(kRemoteConfigErrorConfigUpdateMessageInvalid);
+    }
+  }
+  return true;
+}
+
+void RealtimeStream::OnMessage(std::string&& message) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    messages_.push_back(std::move(message));
+  }
+  condition_.notify_all();
+}
+
+void RealtimeStream::OnConnectionComplete() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    connection_complete_ = true;
+  }
+  condition_.notify_all();
+}
+
+bool RealtimeStream::WaitUnlessStopped(int64_t delay_ms) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  condition_.wait_for(lock, std::chrono::milliseconds(delay_ms),
+                      [this]() { return stopped(); });
+  return !stopped();
+}
+
+}  // namespace internal
+}  // namespace remote_config
+}  // namespace firebase
@@ -0,0 +1,173 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_REALTIME_STREAM_H_
+#define FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_REALTIME_STREAM_H_
+
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+
+#include "app/rest/retry_policy.h"
+#include "remote_config/src/include/firebase/remote_config.h"
+
+namespace firebase {
+namespace remote_config {
+namespace internal {
+
+const char* const kRealtimeServerURL =
+    "https://firebaseremoteconfigrealtime.googleapis.com/v1/projects";
+const char* const kRealtimeStreamFetchString =
+    ":streamFetchInvalidations";
+
+// Splits the body of the real-time stream into messages. The server sends a
+// JSON object for each message, which can arrive split across or combined in
+// chunks of the response, so objects are extracted once their closing brace
+// has been received.
+class RealtimeMessageParser {
+ public:
+  RealtimeMessageParser();
+
+  // Add data received from the stream.
+  void Append(const char* data, size_t size);
+
+  // Take the next complete message and return true, or return false if there
+  // is none yet.
+  bool Next(std::string* message);
+
+ private:
+  // Data that hasn't been returned as a message yet.
+  std::string buffer_;
+  // How far buffer_ has been scanned, and the state of the scan there.
+  size_t scanned_;
+  int depth_;
+  bool in_string_;
+  bool escaped_;
+};
+
+// Keeps a long-lived streaming request open to the Remote Config real-time
+// service, which announces the latest template version whenever it changes,
+// and reconnects with backoff when the connection is lost.
+//
+// Callbacks are called on the stream's own thread, so they can block (for
+// example to fetch) without holding up other transfers.
+class RealtimeStream {
+ public:
+  // Returns the body of the request for each connection, which includes the
+  // last template version the client knows about.
+  typedef std::function<std::string()> RequestBodyCallback;
+  // Called with each template version announced by the server.
+  typedef std::function<void(int64_t template_version)> VersionCallback;
+  // Called when a message can't be used, or when the stream gives up.
+  typedef std::function<void(RemoteConfigError error)> ErrorCallback;
+
+  RealtimeStream(const std::string& url, const std::string& api_key,
+                 RequestBodyCallback request_body, VersionCallback on_version,
+                 ErrorCallback on_error);
+  // Stops the stream and waits for its thread to exit. Must not be called
+  // from a callback.
+  ~RealtimeStream();
+
+  // Open the stream, starting its thread the first time. Does nothing if
+  // it's already open.
+  void Start();
+
+  // Close the stream without waiting. The stream's thread waits to be
+  // started again until the stream is destroyed, so this can be called from
+  // a callback.
+  void Stop();
+
+  // Whether the stream has been started and not stopped. A stream also stops
+  // once it has given up after repeated failures or because the service is
+  // disabled.
+  bool running() const;
+
+  // Wait for delay_ms or until the stream is stopped, and return false if it
+  // was stopped. Lets a callback retry without holding up the stream's
+  // destruction.
+  bool WaitUnlessStopped(int64_t delay_ms);
+
+  // Set how reconnections are delayed. max_attempts is the number of
+  // consecutive failed connections after which the stream gives up.
+  void set_retry_policy(const rest::RetryPolicy& policy);
+
+  // Set the maximum time a connection is kept open before the stream
+  // reconnects, in case a dropped connection isn't noticed.
+  void set_connection_timeout_ms(int64_t timeout_ms);
+
+ private:
+  // Result of a single connection.
+  enum ConnectionResult {
+    // The server closed the stream, which it does periodically.
+    kConnectionClosed,
+    // The connection failed in a way that may succeed later.
+    kConnectionFailedRetryable,
+    // The stream can't be used, so it shouldn't be reopened.
+    kConnectionFailedPermanently,
+    // Stop() was called.
+    kConnectionStopped,
+  };
+
+  class StreamResponse;
+
+  void Run();
+
+  // Keep the stream open, reconnecting as needed, until it's stopped or
+  // gives up.
+  void RunConnections();
+
+  // Whether the stream should close. Call with mutex_ held.
+  bool stopped() const { return !running_ || shutting_down_; }
+
+  // Open a connection and handle its messages until it closes.
+  ConnectionResult Connect();
+
+  // Handle a message from the server. Returns false if the stream should be
+  // closed for good.
+  bool HandleMessage(const std::string& message);
+
+  // Called by the response on the transport's thread.
+  void OnMessage(std::string&& message);
+  void OnConnectionComplete();
+
+  std::string url_;
+  std::string api_key_;
+  RequestBodyCallback request_body_;
+  VersionCallback on_version_;
+  ErrorCallback on_error_;
+  rest::RetryPolicy retry_policy_;
+  int64_t connection_timeout_ms_;
+
+  std::thread thread_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  // Guarded by mutex_.
+  bool running_;
+  bool shutting_down_;
+  bool connection_complete_;
+  std::deque<std::string> messages_;
+  // Delay before reconnecting requested by the server, or -1 if none.
+  int64_t server_retry_delay_ms_;
+};
+
+}  // namespace internal
+}  // namespace remote_config
+}  // namespace firebase
+
+#endif  // FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_REALTIME_STREAM_H_
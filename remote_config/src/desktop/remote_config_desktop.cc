@@ -27,8 +27,11 @@
 
 #include "app/src/callback.h"
 #include "app/src/include/firebase/internal/platform.h"
+#include "app/src/log.h"
 #include "app/src/time.h"
+#include "app/src/variant_util.h"
 #include "remote_config/src/common.h"
+#include "remote_config/src/config_update_listener_registration_internal.h"
 #include "remote_config/src/include/firebase/remote_config.h"
 
 #ifndef SWIG
@@ -49,6 +52,28 @@ const bool RemoteConfigInternal::kDefaultValueForBool = false;
 
 static const char* kFilePathSuffix = "remote_config_data";
 
+// How long to wait for further changes before saving, so that changes made
+// in quick succession are written to the file once.
+static const int kSaveCoalescingDelayMs = 20;
+
+// How many times a template version announced by the real-time service is
+// fetched before giving up, in case a fetch is served an older template, and
+// the delay before the first retry, which doubles with each retry.
+static const int kRealtimeFetchAttempts = 3;
+static const int64_t kRealtimeFetchRetryDelayMs = 1000;
+
+// Returns the URL of the real-time service for the app's project.
+static std::string GetRealtimeUrl(const AppOptions& options,
+                                  const char* name_space) {
+  std::string url(kRealtimeServerURL);
+  url.append("/");
+  url.append(options.messaging_sender_id());
+  url.append("/namespaces/");
+  url.append(name_space);
+  url.append(kRealtimeStreamFetchString);
+  return url;
+}
+
 template <typename T>
 struct RCDataHandle {
   RCDataHandle(
@@ -72,8 +97,11 @@ RemoteConfigInternal::RemoteConfigInternal(
       file_manager_(file_manager),
       is_fetch_process_have_task_(false),
       future_impl_(kRemoteConfigFnCount),
+      next_config_update_listener_id_(0),
+      realtime_url_(GetRealtimeUrl(app.options(), kDefaultNamespace)),
       safe_this_(this),
-      rest_(app.options(), configs_, kDefaultNamespace),
+      fetched_template_version_(0),
+      rest_(app.options(), fetch_configs_, kDefaultNamespace),
       initialized_(false) {
   InternalInit();
 }
@@ -83,13 +111,24 @@ RemoteConfigInternal::RemoteConfigInternal(const firebase::App& app)
       file_manager_(kFilePathSuffix, app),
       is_fetch_process_have_task_(false),
       future_impl_(kRemoteConfigFnCount),
+      next_config_update_listener_id_(0),
+      realtime_url_(GetRealtimeUrl(app.options(), kDefaultNamespace)),
       safe_this_(this),
-      rest_(app.options(), configs_, kDefaultNamespace),
+      fetched_template_version_(0),
+      rest_(app.options(), fetch_configs_, kDefaultNamespace),
       initialized_(false) {
   InternalInit();
 }
 
 RemoteConfigInternal::~RemoteConfigInternal() {
+  // Close the real-time stream first, as its thread fetches into `configs_`.
+  std::unique_ptr<RealtimeStream> realtime_stream;
+  {
+    MutexLock lock(config_update_listeners_mutex_);
+    realtime_stream = std::move(realtime_stream_);
+  }
+  realtime_stream.reset();
+
   save_channel_.Close();
   if (save_thread_.joinable()) {
     save_thread_.join();
@@ -99,7 +138,12 @@ RemoteConfigInternal::~RemoteConfigInternal() {
 }
 
 void RemoteConfigInternal::InternalInit() {
-  file_manager_.Load(&configs_);
+  {
+    MutexLock lock(internal_mutex_);
+    file_manager_.Load(&configs_);
+    PublishSnapshot();
+    fetch_configs_.fetched = configs_.fetched;
+  }
   AsyncSaveToFile();
   initialized_ = true;
 }
@@ -114,8 +158,7 @@ Future<ConfigInfo> RemoteConfigInternal::EnsureInitialized() {
   const auto handle =
       future_impl_.SafeAlloc<ConfigInfo>(kRemoteConfigFnEnsureInitialized);
   future_impl_.CompleteWithResult(handle, kFutureStatusSuccess,
-                                  kFutureNoErrorMessage,
-                                  rest_.metadata().info());
+                                  kFutureNoErrorMessage, GetInfo());
   return MakeFuture<ConfigInfo>(&future_impl_, handle);
 }
 
@@ -171,8 +214,6 @@ Future<bool> RemoteConfigInternal::FetchAndActivate() {
         [](ThisRef ref, std::shared_ptr<RCDataHandle<bool>> handle) {
           ThisRefLock lock(&ref);
           if (lock.GetReference() != nullptr) {
-            MutexLock lock(handle->rc_internal->internal_mutex_);
-
             handle->rc_internal->FetchInternal();
 
             FutureStatus futureResult =
@@ -321,6 +362,7 @@ Future<void> RemoteConfigInternal::SetCustomSignalsLastResult() {
 void RemoteConfigInternal::AsyncSaveToFile() {
   save_thread_ = std::thread([this]() {
     while (save_channel_.Get()) {
+      save_channel_.Coalesce(std::chrono::milliseconds(kSaveCoalescingDelayMs));
       LayeredConfigs copy;
       {
         MutexLock lock(internal_mutex_);
@@ -403,6 +445,7 @@ void RemoteConfigInternal::SetDefaults(
   {
     MutexLock lock(internal_mutex_);
     configs_.defaults.SetNamespace(defaults_map, kDefaultNamespace);
+    PublishSnapshot();
   }
   save_channel_.Put();
 }
@@ -424,30 +467,69 @@ void RemoteConfigInternal::SetConfigSetting(ConfigSetting setting,
   save_channel_.Put();
 }
 
-bool RemoteConfigInternal::CheckValueInActiveAndDefault(const char* key,
-                                                        ValueInfo* info,
-                                                        std::string* value) {
-  return CheckValueInConfig(configs_.active, kValueSourceRemoteValue, key, info,
-                            value) ||
-         CheckValueInConfig(configs_.defaults, kValueSourceDefaultValue, key,
-                            info, value);
+SnapshotValue RemoteConfigInternal::MakeSnapshotValue(const std::string& from,
+                                                     ValueSource source) {
+  SnapshotValue value;
+  value.string_value = from;
+  value.source = source;
+  value.is_bool = ConvertToBool(from, &value.bool_value);
+  value.is_long = ConvertToLong(from, &value.long_value);
+  value.is_double = ConvertToDouble(from, &value.double_value);
+  return value;
 }
 
-bool RemoteConfigInternal::CheckValueInConfig(
-    const NamespacedConfigData& config, ValueSource source, const char* key,
-    ValueInfo* info, std::string* value) {
-  if (!key) return false;
+void RemoteConfigInternal::PublishSnapshot() {
+  std::unique_ptr<ConfigSnapshot> snapshot(new ConfigSnapshot());
+  // Add defaults first so active values replace them.
+  const struct {
+    const NamespacedConfigData* config;
+    ValueSource source;
+  } layers[] = {{&configs_.defaults, kValueSourceDefaultValue},
+                {&configs_.active, kValueSourceRemoteValue}};
+  for (const auto& layer : layers) {
+    auto name_space = layer.config->config().find(kDefaultNamespace);
+    if (name_space == layer.config->config().end()) continue;
+    for (const auto& key_value : name_space->second) {
+      snapshot->Add(key_value.first,
+                    MakeSnapshotValue(key_value.second, layer.source));
+    }
+  }
+  snapshot_.Publish(std::move(snapshot));
+}
 
+void RemoteConfigInternal::UpdateSnapshot(
+    const std::vector<std::string>& keys) {
+  std::unique_ptr<ConfigSnapshot> snapshot;
   {
-    MutexLock lock(internal_mutex_);
-    if (!config.HasValue(key, kDefaultNamespace)) {
-      return false;
+    ConfigSnapshotHolder::ReadLock lock(snapshot_);
+    snapshot.reset(new ConfigSnapshot(lock.snapshot()));
+  }
+  for (const std::string& key : keys) {
+    if (configs_.active.HasValue(key, kDefaultNamespace)) {
+      snapshot->Add(key,
+                    MakeSnapshotValue(configs_.active.GetValue(
+                                          key, kDefaultNamespace),
+                                      kValueSourceRemoteValue));
+    } else if (configs_.defaults.HasValue(key, kDefaultNamespace)) {
+      snapshot->Add(key,
+                    MakeSnapshotValue(configs_.defaults.GetValue(
+                                          key, kDefaultNamespace),
+                                      kValueSourceDefaultValue));
+    } else {
+      snapshot->Remove(key);
     }
-    *value = config.GetValue(key, kDefaultNamespace);
   }
+  snapshot_.Publish(std::move(snapshot));
+}
 
-  if (info) info->source = source;
-  return true;
+const SnapshotValue* RemoteConfigInternal::FindValue(
+    const ConfigSnapshot& snapshot, const char* key, ValueInfo* info) {
+  const SnapshotValue* value = snapshot.Find(key);
+  if (info) {
+    info->source = value ? value->source : kValueSourceStaticValue;
+    info->conversion_successful = true;
+  }
+  return value;
 }
 
 bool RemoteConfigInternal::IsBoolTrue(const std::string& str) {
@@ -498,34 +580,19 @@ bool RemoteConfigInternal::ConvertToBool(const std::string& from, bool* out) {
 }
 
 bool RemoteConfigInternal::GetBoolean(const char* key, ValueInfo* info) {
-  std::string value;
-  if (!CheckValueInActiveAndDefault(key, info, &value)) {
-    if (info) {
-      info->source = kValueSourceStaticValue;
-      info->conversion_successful = true;
-    }
-    return kDefaultValueForBool;
-  }
-
-  bool bool_value;
-  bool conversion_successful = ConvertToBool(value, &bool_value);
+  ConfigSnapshotHolder::ReadLock lock(snapshot_);
+  const SnapshotValue* value = FindValue(lock.snapshot(), key, info);
+  if (!value) return kDefaultValueForBool;
 
-  if (info) info->conversion_successful = conversion_successful;
-  return bool_value;
+  if (info) info->conversion_successful = value->is_bool;
+  return value->bool_value;
 }
 
 std::string RemoteConfigInternal::GetString(const char* key, ValueInfo* info) {
-  std::string value;
-  if (!CheckValueInActiveAndDefault(key, info, &value)) {
-    if (info) {
-      info->source = kValueSourceStaticValue;
-      info->conversion_successful = true;
-    }
-    return kDefaultValueForString;
-  }
-
-  if (info) info->conversion_successful = true;
-  return value;
+  ConfigSnapshotHolder::ReadLock lock(snapshot_);
+  const SnapshotValue* value = FindValue(lock.snapshot(), key, info);
+  if (!value) return kDefaultValueForString;
+  return value->string_value;
 }
 
 bool RemoteConfigInternal::ConvertToLong(const std::string& from,
@@ -543,19 +610,12 @@ bool RemoteConfigInternal::ConvertToLong(const std::string& from,
 }
 
 int64_t RemoteConfigInternal::GetLong(const char* key, ValueInfo* info) {
-  std::string value;
-  if (!CheckValueInActiveAndDefault(key, info, &value)) {
-    if (info) {
-      info->source = kValueSourceStaticValue;
-      info->conversion_successful = true;
-    }
-    return kDefaultValueForLong;
-  }
+  ConfigSnapshotHolder::ReadLock lock(snapshot_);
+  const SnapshotValue* value = FindValue(lock.snapshot(), key, info);
+  if (!value) return kDefaultValueForLong;
 
-  int64_t long_value = kDefaultValueForLong;
-  bool conversion_successful = ConvertToLong(value, &long_value);
-  if (info) info->conversion_successful = conversion_successful;
-  return long_value;
+  if (info) info->conversion_successful = value->is_long;
+  return value->long_value;
 }
 
 bool RemoteConfigInternal::ConvertToDouble(const std::string& from,
@@ -573,40 +633,21 @@ bool RemoteConfigInternal::ConvertToDouble(const std::string& from,
 }
 
 double RemoteConfigInternal::GetDouble(const char* key, ValueInfo* info) {
-  std::string value;
-  if (!CheckValueInActiveAndDefault(key, info, &value)) {
-    if (info) {
-      info->source = kValueSourceStaticValue;
-      info->conversion_successful = true;
-    }
-    return kDefaultValueForDouble;
-  }
+  ConfigSnapshotHolder::ReadLock lock(snapshot_);
+  const SnapshotValue* value = FindValue(lock.snapshot(), key, info);
+  if (!value) return kDefaultValueForDouble;
 
-  double double_value = kDefaultValueForDouble;
-  bool conversion_successful = ConvertToDouble(value, &double_value);
-
-  if (info) info->conversion_successful = conversion_successful;
-  return double_value;
+  if (info) info->conversion_successful = value->is_double;
+  return value->double_value;
 }
 
 std::vector<unsigned char> RemoteConfigInternal::GetData(const char* key,
                                                          ValueInfo* info) {
-  std::string value;
-  if (!CheckValueInActiveAndDefault(key, info, &value)) {
-    if (info) {
-      info->source = kValueSourceStaticValue;
-      info->conversion_successful = true;
-    }
-    return kDefaultValueForData;
-  }
-
-  std::vector<unsigned char> data_value;
-  data_value.reserve(value.size());
-  for (const char& ch : value)
-    data_value.push_back(static_cast<unsigned char>(ch));
-
-  if (info) info->conversion_successful = true;
-  return data_value;
+  ConfigSnapshotHolder::ReadLock lock(snapshot_);
+  const SnapshotValue* value = FindValue(lock.snapshot(), key, info);
+  if (!value) return kDefaultValueForData;
+  return std::vector<unsigned char>(value->string_value.begin(),
+                                    value->string_value.end());
 }
 
 std::vector<std::string> RemoteConfigInternal::GetKeys() {
@@ -665,7 +706,12 @@ bool RemoteConfigInternal::ActivateFetched() {
     // Fetched config not found or already activated.
     if (configs_.fetched.timestamp() <= configs_.active.timestamp())
       return false;
-    configs_.active = configs_.fetched;
+    // Only the values that changed are copied and converted for getters, and
+    // activating the same template again doesn't rewrite the file.
+    std::vector<std::string> changed_keys = GetChangedKeys(
+        configs_.fetched, configs_.active, kDefaultNamespace);
+    if (!configs_.active.UpdateFrom(configs_.fetched)) return true;
+    UpdateSnapshot(changed_keys);
   }
   save_channel_.Put();
   return true;
@@ -680,14 +726,180 @@ ConfigUpdateListenerRegistration
 RemoteConfigInternal::AddOnConfigUpdateListener(
     std::function<void(ConfigUpdate&&, RemoteConfigError)>
         config_update_listener) {
-  // Realtime RC is not yet implemented on desktop, so just return a
-  // registration object that is no-op.
-  return ConfigUpdateListenerRegistration();
+  int id;
+  {
+    MutexLock lock(config_update_listeners_mutex_);
+    id = next_config_update_listener_id_++;
+    config_update_listeners_[id] = std::move(config_update_listener);
+    if (!realtime_stream_) {
+      realtime_stream_.reset(new RealtimeStream(
+          realtime_url_, app_.options().api_key(),
+          [this]() { return RealtimeRequestBody(); },
+          [this](int64_t template_version) {
+            OnTemplateVersion(template_version);
+          },
+          [this](RemoteConfigError error) {
+            NotifyConfigUpdateListeners(ConfigUpdate(), error);
+          }));
+    }
+    realtime_stream_->Start();
+  }
+
+  ConfigUpdateListenerRegistrationInternal* registration_internal =
+      new ConfigUpdateListenerRegistrationInternal(
+          this, [this, id]() { RemoveConfigUpdateListener(id); });
+  // Delete the internal registration when RemoteConfigInternal is cleaned up.
+  cleanup_notifier().RegisterObject(
+      registration_internal, [](void* registration) {
+        delete reinterpret_cast<ConfigUpdateListenerRegistrationInternal*>(
+            registration);
+      });
+  return ConfigUpdateListenerRegistration(registration_internal);
+}
+
+void RemoteConfigInternal::RemoveConfigUpdateListener(int id) {
+  MutexLock lock(config_update_listeners_mutex_);
+  config_update_listeners_.erase(id);
+  if (config_update_listeners_.empty() && realtime_stream_) {
+    realtime_stream_->Stop();
+  }
+}
+
+void RemoteConfigInternal::NotifyConfigUpdateListeners(
+    const ConfigUpdate& update, RemoteConfigError error) {
+  std::vector<std::function<void(ConfigUpdate&&, RemoteConfigError)>>
+      listeners;
+  {
+    MutexLock lock(config_update_listeners_mutex_);
+    listeners.reserve(config_update_listeners_.size());
+    for (const auto& entry : config_update_listeners_) {
+      listeners.push_back(entry.second);
+    }
+  }
+  for (auto& listener : listeners) {
+    ConfigUpdate copy(update);
+    listener(std::move(copy), error);
+  }
+}
+
+std::string RemoteConfigInternal::RealtimeRequestBody() {
+  int64_t template_version;
+  {
+    MutexLock lock(internal_mutex_);
+    template_version = fetched_template_version_;
+  }
+  Variant body = Variant::EmptyMap();
+  body.map()["project"] = app_.options().messaging_sender_id();
+  body.map()["namespace"] = kDefaultNamespace;
+  body.map()["lastKnownVersionNumber"] = std::to_string(template_version);
+  body.map()["appId"] = app_.options().app_id();
+  body.map()["sdkVersion"] = std::to_string(
+      SDK_MAJOR_VERSION * 10000 + SDK_MINOR_VERSION * 100 + SDK_PATCH_VERSION);
+  return util::VariantToJson(body);
+}
+
+void RemoteConfigInternal::OnTemplateVersion(int64_t template_version) {
+  for (int attempt = 1;; ++attempt) {
+    ConfigUpdate update;
+    bool fetched;
+    {
+      MutexLock lock(internal_mutex_);
+      // Already fetched, by an earlier announcement or by Fetch().
+      if (fetched_template_version_ >= template_version) return;
+    }
+    FetchConfig();
+    {
+      MutexLock lock(internal_mutex_);
+      fetched = configs_.metadata.info().last_fetch_status ==
+                    kLastFetchStatusSuccess &&
+                fetched_template_version_ >= template_version;
+      if (fetched) {
+        update.updated_keys = GetChangedKeys(configs_.fetched, configs_.active,
+                                             kDefaultNamespace);
+      }
+    }
+    if (fetched) {
+      save_channel_.Put();
+      NotifyConfigUpdateListeners(update, kRemoteConfigErrorNone);
+      return;
+    }
+    if (attempt >= kRealtimeFetchAttempts) break;
+    RealtimeStream* realtime_stream;
+    {
+      MutexLock lock(config_update_listeners_mutex_);
+      realtime_stream = realtime_stream_.get();
+    }
+    // The stream outlives this call, which runs on its thread.
+    if (!realtime_stream ||
+        !realtime_stream->WaitUnlessStopped(kRealtimeFetchRetryDelayMs
+                                            << (attempt - 1))) {
+      return;
+    }
+  }
+  LogWarning("Failed to fetch Remote Config template version %lld.",
+             static_cast<long long>(template_version));  // NOLINT
+  NotifyConfigUpdateListeners(ConfigUpdate(),
+                              kRemoteConfigErrorConfigUpdateNotFetched);
+}
+
+std::vector<std::string> RemoteConfigInternal::GetChangedKeys(
+    const NamespacedConfigData& fetched, const NamespacedConfigData& active,
+    const std::string& name_space) {
+  static const std::map<std::string, std::string> kEmpty;
+  auto fetched_namespace = fetched.config().find(name_space);
+  auto active_namespace = active.config().find(name_space);
+  const std::map<std::string, std::string>& fetched_values =
+      fetched_namespace == fetched.config().end() ? kEmpty
+                                                  : fetched_namespace->second;
+  const std::map<std::string, std::string>& active_values =
+      active_namespace == active.config().end() ? kEmpty
+                                                : active_namespace->second;
+  // Walk both maps in key order at once.
+  std::vector<std::string> keys;
+  auto fetched_it = fetched_values.begin();
+  auto active_it = active_values.begin();
+  while (fetched_it != fetched_values.end() ||
+         active_it != active_values.end()) {
+    if (active_it == active_values.end() ||
+        (fetched_it != fetched_values.end() &&
+         fetched_it->first < active_it->first)) {
+      keys.push_back(fetched_it->first);
+      ++fetched_it;
+    } else if (fetched_it == fetched_values.end() ||
+               active_it->first < fetched_it->first) {
+      keys.push_back(active_it->first);
+      ++active_it;
+    } else {
+      if (fetched_it->second != active_it->second) {
+        keys.push_back(fetched_it->first);
+      }
+      ++fetched_it;
+      ++active_it;
+    }
+  }
+  return keys;
 }
 
 void RemoteConfigInternal::FetchInternal() {
+  FetchConfig();
+  MutexLock lock(internal_mutex_);
+  is_fetch_process_have_task_ = false;
+}
+
+void RemoteConfigInternal::FetchConfig() {
+  MutexLock fetch_lock(fetch_mutex_);
+  uint64_t fetch_timeout_in_milliseconds;
+  {
+    MutexLock lock(internal_mutex_);
+    // The request is made with the current settings and custom signals.
+    fetch_configs_.metadata = configs_.metadata;
+    fetch_timeout_in_milliseconds =
+        config_settings_.fetch_timeout_in_milliseconds;
+  }
   // Fetch fresh config from server.
-  rest_.Fetch(app_, config_settings_.fetch_timeout_in_milliseconds);
+  rest_.Fetch(app_, fetch_timeout_in_milliseconds);
+
+  MutexLock lock(internal_mutex_);
   // Need to copy everything to `configs_.fetched`.
   configs_.fetched = rest_.fetched();
 
@@ -695,8 +907,7 @@ void RemoteConfigInternal::FetchInternal() {
   const RemoteConfigMetadata& metadata = rest_.metadata();
   configs_.metadata.set_info(metadata.info());
   configs_.metadata.set_digest_by_namespace(metadata.digest_by_namespace());
-
-  is_fetch_process_have_task_ = false;
+  fetched_template_version_ = rest_.template_version();
 }
 
 Future<void> RemoteConfigInternal::Fetch(uint64_t cache_expiration_in_seconds) {
@@ -731,8 +942,6 @@ Future<void> RemoteConfigInternal::Fetch(uint64_t cache_expiration_in_seconds) {
         [](ThisRef ref, std::shared_ptr<RCDataHandle<void>> handle) {
           ThisRefLock lock(&ref);
           if (lock.GetReference() != nullptr) {
-            MutexLock lock(handle->rc_internal->internal_mutex_);
-
             handle->rc_internal->FetchInternal();
 
             FutureStatus futureResult =
@@ -16,8 +16,12 @@
 #define FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_REMOTE_CONFIG_DESKTOP_H_
 
 #include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
 #include <string>
 #include <thread>  // NOLINT
+#include <vector>
 
 #include "app/src/cleanup_notifier.h"
 #include "app/src/include/firebase/internal/mutex.h"
@@ -27,8 +31,10 @@
 #include "firebase/app.h"
 #include "firebase/future.h"
 #include "remote_config/src/desktop/config_data.h"
+#include "remote_config/src/desktop/config_snapshot.h"
 #include "remote_config/src/desktop/file_manager.h"
 #include "remote_config/src/desktop/notification_channel.h"
+#include "remote_config/src/desktop/realtime_stream.h"
 #include "remote_config/src/desktop/rest.h"
 #include "remote_config/src/include/firebase/remote_config.h"
 
@@ -64,14 +70,19 @@ class RemoteConfigInternal {
   FRIEND_TEST(RemoteConfigDesktopTest, FailedLoadFromFile);
   FRIEND_TEST(RemoteConfigDesktopTest, SuccessLoadFromFile);
   FRIEND_TEST(RemoteConfigDesktopTest, SuccessAsyncSaveToFile);
+  FRIEND_TEST(RemoteConfigDesktopTest, SavesPendingChangesOnDestruction);
   FRIEND_TEST(RemoteConfigDesktopTest, SetDefaultsKeyValueVariant);
   FRIEND_TEST(RemoteConfigDesktopTest, SetDefaultsKeyValue);
   FRIEND_TEST(RemoteConfigDesktopTest, ActivateFetched);
+  FRIEND_TEST(RemoteConfigDesktopTest, GettersReadActivatedValues);
+  FRIEND_TEST(RemoteConfigDesktopTest, ActivateFetchedUpdatesChangedValues);
   FRIEND_TEST(RemoteConfigDesktopTest, Fetch);
   FRIEND_TEST(RemoteConfigDesktopTest, SetCustomSignals);
   FRIEND_TEST(RemoteConfigDesktopTest, SetCustomSignalsMergeAndRemove);
   FRIEND_TEST(RemoteConfigDesktopTest, SetCustomSignalsValidation);
   FRIEND_TEST(RemoteConfigDesktopTest, SetCustomSignalsPersistence);
+  FRIEND_TEST(RemoteConfigDesktopTest, ChangedKeys);
+  FRIEND_TEST(RemoteConfigDesktopTest, ConfigUpdateListenersOpenStream);
 #endif  // FIREBASE_TESTING
 
   explicit RemoteConfigInternal(const firebase::App& app,
@@ -153,7 +164,8 @@ class RemoteConfigInternal {
 
  private:
   // Open a new thread for saving state in the file. Thread will wait
-  // notifications in loop from the `save_channel_` until it will be closed.
+  // notifications in loop from the `save_channel_` until it will be closed,
+  // and writes changes made before closing the channel before it exits.
   void AsyncSaveToFile();
 
   void InternalInit();
@@ -167,23 +179,55 @@ class RemoteConfigInternal {
   // Set default values to `configs_.defaults` holder.
   void SetDefaults(const std::map<std::string, std::string>& defaults_map);
 
-  // Returns true and assigns the found record to the `value` if the `active` or
-  // `defaults` holders contains a record for the key.
-  //
-  // Assign `info->source` If info is not nullptr.
-  bool CheckValueInActiveAndDefault(const char* key, ValueInfo* info,
-                                    std::string* value);
+  // Rebuild the snapshot read by the getters from `configs_.active` and
+  // `configs_.defaults`. Call with `internal_mutex_` held after changing
+  // either of them.
+  void PublishSnapshot();
+
+  // Update the values of `keys` in the snapshot read by the getters, leaving
+  // the other values as they are. Call with `internal_mutex_` held after
+  // changing only those keys of `configs_.active`.
+  void UpdateSnapshot(const std::vector<std::string>& keys);
 
-  // Returns true and assigns the found record to the `value` if the `holder`
-  // contains a record for the key.
+  // Returns `from` converted to each type the getters return.
+  static SnapshotValue MakeSnapshotValue(const std::string& from,
+                                         ValueSource source);
+
+  // Returns the value of the key in `snapshot` or nullptr if there is none.
   //
   // Assign `info->source` If info is not nullptr.
-  bool CheckValueInConfig(const NamespacedConfigData& config,
-                          ValueSource source, const char* key, ValueInfo* info,
-                          std::string* value);
+  static const SnapshotValue* FindValue(const ConfigSnapshot& snapshot,
+                                        const char* key, ValueInfo* info);
 
   void FetchInternal();
 
+  // Fetch config from the server into `configs_`. Call without
+  // `internal_mutex_` held. It's only taken to copy the metadata the request
+  // needs and the result.
+  void FetchConfig();
+
+  // Called on the real-time stream's thread with each template version the
+  // server announces. Fetches the template if it's newer than the one last
+  // fetched and tells the listeners which keys changed.
+  void OnTemplateVersion(int64_t template_version);
+
+  // Call every config update listener with update or error.
+  void NotifyConfigUpdateListeners(const ConfigUpdate& update,
+                                   RemoteConfigError error);
+
+  // Remove the listener with id, closing the real-time stream if it was the
+  // last one.
+  void RemoveConfigUpdateListener(int id);
+
+  // Returns the body of requests to the real-time service.
+  std::string RealtimeRequestBody();
+
+  // Returns the keys of `name_space` whose values differ between fetched and
+  // active, including keys that are in only one of them.
+  static std::vector<std::string> GetChangedKeys(
+      const NamespacedConfigData& fetched, const NamespacedConfigData& active,
+      const std::string& name_space);
+
   static const char* const kDefaultNamespace;
   static const char* const kDefaultValueForString;
   static const int64_t kDefaultValueForLong;
@@ -210,7 +254,8 @@ class RemoteConfigInternal {
   // Thread safety notification channel.
   //
   // Call non blocking `save_channel_.Put()` function after changing the
-  // `configs_` variable. Call `save_channel_.Close()` to close the channel.
+  // `configs_` variable. Changes made shortly after each other are saved
+  // together. Call `save_channel_.Close()` to close the channel.
   NotificationChannel save_channel_;
 
   // Last value of `Fetch` function argument. Update only if we will fetch.
@@ -225,9 +270,31 @@ class RemoteConfigInternal {
 
   mutable Mutex internal_mutex_;
 
+  // Pre-converted active and default values, so getters don't need to lock
+  // `internal_mutex_` or parse values.
+  ConfigSnapshotHolder snapshot_;
+
   // Handle calls from Futures that the API returns.
   ReferenceCountedFutureImpl future_impl_;
 
+  // Config update listeners by the id of their registration.
+  std::map<int, std::function<void(ConfigUpdate&&, RemoteConfigError)>>
+      config_update_listeners_;
+  int next_config_update_listener_id_;
+
+  // Stream announcing template updates. It's created with the first config
+  // update listener and open while there are any.
+  std::unique_ptr<RealtimeStream> realtime_stream_;
+
+  // Guards `config_update_listeners_` and `realtime_stream_`. Not held while
+  // calling listeners, so listeners can add or remove listeners.
+  Mutex config_update_listeners_mutex_;
+
+  // URL of the real-time service for the app.
+  std::string realtime_url_;
+
+  // Destroyed before the listeners, so removing the registrations it deletes
+  // can still close the stream.
   CleanupNotifier cleanup_;
 
   scheduler::Scheduler scheduler_;
@@ -240,6 +307,19 @@ class RemoteConfigInternal {
       ThisRefLock;
   ThisRef safe_this_;
 
+  // Serializes fetches and guards `rest_` and `fetch_configs_`. Taken before
+  // `internal_mutex_` when both are held.
+  Mutex fetch_mutex_;
+
+  // Config `rest_` fetches into, so the request doesn't hold
+  // `internal_mutex_`. Its fetched config is only changed by fetching, so it
+  // stays the same as `configs_.fetched`.
+  LayeredConfigs fetch_configs_;
+
+  // Version of the template in `configs_.fetched`, or 0 if none has been
+  // fetched since this was created.
+  int64_t fetched_template_version_;
+
   RemoteConfigREST rest_;
   bool initialized_;
   ConfigSettings config_settings_;
@@ -30,6 +30,7 @@ namespace internal {
 
 RemoteConfigRequest::RemoteConfigRequest(const char* schema)
     : RequestJson(schema), custom_signals_() {
+  options_.category = rest::kTransferCategoryRemoteConfig;
   add_header(app_common::kApiClientHeader, App::GetUserAgent());
 }
 
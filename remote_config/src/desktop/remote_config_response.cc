@@ -16,6 +16,8 @@
 
 #include "remote_config/src/desktop/remote_config_response.h"
 
+#include <cstdlib>
+
 namespace firebase {
 namespace remote_config {
 namespace internal {
@@ -92,6 +94,14 @@ Variant FlexbufferToVariant(const flexbuffers::Reference& ref) {
 
 Variant RemoteConfigResponse::GetEntries() { return entries_; }
 
+int64_t RemoteConfigResponse::GetTemplateVersion() {
+  // The version is a string in the JSON because it's an int64.
+  if (!application_data_ || application_data_->templateVersion.empty()) {
+    return 0;
+  }
+  return strtoll(application_data_->templateVersion.c_str(), nullptr, 10);
+}
+
 // Mark the response completed for both header and body.
 void RemoteConfigResponse::MarkCompleted() {
   ResponseJson::MarkCompleted();
@@ -17,6 +17,8 @@
 #ifndef FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_REMOTE_CONFIG_RESPONSE_H_
 #define FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_REMOTE_CONFIG_RESPONSE_H_
 
+#include <cstdint>
+
 #include "app/rest/response_json.h"
 #include "app/src/include/firebase/variant.h"
 #include "remote_config/response_generated.h"
@@ -47,6 +49,9 @@ class RemoteConfigResponse
 
   Variant GetEntries();
 
+  // The version of the fetched template, or 0 if the response has none.
+  int64_t GetTemplateVersion();
+
   bool StatusMatch(std::string status_name) {
     return application_data_->state == status_name;
   }
@@ -17,8 +17,10 @@
 #include <chrono>  // NOLINT
 #include <cstdint>
 #include <cstring>
+#include <map>
 #include <memory>
 #include <sstream>
+#include <string>
 #include <utility>
 
 #include "app/rest/transport_builder.h"
@@ -55,7 +57,9 @@ RemoteConfigREST::RemoteConfigREST(const firebase::AppOptions& app_options,
       api_key_(app_options.api_key()),
       namespaces_(std::move(namespaces)),
       configs_(configs),
-      fetch_future_sem_(0) {
+      fetch_future_sem_(0),
+      rc_response_(new RemoteConfigResponse()),
+      template_version_(0) {
   rest::util::Initialize();
   firebase::rest::InitTransportCurl();
 }
@@ -70,7 +74,8 @@ void RemoteConfigREST::Fetch(const App& app,
   TryGetInstallationsAndToken(app);
 
   SetupRestRequest(app, fetch_timeout_in_milliseconds);
-  firebase::rest::CreateTransport()->Perform(rc_request_, &rc_response_);
+  rc_response_.reset(new RemoteConfigResponse());
+  firebase::rest::CreateTransport()->Perform(rc_request_, rc_response_.get());
   ParseRestResponse();
 }
 
@@ -121,6 +126,15 @@ void RemoteConfigREST::SetupRestRequest(
   rc_request_.add_header(kContentTypeHeaderName, kJSONContentTypeValue);
   rc_request_.add_header(kAcceptHeaderName, kJSONContentTypeValue);
   rc_request_.options().timeout_ms = fetch_timeout_in_milliseconds;
+  // Only ask whether the template changed while the fetched config still
+  // holds it.
+  if (!etag_.empty() &&
+      configs_.fetched.config().find(namespaces_) !=
+          configs_.fetched.config().end()) {
+    rc_request_.options().header[kIfNoneMatchHeader] = etag_;
+  } else {
+    rc_request_.options().header.erase(kIfNoneMatchHeader);
+  }
 
   rc_request_.SetAppId(app_gmp_project_id_);
   rc_request_.SetAppInstanceId(
@@ -144,42 +158,59 @@ void RemoteConfigREST::SetupRestRequest(
 }
 
 void RemoteConfigREST::ParseRestResponse() {
-  if (rc_response_.status() != kHTTPStatusOk) {
+  if (rc_response_->status() == kHTTPStatusNotModified) {
+    // The fetched config already holds the template, so it's only marked as
+    // fetched again.
+    LogDebug("Template not modified");
+    configs_.fetched.set_timestamp(MillisecondsSinceEpoch());
+    FetchSuccess(kLastFetchStatusSuccess);
+    return;
+  }
+
+  if (rc_response_->status() != kHTTPStatusOk) {
     FetchFailure(kFetchFailureReasonError);
-    LogError("fetching failure: http code %d", rc_response_.status());
+    LogError("fetching failure: http code %d", rc_response_->status());
     return;
   }
 
-  if (strlen(rc_response_.GetBody()) == 0) {
+  if (strlen(rc_response_->GetBody()) == 0) {
     FetchFailure(kFetchFailureReasonError);
-    LogError("fetching failure: http code %d", rc_response_.status());
+    LogError("fetching failure: http code %d", rc_response_->status());
     return;
   }
 
-  Variant entries = rc_response_.GetEntries();
+  Variant entries = rc_response_->GetEntries();
 
-  NamespaceKeyValueMap config_map(configs_.fetched.config());
+  // Only the values that differ from the last fetch are changed.
   LogDebug("Parsing config response...");
-  if (rc_response_.StatusMatch("NO_CHANGE")) {
+  if (rc_response_->StatusMatch("NO_CHANGE")) {
     LogDebug("No change");
-  } else if (rc_response_.StatusMatch("UPDATE")) {
-    config_map[namespaces_].clear();
+  } else if (rc_response_->StatusMatch("UPDATE")) {
+    std::map<std::string, std::string> values;
     for (const auto& keyvalue : entries.map()) {
-      config_map[namespaces_][keyvalue.first.mutable_string()] =
-          keyvalue.second.mutable_string();
+      values.emplace(keyvalue.first.mutable_string(),
+                     keyvalue.second.mutable_string());
       LogDebug("Update: ns=%s kv=(%s, %s)", namespaces_.c_str(),
                keyvalue.first.mutable_string().c_str(),
                keyvalue.second.mutable_string().c_str());
     }
-  } else if (rc_response_.StatusMatch("NO_TEMPLATE")) {
+    configs_.fetched.UpdateNamespace(values, namespaces_);
+  } else if (rc_response_->StatusMatch("NO_TEMPLATE")) {
     LogDebug("NotAuthorized: ns=%s", namespaces_.c_str());
-    config_map.erase(namespaces_);
-  } else if (rc_response_.StatusMatch("EMPTY_CONFIG")) {
+    configs_.fetched.RemoveNamespace(namespaces_);
+  } else if (rc_response_->StatusMatch("EMPTY_CONFIG")) {
     LogDebug("EmptyConfig: ns=%s", namespaces_.c_str());
-    config_map[namespaces_].clear();
+    configs_.fetched.UpdateNamespace(std::map<std::string, std::string>(),
+                                     namespaces_);
   }
-
-  configs_.fetched = NamespacedConfigData(config_map, MillisecondsSinceEpoch());
+  configs_.fetched.set_timestamp(MillisecondsSinceEpoch());
+
+  int64_t template_version = rc_response_->GetTemplateVersion();
+  if (template_version > 0) template_version_ = template_version;
+  // HTTP/2 responses have lower case header names.
+  const char* etag = rc_response_->GetHeader(kEtagHeader);
+  if (!etag) etag = rc_response_->GetHeader("etag");
+  etag_ = etag ? etag : "";
   FetchSuccess(kLastFetchStatusSuccess);
 }
 
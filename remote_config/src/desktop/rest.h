@@ -16,6 +16,8 @@
 #define FIREBASE_REMOTE_CONFIG_SRC_DESKTOP_REST_H_
 
 #include <cstdint>
+#include <memory>
+#include <string>
 
 #include "app/rest/request_json.h"
 #include "app/rest/response_json.h"
@@ -58,6 +60,7 @@ const char* const kJSONContentTypeValue = "application/json";
 const char* const kDeveloperModeKey = "_rcn_developer";
 
 const int kHTTPStatusOk = 200;
+const int kHTTPStatusNotModified = 304;
 
 // const char* const kApiKeyHeader = "X-Goog-Api-Key";
 const char* const kEtagHeader = "ETag";
@@ -78,6 +81,8 @@ class RemoteConfigREST {
   FRIEND_TEST(RemoteConfigRESTTest, Fetch);
   FRIEND_TEST(RemoteConfigRESTTest, ParseRestResponseProtoFailure);
   FRIEND_TEST(RemoteConfigRESTTest, ParseRestResponseSuccess);
+  FRIEND_TEST(RemoteConfigRESTTest, ParseRestResponseNotModified);
+  FRIEND_TEST(RemoteConfigRESTTest, ParseRestResponseUpdateChangesKeys);
 #endif  // FIREBASE_TESTING
 
   RemoteConfigREST(const firebase::AppOptions& app_options,
@@ -99,6 +104,10 @@ class RemoteConfigREST {
   // updated metadata.
   const RemoteConfigMetadata& metadata() const { return configs_.metadata; }
 
+  // Version of the template last fetched, or 0 if none has been fetched
+  // since this was created.
+  int64_t template_version() const { return template_version_; }
+
  private:
   // Attempt to get Installations and Auth Token from app synchronously.  This
   // will block the current thread and wait until the futures are complete.
@@ -137,7 +146,15 @@ class RemoteConfigREST {
   Semaphore fetch_future_sem_;
 
   RemoteConfigRequest rc_request_;
-  RemoteConfigResponse rc_response_;
+  // Created for each fetch, since a response can't be reused.
+  std::unique_ptr<RemoteConfigResponse> rc_response_;
+
+  int64_t template_version_;
+  // ETag of the template last fetched, sent with the next fetch so the server
+  // can reply that the template is unchanged without sending it again. Kept
+  // with template_version_ for the life of this object only, so the first
+  // fetch after a restart always gets the whole template.
+  std::string etag_;
 };
 
 }  // namespace internal
@@ -36,7 +36,9 @@ RemoteConfigREST::RemoteConfigREST(const firebase::AppOptions& app_options,
       api_key_(app_options.api_key()),
       namespaces_(std::move(namespaces)),
       configs_(configs),
-      fetch_future_sem_(0) {
+      fetch_future_sem_(0),
+      rc_response_(new RemoteConfigResponse()),
+      template_version_(0) {
   configs_.fetched = NamespacedConfigData(
       NamespaceKeyValueMap({{"namespace", {{"key", "value"}}}}), 1000000);
 
@@ -0,0 +1,272 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "remote_config/src/desktop/realtime_stream.h"
+
+#include <algorithm>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "testing/fake_http_server.h"
+
+namespace firebase {
+namespace remote_config {
+namespace internal {
+namespace {
+
+std::vector<std::string> ParseAll(RealtimeMessageParser* parser) {
+  std::vector<std::string> messages;
+  std::string message;
+  while (parser->Next(&message)) messages.push_back(message);
+  return messages;
+}
+
+TEST(RealtimeMessageParserTest, SplitsMessages) {
+  RealtimeMessageParser parser;
+  std::string stream =
+      "[{\"latestTemplateVersionNumber\": \"1\"},\n"
+      "{\"latestTemplateVersionNumber\": \"2\"}";
+  parser.Append(stream.data(), stream.size());
+  EXPECT_THAT(ParseAll(&parser),
+              ::testing::ElementsAre("{\"latestTemplateVersionNumber\": \"1\"}",
+                                     "{\"latestTemplateVersionNumber\": \"2\"}"));
+}
+
+TEST(RealtimeMessageParserTest, JoinsMessagesSplitAcrossChunks) {
+  RealtimeMessageParser parser;
+  std::string stream = "[{\"a\": {\"b\": 1}}, {\"c\": 2}]";
+  std::vector<std::string> messages;
+  for (char c : stream) {
+    parser.Append(&c, 1);
+    std::vector<std::string> parsed = ParseAll(&parser);
+    messages.insert(messages.end(), parsed.begin(), parsed.end());
+  }
+  EXPECT_THAT(messages,
+              ::testing::ElementsAre("{\"a\": {\"b\": 1}}", "{\"c\": 2}"));
+}
+
+TEST(RealtimeMessageParserTest, IgnoresBracesInStrings) {
+  RealtimeMessageParser parser;
+  std::string stream = "{\"a\": \"}{\\\"}\"}";
+  parser.Append(stream.data(), stream.size());
+  EXPECT_THAT(ParseAll(&parser), ::testing::ElementsAre(stream));
+}
+
+#ifndef _WIN32
+
+using ::firebase::testing::cppsdk::FakeHttpServer;
+
+// Local stand-in for the real-time service. Each connection is answered with
+// the next of a list of responses, and the last response is repeated. A
+// response is a list of chunks that are sent with a short pause between
+// them, before the connection is closed.
+class FakeRealtimeServer {
+ public:
+  explicit FakeRealtimeServer(std::vector<std::vector<std::string>> responses)
+      : responses_(std::move(responses)),
+        server_([this](const FakeHttpServer::Request& request, int connection) {
+          size_t index = std::min(static_cast<size_t>(request.index),
+                                  responses_.size() - 1);
+          for (const std::string& chunk : responses_[index]) {
+            FakeHttpServer::Send(connection, chunk);
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+          }
+          return false;
+        }) {}
+
+  std::string url() const { return server_.url("/stream"); }
+
+  // Each connection makes a single request.
+  int connections() { return server_.requests(); }
+
+  std::string last_request() {
+    FakeHttpServer::Request request = server_.last_request();
+    return request.headers + "\r\n\r\n" + request.body;
+  }
+
+  static std::vector<std::string> Status(int status) {
+    return {"HTTP/1.1 " + std::to_string(status) +
+            " Status\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"};
+  }
+
+  static std::vector<std::string> Stream(std::vector<std::string> chunks) {
+    chunks.insert(chunks.begin(),
+                  "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                  "Connection: close\r\n\r\n");
+    return chunks;
+  }
+
+ private:
+  std::vector<std::vector<std::string>> responses_;
+  FakeHttpServer server_;
+};
+
+class RealtimeStreamTest : public ::testing::Test {
+ protected:
+  // Create a stream that connects to server and retries quickly.
+  void CreateStream(const FakeRealtimeServer& server, int max_attempts = 8) {
+    stream_.reset(new RealtimeStream(
+        server.url(), "fake_api_key",
+        []() { return std::string("{\"lastKnownVersionNumber\": \"0\"}"); },
+        [this](int64_t version) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          versions_.push_back(version);
+          condition_.notify_all();
+        },
+        [this](RemoteConfigError error) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          errors_.push_back(error);
+          condition_.notify_all();
+        }));
+    rest::RetryPolicy policy;
+    policy.max_attempts = max_attempts;
+    policy.initial_backoff_ms = 10;
+    policy.max_backoff_ms = 10;
+    stream_->set_retry_policy(policy);
+  }
+
+  // Wait until at least count versions have been received.
+  std::vector<int64_t> WaitForVersions(size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait_for(lock, std::chrono::seconds(10),
+                        [&]() { return versions_.size() >= count; });
+    return versions_;
+  }
+
+  // Wait until at least count errors have been received.
+  std::vector<RemoteConfigError> WaitForErrors(size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait_for(lock, std::chrono::seconds(10),
+                        [&]() { return errors_.size() >= count; });
+    return errors_;
+  }
+
+  // Wait until the stream stops after giving up.
+  bool WaitUntilStopped() {
+    for (int i = 0; i < 1000 && stream_->running(); ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return !stream_->running();
+  }
+
+  std::unique_ptr<RealtimeStream> stream_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::vector<int64_t> versions_;
+  std::vector<RemoteConfigError> errors_;
+};
+
+TEST_F(RealtimeStreamTest, ReceivesVersionsAsTheyAreSent) {
+  FakeRealtimeServer server({FakeRealtimeServer::Stream(
+      {"[{\"latestTemplateVersionNumber\": \"5\"}",
+       ",\n{\"latestTemplateVersio", "nNumber\": 6}"})});
+  CreateStream(server);
+  stream_->Start();
+  EXPECT_THAT(WaitForVersions(2), ::testing::ElementsAre(5, 6));
+  stream_->Stop();
+
+  std::string request = server.last_request();
+  EXPECT_THAT(request, ::testing::HasSubstr("POST /stream"));
+  EXPECT_THAT(request, ::testing::HasSubstr("X-Goog-Api-Key:fake_api_key"));
+  EXPECT_THAT(request,
+              ::testing::HasSubstr("X-Accept-Response-Streaming:true"));
+  EXPECT_THAT(request,
+              ::testing::HasSubstr("{\"lastKnownVersionNumber\": \"0\"}"));
+}
+
+TEST_F(RealtimeStreamTest, ReconnectsAfterRetryableFailure) {
+  FakeRealtimeServer server(
+      {FakeRealtimeServer::Status(503), FakeRealtimeServer::Status(429),
+       FakeRealtimeServer::Stream({"[{\"latestTemplateVersionNumber\": 7}"})});
+  CreateStream(server);
+  stream_->Start();
+  EXPECT_THAT(WaitForVersions(1), ::testing::ElementsAre(7));
+  EXPECT_GE(server.connections(), 3);
+  EXPECT_TRUE(stream_->running());
+}
+
+TEST_F(RealtimeStreamTest, GivesUpAfterRepeatedFailures) {
+  FakeRealtimeServer server({FakeRealtimeServer::Status(503)});
+  CreateStream(server, 3);
+  stream_->Start();
+  EXPECT_THAT(WaitForErrors(1), ::testing::ElementsAre(
+                                    kRemoteConfigErrorConfigUpdateStreamError));
+  EXPECT_TRUE(WaitUntilStopped());
+  EXPECT_EQ(server.connections(), 3);
+}
+
+TEST_F(RealtimeStreamTest, StopsOnPermanentFailure) {
+  FakeRealtimeServer server({FakeRealtimeServer::Status(403)});
+  CreateStream(server);
+  stream_->Start();
+  EXPECT_THAT(WaitForErrors(1), ::testing::ElementsAre(
+                                    kRemoteConfigErrorConfigUpdateStreamError));
+  EXPECT_TRUE(WaitUntilStopped());
+  EXPECT_EQ(server.connections(), 1);
+}
+
+TEST_F(RealtimeStreamTest, StopsWhenFeatureDisabled) {
+  FakeRealtimeServer server(
+      {FakeRealtimeServer::Stream({"[{\"featureDisabled\": true}"})});
+  CreateStream(server);
+  stream_->Start();
+  EXPECT_THAT(WaitForErrors(1), ::testing::ElementsAre(
+                                    kRemoteConfigErrorConfigUpdateUnavailable));
+  EXPECT_TRUE(WaitUntilStopped());
+  EXPECT_EQ(server.connections(), 1);
+}
+
+TEST_F(RealtimeStreamTest, ReportsInvalidMessages) {
+  FakeRealtimeServer server({FakeRealtimeServer::Stream(
+      {"[{\"latestTemplateVersionNumber\": \"x\"}, "
+       "{\"latestTemplateVersionNumber\": 8}"})});
+  CreateStream(server);
+  stream_->Start();
+  EXPECT_THAT(WaitForVersions(1), ::testing::ElementsAre(8));
+  EXPECT_THAT(WaitForErrors(1),
+              ::testing::ElementsAre(
+                  kRemoteConfigErrorConfigUpdateMessageInvalid));
+}
+
+TEST_F(RealtimeStreamTest, StopClosesOpenConnection) {
+  // The server keeps the connection open for a while after the message.
+  std::vector<std::string> chunks = {"[{\"latestTemplateVersionNumber\": 1}"};
+  chunks.resize(25, " ");
+  FakeRealtimeServer server({FakeRealtimeServer::Stream(chunks)});
+  CreateStream(server);
+  stream_->Start();
+  EXPECT_THAT(WaitForVersions(1), ::testing::ElementsAre(1));
+  stream_->Stop();
+  EXPECT_FALSE(stream_->running());
+  // Restarting the stream opens a new connection.
+  stream_->Start();
+  EXPECT_THAT(WaitForVersions(2), ::testing::ElementsAre(1, 1));
+  EXPECT_EQ(server.connections(), 2);
+  stream_.reset();
+}
+
+#endif  // !_WIN32
+
+}  // namespace
+}  // namespace internal
+}  // namespace remote_config
+}  // namespace firebase
@@ -14,7 +14,9 @@
 
 #include "remote_config/src/desktop/remote_config_desktop.h"
 
+#include <atomic>
 #include <chrono>  // NOLINT
+#include <thread>  // NOLINT
 
 #include "app/tests/include/firebase/app_for_testing.h"
 #include "firebase/app.h"
@@ -132,6 +134,20 @@ TEST_F(RemoteConfigDesktopTest, SuccessAsyncSaveToFile) {
   EXPECT_EQ(new_content, instance_->configs_);
 }
 
+// Changes made just before the instance is destroyed are still saved.
+TEST_F(RemoteConfigDesktopTest, SavesPendingChangesOnDestruction) {
+  ConfigKeyValue defaults[] = {{"key_saved", "value_saved"}};
+  instance_->SetDefaults(defaults, 1);
+  delete instance_;
+  instance_ = nullptr;
+
+  LayeredConfigs new_content;
+  EXPECT_TRUE(file_manager_->Load(&new_content));
+  EXPECT_EQ(new_content.defaults.GetValue(
+                "key_saved", RemoteConfigInternal::kDefaultNamespace),
+            "value_saved");
+}
+
 TEST_F(RemoteConfigDesktopTest, SetDefaultsKeyValueVariant) {
   {
     SetUpInstance();
@@ -329,6 +345,151 @@ TEST_F(RemoteConfigDesktopTest, ActivateFetched) {
   }
 }
 
+TEST_F(RemoteConfigDesktopTest, ChangedKeys) {
+  const std::string name_space = RemoteConfigInternal::kDefaultNamespace;
+  NamespacedConfigData fetched(
+      NamespaceKeyValueMap({{name_space,
+                             {{"added", "1"},
+                              {"changed", "new"},
+                              {"same", "value"}}},
+                            {"other", {{"ignored", "1"}}}}),
+      2000);
+  NamespacedConfigData active(
+      NamespaceKeyValueMap(
+          {{name_space,
+            {{"changed", "old"}, {"removed", "1"}, {"same", "value"}}}}),
+      1000);
+  EXPECT_THAT(
+      RemoteConfigInternal::GetChangedKeys(fetched, active, name_space),
+      ::testing::ElementsAre("added", "changed", "removed"));
+  EXPECT_THAT(
+      RemoteConfigInternal::GetChangedKeys(fetched, NamespacedConfigData(),
+                                           name_space),
+      ::testing::ElementsAre("added", "changed", "same"));
+  EXPECT_TRUE(
+      RemoteConfigInternal::GetChangedKeys(active, active, name_space).empty());
+}
+
+TEST_F(RemoteConfigDesktopTest, ConfigUpdateListenersOpenStream) {
+  // Nothing listens on the port, so the stream keeps retrying.
+  instance_->realtime_url_ = "http://127.0.0.1:1/stream";
+  auto listener = [](ConfigUpdate&&, RemoteConfigError) {};
+  EXPECT_FALSE(instance_->realtime_stream_);
+
+  ConfigUpdateListenerRegistration first =
+      instance_->AddOnConfigUpdateListener(listener);
+  ConfigUpdateListenerRegistration second =
+      instance_->AddOnConfigUpdateListener(listener);
+  ASSERT_TRUE(instance_->realtime_stream_);
+  EXPECT_TRUE(instance_->realtime_stream_->running());
+
+  first.Remove();
+  EXPECT_TRUE(instance_->realtime_stream_->running());
+  second.Remove();
+  EXPECT_FALSE(instance_->realtime_stream_->running());
+
+  // Adding a listener reopens the stream.
+  ConfigUpdateListenerRegistration third =
+      instance_->AddOnConfigUpdateListener(listener);
+  EXPECT_TRUE(instance_->realtime_stream_->running());
+}
+
+TEST_F(RemoteConfigDesktopTest, GettersReadDefaults) {
+  ConfigKeyValue defaults[] = {{"key_string", "default"},
+                               {"key_default_long", "12"}};
+  instance_->SetDefaults(defaults, 2);
+  {
+    // Active values take precedence over defaults.
+    ValueInfo info;
+    EXPECT_EQ(instance_->GetString("key_string", &info), "aaa");
+    EXPECT_EQ(info.source, kValueSourceRemoteValue);
+  }
+  {
+    ValueInfo info;
+    EXPECT_EQ(instance_->GetLong("key_default_long", &info), 12);
+    EXPECT_TRUE(info.conversion_successful);
+    EXPECT_EQ(info.source, kValueSourceDefaultValue);
+  }
+  {
+    ValueInfo info;
+    EXPECT_FALSE(instance_->GetBoolean("key_default_long", &info));
+    EXPECT_FALSE(info.conversion_successful);
+    EXPECT_EQ(info.source, kValueSourceDefaultValue);
+  }
+  {
+    ValueInfo info;
+    EXPECT_EQ(instance_->GetDouble("key_missing", &info), 0.0);
+    EXPECT_TRUE(info.conversion_successful);
+    EXPECT_EQ(info.source, kValueSourceStaticValue);
+  }
+}
+
+TEST_F(RemoteConfigDesktopTest, GettersReadActivatedValues) {
+  instance_->configs_.fetched = NamespacedConfigData(
+      NamespaceKeyValueMap({{RemoteConfigInternal::kDefaultNamespace,
+                             {{"key_long", "77"}, {"key_new", "1.5"}}}}),
+      9999999999);
+  EXPECT_EQ(instance_->GetLong("key_long", nullptr), 55555);
+  EXPECT_TRUE(instance_->ActivateFetched());
+  EXPECT_EQ(instance_->GetLong("key_long", nullptr), 77);
+  EXPECT_EQ(instance_->GetDouble("key_new", nullptr), 1.5);
+  {
+    // Values that were only in the previous active config are gone.
+    ValueInfo info;
+    EXPECT_EQ(instance_->GetString("key_string", &info), "");
+    EXPECT_EQ(info.source, kValueSourceStaticValue);
+  }
+}
+
+// Activation only changes the values that differ from the active config.
+TEST_F(RemoteConfigDesktopTest, ActivateFetchedUpdatesChangedValues) {
+  ConfigKeyValue defaults[] = {{"key_string", "default"}};
+  instance_->SetDefaults(defaults, 1);
+  instance_->configs_.fetched = NamespacedConfigData(
+      NamespaceKeyValueMap({{RemoteConfigInternal::kDefaultNamespace,
+                             {{"key_bool", "f"},
+                              {"key_long", "66666"},
+                              {"key_double", "100.5"},
+                              {"key_data", "zzz"}}}}),
+      9999999999);
+  EXPECT_TRUE(instance_->ActivateFetched());
+  EXPECT_EQ(instance_->configs_.fetched, instance_->configs_.active);
+  EXPECT_EQ(instance_->GetLong("key_long", nullptr), 66666);
+  EXPECT_EQ(instance_->GetDouble("key_double", nullptr), 100.5);
+  {
+    // A value removed from the active config falls back to its default.
+    ValueInfo info;
+    EXPECT_EQ(instance_->GetString("key_string", &info), "default");
+    EXPECT_EQ(info.source, kValueSourceDefaultValue);
+  }
+
+  // Activating a newer fetch of the same template changes nothing.
+  instance_->configs_.fetched.set_timestamp(99999999999);
+  EXPECT_TRUE(instance_->ActivateFetched());
+  EXPECT_EQ(instance_->configs_.active.timestamp(), 99999999999);
+  EXPECT_EQ(instance_->GetLong("key_long", nullptr), 66666);
+}
+
+// Getters must keep returning consistent values while defaults are replaced
+// on another thread.
+TEST_F(RemoteConfigDesktopTest, GettersDuringSetDefaults) {
+  std::atomic<bool> done(false);
+  std::thread reader([this, &done]() {
+    while (!done.load()) {
+      ValueInfo info;
+      int64_t value = instance_->GetLong("key_changing", &info);
+      EXPECT_TRUE(info.conversion_successful);
+      EXPECT_TRUE(value == 0 || value == 1 || value == 2) << value;
+    }
+  });
+  for (int i = 0; i < 200; ++i) {
+    ConfigKeyValue defaults[] = {{"key_changing", i % 2 ? "1" : "2"}};
+    instance_->SetDefaults(defaults, 1);
+  }
+  done.store(true);
+  reader.join();
+}
+
 TEST_F(RemoteConfigDesktopTest, Fetch) {
   {
     // Will fetch, because cache_expiration_in_seconds == 0.
@@ -515,8 +676,8 @@ TEST_F(RemoteConfigDesktopTest, SetCustomSignals) {
   EXPECT_EQ(stored_signals.at("key_int"), Variant(123));
   EXPECT_EQ(stored_signals.at("key_double"), Variant(45.6));
 
-  // Verify that rest_ holds a reference to configs_ and immediately reflects
-  // the updated signals.
+  // Verify that the next fetch sends the updated signals.
+  instance_->FetchConfig();
   const MetaCustomSignalsMap& rest_signals =
       instance_->rest_.metadata().custom_signals();
   EXPECT_EQ(rest_signals.size(), 3);
@@ -89,9 +89,9 @@ class RemoteConfigRESTTest : public ::testing::Test {
 
   //  Check all values in case when fetch failed.
   void ExpectFetchFailure(const RemoteConfigREST& rest, int code) {
-    EXPECT_EQ(rest.rc_response_.status(), code);
-    EXPECT_TRUE(rest.rc_response_.header_completed());
-    EXPECT_TRUE(rest.rc_response_.body_completed());
+    EXPECT_EQ(rest.rc_response_->status(), code);
+    EXPECT_TRUE(rest.rc_response_->header_completed());
+    EXPECT_TRUE(rest.rc_response_->body_completed());
 
     EXPECT_EQ(rest.fetched().config(), configs_.fetched.config());
     EXPECT_EQ(rest.metadata().digest_by_namespace(),
@@ -241,10 +241,10 @@ TEST_F(RemoteConfigRESTTest, ParseRestResponseProtoFailure) {
   std::string body = "";
 
   RemoteConfigREST rest(app_->options(), configs_, kTestNamespaces);
-  rest.rc_response_.ProcessHeader(header.data(), header.length());
-  rest.rc_response_.ProcessBody(body.data(), body.length());
-  rest.rc_response_.MarkCompleted();
-  EXPECT_EQ(rest.rc_response_.status(), 200);
+  rest.rc_response_->ProcessHeader(header.data(), header.length());
+  rest.rc_response_->ProcessBody(body.data(), body.length());
+  rest.rc_response_->MarkCompleted();
+  EXPECT_EQ(rest.rc_response_->status(), 200);
 
   rest.ParseRestResponse();
 
@@ -255,10 +255,10 @@ TEST_F(RemoteConfigRESTTest, ParseRestResponseSuccess) {
   std::string header = "HTTP/1.1 200 Ok";
 
   RemoteConfigREST rest(app_->options(), configs_, kTestNamespaces);
-  rest.rc_response_.ProcessHeader(header.data(), header.length());
-  rest.rc_response_.ProcessBody(response_body_.data(), response_body_.length());
-  rest.rc_response_.MarkCompleted();
-  EXPECT_EQ(rest.rc_response_.status(), 200);
+  rest.rc_response_->ProcessHeader(header.data(), header.length());
+  rest.rc_response_->ProcessBody(response_body_.data(), response_body_.length());
+  rest.rc_response_->MarkCompleted();
+  EXPECT_EQ(rest.rc_response_->status(), 200);
 
   rest.ParseRestResponse();
 
@@ -279,6 +279,61 @@ TEST_F(RemoteConfigRESTTest, ParseRestResponseSuccess) {
   EXPECT_GE(info.fetch_time, MillisecondsSinceEpoch() - 10000);
 }
 
+TEST_F(RemoteConfigRESTTest, ParseRestResponseNotModified) {
+  std::string header = "HTTP/1.1 304 Not Modified";
+  NamespaceKeyValueMap fetched_config = configs_.fetched.config();
+  uint64_t fetched_timestamp = configs_.fetched.timestamp();
+
+  RemoteConfigREST rest(app_->options(), configs_, kTestNamespaces);
+  rest.etag_ = "etag-1";
+  rest.rc_response_->ProcessHeader(header.data(), header.length());
+  rest.rc_response_->MarkCompleted();
+
+  rest.ParseRestResponse();
+
+  // The template fetched before is kept and marked as fetched again.
+  EXPECT_THAT(rest.fetched().config(),
+              ::testing::ContainerEq(fetched_config));
+  EXPECT_GT(rest.fetched().timestamp(), fetched_timestamp);
+  EXPECT_EQ(rest.etag_, "etag-1");
+  ConfigInfo info = rest.metadata().info();
+  EXPECT_EQ(info.last_fetch_status, kLastFetchStatusSuccess);
+}
+
+TEST_F(RemoteConfigRESTTest, ParseRestResponseUpdateChangesKeys) {
+  std::string status = "HTTP/1.1 200 Ok";
+  std::string etag = "ETag: etag-2";
+  std::string body = R"({
+    "entries": {
+      "TestBoolean": "false",
+      "TestData": "12345",
+      "TestNew": "new"
+    },
+    "state": "UPDATE"
+  })";
+
+  RemoteConfigREST rest(app_->options(), configs_, kTestNamespaces);
+  rest.rc_response_->ProcessHeader(status.data(), status.length());
+  rest.rc_response_->ProcessHeader(etag.data(), etag.length());
+  rest.rc_response_->ProcessBody(body.data(), body.length());
+  rest.rc_response_->MarkCompleted();
+
+  rest.ParseRestResponse();
+
+  EXPECT_THAT(rest.fetched().config(),
+              ::testing::ContainerEq(NamespaceKeyValueMap({
+                  {kTestNamespaces,
+                   {{"TestBoolean", "false"},
+                    {"TestData", "12345"},
+                    {"TestNew", "new"}}},
+              })));
+  EXPECT_EQ(rest.etag_, "etag-2");
+
+  // The next fetch asks whether the template has changed.
+  rest.SetupRestRequest(*app_, 3600);
+  EXPECT_EQ(rest.rc_request_.options().header[kIfNoneMatchHeader], "etag-2");
+}
+
 }  // namespace internal
 }  // namespace remote_config
 }  // namespace firebase
@@ -443,6 +443,83 @@ TEST_F(FirebaseStorageTest, TestWriteAndReadByteBuffer) {
   }
 }
 
+#if FIREBASE_PLATFORM_DESKTOP
+// Generates kSize bytes of data as it's read.
+class GeneratedUploadSource : public firebase::storage::UploadSource {
+ public:
+  static const size_t kSize = 3 * 1024 * 1024 + 17;
+
+  GeneratedUploadSource() : offset_(0) {}
+
+  bool Read(void* buffer, size_t buffer_size, size_t* bytes_read) override {
+    *bytes_read = std::min(buffer_size, kSize - offset_);
+    for (size_t i = 0; i < *bytes_read; ++i) {
+      static_cast<char*>(buffer)[i] = ByteAt(offset_ + i);
+    }
+    offset_ += *bytes_read;
+    return true;
+  }
+
+  static char ByteAt(size_t offset) { return static_cast<char>(offset * 31); }
+
+ private:
+  size_t offset_;
+};
+
+// Checks the data it receives matches GeneratedUploadSource.
+class CheckingDownloadSink : public firebase::storage::DownloadSink {
+ public:
+  CheckingDownloadSink() : offset_(0), mismatches_(0) {}
+
+  bool Write(const void* data, size_t size) override {
+    for (size_t i = 0; i < size; ++i) {
+      if (static_cast<const char*>(data)[i] !=
+          GeneratedUploadSource::ByteAt(offset_ + i)) {
+        ++mismatches_;
+      }
+    }
+    offset_ += size;
+    return true;
+  }
+
+  size_t offset() const { return offset_; }
+  size_t mismatches() const { return mismatches_; }
+
+ private:
+  size_t offset_;
+  size_t mismatches_;
+};
+
+TEST_F(FirebaseStorageTest, TestPutStreamAndGetStream) {
+  SignIn();
+
+  firebase::storage::StorageReference ref =
+      CreateFolder().Child("TestStream.bin");
+  cleanup_files_.push_back(ref);
+  {
+    LogDebug("Upload generated data from a stream.");
+    GeneratedUploadSource source;
+    firebase::storage::Metadata new_metadata;
+    new_metadata.set_content_type("application/octet-stream");
+    firebase::Future<firebase::storage::Metadata> future =
+        ref.PutStream(&source, new_metadata);
+    WaitForCompletion(future, "PutStream");
+    ASSERT_NE(future.result(), nullptr);
+    EXPECT_EQ(future.result()->size_bytes(), GeneratedUploadSource::kSize);
+  }
+  {
+    LogDebug("Download to a stream.");
+    CheckingDownloadSink sink;
+    firebase::Future<size_t> future = ref.GetStream(&sink);
+    WaitForCompletion(future, "GetStream");
+    ASSERT_NE(future.result(), nullptr);
+    EXPECT_EQ(*future.result(), GeneratedUploadSource::kSize);
+    EXPECT_EQ(sink.offset(), GeneratedUploadSource::kSize);
+    EXPECT_EQ(sink.mismatches(), 0u);
+  }
+}
+#endif  // FIREBASE_PLATFORM_DESKTOP
+
 TEST_F(FirebaseStorageTest, TestWriteAndReadFileWithCustomMetadata) {
   SignIn();
 
@@ -817,6 +894,78 @@ TEST_F(FirebaseStorageTest, TestList) {
   EXPECT_EQ(page2_result.next_page_token(), "");
 }
 
+#if FIREBASE_PLATFORM_DESKTOP
+TEST_F(FirebaseStorageTest, TestBulkOperations) {
+  SignIn();
+
+  firebase::storage::StorageReference ref = CreateFolder().Child("bulk_test");
+  const char* kFileNames[] = {"file_0.txt", "file_1.txt", "file_2.txt",
+                              "subfolder/file_3.txt", "subfolder/file_4.txt"};
+  const int kNumFiles = sizeof(kFileNames) / sizeof(kFileNames[0]);
+  std::vector<firebase::storage::StorageReference> file_refs;
+  for (int i = 0; i < kNumFiles; ++i) {
+    firebase::storage::StorageReference file_ref = ref.Child(kFileNames[i]);
+    firebase::Future<firebase::storage::Metadata> put_future =
+        file_ref.PutBytes(kFileNames[i], strlen(kFileNames[i]));
+    WaitForCompletion(put_future, "PutBytes");
+    cleanup_files_.push_back(file_ref);
+    file_refs.push_back(file_ref);
+  }
+
+  firebase::storage::BulkOptions options;
+  options.max_concurrent_operations = 2;
+  // Several pages are listed for each folder.
+  options.max_results_per_page = 2;
+  {
+    LogDebug("Get the metadata of every object under a prefix.");
+    firebase::Future<firebase::storage::BulkResult> future =
+        storage_->RunBulkOperation(firebase::storage::kBulkOperationGetMetadata,
+                                   ref, options);
+    WaitForCompletionAnyResult(future, "RunBulkOperation GetMetadata");
+    if (future.error() == firebase::storage::kErrorUnknown) {
+      LogWarning(
+          "Skipping TestBulkOperations as the test project is likely using an "
+          "older rules_version.");
+      return;
+    }
+    EXPECT_EQ(future.error(), firebase::storage::kErrorNone);
+    ASSERT_NE(future.result(), nullptr);
+    EXPECT_EQ(future.result()->items.size(), kNumFiles);
+    EXPECT_EQ(future.result()->failure_count, 0);
+    for (const auto& item : future.result()->items) {
+      EXPECT_EQ(item.error, firebase::storage::kErrorNone);
+      EXPECT_GT(item.metadata.size_bytes(), 0);
+    }
+  }
+  {
+    LogDebug("Delete a list of objects.");
+    std::vector<firebase::storage::StorageReference> to_delete(
+        file_refs.begin(), file_refs.begin() + 2);
+    firebase::Future<firebase::storage::BulkResult> future =
+        storage_->RunBulkOperation(firebase::storage::kBulkOperationDelete,
+                                   to_delete, options);
+    WaitForCompletion(future, "RunBulkOperation Delete list");
+    ASSERT_NE(future.result(), nullptr);
+    EXPECT_EQ(future.result()->items.size(), to_delete.size());
+  }
+  {
+    LogDebug("Delete the remaining objects under the prefix.");
+    firebase::Future<firebase::storage::BulkResult> future =
+        storage_->RunBulkOperation(firebase::storage::kBulkOperationDelete,
+                                   ref, options);
+    WaitForCompletion(future, "RunBulkOperation Delete prefix");
+    ASSERT_NE(future.result(), nullptr);
+    EXPECT_EQ(future.result()->items.size(), kNumFiles - 2);
+
+    firebase::Future<firebase::storage::StorageListResult> list_future =
+        ref.List();
+    WaitForCompletion(list_future, "List");
+    EXPECT_TRUE(list_future.result()->items().empty());
+    EXPECT_TRUE(list_future.result()->prefixes().empty());
+  }
+}
+#endif  // FIREBASE_PLATFORM_DESKTOP
+
 // Only test retries on desktop since Android and iOS don't have an option
 // to retry file-not-found errors and just pass-through to native
 // implementations.
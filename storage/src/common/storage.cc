@@ -227,6 +227,27 @@ void Storage::set_max_operation_retry_time(double max_transfer_retry_seconds) {
     return internal_->set_max_operation_retry_time(max_transfer_retry_seconds);
 }
 
+#if FIREBASE_PLATFORM_DESKTOP
+Future<BulkResult> Storage::RunBulkOperation(
+    BulkOperation operation, const std::vector<StorageReference>& references,
+    const BulkOptions& options) {
+  return internal_ ? internal_->RunBulkOperation(operation, references, options)
+                   : Future<BulkResult>();
+}
+
+Future<BulkResult> Storage::RunBulkOperation(BulkOperation operation,
+                                             const StorageReference& prefix,
+                                             const BulkOptions& options) {
+  return internal_ ? internal_->RunBulkOperation(operation, prefix, options)
+                   : Future<BulkResult>();
+}
+
+Future<BulkResult> Storage::RunBulkOperationLastResult() {
+  return internal_ ? internal_->RunBulkOperationLastResult()
+                   : Future<BulkResult>();
+}
+#endif  // FIREBASE_PLATFORM_DESKTOP
+
 void Storage::UseEmulator(const char* host, int port) {
   if (internal_) internal_->UseEmulator(host, port);
 }
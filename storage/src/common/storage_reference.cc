@@ -169,6 +169,19 @@ Future<size_t> StorageReference::GetBytesLastResult() {
   return internal_ ? internal_->GetBytesLastResult() : Future<size_t>();
 }
 
+#if FIREBASE_PLATFORM_DESKTOP
+Future<size_t> StorageReference::GetStream(DownloadSink* sink,
+                                           Listener* listener,
+                                           Controller* controller_out) {
+  return internal_ ? internal_->GetStream(sink, listener, controller_out)
+                   : Future<size_t>();
+}
+
+Future<size_t> StorageReference::GetStreamLastResult() {
+  return internal_ ? internal_->GetStreamLastResult() : Future<size_t>();
+}
+#endif  // FIREBASE_PLATFORM_DESKTOP
+
 Future<std::string> StorageReference::GetDownloadUrl() {
   return internal_ ? internal_->GetDownloadUrl() : Future<std::string>();
 }
@@ -228,6 +241,29 @@ Future<Metadata> StorageReference::PutBytesLastResult() {
   return internal_ ? internal_->PutBytesLastResult() : Future<Metadata>();
 }
 
+#if FIREBASE_PLATFORM_DESKTOP
+Future<Metadata> StorageReference::PutStream(UploadSource* source,
+                                             Listener* listener,
+                                             Controller* controller_out) {
+  return internal_ ? internal_->PutStream(source, listener, controller_out)
+                   : Future<Metadata>();
+}
+
+Future<Metadata> StorageReference::PutStream(UploadSource* source,
+                                             const Metadata& metadata,
+                                             Listener* listener,
+                                             Controller* controller_out) {
+  AssertMetadataIsValid(metadata);
+  return internal_ ? internal_->PutStream(source, &metadata, listener,
+                                          controller_out)
+                   : Future<Metadata>();
+}
+
+Future<Metadata> StorageReference::PutStreamLastResult() {
+  return internal_ ? internal_->PutStreamLastResult() : Future<Metadata>();
+}
+#endif  // FIREBASE_PLATFORM_DESKTOP
+
 Future<Metadata> StorageReference::PutFile(const char* path, Listener* listener,
                                            Controller* controller_out) {
   return internal_ ? internal_->PutFile(path, listener, controller_out)
@@ -0,0 +1,430 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "storage/src/desktop/bulk_operation.h"
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "app/src/include/firebase/internal/platform.h"
+#include "storage/src/include/firebase/storage/common.h"
+
+#if FIREBASE_PLATFORM_WINDOWS
+#include <direct.h>
+
+#include <codecvt>
+#include <locale>
+#endif  // FIREBASE_PLATFORM_WINDOWS
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+namespace {
+
+const char kNoDestinationDirectory[] =
+    "BulkOptions::destination_directory must be set to download objects.";
+const char kInvalidFilePath[] =
+    "The name of the object can't be used as a path in the destination "
+    "directory.";
+const char kInvalidReference[] = "The StorageReference is invalid.";
+
+// Returns whether path, relative to the destination directory, stays within
+// it.
+bool IsSafeRelativePath(const std::string& path) {
+  if (path.empty() || path[0] == '/' || path[0] == '\\') return false;
+  size_t start = 0;
+  while (start <= path.size()) {
+    size_t end = path.find_first_of("/\\", start);
+    if (end == std::string::npos) end = path.size();
+    std::string segment = path.substr(start, end - start);
+    if (segment == ".." || segment.find(':') != std::string::npos) {
+      return false;
+    }
+    start = end + 1;
+  }
+  return true;
+}
+
+// Create the directories under base_directory that contain the file at
+// relative_path.
+bool CreateParentDirectories(const std::string& base_directory,
+                             const std::string& relative_path) {
+  size_t separator = relative_path.find('/');
+  while (separator != std::string::npos) {
+    std::string directory =
+        base_directory + "/" + relative_path.substr(0, separator);
+#if FIREBASE_PLATFORM_WINDOWS
+    std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> utf8_to_wstring;
+    int result = _wmkdir(utf8_to_wstring.from_bytes(directory).c_str());
+#else
+    int result = mkdir(directory.c_str(), 0700);
+#endif  // FIREBASE_PLATFORM_WINDOWS
+    if (result != 0 && errno != EEXIST) return false;
+    separator = relative_path.find('/', separator + 1);
+  }
+  return true;
+}
+
+}  // namespace
+
+void BulkOperationRunner::Start(BulkOperation operation,
+                                const std::vector<StorageReference>& references,
+                                const BulkOptions& options,
+                                CleanupNotifier* cleanup,
+                                ReferenceCountedFutureImpl* future_api,
+                                SafeFutureHandle<BulkResult> handle) {
+  if (operation == kBulkOperationGetFile &&
+      (!options.destination_directory || !options.destination_directory[0])) {
+    future_api->Complete(handle, kErrorUnknown, kNoDestinationDirectory);
+    return;
+  }
+  std::shared_ptr<BulkOperationRunner> runner(new BulkOperationRunner(
+      operation, options, cleanup, future_api, handle));
+  runner->AddReferences(references);
+  runner->Begin();
+}
+
+void BulkOperationRunner::Start(BulkOperation operation,
+                                const StorageReference& prefix,
+                                const BulkOptions& options,
+                                CleanupNotifier* cleanup,
+                                ReferenceCountedFutureImpl* future_api,
+                                SafeFutureHandle<BulkResult> handle) {
+  if (operation == kBulkOperationGetFile &&
+      (!options.destination_directory || !options.destination_directory[0])) {
+    future_api->Complete(handle, kErrorUnknown, kNoDestinationDirectory);
+    return;
+  }
+  if (!prefix.is_valid()) {
+    future_api->Complete(handle, kErrorUnknown, kInvalidReference);
+    return;
+  }
+  std::shared_ptr<BulkOperationRunner> runner(new BulkOperationRunner(
+      operation, options, cleanup, future_api, handle));
+  runner->AddPrefix(prefix);
+  runner->Begin();
+}
+
+BulkOperationRunner::BulkOperationRunner(BulkOperation operation,
+                                         const BulkOptions& options,
+                                         CleanupNotifier* cleanup,
+                                         ReferenceCountedFutureImpl* future_api,
+                                         SafeFutureHandle<BulkResult> handle)
+    : operation_(operation),
+      options_(options),
+      cleanup_(cleanup),
+      future_api_(future_api),
+      handle_(handle),
+      active_(0),
+      next_prefix_(0),
+      list_in_flight_(false),
+      list_error_(kErrorNone),
+      completed_(false),
+      running_(false),
+      run_requested_(false) {
+  // The caller's string may not outlive the call that started the runner.
+  if (options_.destination_directory) {
+    destination_directory_ = options_.destination_directory;
+    options_.destination_directory = nullptr;
+  }
+  options_.max_concurrent_operations =
+      (std::max)(options_.max_concurrent_operations, 1);
+}
+
+BulkOperationRunner::~BulkOperationRunner() {}
+
+void BulkOperationRunner::AddReferences(
+    const std::vector<StorageReference>& references) {
+  MutexLock lock(mutex_);
+  for (StorageReference reference : references) {
+    std::string relative_path;
+    if (reference.is_valid()) {
+      relative_path = reference.full_path();
+      // Paths of objects start with a slash.
+      if (!relative_path.empty() && relative_path[0] == '/') {
+        relative_path.erase(0, 1);
+      }
+    }
+    AddItem(reference, relative_path);
+  }
+}
+
+void BulkOperationRunner::AddPrefix(const StorageReference& prefix) {
+  MutexLock lock(mutex_);
+  prefixes_.push_back(Prefix{prefix, std::string(), std::string()});
+}
+
+void BulkOperationRunner::Begin() {
+  {
+    MutexLock lock(mutex_);
+    self_ = shared_from_this();
+  }
+  cleanup_->RegisterObject(this, [](void* runner) {
+    static_cast<BulkOperationRunner*>(runner)->Abort();
+  });
+  Run();
+}
+
+void BulkOperationRunner::AddItem(const StorageReference& reference,
+                                  const std::string& relative_path) {
+  items_.emplace_back();
+  items_.back().reference = reference;
+  item_paths_.push_back(relative_path);
+  pending_.push_back(items_.size() - 1);
+}
+
+void BulkOperationRunner::Run() {
+  {
+    MutexLock lock(mutex_);
+    run_requested_ = true;
+    if (running_) return;
+    running_ = true;
+  }
+  bool done = false;
+  for (;;) {
+    std::vector<size_t> to_start;
+    StorageReference* prefix = nullptr;
+    std::string page_token;
+    {
+      MutexLock lock(mutex_);
+      if (!run_requested_ || completed_) {
+        running_ = false;
+        break;
+      }
+      run_requested_ = false;
+      while (active_ < options_.max_concurrent_operations &&
+             !pending_.empty()) {
+        to_start.push_back(pending_.front());
+        pending_.pop_front();
+        ++active_;
+      }
+      if (ShouldList()) {
+        list_in_flight_ = true;
+        // Elements of a deque aren't moved when others are added.
+        prefix = &prefixes_[next_prefix_].reference;
+        page_token = prefixes_[next_prefix_].page_token;
+      }
+      if (active_ == 0 && pending_.empty() && !list_in_flight_ &&
+          (next_prefix_ >= prefixes_.size() || list_error_ != kErrorNone)) {
+        completed_ = true;
+        running_ = false;
+        done = true;
+        break;
+      }
+    }
+    // Operations and listings that complete immediately request another pass
+    // rather than calling Run() recursively. They can't complete the runner
+    // while this pass is starting the others as those are still counted as in
+    // progress.
+    for (size_t index : to_start) StartItem(index);
+    if (prefix) ListNextPage(prefix, page_token);
+  }
+  if (done) Complete();
+}
+
+bool BulkOperationRunner::ShouldList() const {
+  // Request the next page while the objects of the previous one are
+  // processed, but no further ahead.
+  size_t max_pending = static_cast<size_t>((std::max)(
+      options_.max_results_per_page, options_.max_concurrent_operations));
+  return !list_in_flight_ && list_error_ == kErrorNone &&
+         next_prefix_ < prefixes_.size() && pending_.size() <= max_pending;
+}
+
+void BulkOperationRunner::StartItem(size_t index) {
+  StorageReference* reference;
+  std::string path;
+  {
+    MutexLock lock(mutex_);
+    // Elements of a deque aren't moved when others are added.
+    reference = &items_[index].reference;
+    path = item_paths_[index];
+  }
+  if (!reference->is_valid()) {
+    ItemComplete(index, nullptr, kErrorUnknown, kInvalidReference);
+    return;
+  }
+  FutureBase future;
+  switch (operation_) {
+    case kBulkOperationDelete:
+      future = reference->Delete();
+      break;
+    case kBulkOperationGetMetadata:
+      future = reference->GetMetadata();
+      break;
+    case kBulkOperationGetFile: {
+      if (!IsSafeRelativePath(path)) {
+        ItemComplete(index, nullptr, kErrorUnknown, kInvalidFilePath);
+        return;
+      }
+      if (!CreateParentDirectories(destination_directory_, path)) {
+        ItemComplete(index, nullptr, kErrorUnknown,
+                     "Unable to create the directory to download to.");
+        return;
+      }
+      path = destination_directory_ + "/" + path;
+      future = reference->GetFile(path.c_str());
+      break;
+    }
+  }
+  std::weak_ptr<BulkOperationRunner> weak_runner = shared_from_this();
+  future.OnCompletion([weak_runner, index](const FutureBase& result) {
+    std::shared_ptr<BulkOperationRunner> runner = weak_runner.lock();
+    if (runner) runner->ItemComplete(index, &result, kErrorNone, nullptr);
+  });
+}
+
+void BulkOperationRunner::ItemComplete(size_t index, const FutureBase* result,
+                                       Error error,
+                                       const char* error_message) {
+  // Read the future before locking mutex_ as its own lock is held while
+  // callbacks run.
+  const Metadata* metadata = nullptr;
+  const size_t* bytes_downloaded = nullptr;
+  if (result) {
+    error = static_cast<Error>(result->error());
+    error_message = result->error_message();
+    if (operation_ == kBulkOperationGetMetadata) {
+      metadata = static_cast<const Future<Metadata>*>(result)->result();
+    } else if (operation_ == kBulkOperationGetFile) {
+      bytes_downloaded = static_cast<const Future<size_t>*>(result)->result();
+    }
+  }
+  {
+    MutexLock lock(mutex_);
+    BulkItemResult& item = items_[index];
+    item.error = error;
+    if (error != kErrorNone) {
+      item.error_message = error_message ? error_message : "";
+    } else if (metadata) {
+      item.metadata = *metadata;
+    }
+    if (bytes_downloaded) item.bytes_downloaded = *bytes_downloaded;
+    --active_;
+  }
+  Run();
+}
+
+void BulkOperationRunner::ListNextPage(StorageReference* prefix,
+                                       const std::string& page_token) {
+  Future<StorageListResult> future =
+      prefix->List(options_.max_results_per_page,
+                   page_token.empty() ? nullptr : page_token.c_str());
+  std::weak_ptr<BulkOperationRunner> weak_runner = shared_from_this();
+  future.OnCompletion(
+      [weak_runner](const Future<StorageListResult>& result) {
+        std::shared_ptr<BulkOperationRunner> runner = weak_runner.lock();
+        if (!runner) return;
+        Error error = static_cast<Error>(result.error());
+        const StorageListResult* page = result.result();
+        if (error == kErrorNone && page) {
+          runner->PageComplete(kErrorNone, nullptr, page->items(),
+                               page->prefixes(), page->next_page_token());
+        } else {
+          runner->PageComplete(error != kErrorNone ? error : kErrorUnknown,
+                               result.error_message(),
+                               std::vector<StorageReference>(),
+                               std::vector<StorageReference>(), std::string());
+        }
+      });
+}
+
+void BulkOperationRunner::PageComplete(
+    Error error, const char* error_message,
+    const std::vector<StorageReference>& items,
+    const std::vector<StorageReference>& prefixes,
+    const std::string& next_page_token) {
+  {
+    MutexLock lock(mutex_);
+    list_in_flight_ = false;
+    if (error != kErrorNone) {
+      list_error_ = error;
+      list_error_message_ = error_message ? error_message : "";
+    } else {
+      Prefix& prefix = prefixes_[next_prefix_];
+      for (StorageReference item : items) {
+        AddItem(item, prefix.relative_path + item.name());
+      }
+      if (options_.recursive) {
+        for (StorageReference folder : prefixes) {
+          std::string relative_path =
+              prefix.relative_path + folder.name() + "/";
+          prefixes_.push_back(Prefix{folder, relative_path, std::string()});
+        }
+      }
+      prefix.page_token = next_page_token;
+      if (prefix.page_token.empty()) ++next_prefix_;
+    }
+  }
+  Run();
+}
+
+void BulkOperationRunner::Abort() {
+  // Keep the runner alive until this returns, as self_ is released.
+  std::shared_ptr<BulkOperationRunner> runner = shared_from_this();
+  MutexLock lock(mutex_);
+  completed_ = true;
+  pending_.clear();
+  cleanup_ = nullptr;
+  if (future_api_) {
+    future_api_->Complete(handle_, kErrorCancelled,
+                          GetErrorMessage(kErrorCancelled));
+    future_api_ = nullptr;
+  }
+  self_.reset();
+}
+
+void BulkOperationRunner::Complete() {
+  // Keep the runner alive until this returns, as self_ is released.
+  std::shared_ptr<BulkOperationRunner> runner = shared_from_this();
+  CleanupNotifier* cleanup;
+  {
+    MutexLock lock(mutex_);
+    cleanup = cleanup_;
+    cleanup_ = nullptr;
+  }
+  // The notifier's lock is held while it calls Abort(), so it's unregistered
+  // from without holding mutex_.
+  if (cleanup) cleanup->UnregisterObject(this);
+
+  MutexLock lock(mutex_);
+  self_.reset();
+  // The future has already failed if the Storage was deleted.
+  if (!future_api_) return;
+  BulkResult result;
+  result.items.assign(items_.begin(), items_.end());
+  Error error = list_error_;
+  std::string error_message = list_error_message_;
+  for (const BulkItemResult& item : result.items) {
+    if (item.error == kErrorNone) continue;
+    ++result.failure_count;
+    if (error == kErrorNone) {
+      error = item.error;
+      error_message = item.error_message;
+    }
+  }
+  future_api_->CompleteWithResult(handle_, error, error_message.c_str(),
+                                  result);
+  future_api_ = nullptr;
+}
+
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
@@ -0,0 +1,180 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_STORAGE_SRC_DESKTOP_BULK_OPERATION_H_
+#define FIREBASE_STORAGE_SRC_DESKTOP_BULK_OPERATION_H_
+
+#include <stddef.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "app/src/cleanup_notifier.h"
+#include "app/src/include/firebase/future.h"
+#include "app/src/include/firebase/internal/mutex.h"
+#include "app/src/reference_counted_future_impl.h"
+#include "storage/src/include/firebase/storage/bulk.h"
+#include "storage/src/include/firebase/storage/list_result.h"
+#include "storage/src/include/firebase/storage/storage_reference.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+// Performs a BulkOperation on a list of objects or on the objects under a
+// prefix, completing a future with the BulkResult.
+//
+// Each object is operated on with the StorageReference API, so the retries,
+// authentication and download cache of a single operation apply. At most
+// BulkOptions::max_concurrent_operations are in progress at a time, an
+// operation is started on the next object as each one completes.
+//
+// The objects under a prefix are listed a page at a time, with one listing in
+// flight while the objects of earlier pages are operated on. Listing stops
+// while enough objects are waiting to keep the operations busy, so a prefix
+// of any size is processed in bounded memory apart from the results.
+//
+// The runner is registered with the Storage's CleanupNotifier and keeps
+// itself alive until the future is complete, or until the Storage is deleted
+// which fails the future with kErrorCancelled.
+class BulkOperationRunner
+    : public std::enable_shared_from_this<BulkOperationRunner> {
+ public:
+  // Operate on each object in references.
+  static void Start(BulkOperation operation,
+                    const std::vector<StorageReference>& references,
+                    const BulkOptions& options, CleanupNotifier* cleanup,
+                    ReferenceCountedFutureImpl* future_api,
+                    SafeFutureHandle<BulkResult> handle);
+
+  // Operate on each object under prefix.
+  static void Start(BulkOperation operation, const StorageReference& prefix,
+                    const BulkOptions& options, CleanupNotifier* cleanup,
+                    ReferenceCountedFutureImpl* future_api,
+                    SafeFutureHandle<BulkResult> handle);
+
+  virtual ~BulkOperationRunner();
+
+ protected:
+  BulkOperationRunner(BulkOperation operation, const BulkOptions& options,
+                      CleanupNotifier* cleanup,
+                      ReferenceCountedFutureImpl* future_api,
+                      SafeFutureHandle<BulkResult> handle);
+
+  // Queue an operation on each of references.
+  void AddReferences(const std::vector<StorageReference>& references);
+
+  // Queue the listing of the objects under prefix.
+  void AddPrefix(const StorageReference& prefix);
+
+  // Register with the CleanupNotifier and start operating on the objects.
+  void Begin();
+
+  // Start the operation on the item at index, calling ItemComplete() once it
+  // is complete.
+  virtual void StartItem(size_t index);
+
+  // Record the result of the operation on the item at index, completed by
+  // result or failed with error and error_message if result is null.
+  void ItemComplete(size_t index, const FutureBase* result, Error error,
+                    const char* error_message);
+
+  // Request the page of the listing of prefix starting at page_token, or the
+  // first page if it's empty, calling PageComplete() once it is complete.
+  virtual void ListNextPage(StorageReference* prefix,
+                            const std::string& page_token);
+
+  // Queue the objects and folders of a page of the listing of the prefix
+  // being listed, or stop listing with error and error_message if it failed.
+  void PageComplete(Error error, const char* error_message,
+                    const std::vector<StorageReference>& items,
+                    const std::vector<StorageReference>& prefixes,
+                    const std::string& next_page_token);
+
+  // Fail the future with kErrorCancelled, as the Storage is being deleted.
+  void Abort();
+
+ private:
+  // Queue an operation on reference, writing a downloaded file to
+  // relative_path under the destination directory. Must be called with
+  // mutex_ held.
+  void AddItem(const StorageReference& reference,
+               const std::string& relative_path);
+
+  // Start operations until max_concurrent_operations are in progress, request
+  // the next page of a listing if more objects are needed and complete the
+  // future if everything is done. Operations that complete while this runs,
+  // including those that complete before they are started, are handled by
+  // the call in progress rather than by a nested one.
+  void Run();
+
+  // Returns whether another page should be listed. Must be called with mutex_
+  // held.
+  bool ShouldList() const;
+
+  // Unregister from the CleanupNotifier and complete the future.
+  void Complete();
+
+  BulkOperation operation_;
+  BulkOptions options_;
+  std::string destination_directory_;
+
+  Mutex mutex_;
+  // Notifier the runner is registered with, null once it has unregistered or
+  // the Storage has been deleted.
+  CleanupNotifier* cleanup_;
+  // Future API to complete the future with, null once it's complete.
+  ReferenceCountedFutureImpl* future_api_;
+  SafeFutureHandle<BulkResult> handle_;
+  // Keeps the runner alive until the future is complete.
+  std::shared_ptr<BulkOperationRunner> self_;
+  // Results of every item so far. Items are never moved once added as each
+  // holds the StorageReference whose future is in progress.
+  std::deque<BulkItemResult> items_;
+  // Path of the file each item is downloaded to.
+  std::deque<std::string> item_paths_;
+  // Indices of items waiting to be started.
+  std::deque<size_t> pending_;
+  // Number of items in progress.
+  int active_;
+  // Prefixes to list, with their paths relative to the prefix passed to
+  // Start(). Prefixes are kept until the runner completes as the futures of
+  // their listings may still be referenced.
+  struct Prefix {
+    StorageReference reference;
+    std::string relative_path;
+    // Token of the next page to list, empty for the first page.
+    std::string page_token;
+  };
+  std::deque<Prefix> prefixes_;
+  // Index of the prefix being listed, prefixes_.size() once all are listed.
+  size_t next_prefix_;
+  bool list_in_flight_;
+  // Error that stopped the listing, kErrorNone if none.
+  Error list_error_;
+  std::string list_error_message_;
+  bool completed_;
+  // Whether Run() is in progress, and whether it should check for more work
+  // once it has started what it found.
+  bool running_;
+  bool run_requested_;
+};
+
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
+
+#endif  // FIREBASE_STORAGE_SRC_DESKTOP_BULK_OPERATION_H_
@@ -0,0 +1,199 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "storage/src/desktop/checksum.h"
+
+#include <string.h>
+
+#include "app/src/base64.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define FIREBASE_STORAGE_CRC32C_SSE42 1
+#include <nmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif  // defined(_MSC_VER)
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define FIREBASE_STORAGE_CRC32C_ARM64 1
+#include <arm_acle.h>
+#endif
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+namespace {
+
+// Reversed Castagnoli polynomial.
+const uint32_t kCrc32cPolynomial = 0x82f63b78;
+
+// Tables to compute the CRC32C of 8 bytes at a time in software.
+struct Crc32cTables {
+  Crc32cTables() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ (kCrc32cPolynomial & (0 - (crc & 1)));
+      }
+      table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+      for (int slice = 1; slice < 8; ++slice) {
+        uint32_t previous = table[slice - 1][i];
+        table[slice][i] = (previous >> 8) ^ table[0][previous & 0xff];
+      }
+    }
+  }
+
+  uint32_t table[8][256];
+};
+
+uint32_t Crc32cSoftware(uint32_t crc, const uint8_t* data, size_t size) {
+  static const Crc32cTables tables;
+  const uint32_t(&table)[8][256] = tables.table;
+  while (size >= 8) {
+    uint32_t low = crc ^ (static_cast<uint32_t>(data[0]) |
+                          static_cast<uint32_t>(data[1]) << 8 |
+                          static_cast<uint32_t>(data[2]) << 16 |
+                          static_cast<uint32_t>(data[3]) << 24);
+    crc = table[7][low & 0xff] ^ table[6][(low >> 8) & 0xff] ^
+          table[5][(low >> 16) & 0xff] ^ table[4][low >> 24] ^
+          table[3][data[4]] ^ table[2][data[5]] ^ table[1][data[6]] ^
+          table[0][data[7]];
+    data += 8;
+    size -= 8;
+  }
+  while (size--) crc = table[0][(crc ^ *data++) & 0xff] ^ (crc >> 8);
+  return crc;
+}
+
+#if FIREBASE_STORAGE_CRC32C_SSE42
+bool HasCrc32Instructions() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 20)) != 0;
+#else
+  return __builtin_cpu_supports("sse4.2");
+#endif  // defined(_MSC_VER)
+}
+
+#if !defined(_MSC_VER)
+__attribute__((target("sse4.2")))
+#endif  // !defined(_MSC_VER)
+uint32_t
+Crc32cHardware(uint32_t crc, const uint8_t* data, size_t size) {
+  uint64_t crc64 = crc;
+  while (size >= 8) {
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    crc64 = _mm_crc32_u64(crc64, value);
+    data += 8;
+    size -= 8;
+  }
+  crc = static_cast<uint32_t>(crc64);
+  while (size--) crc = _mm_crc32_u8(crc, *data++);
+  return crc;
+}
+#elif FIREBASE_STORAGE_CRC32C_ARM64
+bool HasCrc32Instructions() { return true; }
+
+uint32_t Crc32cHardware(uint32_t crc, const uint8_t* data, size_t size) {
+  while (size >= 8) {
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    crc = __crc32cd(crc, value);
+    data += 8;
+    size -= 8;
+  }
+  while (size--) crc = __crc32cb(crc, *data++);
+  return crc;
+}
+#endif  // FIREBASE_STORAGE_CRC32C_SSE42
+
+// Returns whether the base64 encoded expected value is the same as the size
+// bytes in actual.
+bool MatchesBase64(const std::string& expected, const uint8_t* actual,
+                   size_t size) {
+  std::string decoded;
+  return firebase::internal::Base64Decode(expected, &decoded) &&
+         decoded.size() == size && memcmp(decoded.data(), actual, size) == 0;
+}
+
+}  // namespace
+
+uint32_t Crc32c(uint32_t crc, const void* data, size_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  crc = ~crc;
+#if FIREBASE_STORAGE_CRC32C_SSE42 || FIREBASE_STORAGE_CRC32C_ARM64
+  static const bool has_crc32_instructions = HasCrc32Instructions();
+  if (has_crc32_instructions) return ~Crc32cHardware(crc, bytes, size);
+#endif  // FIREBASE_STORAGE_CRC32C_SSE42 || FIREBASE_STORAGE_CRC32C_ARM64
+  return ~Crc32cSoftware(crc, bytes, size);
+}
+
+Md5::Md5() : context_(EVP_MD_CTX_new()) {
+  EVP_DigestInit_ex(context_, EVP_md5(), nullptr);
+}
+
+Md5::Md5(const Md5& other) : context_(EVP_MD_CTX_new()) {
+  EVP_MD_CTX_copy_ex(context_, other.context_);
+}
+
+Md5& Md5::operator=(const Md5& other) {
+  if (this != &other) EVP_MD_CTX_copy_ex(context_, other.context_);
+  return *this;
+}
+
+Md5::~Md5() { EVP_MD_CTX_free(context_); }
+
+void Md5::Update(const void* data, size_t size) {
+  EVP_DigestUpdate(context_, data, size);
+}
+
+void Md5::Finish(uint8_t digest[kDigestSize]) const {
+  // Finishing resets the context, so finish a copy to allow more data to be
+  // added.
+  Md5 md5(*this);
+  unsigned int digest_size = kDigestSize;
+  EVP_DigestFinal_ex(md5.context_, digest, &digest_size);
+}
+
+void TransferChecksum::Start(int types) {
+  types_ = types;
+  crc32c_ = 0;
+  md5_ = Md5();
+}
+
+bool TransferChecksum::Matches(const std::string& expected_crc32c,
+                               const std::string& expected_md5) const {
+  if ((types_ & kTypeCrc32c) && !expected_crc32c.empty()) {
+    // The server reports the CRC32C in big-endian byte order.
+    uint8_t crc32c[4] = {static_cast<uint8_t>(crc32c_ >> 24),
+                         static_cast<uint8_t>(crc32c_ >> 16),
+                         static_cast<uint8_t>(crc32c_ >> 8),
+                         static_cast<uint8_t>(crc32c_)};
+    if (!MatchesBase64(expected_crc32c, crc32c, sizeof(crc32c))) return false;
+  }
+  if ((types_ & kTypeMd5) && !expected_md5.empty()) {
+    uint8_t md5[Md5::kDigestSize];
+    md5_.Finish(md5);
+    if (!MatchesBase64(expected_md5, md5, sizeof(md5))) return false;
+  }
+  return true;
+}
+
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
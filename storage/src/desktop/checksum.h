@@ -0,0 +1,96 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_STORAGE_SRC_DESKTOP_CHECKSUM_H_
+#define FIREBASE_STORAGE_SRC_DESKTOP_CHECKSUM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "openssl/evp.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+// Update crc, the CRC32C (Castagnoli) of the data so far, with size bytes of
+// data. Uses the CRC32 instructions of the CPU when they're available.
+uint32_t Crc32c(uint32_t crc, const void* data, size_t size);
+
+// Computes the MD5 hash of data with the digest of OpenSSL or BoringSSL.
+class Md5 {
+ public:
+  static const size_t kDigestSize = 16;
+
+  Md5();
+  Md5(const Md5& other);
+  Md5& operator=(const Md5& other);
+  ~Md5();
+
+  // Add size bytes of data to the hash.
+  void Update(const void* data, size_t size);
+
+  // Write the hash of the data added so far to digest.
+  void Finish(uint8_t digest[kDigestSize]) const;
+
+ private:
+  EVP_MD_CTX* context_;
+};
+
+// Computes checksums of the data of an object as it's transferred, so it can
+// be compared with the hashes the server reports for the object without
+// reading the data again.
+class TransferChecksum {
+ public:
+  // Checksums to compute.
+  enum Type {
+    kTypeCrc32c = 1 << 0,
+    kTypeMd5 = 1 << 1,
+  };
+
+  TransferChecksum() : types_(0), crc32c_(0) {}
+
+  // Compute the checksums in types, a combination of Type values, discarding
+  // any data added so far.
+  void Start(int types);
+
+  // Whether any checksum is being computed.
+  bool active() const { return types_ != 0; }
+
+  // Add size bytes of data to the checksums.
+  void Update(const void* data, size_t size) {
+    if (types_ & kTypeCrc32c) crc32c_ = Crc32c(crc32c_, data, size);
+    if (types_ & kTypeMd5) md5_.Update(data, size);
+  }
+
+  // Returns false if a computed checksum doesn't match the base64 encoded
+  // value the server reported, as used by the crc32c and md5Hash fields of
+  // object metadata. Checksums that weren't computed or whose expected value
+  // is empty aren't compared.
+  bool Matches(const std::string& expected_crc32c,
+               const std::string& expected_md5) const;
+
+ private:
+  int types_;
+  uint32_t crc32c_;
+  Md5 md5_;
+};
+
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
+
+#endif  // FIREBASE_STORAGE_SRC_DESKTOP_CHECKSUM_H_
@@ -16,6 +16,8 @@
 
 #include <stdio.h>
 
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <string>
 
@@ -37,6 +39,102 @@ static const char* kInvalidJsonResponse =
     "The server did not return a valid JSON response.  "
     "Contact Firebase support if this issue persists.";
 
+static const char* kNonMatchingChecksum =
+    "The checksum of the transferred data does not match the hash reported "
+    "by the server.";
+
+static const char* kCouldNotWriteFile = "Could not write file.";
+
+static const int kHttpPartialContent = 206;
+static const int kHttpNotModified = 304;
+static const int kHttpRangeNotSatisfiable = 416;
+
+// Get a response header, which may have been sent in lower case by an HTTP/2
+// server.
+static const char* GetResponseHeader(rest::Response* response,
+                                     const char* name,
+                                     const char* lower_case_name) {
+  const char* value = response->GetHeader(name);
+  return value ? value : response->GetHeader(lower_case_name);
+}
+
+// Read the base64 encoded CRC32C and MD5 hash of the body of a successful
+// download from its X-Goog-Hash header, a list of hashes such as
+// "crc32c=n03x6A==,md5=Ojk9c3d...". The hashes are left empty if they aren't
+// reported or describe the stored data rather than the body, which is the
+// case when the server decompresses an object stored with gzip encoding.
+static void GetObjectHashes(rest::Response* response, std::string* crc32c,
+                            std::string* md5) {
+  const char* stored_encoding =
+      GetResponseHeader(response, "X-Goog-Stored-Content-Encoding",
+                        "x-goog-stored-content-encoding");
+  if (stored_encoding && strcmp(stored_encoding, "identity") != 0) return;
+  const char* hashes =
+      GetResponseHeader(response, "X-Goog-Hash", "x-goog-hash");
+  if (!hashes) return;
+  std::string value(hashes);
+  std::string* outputs[] = {crc32c, md5};
+  const char* names[] = {"crc32c=", "md5="};
+  for (int i = 0; i < 2; ++i) {
+    size_t start = value.find(names[i]);
+    if (start == std::string::npos) continue;
+    start += strlen(names[i]);
+    *outputs[i] = value.substr(start, value.find(',', start) - start);
+  }
+}
+
+// Returns whether the body of a successful response is complete, where
+// body_size bytes were received.
+static bool IsBodyComplete(rest::Response* response, size_t body_size) {
+  const char* content_length =
+      GetResponseHeader(response, "Content-Length", "content-length");
+  return content_length && strtoull(content_length, nullptr, 10) == body_size;
+}
+
+// Read the version of the object downloaded by a successful response with
+// body_size bytes of body into *entry. Returns false if the body is
+// incomplete.
+static bool GetDownloadCacheEntry(rest::Response* response, size_t body_size,
+                                  DownloadCache::Entry* entry) {
+  if (!IsBodyComplete(response, body_size)) return false;
+  entry->size = body_size;
+  const char* etag = GetResponseHeader(response, "ETag", "etag");
+  if (etag) entry->etag = etag;
+  const char* generation =
+      GetResponseHeader(response, "X-Goog-Generation", "x-goog-generation");
+  if (generation) entry->generation = strtoll(generation, nullptr, 10);
+  std::string crc32c;
+  GetObjectHashes(response, &crc32c, &entry->md5_hash);
+  return true;
+}
+
+// Start computing the checksum of the body of a successful download, choosing
+// a hash reported by the server. CRC32C is preferred as it's much cheaper to
+// compute than MD5.
+static void StartDownloadChecksum(rest::Response* response,
+                                  TransferChecksum* checksum) {
+  std::string crc32c;
+  std::string md5;
+  GetObjectHashes(response, &crc32c, &md5);
+  checksum->Start(!crc32c.empty() ? TransferChecksum::kTypeCrc32c
+                  : !md5.empty()  ? TransferChecksum::kTypeMd5
+                                  : 0);
+}
+
+// Returns true if the complete body of a successful download, body_size bytes
+// with checksum, doesn't match the hashes reported by the server.
+static bool DownloadChecksumMismatch(rest::Response* response,
+                                     size_t body_size,
+                                     const TransferChecksum& checksum) {
+  if (!checksum.active() || !IsBodyComplete(response, body_size)) {
+    return false;
+  }
+  std::string crc32c;
+  std::string md5;
+  GetObjectHashes(response, &crc32c, &md5);
+  return !checksum.Matches(crc32c, md5);
+}
+
 // Utility function to map HTTP status requests onto Firebase Error Codes.
 // Note that the mapping is not 1:1, so not all Firebase error codes can be
 // returned.  (A lot of them end up as kErrorUnknown, due to ambiguity.)
@@ -123,21 +221,63 @@ bool StorageNetworkError::Parse(const char* json_txt) {
   return true;
 }
 
+RequestUploadSource::RequestUploadSource(UploadSource* source)
+    : source_(source) {
+  options_.stream_post_fields = true;
+}
+
+void RequestUploadSource::MarkCompleted() {
+  notifier_.NotifyProgress();
+  notifier_.NotifyComplete();
+  rest::Request::MarkCompleted();
+}
+
+void RequestUploadSource::MarkFailed() {
+  notifier_.NotifyProgress();
+  notifier_.NotifyFailed();
+  rest::Request::MarkFailed();
+}
+
+size_t RequestUploadSource::GetPostFieldsSize() const {
+  int64_t size = source_->TotalByteCount();
+  return size >= 0 ? static_cast<size_t>(size) : ~static_cast<size_t>(0);
+}
+
+size_t RequestUploadSource::ReadBody(char* buffer, size_t length,
+                                     bool* abort) {
+  size_t read_size = 0;
+  *abort = !source_->Read(buffer, length, &read_size);
+  if (*abort) return 0;
+  if (checksum_) checksum_->Update(buffer, read_size);
+  notifier_.NotifyProgress();
+  return read_size;
+}
+
 GetBytesResponse::GetBytesResponse(void* buffer, size_t buffer_size,
                                    SafeFutureHandle<size_t> handle,
-                                   ReferenceCountedFutureImpl* ref_future)
+                                   ReferenceCountedFutureImpl* ref_future,
+                                   const DownloadCacheRequest& cache_request)
     : BlockingResponse(handle.get(), ref_future),
       output_buffer_(buffer),
       buffer_size_(buffer_size),
-      buffer_index_(0) {}
+      buffer_index_(0),
+      cache_request_(cache_request),
+      checksum_started_(false) {}
 
 // Since buffer may NOT necessarily end with \0, pass in length.
 bool GetBytesResponse::ProcessBody(const char* buffer, size_t length) {
   size_t bytes_to_copy = (std::min)(length, buffer_size_ - buffer_index_);
 
+  if (!checksum_started_) {
+    checksum_started_ = true;
+    if (status() == rest::util::HttpSuccess) {
+      StartDownloadChecksum(this, &checksum_);
+    }
+  }
   if (bytes_to_copy) {
     memcpy(static_cast<char*>(output_buffer_) + buffer_index_, buffer,
            bytes_to_copy);
+    if (checksum_.active()) checksum_.Update(buffer, bytes_to_copy);
     buffer_index_ += bytes_to_copy;
     NotifyProgress();
     return true;
@@ -150,7 +290,36 @@ bool GetBytesResponse::ProcessBody(const char* buffer, size_t length) {
 void GetBytesResponse::MarkCompleted() {
   BlockingResponse::MarkCompleted();
   SafeFutureHandle<size_t> handle(handle_);
-  if (status() == rest::util::HttpSuccess) {
+  bool checksum_mismatch =
+      status() == rest::util::HttpSuccess &&
+      DownloadChecksumMismatch(this, buffer_index_, checksum_);
+  DownloadCache* cache = cache_request_.cache.get();
+  if (cache && status() == kHttpNotModified) {
+    uint64_t size;
+    if (cache->CopyToBuffer(cache_request_.key, cache_request_.etag,
+                            output_buffer_, buffer_size_, &size)) {
+      set_status(rest::util::HttpSuccess);
+      buffer_index_ = static_cast<size_t>(size);
+    } else {
+      // The cached object is no longer available, report a retryable status
+      // so the object is downloaded again.
+      set_status(rest::util::HttpRequestTimeout);
+    }
+  } else if (cache && status() == rest::util::HttpSuccess &&
+             !checksum_mismatch) {
+    // An object that didn't fit in the buffer isn't cached.
+    DownloadCache::Entry entry;
+    if (GetDownloadCacheEntry(this, buffer_index_, &entry)) {
+      cache->StoreBuffer(cache_request_.key, entry, output_buffer_,
+                         buffer_index_);
+    }
+  } else if (cache && status() == rest::util::HttpNotFound) {
+    cache->Remove(cache_request_.key);
+  }
+  if (checksum_mismatch) {
+    ref_future_->Complete(handle, kErrorNonMatchingChecksum,
+                          kNonMatchingChecksum);
+  } else if (status() == rest::util::HttpSuccess) {
     ref_future_->CompleteWithResult(handle, kErrorNone, buffer_index_);
   } else {
     StorageNetworkError response;
@@ -197,26 +366,45 @@ void EmptyResponse::MarkCompleted() {
 
 GetFileResponse::GetFileResponse(const char* filename,
                                  SafeFutureHandle<size_t> handle,
-                                 ReferenceCountedFutureImpl* ref_future)
+                                 ReferenceCountedFutureImpl* ref_future,
+                                 const DownloadCacheRequest& cache_request,
+                                 uint64_t direct_io_size)
     : BlockingResponse(handle.get(), ref_future),
       filename_(filename),
-      bytes_written_(0) {}
+      file_(filename_),
+      direct_io_size_(direct_io_size),
+      write_failed_(false),
+      bytes_written_(0),
+      cache_request_(cache_request),
+      checksum_started_(false) {}
 
 // Since buffer may NOT necessarily end with \0, pass in length.
 bool GetFileResponse::ProcessBody(const char* buffer, size_t length) {
   // Things are fine, send the received data to a file.
   if (status() == rest::util::HttpSuccess) {
-    if (!file_.is_open()) {
-      // Writing in binary mode prevents Windows from converting characters such
-      // as "\n" to "\r\n".
-      file_.open(filename_, std::ios::out | std::ios::binary);
+    if (!file_.is_open() && !write_failed_) {
+      // Allocate space for the whole object up front.
+      const char* content_length =
+          GetResponseHeader(this, "Content-Length", "content-length");
+      write_failed_ = !file_.Open(
+          content_length ? strtoll(content_length, nullptr, 10) : -1,
+          direct_io_size_);
+    }
+    if (!checksum_started_) {
+      checksum_started_ = true;
+      StartDownloadChecksum(this, &checksum_);
+    }
+    if (write_failed_ || !file_.Write(buffer, length)) {
+      // Abort the download.
+      write_failed_ = true;
+      return false;
     }
-    file_.write(buffer, length);
+    if (checksum_.active()) checksum_.Update(buffer, length);
     bytes_written_ += length;
   } else {
     // Things are not fine.  Send to a buffer so we can parse the error
     // response later.
-    error_buffer_.append(buffer);
+    error_buffer_.append(buffer, length);
   }
   NotifyProgress();
   return true;
@@ -225,8 +413,53 @@ bool GetFileResponse::ProcessBody(const char* buffer, size_t length) {
 void GetFileResponse::MarkCompleted() {
   BlockingResponse::MarkCompleted();
   SafeFutureHandle<size_t> future_handle_with_size(handle_);
-  if (status() == rest::util::HttpSuccess) {
-    file_.close();
+  bool checksum_mismatch =
+      status() == rest::util::HttpSuccess && !write_failed_ &&
+      DownloadChecksumMismatch(this, bytes_written_, checksum_);
+  DownloadCache* cache = cache_request_.cache.get();
+  if (cache && status() == kHttpNotModified) {
+    uint64_t size;
+    if (cache->CopyToFile(cache_request_.key, cache_request_.etag,
+                          file_.temp_path(), &size) &&
+        file_.Commit()) {
+      set_status(rest::util::HttpSuccess);
+      bytes_written_ = static_cast<size_t>(size);
+    } else {
+      // The cached object is no longer available, report a retryable status
+      // so the object is downloaded again.
+      file_.Discard();
+      set_status(rest::util::HttpRequestTimeout);
+    }
+  } else if (status() == rest::util::HttpSuccess && !write_failed_ &&
+             !checksum_mismatch) {
+    const char* content_length =
+        GetResponseHeader(this, "Content-Length", "content-length");
+    if (content_length &&
+        strtoull(content_length, nullptr, 10) != bytes_written_) {
+      // The connection was lost before the whole object was received, report
+      // a retryable status rather than replacing the file with part of it.
+      set_status(rest::util::HttpRequestTimeout);
+    } else if ((!file_.is_open() && !file_.Open(0)) || !file_.Commit()) {
+      write_failed_ = true;
+    } else if (cache) {
+      DownloadCache::Entry entry;
+      if (GetDownloadCacheEntry(this, bytes_written_, &entry)) {
+        cache->StoreFile(cache_request_.key, entry, filename_);
+      }
+    }
+  } else if (cache && status() == rest::util::HttpNotFound) {
+    cache->Remove(cache_request_.key);
+  }
+  // Anything written by a download that failed is removed.
+  if (file_.is_open()) file_.Discard();
+  if (write_failed_) {
+    ref_future_->CompleteWithResult(future_handle_with_size, kErrorUnknown,
+                                    kCouldNotWriteFile, bytes_written_);
+  } else if (checksum_mismatch) {
+    ref_future_->CompleteWithResult(future_handle_with_size,
+                                    kErrorNonMatchingChecksum,
+                                    kNonMatchingChecksum, bytes_written_);
+  } else if (status() == rest::util::HttpSuccess) {
     ref_future_->CompleteWithResult(future_handle_with_size, kErrorNone,
                                     bytes_written_);
   } else {
@@ -246,11 +479,123 @@ void GetFileResponse::MarkCompleted() {
   BlockingResponse::NotifyComplete();
 }
 
+DownloadSinkResponse::DownloadSinkResponse(
+    DownloadSink* sink, const std::shared_ptr<size_t>& bytes_delivered,
+    SafeFutureHandle<size_t> handle, ReferenceCountedFutureImpl* ref_future)
+    : BlockingResponse(handle.get(), ref_future),
+      sink_(sink),
+      bytes_delivered_(bytes_delivered),
+      skip_(*bytes_delivered),
+      bytes_received_(0),
+      sink_failed_(false) {}
+
+// Since buffer may NOT necessarily end with \0, pass in length.
+bool DownloadSinkResponse::ProcessBody(const char* buffer, size_t length) {
+  if (status() != rest::util::HttpSuccess &&
+      status() != kHttpPartialContent) {
+    error_buffer_.append(buffer, length);
+    return true;
+  }
+  bytes_received_ += length;
+  // A full response repeats the data delivered by earlier attempts.
+  if (status() == rest::util::HttpSuccess && skip_) {
+    size_t skip = (std::min)(skip_, length);
+    skip_ -= skip;
+    buffer += skip;
+    length -= skip;
+  }
+  if (length) {
+    if (!sink_->Write(buffer, length)) {
+      sink_failed_ = true;
+      return false;
+    }
+    *bytes_delivered_ += length;
+  }
+  NotifyProgress();
+  return true;
+}
+
+void DownloadSinkResponse::MarkCompleted() {
+  BlockingResponse::MarkCompleted();
+  SafeFutureHandle<size_t> future_handle_with_size(handle_);
+  const char* content_length = GetHeader("Content-Length");
+  if (!content_length) content_length = GetHeader("content-length");
+  bool succeeded = status() == rest::util::HttpSuccess ||
+                   status() == kHttpPartialContent;
+  if (succeeded && !sink_failed_ && content_length &&
+      strtoull(content_length, nullptr, 10) != bytes_received_) {
+    // The connection was lost before the whole body was received, report a
+    // retryable status so the rest of the object is requested.
+    set_status(rest::util::HttpRequestTimeout);
+    succeeded = false;
+  }
+  if (sink_failed_) {
+    ref_future_->CompleteWithResult(future_handle_with_size, kErrorCancelled,
+                                    "The download was stopped by the sink.",
+                                    *bytes_delivered_);
+  } else if (succeeded || (status() == kHttpRangeNotSatisfiable &&
+                           *bytes_delivered_ > 0)) {
+    // A range that isn't satisfiable means an earlier attempt delivered the
+    // whole object before it failed.
+    ref_future_->CompleteWithResult(future_handle_with_size, kErrorNone,
+                                    *bytes_delivered_);
+  } else {
+    StorageNetworkError response;
+    if (response.Parse(error_buffer_.c_str())) {
+      ref_future_->CompleteWithResult(
+          future_handle_with_size, HttpToErrorCode(status()),
+          response.error_message().c_str(), *bytes_delivered_);
+    } else {
+      ref_future_->CompleteWithResult(future_handle_with_size,
+                                      HttpToErrorCode(status()),
+                                      kInvalidJsonResponse, *bytes_delivered_);
+    }
+  }
+  NotifyProgress();
+  BlockingResponse::NotifyComplete();
+}
+
+DownloadedFileResponse::DownloadedFileResponse(
+    SafeFutureHandle<size_t> handle, ReferenceCountedFutureImpl* ref_future)
+    : BlockingResponse(handle.get(), ref_future) {}
+
+bool DownloadedFileResponse::ProcessBody(const char* buffer, size_t length) {
+  error_buffer_.append(buffer, length);
+  return true;
+}
+
+void DownloadedFileResponse::MarkCompleted() {
+  BlockingResponse::MarkCompleted();
+  SafeFutureHandle<size_t> future_handle_with_size(handle_);
+  if (status() == rest::util::HttpSuccess) {
+    const char* content_length = GetHeader("Content-Length");
+    size_t bytes_written =
+        content_length ? strtoull(content_length, nullptr, 10) : 0;
+    ref_future_->CompleteWithResult(future_handle_with_size, kErrorNone,
+                                    bytes_written);
+  } else {
+    StorageNetworkError response;
+    if (response.Parse(error_buffer_.c_str())) {
+      ref_future_->CompleteWithResult(
+          future_handle_with_size, HttpToErrorCode(status()),
+          response.error_message().c_str(), static_cast<size_t>(0));
+    } else {
+      ref_future_->CompleteWithResult(
+          future_handle_with_size, HttpToErrorCode(status()),
+          kInvalidJsonResponse, static_cast<size_t>(0));
+    }
+  }
+  NotifyProgress();
+  BlockingResponse::NotifyComplete();
+}
+
 ReturnedMetadataResponse::ReturnedMetadataResponse(
     SafeFutureHandle<Metadata> handle, ReferenceCountedFutureImpl* ref_future,
-    const StorageReference& storage_reference)
+    const StorageReference& storage_reference,
+    const std::shared_ptr<TransferChecksum>& upload_checksum)
     : BlockingResponse(handle.get(), ref_future),
-      storage_reference_(storage_reference) {}
+      storage_reference_(storage_reference),
+      upload_checksum_(upload_checksum) {}
 
 bool ReturnedMetadataResponse::ProcessBody(const char* buffer, size_t length) {
   buffer_ += std::string(buffer, length);
@@ -264,13 +609,19 @@ void ReturnedMetadataResponse::MarkCompleted() {
   if (status() == rest::util::HttpSuccess) {
     MetadataInternal* metadata_internal =
         new MetadataInternal(storage_reference_);
-    if (metadata_internal->ImportFromJson(buffer_.c_str())) {
-      ref_future_->CompleteWithResult(
-          handle, kErrorNone, MetadataInternal::AsMetadata(metadata_internal));
-    } else {
+    if (!metadata_internal->ImportFromJson(buffer_.c_str())) {
       // The HTTP request was successful, but it returned invalid metadata JSON.
       ref_future_->Complete(handle, kErrorUnknown, kInvalidJsonResponse);
       delete metadata_internal;
+    } else if (upload_checksum_ &&
+               !upload_checksum_->Matches(metadata_internal->crc32c(),
+                                          metadata_internal->md5_hash())) {
+      ref_future_->Complete(handle, kErrorNonMatchingChecksum,
+                            kNonMatchingChecksum);
+      delete metadata_internal;
+    } else {
+      ref_future_->CompleteWithResult(
+          handle, kErrorNone, MetadataInternal::AsMetadata(metadata_internal));
     }
   } else {
     StorageNetworkError response;
@@ -286,6 +637,21 @@ void ReturnedMetadataResponse::MarkCompleted() {
   BlockingResponse::NotifyComplete();
 }
 
+UploadWithMetadataResponse::UploadWithMetadataResponse(
+    SafeFutureHandle<Metadata> handle, ReferenceCountedFutureImpl* ref_future,
+    const StorageReference& storage_reference, bool* request_rejected,
+    const std::shared_ptr<TransferChecksum>& upload_checksum)
+    : ReturnedMetadataResponse(handle, ref_future, storage_reference,
+                               upload_checksum),
+      request_rejected_(request_rejected) {}
+
+void UploadWithMetadataResponse::MarkCompleted() {
+  if (request_rejected_ && status() == rest::util::HttpBadRequest) {
+    *request_rejected_ = true;
+  }
+  ReturnedMetadataResponse::MarkCompleted();
+}
+
 ReturnedListResponse::ReturnedListResponse(
     SafeFutureHandle<StorageListResult> handle,
     ReferenceCountedFutureImpl* ref_future, StorageInternal* storage)
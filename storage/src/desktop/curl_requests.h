@@ -15,22 +15,28 @@
 #ifndef FIREBASE_STORAGE_SRC_DESKTOP_CURL_REQUESTS_H_
 #define FIREBASE_STORAGE_SRC_DESKTOP_CURL_REQUESTS_H_
 
-#include <fstream>
+#include <memory>
+#include <string>
 
 #include "app/rest/request_binary.h"
 #include "app/rest/request_file.h"
+#include "app/rest/request_multipart.h"
 #include "app/rest/response_binary.h"
 #include "app/rest/transport_builder.h"
 #include "app/rest/util.h"
 #include "app/src/include/firebase/internal/mutex.h"
 #include "app/src/reference_counted_future_impl.h"
 #include "app/src/semaphore.h"
+#include "storage/src/desktop/checksum.h"
+#include "storage/src/desktop/download_cache.h"
+#include "storage/src/desktop/download_file.h"
 #include "storage/src/desktop/listener_desktop.h"
 #include "storage/src/desktop/storage_desktop.h"
 #include "storage/src/include/firebase/storage/common.h"
 #include "storage/src/include/firebase/storage/controller.h"
 #include "storage/src/include/firebase/storage/listener.h"
 #include "storage/src/include/firebase/storage/storage_reference.h"
+#include "storage/src/include/firebase/storage/stream.h"
 
 namespace firebase {
 namespace storage {
@@ -91,10 +97,15 @@ class Notifier {
   void* update_callback_data_;
 };
 
-// Generates the common body of a request class.
+// Generates the common body of a request class. If a checksum is set the
+// body is added to it as it's read.
 #define FIREBASE_STORAGE_REQUEST_CLASS_BODY(base_class_name)             \
   Notifier* notifier() { return &notifier_; }                            \
                                                                          \
+  void set_checksum(const std::shared_ptr<TransferChecksum>& checksum) { \
+    checksum_ = checksum;                                                \
+  }                                                                      \
+                                                                         \
   void MarkCompleted() override {                                        \
     notifier_.NotifyProgress();                                          \
     notifier_.NotifyComplete();                                          \
@@ -109,11 +120,13 @@ class Notifier {
                                                                          \
   size_t ReadBody(char* buffer, size_t length, bool* abort) override {   \
     size_t read_size = base_class_name::ReadBody(buffer, length, abort); \
+    if (checksum_) checksum_->Update(buffer, read_size);                 \
     notifier_.NotifyProgress();                                          \
     return read_size;                                                    \
   }                                                                      \
                                                                          \
  protected:                                                              \
+  std::shared_ptr<TransferChecksum> checksum_;                           \
   Notifier notifier_
 
 // Base request.
@@ -186,6 +199,45 @@ class BlockingResponse : public rest::Response {
   ReferenceCountedFutureImpl* ref_future_;
 };
 
+// Sends metadata JSON followed by the body of content as a multipart/related
+// request.
+class RequestMultipart : public rest::RequestMultipart {
+ public:
+  RequestMultipart(const std::string& json, const char* content_type,
+                   rest::Request* content)
+      : rest::RequestMultipart(json, content_type, content) {}
+
+  FIREBASE_STORAGE_REQUEST_CLASS_BODY(rest::RequestMultipart);
+};
+
+// Reads the body from an UploadSource as it's sent.
+class RequestUploadSource : public rest::Request {
+ public:
+  explicit RequestUploadSource(UploadSource* source);
+
+  Notifier* notifier() { return &notifier_; }
+
+  // Add the data read from the source to checksum.
+  void set_checksum(const std::shared_ptr<TransferChecksum>& checksum) {
+    checksum_ = checksum;
+  }
+
+  void MarkCompleted() override;
+  void MarkFailed() override;
+
+  // Returns the size of the source, or ~0 if it's unknown.
+  size_t GetPostFieldsSize() const override;
+
+  // Read the next part of the body from the source, aborting the request if
+  // the source fails.
+  size_t ReadBody(char* buffer, size_t length, bool* abort) override;
+
+ private:
+  UploadSource* source_;
+  std::shared_ptr<TransferChecksum> checksum_;
+  Notifier notifier_;
+};
+
 // Response class for operations that don't return any data.  (i. e. delete.)
 class EmptyResponse : public BlockingResponse {
  public:
@@ -202,11 +254,15 @@ class EmptyResponse : public BlockingResponse {
 };
 
 // Response class for downloading a storage resource into memory, via CURL.
+// The download fails with kErrorNonMatchingChecksum if the data doesn't match
+// a hash in the X-Goog-Hash header of the response.
 class GetBytesResponse : public BlockingResponse {
  public:
   GetBytesResponse(void* buffer, size_t buffer_size,
                    SafeFutureHandle<size_t> handle,
-                   ReferenceCountedFutureImpl* ref_future);
+                   ReferenceCountedFutureImpl* ref_future,
+                   const DownloadCacheRequest& cache_request =
+                       DownloadCacheRequest());
   bool ProcessBody(const char* buffer, size_t length) override;
   void MarkCompleted() override;
 
@@ -214,38 +270,120 @@ class GetBytesResponse : public BlockingResponse {
   void* output_buffer_;
   size_t buffer_size_;
   size_t buffer_index_;
+  DownloadCacheRequest cache_request_;
+  // Checksum of the body of a successful response.
+  TransferChecksum checksum_;
+  bool checksum_started_;
 };
 
 // Response for downloading a storage resource directly into a file.
 // Primarily useful because it doesn't have to fit in memory - the pieces get
-// shoved into an fstream as they are received.
+// written to a DownloadFile as they are received, which only replaces the
+// file once the whole object has been received. Space for the object is
+// allocated from its Content-Length, and objects of at least direct_io_size
+// bytes are written with direct I/O if direct_io_size isn't 0.
+// The data is checked against the X-Goog-Hash header like GetBytesResponse.
 class GetFileResponse : public BlockingResponse {
  public:
   GetFileResponse(const char* filename, SafeFutureHandle<size_t> handle,
-                  ReferenceCountedFutureImpl* ref_future);
+                  ReferenceCountedFutureImpl* ref_future,
+                  const DownloadCacheRequest& cache_request =
+                      DownloadCacheRequest(),
+                  uint64_t direct_io_size = 0);
   bool ProcessBody(const char* buffer, size_t length) override;
   void MarkCompleted() override;
 
+  // File the body is written to.
+  const DownloadFile& file() const { return file_; }
+
  private:
   std::string filename_;
   std::string error_buffer_;
-  std::fstream file_;
+  DownloadFile file_;
+  uint64_t direct_io_size_;
+  // Whether the file couldn't be created or written.
+  bool write_failed_;
   size_t bytes_written_;
+  DownloadCacheRequest cache_request_;
+  // Checksum of the body of a successful response.
+  TransferChecksum checksum_;
+  bool checksum_started_;
+};
+
+// Response for downloading a storage resource into a DownloadSink as the data
+// is received. *bytes_delivered counts the bytes passed to the sink by all
+// attempts of the download, a retry requests the rest of the object with a
+// Range header and any data the sink already has is skipped.
+class DownloadSinkResponse : public BlockingResponse {
+ public:
+  DownloadSinkResponse(DownloadSink* sink,
+                       const std::shared_ptr<size_t>& bytes_delivered,
+                       SafeFutureHandle<size_t> handle,
+                       ReferenceCountedFutureImpl* ref_future);
+  bool ProcessBody(const char* buffer, size_t length) override;
+  void MarkCompleted() override;
+
+ private:
+  DownloadSink* sink_;
+  std::shared_ptr<size_t> bytes_delivered_;
+  // Bytes of a full response to skip as the sink already has them.
+  size_t skip_;
+  // Bytes of the body received by this attempt.
+  size_t bytes_received_;
+  bool sink_failed_;
+  std::string error_buffer_;
+};
+
+// Response for a download whose data is written to a file by the transport,
+// such as a ParallelDownloadTransport. The size of the file is read from the
+// Content-Length header of a successful response.
+class DownloadedFileResponse : public BlockingResponse {
+ public:
+  DownloadedFileResponse(SafeFutureHandle<size_t> handle,
+                         ReferenceCountedFutureImpl* ref_future);
+  bool ProcessBody(const char* buffer, size_t length) override;
+  void MarkCompleted() override;
+
+ private:
+  std::string error_buffer_;
 };
 
 // Response for any operation that returns a blob of text that we need
 // to interpret as metadata.
+// If upload_checksum is set it holds the checksum of the data uploaded by the
+// request, which must match the hashes in the returned metadata.
 class ReturnedMetadataResponse : public BlockingResponse {
  public:
   ReturnedMetadataResponse(SafeFutureHandle<Metadata> handle,
                            ReferenceCountedFutureImpl* ref_future,
-                           const StorageReference& storage_reference);
+                           const StorageReference& storage_reference,
+                           const std::shared_ptr<TransferChecksum>&
+                               upload_checksum = nullptr);
   bool ProcessBody(const char* buffer, size_t length) override;
   void MarkCompleted() override;
 
  private:
   std::string buffer_;
   StorageReference storage_reference_;
+  std::shared_ptr<TransferChecksum> upload_checksum_;
+};
+
+// Response to an upload that sends metadata with the object data.
+// If the backend rejects the request as malformed and request_rejected is not
+// null, *request_rejected is set before the future completes so the caller
+// can fall back to uploading the data and metadata separately.
+class UploadWithMetadataResponse : public ReturnedMetadataResponse {
+ public:
+  UploadWithMetadataResponse(SafeFutureHandle<Metadata> handle,
+                             ReferenceCountedFutureImpl* ref_future,
+                             const StorageReference& storage_reference,
+                             bool* request_rejected,
+                             const std::shared_ptr<TransferChecksum>&
+                                 upload_checksum = nullptr);
+  void MarkCompleted() override;
+
+ private:
+  bool* request_rejected_;
 };
 
 // Response for any operation that returns a blob of text that we need
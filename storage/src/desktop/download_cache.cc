@@ -0,0 +1,462 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "storage/src/desktop/download_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "app/src/filesystem.h"
+#include "app/src/include/firebase/internal/platform.h"
+#include "app/src/log.h"
+#include "storage/src/desktop/file_util.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+namespace {
+
+const char kDownloadCacheDir[] = "storage_cache";
+const char kIndexFileName[] = "index";
+const char kBlobFileExtension[] = ".blob";
+const char kTempFileExtension[] = ".tmp";
+// Changed whenever the format of the index file changes, an index with a
+// different version is discarded.
+const char kIndexVersion[] = "2";
+// Types of the records in the index.
+const char kIndexEntryRecord[] = "+";
+const char kIndexRemoveRecord[] = "-";
+// The index isn't rewritten until it has at least this many records.
+const size_t kMinIndexRecordsToCompact = 256;
+const size_t kCopyBufferSize = 64 * 1024;
+
+// Copy the file at from to the file at to, returning the number of bytes
+// copied or -1 if an error occurred.
+int64_t CopyFileData(const std::string& from, const std::string& to) {
+  std::ifstream input(ToFilePath(from), std::ios::in | std::ios::binary);
+  if (!input) return -1;
+  std::ofstream output(ToFilePath(to),
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!output) return -1;
+  std::vector<char> buffer(kCopyBufferSize);
+  int64_t copied = 0;
+  while (input) {
+    input.read(buffer.data(), buffer.size());
+    std::streamsize read = input.gcount();
+    if (read <= 0) break;
+    if (!output.write(buffer.data(), read)) return -1;
+    copied += read;
+  }
+  if (input.bad()) return -1;
+  output.close();
+  return output ? copied : -1;
+}
+
+std::string ToHex(uint64_t value) {
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016llx",
+           static_cast<unsigned long long>(value));  // NOLINT
+  return std::string(hex);
+}
+
+}  // namespace
+
+DownloadCache::DownloadCache(const std::string& directory, uint64_t max_size)
+    : directory_(directory),
+      max_size_(max_size),
+      size_(0),
+      temp_file_count_(0),
+      index_records_(0),
+      lru_changed_(false) {
+  MutexLock lock(mutex_);
+  LoadIndex();
+  Evict();
+}
+
+DownloadCache::~DownloadCache() {
+  // Entries used since the index was last rewritten are recorded so the least
+  // recently used order is preserved.
+  MutexLock lock(mutex_);
+  if (lru_changed_ || index_records_ != entries_.size()) SaveIndex();
+}
+
+std::string DownloadCache::GetKey(const std::string& bucket,
+                                  const std::string& path) {
+  // Object names can't contain a line feed, so this can't be ambiguous.
+  return bucket + "\n" + path;
+}
+
+bool DownloadCache::Lookup(const std::string& key, Entry* entry) {
+  MutexLock lock(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) return false;
+  *entry = it->second.entry;
+  return true;
+}
+
+bool DownloadCache::CopyToFile(const std::string& key, const std::string& etag,
+                               const std::string& path, uint64_t* size) {
+  std::string blob;
+  uint64_t blob_size;
+  if (!AcquireData(key, etag, &blob, &blob_size)) return false;
+  int64_t copied = CopyFileData(GetPath(blob), path);
+  bool read = copied >= 0 && static_cast<uint64_t>(copied) == blob_size;
+  ReleaseData(key, blob, read);
+  if (read) *size = blob_size;
+  return read;
+}
+
+bool DownloadCache::CopyToBuffer(const std::string& key,
+                                 const std::string& etag, void* buffer,
+                                 size_t buffer_size, uint64_t* size) {
+  std::string blob;
+  uint64_t blob_size;
+  if (!AcquireData(key, etag, &blob, &blob_size)) return false;
+  uint64_t to_copy =
+      (std::min)(static_cast<uint64_t>(buffer_size), blob_size);
+  std::ifstream input(ToFilePath(GetPath(blob)),
+                      std::ios::in | std::ios::binary);
+  bool read = input && input.read(static_cast<char*>(buffer),
+                                  static_cast<std::streamsize>(to_copy));
+  input.close();
+  ReleaseData(key, blob, read);
+  if (read) *size = to_copy;
+  return read;
+}
+
+bool DownloadCache::StoreFile(const std::string& key, const Entry& entry,
+                              const std::string& path) {
+  return Store(key, entry, [&path](const std::string& temp_path) {
+    return CopyFileData(path, temp_path);
+  });
+}
+
+bool DownloadCache::StoreBuffer(const std::string& key, const Entry& entry,
+                                const void* buffer, size_t buffer_size) {
+  return Store(key, entry, [buffer, buffer_size](const std::string& temp_path) {
+    std::ofstream output(ToFilePath(temp_path),
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+    output.write(static_cast<const char*>(buffer),
+                 static_cast<std::streamsize>(buffer_size));
+    output.close();
+    return output ? static_cast<int64_t>(buffer_size) : -1;
+  });
+}
+
+bool DownloadCache::AcquireData(const std::string& key,
+                                const std::string& etag, std::string* blob,
+                                uint64_t* size) {
+  MutexLock lock(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end() || it->second.entry.etag != etag) return false;
+  IndexEntry& index_entry = it->second;
+  lru_.splice(lru_.end(), lru_, index_entry.lru_position);
+  lru_changed_ = true;
+  blobs_[index_entry.blob].readers++;
+  *blob = index_entry.blob;
+  *size = index_entry.entry.size;
+  return true;
+}
+
+void DownloadCache::ReleaseData(const std::string& key,
+                                const std::string& blob, bool read) {
+  MutexLock lock(mutex_);
+  if (!read) {
+    LogWarning("Failed to read cached storage object %s", blob.c_str());
+    // Remove the entry unless it was replaced while the data was read.
+    auto it = entries_.find(key);
+    if (it != entries_.end() && it->second.blob == blob) {
+      RemoveEntry(key);
+      AppendToIndex(key, nullptr);
+    }
+  }
+  auto it = blobs_.find(blob);
+  if (it == blobs_.end()) return;
+  it->second.readers--;
+  DeleteBlobIfUnused(it);
+}
+
+bool DownloadCache::Store(
+    const std::string& key, const Entry& entry,
+    const std::function<int64_t(const std::string&)>& write_data) {
+  std::string blob = GetBlobName(key, entry);
+  std::string temp_path;
+  {
+    MutexLock lock(mutex_);
+    // Objects that can't be revalidated or don't fit aren't cached, replacing
+    // any older version of the object.
+    if (entry.etag.empty() || entry.size > max_size_) {
+      if (RemoveEntry(key)) AppendToIndex(key, nullptr);
+      return false;
+    }
+    // Data that is already cached for another object is shared.
+    if (IsCached(blob)) {
+      AddEntry(key, entry, blob);
+      return true;
+    }
+    // Each store writes its own file, as the same data may be stored by
+    // several threads at once.
+    temp_path =
+        GetPath(blob + "." + ToHex(++temp_file_count_) + kTempFileExtension);
+  }
+  int64_t written = write_data(temp_path);
+  MutexLock lock(mutex_);
+  // The data may have been cached by another store while it was written.
+  bool cached = IsCached(blob);
+  if (written < 0 || static_cast<uint64_t>(written) != entry.size ||
+      (!cached && !RenameFile(temp_path, GetPath(blob)))) {
+    LogWarning("Failed to cache storage object %s", blob.c_str());
+    RemoveFile(temp_path);
+    if (RemoveEntry(key)) AppendToIndex(key, nullptr);
+    return false;
+  }
+  if (cached) RemoveFile(temp_path);
+  AddEntry(key, entry, blob);
+  return true;
+}
+
+void DownloadCache::Remove(const std::string& key) {
+  MutexLock lock(mutex_);
+  if (RemoveEntry(key)) AppendToIndex(key, nullptr);
+}
+
+uint64_t DownloadCache::size() {
+  MutexLock lock(mutex_);
+  return size_;
+}
+
+uint64_t DownloadCache::max_size() {
+  MutexLock lock(mutex_);
+  return max_size_;
+}
+
+void DownloadCache::set_max_size(uint64_t max_size) {
+  MutexLock lock(mutex_);
+  max_size_ = max_size;
+  Evict();
+}
+
+std::string DownloadCache::GetBlobName(const std::string& key,
+                                       const Entry& entry) {
+  // Data is addressed by its hash when it's known, otherwise it's specific to
+  // the version of the object.
+  std::stringstream address;
+  if (!entry.md5_hash.empty()) {
+    address << "md5\n" << entry.md5_hash << "\n" << entry.size;
+  } else {
+    address << "etag\n" << key << "\n" << entry.etag << "\n" << entry.size;
+  }
+  return ToHex(HashString(address.str())) + kBlobFileExtension;
+}
+
+std::string DownloadCache::GetPath(const std::string& name) const {
+  return directory_ + "/" + name;
+}
+
+bool DownloadCache::IsCached(const std::string& blob) const {
+  auto it = blobs_.find(blob);
+  return it != blobs_.end() && it->second.references > 0;
+}
+
+void DownloadCache::AddEntry(const std::string& key, const Entry& entry,
+                             const std::string& blob) {
+  // Reference the data before removing the previous entry in case they share
+  // it.
+  if (blobs_[blob].references++ == 0) size_ += entry.size;
+  RemoveEntry(key);
+  IndexEntry& index_entry = entries_[key];
+  index_entry.entry = entry;
+  index_entry.blob = blob;
+  index_entry.lru_position = lru_.insert(lru_.end(), key);
+  AppendToIndex(key, &index_entry);
+  Evict();
+}
+
+bool DownloadCache::RemoveEntry(const std::string& key) {
+  auto it = entries_.find(key);
+  if (it == entries_.end()) return false;
+  lru_.erase(it->second.lru_position);
+  auto blob = blobs_.find(it->second.blob);
+  if (blob != blobs_.end() && --blob->second.references == 0) {
+    size_ -= (std::min)(size_, it->second.entry.size);
+    DeleteBlobIfUnused(blob);
+  }
+  entries_.erase(it);
+  return true;
+}
+
+void DownloadCache::DeleteBlobIfUnused(
+    std::map<std::string, Blob>::iterator blob) {
+  if (blob->second.references > 0 || blob->second.readers > 0) return;
+  RemoveFile(GetPath(blob->first));
+  blobs_.erase(blob);
+}
+
+void DownloadCache::Evict() {
+  while (size_ > max_size_ && !lru_.empty()) {
+    std::string key = lru_.front();
+    RemoveEntry(key);
+    AppendToIndex(key, nullptr);
+  }
+}
+
+void DownloadCache::LoadIndex() {
+  std::ifstream file(ToFilePath(GetPath(kIndexFileName)),
+                     std::ios::in | std::ios::binary);
+  std::string version;
+  if (!file || !std::getline(file, version) || version != kIndexVersion) {
+    // Start a new index.
+    file.close();
+    SaveIndex();
+    return;
+  }
+  // Each record is a sequence of lines, which is unambiguous as none of the
+  // values can contain a line feed. A later record for a key replaces earlier
+  // ones, and entries are recorded from the least to the most recently used.
+  std::map<std::string, IndexEntry> entries;
+  std::list<std::string> lru;
+  std::string type, bucket, path;
+  while (std::getline(file, type) && std::getline(file, bucket) &&
+         std::getline(file, path)) {
+    std::string key = GetKey(bucket, path);
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+      lru.erase(it->second.lru_position);
+      entries.erase(it);
+    }
+    index_records_++;
+    if (type == kIndexRemoveRecord) continue;
+    std::string blob, size, generation, md5_hash, etag;
+    if (type != kIndexEntryRecord || !std::getline(file, blob) ||
+        !std::getline(file, size) || !std::getline(file, generation) ||
+        !std::getline(file, md5_hash) || !std::getline(file, etag)) {
+      break;
+    }
+    IndexEntry& index_entry = entries[key];
+    index_entry.entry.size = strtoull(size.c_str(), nullptr, 10);
+    index_entry.entry.generation = strtoll(generation.c_str(), nullptr, 10);
+    index_entry.entry.md5_hash = md5_hash;
+    index_entry.entry.etag = etag;
+    index_entry.blob = blob;
+    index_entry.lru_position = lru.insert(lru.end(), key);
+  }
+  file.close();
+  for (const std::string& key : lru) {
+    const IndexEntry& index_entry = entries[key];
+    // Skip entries whose data is missing or incomplete.
+    if (index_entry.blob.empty() || index_entry.entry.etag.empty() ||
+        GetFileSize(GetPath(index_entry.blob)) !=
+            static_cast<int64_t>(index_entry.entry.size)) {
+      continue;
+    }
+    if (blobs_[index_entry.blob].references++ == 0) {
+      size_ += index_entry.entry.size;
+    }
+    IndexEntry& loaded = entries_[key];
+    loaded = index_entry;
+    loaded.lru_position = lru_.insert(lru_.end(), key);
+  }
+  if (index_records_ != entries_.size()) SaveIndex();
+}
+
+void DownloadCache::SaveIndex() {
+  std::string temp_path = GetPath(std::string(kIndexFileName) +
+                                  kTempFileExtension);
+  {
+    std::ofstream file(ToFilePath(temp_path),
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+    file << kIndexVersion << "\n";
+    for (const std::string& key : lru_) {
+      const IndexEntry& index_entry = entries_[key];
+      // The key is the bucket and path separated by a line feed.
+      file << kIndexEntryRecord << "\n"
+           << key << "\n"
+           << index_entry.blob << "\n"
+           << index_entry.entry.size << "\n"
+           << index_entry.entry.generation << "\n"
+           << index_entry.entry.md5_hash << "\n"
+           << index_entry.entry.etag << "\n";
+    }
+    file.close();
+    if (!file) {
+      LogWarning("Failed to save storage download cache index to %s",
+                 directory_.c_str());
+      RemoveFile(temp_path);
+      return;
+    }
+  }
+  // Replace the index in one step so an interrupted write doesn't lose it.
+  if (!RenameFile(temp_path, GetPath(kIndexFileName))) {
+    RemoveFile(temp_path);
+    return;
+  }
+  index_records_ = entries_.size();
+  lru_changed_ = false;
+}
+
+void DownloadCache::AppendToIndex(const std::string& key,
+                                  const IndexEntry* entry) {
+  // Rewrite the index instead once most of its records are out of date.
+  if (index_records_ >= kMinIndexRecordsToCompact &&
+      index_records_ >= 2 * entries_.size()) {
+    SaveIndex();
+    return;
+  }
+  std::ofstream file(ToFilePath(GetPath(kIndexFileName)),
+                     std::ios::out | std::ios::binary | std::ios::app);
+  if (entry) {
+    file << kIndexEntryRecord << "\n"
+         << key << "\n"
+         << entry->blob << "\n"
+         << entry->entry.size << "\n"
+         << entry->entry.generation << "\n"
+         << entry->entry.md5_hash << "\n"
+         << entry->entry.etag << "\n";
+  } else {
+    file << kIndexRemoveRecord << "\n" << key << "\n";
+  }
+  file.close();
+  if (!file) {
+    LogWarning("Failed to update storage download cache index in %s",
+               directory_.c_str());
+  }
+  index_records_++;
+}
+
+std::string GetDownloadCacheDirectory(const char* package_name,
+                                      const std::string& bucket) {
+  std::string app_data_prefix =
+      (package_name && package_name[0] != '\0')
+          ? std::string(package_name) + "/" + kDownloadCacheDir
+          : kDownloadCacheDir;
+  // Each bucket has its own directory as each Storage instance has its own
+  // cache.
+  app_data_prefix += "/" + ToHex(HashString(bucket));
+  std::string error;
+  std::string app_dir =
+      AppDataDir(app_data_prefix.c_str(), /*should_create=*/true, &error);
+  if (!error.empty()) return std::string();
+  return app_dir;
+}
+
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
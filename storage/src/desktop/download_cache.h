@@ -0,0 +1,231 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_STORAGE_SRC_DESKTOP_DOWNLOAD_CACHE_H_
+#define FIREBASE_STORAGE_SRC_DESKTOP_DOWNLOAD_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "app/src/include/firebase/internal/mutex.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+// Stores the data of downloaded objects on disk so they don't have to be
+// downloaded again while they haven't changed.
+//
+// Objects are identified by a key built from their bucket and path. Each
+// entry records the generation, MD5 hash and ETag of the version of the object
+// that was cached, a cached object is revalidated by sending the ETag in an
+// If-None-Match header and is only used if the server responds with 304 (Not
+// Modified).
+//
+// The data is stored in files named after the MD5 hash of the object, so
+// objects with the same content at different paths share a file. When the
+// total size of the files exceeds the maximum size of the cache the least
+// recently used entries are evicted.
+//
+// The entries are recorded in an index file in the cache directory which is
+// loaded by the constructor, only one DownloadCache should use a directory at
+// a time. Changes are appended to the index, which is rewritten once most of
+// its records are out of date. Data is copied into and out of the cache
+// without holding its lock.
+class DownloadCache {
+ public:
+  // Version of an object held by the cache.
+  struct Entry {
+    Entry() : generation(-1), size(0) {}
+
+    // Generation of the object, -1 if unknown.
+    int64_t generation;
+    // Base64 encoded MD5 hash of the object, empty if unknown.
+    std::string md5_hash;
+    // ETag of the object, used to revalidate the entry.
+    std::string etag;
+    // Size of the object in bytes.
+    uint64_t size;
+  };
+
+  // Create a cache that stores files in directory, keeping at most max_size
+  // bytes of objects.
+  DownloadCache(const std::string& directory, uint64_t max_size);
+  ~DownloadCache();
+
+  // Returns the key of the object at path in bucket.
+  static std::string GetKey(const std::string& bucket,
+                            const std::string& path);
+
+  // Copy the entry for key to *entry, returns false if there isn't one.
+  bool Lookup(const std::string& key, Entry* entry);
+
+  // Copy the cached data of the object with key and etag to the file at path,
+  // setting *size to the number of bytes written. Returns false if the object
+  // isn't cached or its data could not be read.
+  bool CopyToFile(const std::string& key, const std::string& etag,
+                  const std::string& path, uint64_t* size);
+
+  // Copy up to buffer_size bytes of the cached data of the object with key and
+  // etag to buffer, setting *size to the number of bytes copied. Returns false
+  // if the object isn't cached or its data could not be read.
+  bool CopyToBuffer(const std::string& key, const std::string& etag,
+                    void* buffer, size_t buffer_size, uint64_t* size);
+
+  // Cache the object in the file at path as the entry for key, replacing any
+  // existing entry. Returns false if the object could not be cached.
+  bool StoreFile(const std::string& key, const Entry& entry,
+                 const std::string& path);
+
+  // Cache the object in buffer as the entry for key, replacing any existing
+  // entry. Returns false if the object could not be cached.
+  bool StoreBuffer(const std::string& key, const Entry& entry,
+                   const void* buffer, size_t buffer_size);
+
+  // Remove the entry for key, if there is one.
+  void Remove(const std::string& key);
+
+  // Returns the number of bytes of data held by the cache.
+  uint64_t size();
+
+  // Returns the maximum number of bytes of data held by the cache.
+  uint64_t max_size();
+
+  // Sets the maximum number of bytes of data held by the cache, evicting
+  // entries if it's now too large.
+  void set_max_size(uint64_t max_size);
+
+ private:
+  struct IndexEntry {
+    Entry entry;
+    // Name of the file in the cache directory holding the data.
+    std::string blob;
+    // Position of the key in lru_.
+    std::list<std::string>::iterator lru_position;
+  };
+
+  // File of data, which is shared by the entries of identical objects.
+  struct Blob {
+    Blob() : references(0), readers(0) {}
+
+    // Number of entries that refer to the file.
+    int references;
+    // Number of copies from the file in progress. The file is deleted once
+    // there are no references or readers.
+    int readers;
+  };
+
+  // Returns the name of the file that holds the data of entry for key.
+  static std::string GetBlobName(const std::string& key, const Entry& entry);
+
+  // Returns the path of the file named name in the cache directory.
+  std::string GetPath(const std::string& name) const;
+
+  // Mark the entry for key as used and prevent its data from being deleted
+  // until ReleaseData() is called, setting *blob and *size to the name and
+  // size of its data. Returns false if there's no entry for key with etag.
+  bool AcquireData(const std::string& key, const std::string& etag,
+                   std::string* blob, uint64_t* size);
+
+  // Release data acquired for key by AcquireData(), removing the entry if the
+  // data could not be read.
+  void ReleaseData(const std::string& key, const std::string& blob, bool read);
+
+  // Cache an object as the entry for key. If its data isn't already cached
+  // write_data is called to write it to a file at the path passed to it,
+  // returning the number of bytes written or -1 if an error occurred.
+  bool Store(const std::string& key, const Entry& entry,
+             const std::function<int64_t(const std::string&)>& write_data);
+
+  // Returns whether an entry refers to the data in blob. Must be called with
+  // mutex_ held.
+  bool IsCached(const std::string& blob) const;
+
+  // Add the entry for key, replacing any existing entry, and evict entries if
+  // the cache is now too large. Must be called with mutex_ held.
+  void AddEntry(const std::string& key, const Entry& entry,
+                const std::string& blob);
+
+  // Remove the entry for key, deleting its data if nothing else uses it.
+  // Returns false if there's no entry for key. Must be called with mutex_
+  // held.
+  bool RemoveEntry(const std::string& key);
+
+  // Delete the data in the blob unless an entry or reader still uses it. Must
+  // be called with mutex_ held.
+  void DeleteBlobIfUnused(std::map<std::string, Blob>::iterator blob);
+
+  // Evict the least recently used entries until the cache isn't larger than
+  // max_size_. Must be called with mutex_ held.
+  void Evict();
+
+  // Load the index, rewriting it if it has records that are out of date.
+  void LoadIndex();
+  // Rewrite the index with a record for each entry, from the least to the
+  // most recently used.
+  void SaveIndex();
+  // Append a record of the entry for key, or of its removal if entry is null,
+  // to the index.
+  void AppendToIndex(const std::string& key, const IndexEntry* entry);
+
+  Mutex mutex_;
+  std::string directory_;
+  uint64_t max_size_;
+  // Entries by key.
+  std::map<std::string, IndexEntry> entries_;
+  // Keys of the entries from the least to the most recently used.
+  std::list<std::string> lru_;
+  // Files of data by name.
+  std::map<std::string, Blob> blobs_;
+  // Total size of the files of data referred to by entries.
+  uint64_t size_;
+  // Number of temporary files created, used to name them.
+  uint64_t temp_file_count_;
+  // Number of records in the index file.
+  size_t index_records_;
+  // Whether entries have been used since the index was last rewritten, so
+  // the order of lru_ isn't recorded in the index.
+  bool lru_changed_;
+};
+
+// Describes how a download uses a DownloadCache. The response to a request
+// sent with an If-None-Match header for a cached object is completed with the
+// cached data if the server responds with 304 (Not Modified), otherwise a
+// successful response is added to the cache.
+struct DownloadCacheRequest {
+  // Cache used by the download, null if the download isn't cached.
+  std::shared_ptr<DownloadCache> cache;
+  // Key of the object in the cache.
+  std::string key;
+  // ETag of the cached object sent in the If-None-Match header, empty if the
+  // object wasn't cached.
+  std::string etag;
+};
+
+// Returns the directory used to cache objects downloaded from bucket by the app
+// with package_name, or an empty string if it could not be created.
+std::string GetDownloadCacheDirectory(const char* package_name,
+                                      const std::string& bucket);
+
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
+
+#endif  // FIREBASE_STORAGE_SRC_DESKTOP_DOWNLOAD_CACHE_H_
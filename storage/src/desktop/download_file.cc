@@ -0,0 +1,276 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "storage/src/desktop/download_file.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include "storage/src/desktop/file_util.h"
+
+#if FIREBASE_PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif  // FIREBASE_PLATFORM_WINDOWS
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+namespace {
+
+const char kTempFileExtension[] = ".tmp";
+
+// Number of DownloadFiles created by this process.
+std::atomic<uint64_t> g_download_file_count(0);
+
+// Returns a path next to path for a temporary file that no other download
+// uses, whether it's to the same path in this process or in another.
+std::string GetTempPath(const std::string& path) {
+#if FIREBASE_PLATFORM_WINDOWS
+  unsigned long long process_id = GetCurrentProcessId();  // NOLINT
+#else
+  unsigned long long process_id = getpid();  // NOLINT
+#endif  // FIREBASE_PLATFORM_WINDOWS
+  char suffix[40];
+  snprintf(suffix, sizeof(suffix), ".%llx.%llx", process_id,
+           static_cast<unsigned long long>(++g_download_file_count));  // NOLINT
+  return path + suffix + kTempFileExtension;
+}
+
+// Alignment of the buffer, and of the size of the writes, required by direct
+// I/O.
+const size_t kDirectIoAlignment = 4096;
+
+}  // namespace
+
+DownloadFile::DownloadFile(const std::string& path)
+    : path_(path),
+      temp_path_(GetTempPath(path)),
+      handle_(InvalidHandle()),
+      direct_io_(false),
+      buffer_(nullptr),
+      buffered_(0),
+      size_(0) {}
+
+DownloadFile::~DownloadFile() {
+  if (is_open()) Discard();
+}
+
+DownloadFile::Handle DownloadFile::InvalidHandle() {
+#if FIREBASE_PLATFORM_WINDOWS
+  return INVALID_HANDLE_VALUE;
+#else
+  return -1;
+#endif  // FIREBASE_PLATFORM_WINDOWS
+}
+
+bool DownloadFile::Open(int64_t expected_size, uint64_t direct_io_size) {
+  Close();
+  buffered_ = 0;
+  size_ = 0;
+  direct_io_ = false;
+#if FIREBASE_PLATFORM_WINDOWS
+  // Direct I/O isn't supported on Windows, where unbuffered writes can't be
+  // mixed with the unaligned write at the end of the file.
+  (void)direct_io_size;
+  handle_ = CreateFileW(ToFilePath(temp_path_).c_str(), GENERIC_WRITE, 0,
+                        nullptr, CREATE_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                        nullptr);
+#else
+  bool use_direct_io =
+      direct_io_size && expected_size >= 0 &&
+      static_cast<uint64_t>(expected_size) >= direct_io_size;
+  int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#if defined(O_DIRECT)
+  if (use_direct_io) {
+    handle_ = open(temp_path_.c_str(), flags | O_DIRECT, 0644);
+    // Not all file systems support direct I/O.
+    direct_io_ = handle_ != InvalidHandle();
+  }
+#endif  // defined(O_DIRECT)
+  if (handle_ == InvalidHandle()) {
+    handle_ = open(temp_path_.c_str(), flags, 0644);
+  }
+#if defined(F_NOCACHE)
+  if (use_direct_io && handle_ != InvalidHandle()) {
+    direct_io_ = fcntl(handle_, F_NOCACHE, 1) == 0;
+  }
+#endif  // defined(F_NOCACHE)
+#endif  // FIREBASE_PLATFORM_WINDOWS
+  if (handle_ == InvalidHandle()) return false;
+  if (buffer_storage_.empty()) {
+    buffer_storage_.resize(kDownloadFileBufferSize + kDirectIoAlignment);
+    uintptr_t address = reinterpret_cast<uintptr_t>(buffer_storage_.data());
+    buffer_ = buffer_storage_.data() +
+              (kDirectIoAlignment - address % kDirectIoAlignment) %
+                  kDirectIoAlignment;
+  }
+  if (expected_size > 0) Preallocate(expected_size);
+  return true;
+}
+
+bool DownloadFile::is_open() const { return handle_ != InvalidHandle(); }
+
+void DownloadFile::Preallocate(int64_t size) {
+  // Preallocation is only a hint, so failures are ignored.
+#if FIREBASE_PLATFORM_WINDOWS
+  FILE_ALLOCATION_INFO info;
+  info.AllocationSize.QuadPart = size;
+  SetFileInformationByHandle(handle_, FileAllocationInfo, &info, sizeof(info));
+#elif defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+  // Keep the size of the file so it only grows as data is written.
+  fallocate(handle_, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size));
+#elif defined(F_PREALLOCATE)
+  fstore_t store = {F_ALLOCATECONTIG, F_PEOFPOSMODE, 0,
+                    static_cast<off_t>(size), 0};
+  if (fcntl(handle_, F_PREALLOCATE, &store) != 0) {
+    store.fst_flags = F_ALLOCATEALL;
+    fcntl(handle_, F_PREALLOCATE, &store);
+  }
+#else
+  (void)size;
+#endif  // FIREBASE_PLATFORM_WINDOWS
+}
+
+bool DownloadFile::Write(const char* data, size_t size) {
+  if (!is_open()) return false;
+  while (size) {
+    size_t copy = (std::min)(size, kDownloadFileBufferSize - buffered_);
+    memcpy(buffer_ + buffered_, data, copy);
+    buffered_ += copy;
+    size_ += copy;
+    data += copy;
+    size -= copy;
+    if (buffered_ == kDownloadFileBufferSize && !Flush(false)) return false;
+  }
+  return true;
+}
+
+bool DownloadFile::Flush(bool final) {
+  if (!buffered_) return true;
+  if (final && buffered_ % kDirectIoAlignment) DisableDirectIo();
+  bool written = WriteFully(buffer_, buffered_);
+  buffered_ = 0;
+  return written;
+}
+
+bool DownloadFile::WriteFully(const char* data, size_t size) {
+  while (size) {
+#if FIREBASE_PLATFORM_WINDOWS
+    DWORD written = 0;
+    if (!WriteFile(handle_, data,
+                   static_cast<DWORD>((std::min)(size, size_t(1) << 30)),
+                   &written, nullptr) ||
+        !written) {
+      return false;
+    }
+#else
+    ssize_t written = write(handle_, data, size);
+    if (written < 0 && errno == EINTR) continue;
+    if (written < 0 && errno == EINVAL && direct_io_) {
+      // The file system requires a larger alignment than the buffer's.
+      DisableDirectIo();
+      continue;
+    }
+    if (written <= 0) return false;
+#endif  // FIREBASE_PLATFORM_WINDOWS
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+void DownloadFile::DisableDirectIo() {
+#if !FIREBASE_PLATFORM_WINDOWS && defined(O_DIRECT)
+  // Unlike O_DIRECT, F_NOCACHE doesn't restrict the alignment of writes so it
+  // doesn't need to be disabled.
+  if (direct_io_) {
+    int flags = fcntl(handle_, F_GETFL);
+    if (flags != -1) fcntl(handle_, F_SETFL, flags & ~O_DIRECT);
+  }
+#endif  // !FIREBASE_PLATFORM_WINDOWS && defined(O_DIRECT)
+  direct_io_ = false;
+}
+
+bool DownloadFile::Commit() {
+  if (!is_open()) {
+    // Open a file written by other means so it can be flushed to disk.
+#if FIREBASE_PLATFORM_WINDOWS
+    handle_ = CreateFileW(ToFilePath(temp_path_).c_str(), GENERIC_WRITE, 0,
+                          nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                          nullptr);
+#else
+    handle_ = open(temp_path_.c_str(), O_WRONLY);
+#endif  // FIREBASE_PLATFORM_WINDOWS
+    if (!is_open()) {
+      RemoveFile(temp_path_);
+      return false;
+    }
+  }
+  // Flush the data to disk before the file replaces the destination, so a
+  // crash can't leave an incomplete file in its place.
+  bool flushed = Flush(true);
+#if FIREBASE_PLATFORM_WINDOWS
+  flushed = flushed && FlushFileBuffers(handle_) != 0;
+  bool closed = CloseHandle(handle_) != 0;
+#else
+  flushed = flushed && fsync(handle_) == 0;
+  bool closed = close(handle_) == 0;
+#endif  // FIREBASE_PLATFORM_WINDOWS
+  handle_ = InvalidHandle();
+  if (!flushed || !closed || !RenameFile(temp_path_, path_)) {
+    RemoveFile(temp_path_);
+    return false;
+  }
+#if !FIREBASE_PLATFORM_WINDOWS
+  // Flush the directory so the rename itself survives a crash.
+  std::string::size_type separator = path_.find_last_of('/');
+  std::string directory =
+      separator == std::string::npos ? "." : path_.substr(0, separator + 1);
+  int directory_handle = open(directory.c_str(), O_RDONLY);
+  if (directory_handle >= 0) {
+    fsync(directory_handle);
+    close(directory_handle);
+  }
+#endif  // !FIREBASE_PLATFORM_WINDOWS
+  return true;
+}
+
+void DownloadFile::Discard() {
+  Close();
+  buffered_ = 0;
+  RemoveFile(temp_path_);
+}
+
+void DownloadFile::Close() {
+  if (!is_open()) return;
+#if FIREBASE_PLATFORM_WINDOWS
+  CloseHandle(handle_);
+#else
+  close(handle_);
+#endif  // FIREBASE_PLATFORM_WINDOWS
+  handle_ = InvalidHandle();
+}
+
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
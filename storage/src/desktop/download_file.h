@@ -0,0 +1,125 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_STORAGE_SRC_DESKTOP_DOWNLOAD_FILE_H_
+#define FIREBASE_STORAGE_SRC_DESKTOP_DOWNLOAD_FILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "app/src/include/firebase/internal/platform.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+// Size of the buffer data is collected in before it's written to the file.
+const size_t kDownloadFileBufferSize = 1024 * 1024;
+
+// Writes the body of a download to a temporary file next to its destination,
+// which replaces the destination once the download is complete. A download
+// that fails leaves the destination untouched. Each DownloadFile has its own
+// temporary file, so concurrent downloads to the same destination don't
+// corrupt each other and the last to complete wins.
+//
+// Data is collected in a large aligned buffer so the file is written with a
+// few large writes rather than one per chunk of the response, and space for
+// the expected size of the object is allocated up front so the file isn't
+// fragmented as it grows. Large objects can be written with direct I/O to
+// avoid filling the page cache with data that won't be read again soon.
+//
+// Not thread safe.
+class DownloadFile {
+ public:
+  explicit DownloadFile(const std::string& path);
+  // Removes the temporary file if the download wasn't committed.
+  ~DownloadFile();
+
+  // Create the temporary file, discarding anything written before.
+  // expected_size is the size of the object if it's known or -1. Direct I/O
+  // is used if direct_io_size isn't 0 and the object is at least that large,
+  // where it's supported by the platform and file system.
+  bool Open(int64_t expected_size, uint64_t direct_io_size = 0);
+
+  // Whether the temporary file is open.
+  bool is_open() const;
+
+  // Append size bytes of data to the file.
+  bool Write(const char* data, size_t size);
+
+  // Write any buffered data, flush the temporary file to disk and replace the
+  // destination with it. The temporary file doesn't need to have been opened
+  // by Open(), so a file written to temp_path() by other means can be
+  // committed.
+  bool Commit();
+
+  // Close and remove the temporary file.
+  void Discard();
+
+  // Path of the destination of the download.
+  const std::string& path() const { return path_; }
+
+  // Path of the temporary file the download is written to.
+  const std::string& temp_path() const { return temp_path_; }
+
+  // Number of bytes written to the file, including those still buffered.
+  uint64_t size() const { return size_; }
+
+  // Whether the file is written with direct I/O.
+  bool direct_io() const { return direct_io_; }
+
+ private:
+#if FIREBASE_PLATFORM_WINDOWS
+  typedef void* Handle;
+#else
+  typedef int Handle;
+#endif  // FIREBASE_PLATFORM_WINDOWS
+
+  static Handle InvalidHandle();
+
+  // Allocate size bytes for the file without changing its size.
+  void Preallocate(int64_t size);
+
+  // Write the buffered data to the file. Direct I/O is only used for whole
+  // buffers, so the rest of the file is written without it once final data
+  // that doesn't fill the buffer is flushed.
+  bool Flush(bool final);
+
+  // Write size bytes of data at the end of the file.
+  bool WriteFully(const char* data, size_t size);
+
+  // Stop writing the file with direct I/O.
+  void DisableDirectIo();
+
+  void Close();
+
+  std::string path_;
+  std::string temp_path_;
+  Handle handle_;
+  bool direct_io_;
+  // Storage for the buffer, which is aligned for direct I/O within it.
+  std::vector<char> buffer_storage_;
+  char* buffer_;
+  size_t buffered_;
+  uint64_t size_;
+};
+
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
+
+#endif  // FIREBASE_STORAGE_SRC_DESKTOP_DOWNLOAD_FILE_H_
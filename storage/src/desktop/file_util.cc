@@ -0,0 +1,80 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "storage/src/desktop/file_util.h"
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#if FIREBASE_PLATFORM_WINDOWS
+#include <windows.h>
+
+#include <codecvt>
+#include <locale>
+#endif  // FIREBASE_PLATFORM_WINDOWS
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+#if FIREBASE_PLATFORM_WINDOWS
+FilePath ToFilePath(const std::string& path) {
+  std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> utf8_to_wstring;
+  return utf8_to_wstring.from_bytes(path);
+}
+#else
+FilePath ToFilePath(const std::string& path) { return path; }
+#endif  // FIREBASE_PLATFORM_WINDOWS
+
+int64_t GetFileSize(const std::string& path) {
+#if FIREBASE_PLATFORM_WINDOWS
+  struct _stat64 info;
+  if (_wstat64(ToFilePath(path).c_str(), &info) != 0) return -1;
+#else
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0) return -1;
+#endif  // FIREBASE_PLATFORM_WINDOWS
+  return static_cast<int64_t>(info.st_size);
+}
+
+void RemoveFile(const std::string& path) {
+#if FIREBASE_PLATFORM_WINDOWS
+  _wremove(ToFilePath(path).c_str());
+#else
+  remove(path.c_str());
+#endif  // FIREBASE_PLATFORM_WINDOWS
+}
+
+bool RenameFile(const std::string& from, const std::string& to) {
+#if FIREBASE_PLATFORM_WINDOWS
+  return MoveFileExW(ToFilePath(from).c_str(), ToFilePath(to).c_str(),
+                     MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  return rename(from.c_str(), to.c_str()) == 0;
+#endif  // FIREBASE_PLATFORM_WINDOWS
+}
+
+uint64_t HashString(const std::string& value) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : value) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
@@ -0,0 +1,56 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_STORAGE_SRC_DESKTOP_FILE_UTIL_H_
+#define FIREBASE_STORAGE_SRC_DESKTOP_FILE_UTIL_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "app/src/include/firebase/internal/platform.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+// Path of a file in the form the platform's file APIs take it: UTF-16 on
+// Windows and UTF-8 elsewhere.
+#if FIREBASE_PLATFORM_WINDOWS
+typedef std::wstring FilePath;
+#else
+typedef std::string FilePath;
+#endif  // FIREBASE_PLATFORM_WINDOWS
+
+// Convert a UTF-8 path to a FilePath.
+FilePath ToFilePath(const std::string& path);
+
+// Get the size of a file, or -1 if it doesn't exist.
+int64_t GetFileSize(const std::string& path);
+
+// Delete a file, ignoring errors.
+void RemoveFile(const std::string& path);
+
+// Replace the file at to with the file at from.
+bool RenameFile(const std::string& from, const std::string& to);
+
+// Hash a string with 64-bit FNV-1a, which is stable across processes unlike
+// std::hash.
+uint64_t HashString(const std::string& value);
+
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
+
+#endif  // FIREBASE_STORAGE_SRC_DESKTOP_FILE_UTIL_H_
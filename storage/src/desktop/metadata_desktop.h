@@ -45,6 +45,7 @@ class MetadataInternal {
   static const char* kContentTypeKey;
   static const char* kDownloadTokensKey;
   static const char* kMd5HashKey;
+  static const char* kCrc32cKey;
   static const char* kSizeKey;
   static const char* kTimeUpdatedKey;
   static const char* kTimeCreatedKey;
@@ -152,6 +153,10 @@ class MetadataInternal {
 
   const char* md5_hash() { return md5_hash_.c_str(); }
 
+  // Return the base64 encoded CRC32C of the object, which is only read from
+  // the server and isn't part of the public metadata.
+  const std::string& crc32c() const { return crc32c_; }
+
   // Special method to create an invalid Metadata, because Metadata's default
   // constructor now gives us a valid one.
   static Metadata GetInvalidMetadata() { return Metadata(nullptr); }
@@ -190,6 +195,7 @@ class MetadataInternal {
   int64_t updated_time_;
   int64_t size_bytes_;
   std::string md5_hash_;
+  std::string crc32c_;
   std::string content_disposition_;
   std::string content_encoding_;
   std::string content_language_;
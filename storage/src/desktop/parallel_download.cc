@@ -0,0 +1,847 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "storage/src/desktop/parallel_download.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "app/rest/transport_builder.h"
+#include "app/rest/util.h"
+#include "app/src/include/firebase/internal/mutex.h"
+#include "app/src/include/firebase/internal/platform.h"
+#include "app/src/log.h"
+#include "app/src/semaphore.h"
+#include "app/src/thread.h"
+#include "app/src/time.h"
+#include "storage/src/desktop/curl_requests.h"
+#include "storage/src/desktop/file_util.h"
+
+#if FIREBASE_PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif  // FIREBASE_PLATFORM_WINDOWS
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+namespace {
+
+const char kRangeHeader[] = "Range";
+const char kContentLengthHeader[] = "Content-Length";
+// Response headers are matched in lower case, like the upload protocol's.
+const char kContentRangeHeader[] = "content-range";
+const char kContentLengthHeaderLower[] = "content-length";
+const char kEtagHeader[] = "etag";
+
+const char kDownloadStateFileExtension[] = ".download";
+
+const int kHttpPartialContent = 206;
+const int kHttpRangeNotSatisfiable = 416;
+
+// Parse a Content-Range header of the form "bytes first-last/total".
+bool ParseContentRange(const std::string& value, int64_t* first,
+                       int64_t* last, int64_t* total) {
+  long long range_first, range_last, range_total;  // NOLINT
+  if (sscanf(value.c_str(), "bytes %lld-%lld/%lld", &range_first,  // NOLINT
+             &range_last, &range_total) != 3 ||
+      range_first < 0 || range_last < range_first ||
+      range_total <= range_last) {
+    return false;
+  }
+  *first = range_first;
+  *last = range_last;
+  *total = range_total;
+  return true;
+}
+
+}  // namespace
+
+// File that can be written at arbitrary offsets from multiple threads.
+class OutputFile {
+ public:
+  OutputFile() : handle_(InvalidHandle()) {}
+  ~OutputFile() { Close(); }
+
+  // Open the file at path, discarding its contents if truncate is true.
+  bool Open(const std::string& path, bool truncate) {
+#if FIREBASE_PLATFORM_WINDOWS
+    handle_ = CreateFileW(ToFilePath(path).c_str(), GENERIC_WRITE,
+                          FILE_SHARE_READ, nullptr,
+                          truncate ? CREATE_ALWAYS : OPEN_ALWAYS,
+                          FILE_ATTRIBUTE_NORMAL, nullptr);
+#else
+    handle_ = open(path.c_str(), O_WRONLY | O_CREAT | (truncate ? O_TRUNC : 0),
+                   0644);
+#endif  // FIREBASE_PLATFORM_WINDOWS
+    return handle_ != InvalidHandle();
+  }
+
+  void Close() {
+    if (handle_ == InvalidHandle()) return;
+#if FIREBASE_PLATFORM_WINDOWS
+    CloseHandle(handle_);
+#else
+    close(handle_);
+#endif  // FIREBASE_PLATFORM_WINDOWS
+    handle_ = InvalidHandle();
+  }
+
+  // Set the size of the file. Must not be called while writes are in
+  // progress.
+  bool Resize(int64_t size) {
+#if FIREBASE_PLATFORM_WINDOWS
+    LARGE_INTEGER position;
+    position.QuadPart = size;
+    return SetFilePointerEx(handle_, position, nullptr, FILE_BEGIN) &&
+           SetEndOfFile(handle_);
+#else
+    return ftruncate(handle_, static_cast<off_t>(size)) == 0;
+#endif  // FIREBASE_PLATFORM_WINDOWS
+  }
+
+  // Write size bytes of data at offset.
+  bool Write(int64_t offset, const char* data, size_t size) {
+    while (size) {
+#if FIREBASE_PLATFORM_WINDOWS
+      OVERLAPPED overlapped = {};
+      overlapped.Offset = static_cast<DWORD>(offset & 0xffffffff);
+      overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+      DWORD written = 0;
+      if (!WriteFile(handle_, data,
+                     static_cast<DWORD>((std::min)(size, size_t(1) << 30)),
+                     &written, &overlapped) ||
+          !written) {
+        return false;
+      }
+#else
+      ssize_t written = pwrite(handle_, data, size, static_cast<off_t>(offset));
+      if (written < 0 && errno == EINTR) continue;
+      if (written <= 0) return false;
+#endif  // FIREBASE_PLATFORM_WINDOWS
+      offset += written;
+      data += written;
+      size -= written;
+    }
+    return true;
+  }
+
+ private:
+#if FIREBASE_PLATFORM_WINDOWS
+  typedef HANDLE Handle;
+  static Handle InvalidHandle() { return INVALID_HANDLE_VALUE; }
+#else
+  typedef int Handle;
+  static Handle InvalidHandle() { return -1; }
+#endif  // FIREBASE_PLATFORM_WINDOWS
+
+  Handle handle_;
+};
+
+// Runs a download for a ParallelDownloadTransport.
+class ParallelDownload {
+ public:
+  ParallelDownload(const ParallelDownloadOptions& options,
+                   Notifier* progress_notifier);
+  ~ParallelDownload();
+
+  // Start downloading the object requested by request, reporting the final
+  // result through response.
+  void Start(rest::Request* request, rest::Response* response);
+
+  bool Pause();
+  bool Resume();
+  bool Cancel();
+  bool is_paused() const;
+  int64_t total_size() const;
+  int64_t bytes_transferred() const;
+
+  // Whether the requests in flight should be aborted.
+  bool interrupted() const;
+
+  // Write data received for the object at offset.
+  bool Write(int64_t offset, const char* data, size_t size);
+
+ private:
+  // Fetches parts of the object on a thread.
+  struct Worker {
+    explicit Worker(ParallelDownload* owner)
+        : download(owner), wake(0), random(std::random_device()()) {}
+
+    ParallelDownload* download;
+    // Wakes the worker when the download is paused, resumed or stopped.
+    Semaphore wake;
+    std::minstd_rand random;
+    Thread thread;
+  };
+
+  static void Run(ParallelDownload* download) { download->Download(); }
+  static void RunWorker(Worker* worker) {
+    flatbuffers::unique_ptr<rest::Transport> transport =
+        rest::CreateTransport();
+    worker->download->FetchParts(worker, transport.get());
+  }
+
+  // Perform the download on the download thread.
+  void Download();
+
+  // Fetch parts that haven't been fetched yet until none are left or the
+  // download stops.
+  void FetchParts(Worker* worker, rest::Transport* transport);
+
+  // Fetch a part, retrying until it's complete. The probe fetches the first
+  // part before the size of the object is known. Returns false if the
+  // download stopped.
+  bool FetchPart(Worker* worker, rest::Transport* transport, int part,
+                 bool probe);
+
+  // Get the next part that should be fetched or -1 if there are none left.
+  int TakeNextPart();
+
+  // Get the number of bytes in a part of the object.
+  int64_t GetPartSize(int part) const;
+
+  // Stop the download with the status and body of a failed request.
+  // Retryable failures keep the state so the download can be resumed later.
+  void Fail(int status, const std::string& body, bool retryable);
+
+  // Complete the response of the download.
+  void Complete();
+
+  // Wait until the download isn't paused. Returns false if it stopped.
+  bool WaitWhilePaused(Worker* worker);
+
+  // Wake all workers so they notice the download changed state.
+  void WakeAll();
+
+  // Access the persisted state. LoadState() returns true if there is a
+  // partial download to resume.
+  bool LoadState();
+  void SaveState();
+  void DeleteState();
+
+  ParallelDownloadOptions options_;
+  Notifier* progress_notifier_;
+  rest::Request* request_;
+  rest::Response* response_;
+  std::string state_file_;
+  OutputFile file_;
+  Thread thread_;
+  // The first worker runs on the download thread.
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  // Object identity restored from the state file.
+  std::string resume_etag_;
+  int64_t resume_total_size_;
+  // Object identity reported by the server, set by the probe.
+  std::string etag_;
+  bool whole_object_;
+
+  // Serializes writes to the state file.
+  Mutex state_mutex_;
+
+  // Guards the following members.
+  mutable Mutex mutex_;
+  // Size of the object or -1 if it's not known yet.
+  int64_t total_size_;
+  int64_t bytes_transferred_;
+  // Whether each part has been written to the file.
+  std::vector<bool> completed_;
+  int next_part_;
+  bool paused_;
+  bool canceled_;
+  bool complete_;
+  bool failed_;
+  bool failure_retryable_;
+  int failure_status_;
+  std::string failure_body_;
+};
+
+namespace {
+
+// Response to a ranged request that writes the part of the object it
+// receives to the file.
+class PartResponse : public rest::Response {
+ public:
+  // The body is written starting at offset. If accept_whole_object is true
+  // a 200 response with the whole object is written from the start of the
+  // file.
+  PartResponse(ParallelDownload* download, int64_t offset,
+               bool accept_whole_object)
+      : download_(download),
+        offset_(offset),
+        accept_whole_object_(accept_whole_object),
+        bytes_written_(0),
+        aborted_(false),
+        write_failed_(false) {}
+
+  bool ProcessHeader(const char* buffer, size_t length) override {
+    std::string header(buffer, length);
+    size_t colon_index = header.find(rest::util::kHttpHeaderSeparator);
+    if (colon_index != std::string::npos) {
+      std::string key =
+          rest::util::TrimWhitespace(header.substr(0, colon_index));
+      std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+      part_headers_[key] =
+          rest::util::TrimWhitespace(header.substr(colon_index + 1));
+    }
+    return rest::Response::ProcessHeader(buffer, length);
+  }
+
+  bool ProcessBody(const char* buffer, size_t length) override {
+    bool whole_object = status() == rest::util::HttpSuccess;
+    if (status() != kHttpPartialContent) {
+      // Don't buffer the object if the server ignored the range.
+      if (whole_object && !accept_whole_object_) return false;
+      if (!whole_object) return rest::Response::ProcessBody(buffer, length);
+    }
+    if (download_->interrupted()) {
+      aborted_ = true;
+      return false;
+    }
+    int64_t offset = (whole_object ? 0 : offset_) + bytes_written_;
+    if (!download_->Write(offset, buffer, length)) {
+      write_failed_ = true;
+      return false;
+    }
+    bytes_written_ += static_cast<int64_t>(length);
+    return true;
+  }
+
+  // Get a header by lower case name, or an empty string if it's not present.
+  std::string GetPartHeader(const char* name) const {
+    auto it = part_headers_.find(name);
+    return it != part_headers_.end() ? it->second : std::string();
+  }
+
+  std::string body() const {
+    const char* data;
+    size_t size;
+    GetBody(&data, &size);
+    return std::string(data, size);
+  }
+
+  int64_t bytes_written() const { return bytes_written_; }
+  // Whether the transfer was aborted as the download was interrupted.
+  bool aborted() const { return aborted_; }
+  bool write_failed() const { return write_failed_; }
+
+ private:
+  ParallelDownload* download_;
+  int64_t offset_;
+  bool accept_whole_object_;
+  int64_t bytes_written_;
+  bool aborted_;
+  bool write_failed_;
+  std::map<std::string, std::string> part_headers_;
+};
+
+// Delegates to the download for ParallelDownloadTransport.
+class ParallelDownloadController : public rest::Controller {
+ public:
+  explicit ParallelDownloadController(ParallelDownload* download)
+      : download_(download) {}
+
+  bool Pause() override { return download_->Pause(); }
+  bool Resume() override { return download_->Resume(); }
+  bool IsPaused() override { return download_->is_paused(); }
+  bool Cancel() override { return download_->Cancel(); }
+  float Progress() override {
+    int64_t total = download_->total_size();
+    return total > 0 ? static_cast<float>(download_->bytes_transferred()) /
+                           static_cast<float>(total)
+                     : 0.0f;
+  }
+  int64_t TransferSize() override { return download_->total_size(); }
+  int64_t BytesTransferred() override {
+    return download_->bytes_transferred();
+  }
+
+ private:
+  ParallelDownload* download_;
+};
+
+}  // namespace
+
+ParallelDownload::ParallelDownload(const ParallelDownloadOptions& options,
+                                   Notifier* progress_notifier)
+    : options_(options),
+      progress_notifier_(progress_notifier),
+      request_(nullptr),
+      response_(nullptr),
+      state_file_(GetDownloadStateFile(options.path)),
+      resume_total_size_(-1),
+      whole_object_(false),
+      total_size_(-1),
+      bytes_transferred_(0),
+      next_part_(0),
+      paused_(false),
+      canceled_(false),
+      complete_(false),
+      failed_(false),
+      failure_retryable_(false),
+      failure_status_(rest::util::HttpInvalid) {
+  options_.part_size = (std::max)(options_.part_size, static_cast<size_t>(1));
+  options_.max_parallel_parts = (std::max)(options_.max_parallel_parts, 1);
+  for (int i = 0; i < options_.max_parallel_parts; ++i) {
+    workers_.emplace_back(new Worker(this));
+  }
+}
+
+ParallelDownload::~ParallelDownload() {
+  {
+    MutexLock lock(mutex_);
+    canceled_ = true;
+  }
+  WakeAll();
+  if (thread_.Joinable()) thread_.Join();
+}
+
+void ParallelDownload::Start(rest::Request* request,
+                             rest::Response* response) {
+  request_ = request;
+  response_ = response;
+  thread_ = Thread(Run, this);
+}
+
+bool ParallelDownload::Pause() {
+  {
+    MutexLock lock(mutex_);
+    if (complete_ || canceled_ || paused_) return false;
+    paused_ = true;
+  }
+  WakeAll();
+  return true;
+}
+
+bool ParallelDownload::Resume() {
+  {
+    MutexLock lock(mutex_);
+    if (!paused_) return false;
+    paused_ = false;
+  }
+  WakeAll();
+  return true;
+}
+
+bool ParallelDownload::Cancel() {
+  {
+    MutexLock lock(mutex_);
+    if (complete_ || canceled_) return false;
+    canceled_ = true;
+  }
+  WakeAll();
+  return true;
+}
+
+bool ParallelDownload::is_paused() const {
+  MutexLock lock(mutex_);
+  return paused_;
+}
+
+int64_t ParallelDownload::total_size() const {
+  MutexLock lock(mutex_);
+  return total_size_;
+}
+
+int64_t ParallelDownload::bytes_transferred() const {
+  MutexLock lock(mutex_);
+  return bytes_transferred_;
+}
+
+bool ParallelDownload::interrupted() const {
+  MutexLock lock(mutex_);
+  return paused_ || canceled_ || failed_;
+}
+
+bool ParallelDownload::Write(int64_t offset, const char* data, size_t size) {
+  if (!file_.Write(offset, data, size)) {
+    LogError("Failed to write downloaded data to %s", options_.path.c_str());
+    return false;
+  }
+  {
+    MutexLock lock(mutex_);
+    bytes_transferred_ += static_cast<int64_t>(size);
+  }
+  if (progress_notifier_ && size) progress_notifier_->NotifyProgress();
+  return true;
+}
+
+void ParallelDownload::Download() {
+  flatbuffers::unique_ptr<rest::Transport> transport = rest::CreateTransport();
+  bool resume = LoadState();
+  if (!file_.Open(options_.path, !resume)) {
+    LogError("Failed to open %s to write downloaded data.",
+             options_.path.c_str());
+    Fail(rest::util::HttpInvalid, std::string(), false);
+    Complete();
+    return;
+  }
+
+  // Fetch the first part that is missing to find the size of the object and
+  // whether it changed since the partial download.
+  int probe_part = 0;
+  if (resume) {
+    MutexLock lock(mutex_);
+    while (probe_part < static_cast<int>(completed_.size()) - 1 &&
+           completed_[probe_part]) {
+      ++probe_part;
+    }
+  }
+  if (!FetchPart(workers_[0].get(), transport.get(), probe_part, true)) {
+    Complete();
+    return;
+  }
+  if (whole_object_) {
+    if (!file_.Resize(total_size())) {
+      Fail(rest::util::HttpInvalid, std::string(), false);
+    }
+    Complete();
+    return;
+  }
+
+  int worker_count;
+  {
+    MutexLock lock(mutex_);
+    if (!resume || etag_.empty() || etag_ != resume_etag_ ||
+        total_size_ != resume_total_size_) {
+      if (resume) {
+        LogDebug("Storage object changed since %s was partially downloaded.",
+                 options_.path.c_str());
+      }
+      int64_t part_size = static_cast<int64_t>(options_.part_size);
+      completed_.assign(
+          static_cast<size_t>((total_size_ + part_size - 1) / part_size),
+          false);
+      bytes_transferred_ = GetPartSize(probe_part);
+    } else if (completed_[probe_part]) {
+      // Every part was downloaded, the probe fetched the last one again.
+      bytes_transferred_ -= GetPartSize(probe_part);
+    }
+    completed_[probe_part] = true;
+    int remaining = static_cast<int>(
+        std::count(completed_.begin(), completed_.end(), false));
+    worker_count = (std::min)(options_.max_parallel_parts, remaining);
+  }
+  if (!file_.Resize(total_size())) {
+    LogError("Failed to resize %s to the size of the downloaded object.",
+             options_.path.c_str());
+    Fail(rest::util::HttpInvalid, std::string(), false);
+    Complete();
+    return;
+  }
+  SaveState();
+
+  for (int i = 1; i < worker_count; ++i) {
+    workers_[i]->thread = Thread(RunWorker, workers_[i].get());
+  }
+  if (worker_count) FetchParts(workers_[0].get(), transport.get());
+  for (int i = 1; i < worker_count; ++i) workers_[i]->thread.Join();
+  Complete();
+}
+
+void ParallelDownload::FetchParts(Worker* worker, rest::Transport* transport) {
+  for (;;) {
+    int part = TakeNextPart();
+    if (part < 0 || !FetchPart(worker, transport, part, false)) return;
+    {
+      MutexLock lock(mutex_);
+      completed_[part] = true;
+    }
+    SaveState();
+  }
+}
+
+bool ParallelDownload::FetchPart(Worker* worker, rest::Transport* transport,
+                                 int part, bool probe) {
+  const rest::RetryPolicy& policy = options_.retry_policy;
+  int64_t part_size = static_cast<int64_t>(options_.part_size);
+  int64_t part_start = part * part_size;
+  // The size of the object is only known once the probe completes.
+  int64_t part_end = part_start + (probe ? part_size : GetPartSize(part)) - 1;
+  int64_t received = 0;
+  bool use_range = true;
+  int retries = 0;
+  uint64_t last_progress_ms = ::firebase::internal::GetTimestamp();
+  for (;;) {
+    if (!WaitWhilePaused(worker)) return false;
+
+    int64_t start = part_start + received;
+    rest::Request request;
+    request.set_url(request_->options().url.c_str());
+    request.set_method(request_->options().method.c_str());
+    request.options().category = request_->options().category;
+    request.options().timeout_ms = request_->options().timeout_ms;
+    for (const auto& header : request_->options().header) {
+      request.add_header(header.first.c_str(), header.second.c_str());
+    }
+    if (use_range) {
+      request.add_header(kRangeHeader, ("bytes=" + std::to_string(start) +
+                                        "-" + std::to_string(part_end))
+                                           .c_str());
+    }
+    PartResponse response(this, start, probe && received == 0);
+    transport->Perform(&request, &response, nullptr);
+
+    int status = response.status();
+    if (response.write_failed()) {
+      Fail(rest::util::HttpInvalid, std::string(), false);
+      return false;
+    }
+    if (response.bytes_written()) {
+      retries = 0;
+      last_progress_ms = ::firebase::internal::GetTimestamp();
+    }
+    if (status == kHttpPartialContent) {
+      int64_t first, last, total;
+      if (!ParseContentRange(response.GetPartHeader(kContentRangeHeader),
+                             &first, &last, &total) ||
+          first != start) {
+        LogError("Storage download of %s received an unexpected range %s.",
+                 options_.path.c_str(),
+                 response.GetPartHeader(kContentRangeHeader).c_str());
+        Fail(rest::util::HttpInvalid, std::string(), false);
+        return false;
+      }
+      received += response.bytes_written();
+      if (probe) {
+        MutexLock lock(mutex_);
+        etag_ = response.GetPartHeader(kEtagHeader);
+        total_size_ = total;
+      }
+      if (start + response.bytes_written() == last + 1) return true;
+      part_end = last;
+    } else if (status == rest::util::HttpSuccess && probe && received == 0) {
+      // The server sent the whole object.
+      std::string length = response.GetPartHeader(kContentLengthHeaderLower);
+      if (!response.aborted() &&
+          (length.empty() ||
+           strtoll(length.c_str(), nullptr, 10) == response.bytes_written())) {
+        MutexLock lock(mutex_);
+        etag_ = response.GetPartHeader(kEtagHeader);
+        total_size_ = response.bytes_written();
+        whole_object_ = true;
+        return true;
+      }
+      // The object can't be resumed part way through, so start again.
+      MutexLock lock(mutex_);
+      bytes_transferred_ -= response.bytes_written();
+    } else if (status == kHttpRangeNotSatisfiable && probe && use_range &&
+               received == 0) {
+      // The object is empty so it has no ranges.
+      use_range = false;
+      continue;
+    } else if (status == rest::util::HttpSuccess) {
+      LogError("Storage server ignored the range requested to download %s.",
+               options_.path.c_str());
+      Fail(rest::util::HttpInvalid, std::string(), false);
+      return false;
+    } else if (status != rest::util::HttpInvalid &&
+               !policy.is_retryable(status)) {
+      Fail(status, response.body(), false);
+      return false;
+    }
+
+    // The request failed or was interrupted, so fetch the rest of the part.
+    // A paused or stopped download is handled at the start of the loop.
+    if (interrupted()) continue;
+    int64_t delay_ms = policy.GetBackoffMilliseconds(
+        ++retries,
+        std::uniform_real_distribution<double>(0.0, 1.0)(worker->random));
+    int64_t elapsed_ms = static_cast<int64_t>(
+        ::firebase::internal::GetTimestamp() - last_progress_ms);
+    if (elapsed_ms + delay_ms > policy.max_retry_time_ms) {
+      Fail(status, response.body(), true);
+      return false;
+    }
+    worker->wake.TimedWait(static_cast<int>(delay_ms));
+  }
+}
+
+int ParallelDownload::TakeNextPart() {
+  MutexLock lock(mutex_);
+  int part_count = static_cast<int>(completed_.size());
+  while (next_part_ < part_count && completed_[next_part_]) ++next_part_;
+  return next_part_ < part_count ? next_part_++ : -1;
+}
+
+int64_t ParallelDownload::GetPartSize(int part) const {
+  int64_t part_size = static_cast<int64_t>(options_.part_size);
+  return (std::min)(part_size, total_size_ - part * part_size);
+}
+
+void ParallelDownload::Fail(int status, const std::string& body,
+                            bool retryable) {
+  {
+    MutexLock lock(mutex_);
+    if (failed_) return;
+    failed_ = true;
+    failure_status_ = status;
+    failure_body_ = body;
+    failure_retryable_ = retryable;
+  }
+  WakeAll();
+}
+
+void ParallelDownload::Complete() {
+  file_.Close();
+  bool canceled, failed, retryable;
+  int status;
+  std::string body;
+  int64_t size;
+  {
+    MutexLock lock(mutex_);
+    complete_ = true;
+    canceled = canceled_;
+    failed = failed_;
+    retryable = failure_retryable_;
+    status = failure_status_;
+    body = failure_body_;
+    size = total_size_;
+  }
+  if (canceled) {
+    response_->set_status(rest::util::HttpNoContent);
+    request_->MarkFailed();
+    response_->MarkFailed();
+  } else if (failed && retryable) {
+    // Keep the state so the download can be resumed later.
+    response_->set_status(rest::util::HttpRequestTimeout);
+    request_->MarkFailed();
+    response_->MarkFailed();
+  } else {
+    DeleteState();
+    if (failed) {
+      response_->set_status(status);
+      if (!body.empty()) response_->ProcessBody(body.data(), body.size());
+    } else {
+      std::string header = std::string(kContentLengthHeader) +
+                           rest::util::kHttpHeaderSeparator + " " +
+                           std::to_string(size) + rest::util::kCrLf;
+      response_->set_status(rest::util::HttpSuccess);
+      response_->ProcessHeader(header.data(), header.size());
+    }
+    request_->MarkCompleted();
+    response_->MarkCompleted();
+  }
+}
+
+bool ParallelDownload::WaitWhilePaused(Worker* worker) {
+  for (;;) {
+    {
+      MutexLock lock(mutex_);
+      if (canceled_ || failed_) return false;
+      if (!paused_) return true;
+    }
+    worker->wake.Wait();
+  }
+}
+
+void ParallelDownload::WakeAll() {
+  for (auto& worker : workers_) worker->wake.Post();
+}
+
+bool ParallelDownload::LoadState() {
+  std::ifstream file(ToFilePath(state_file_), std::ios::in | std::ios::binary);
+  if (!file) return false;
+  std::string etag;
+  long long total = -1;  // NOLINT
+  size_t part_size = 0;
+  if (!std::getline(file, etag) || etag.empty() ||
+      !(file >> total >> part_size) || total <= 0 ||
+      part_size != options_.part_size || GetFileSize(options_.path) != total) {
+    return false;
+  }
+  MutexLock lock(mutex_);
+  total_size_ = total;
+  completed_.assign(static_cast<size_t>((total + part_size - 1) / part_size),
+                    false);
+  int part;
+  while (file >> part) {
+    if (part < 0 || part >= static_cast<int>(completed_.size()) ||
+        completed_[part]) {
+      continue;
+    }
+    completed_[part] = true;
+    bytes_transferred_ += GetPartSize(part);
+  }
+  resume_etag_ = etag;
+  resume_total_size_ = total;
+  return true;
+}
+
+void ParallelDownload::SaveState() {
+  std::string etag;
+  int64_t total;
+  std::vector<bool> completed;
+  {
+    MutexLock lock(mutex_);
+    etag = etag_;
+    total = total_size_;
+    completed = completed_;
+  }
+  // The ETag identifies the object that was partially downloaded.
+  if (etag.empty() || state_file_.empty()) return;
+  MutexLock lock(state_mutex_);
+  std::ofstream file(ToFilePath(state_file_),
+                     std::ios::out | std::ios::binary | std::ios::trunc);
+  file << etag << "\n" << total << "\n" << options_.part_size << "\n";
+  for (size_t i = 0; i < completed.size(); ++i) {
+    if (completed[i]) file << i << "\n";
+  }
+  if (!file) {
+    LogWarning("Failed to save storage download state to %s",
+               state_file_.c_str());
+  }
+}
+
+void ParallelDownload::DeleteState() {
+  if (state_file_.empty()) return;
+  MutexLock lock(state_mutex_);
+  RemoveFile(state_file_);
+}
+
+ParallelDownloadTransport::ParallelDownloadTransport(
+    const ParallelDownloadOptions& options, Notifier* progress_notifier)
+    : download_(new ParallelDownload(options, progress_notifier)) {}
+
+ParallelDownloadTransport::~ParallelDownloadTransport() {}
+
+void ParallelDownloadTransport::PerformInternal(
+    rest::Request* request, rest::Response* response,
+    flatbuffers::unique_ptr<rest::Controller>* controller_out) {
+  if (controller_out) {
+    controller_out->reset(new ParallelDownloadController(download_.get()));
+  }
+  download_->Start(request, response);
+}
+
+std::string GetDownloadStateFile(const std::string& path) {
+  if (path.empty()) return std::string();
+  return path + kDownloadStateFileExtension;
+}
+
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
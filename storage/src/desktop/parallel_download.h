@@ -0,0 +1,106 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_STORAGE_SRC_DESKTOP_PARALLEL_DOWNLOAD_H_
+#define FIREBASE_STORAGE_SRC_DESKTOP_PARALLEL_DOWNLOAD_H_
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+
+#include "app/rest/controller_interface.h"
+#include "app/rest/request.h"
+#include "app/rest/response.h"
+#include "app/rest/retry_policy.h"
+#include "app/rest/transport_interface.h"
+#include "flatbuffers/stl_emulation.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+class Notifier;
+class ParallelDownload;
+
+// Default size of each part of a parallel download.
+const size_t kDefaultDownloadPartSize = 8 * 1024 * 1024;
+
+// Configures a parallel download.
+struct ParallelDownloadOptions {
+  ParallelDownloadOptions()
+      : part_size(kDefaultDownloadPartSize), max_parallel_parts(4) {
+    retry_policy.initial_backoff_ms = 1000;
+    retry_policy.max_backoff_ms = 30000;
+    retry_policy.max_retry_time_ms = 600000;
+  }
+
+  // Path of the file the object is written to.
+  std::string path;
+  // Number of bytes fetched by each ranged request.
+  size_t part_size;
+  // Maximum number of parts fetched at the same time.
+  int max_parallel_parts;
+  // How failed requests are retried. max_retry_time_ms is measured from the
+  // last time a part made progress rather than from the start of the
+  // download.
+  rest::RetryPolicy retry_policy;
+};
+
+// Downloads the object at the URL of a GET request by splitting it into byte
+// ranges that are fetched concurrently and written to a file at their
+// offsets. The first range is fetched on its own to find the size of the
+// object from the Content-Range of its response, so an object no larger than
+// one part is downloaded with a single request.
+//
+// Completed parts are recorded in a state file next to the destination, so a
+// download that is interrupted can be resumed by a later download of the same
+// object to the same path as long as its ETag hasn't changed.
+//
+// The response passed to Perform() is completed as if it was the response to
+// a GET of the whole object whose body was written to the file: with status
+// 200 and a Content-Length header with the size of the file. If the download
+// fails it's completed with the status and body of the failed request.
+//
+// Each part is fetched using a synchronous transport from
+// rest::CreateTransport() on a thread owned by this object. The returned
+// controller pauses the download by aborting the parts in flight, resuming
+// requests the remainder of each part.
+//
+// Only one request can be performed by each instance.
+class ParallelDownloadTransport : public rest::Transport {
+ public:
+  // progress_notifier is optional and is notified as data is received.
+  ParallelDownloadTransport(const ParallelDownloadOptions& options,
+                            Notifier* progress_notifier);
+  // Waits for the download threads to finish.
+  ~ParallelDownloadTransport() override;
+
+ private:
+  void PerformInternal(
+      rest::Request* request, rest::Response* response,
+      flatbuffers::unique_ptr<rest::Controller>* controller_out) override;
+
+  std::unique_ptr<ParallelDownload> download_;
+};
+
+// Get the path of the file used to record the progress of a parallel download
+// to path.
+std::string GetDownloadStateFile(const std::string& path);
+
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
+
+#endif  // FIREBASE_STORAGE_SRC_DESKTOP_PARALLEL_DOWNLOAD_H_
@@ -34,13 +34,15 @@ RestOperation::RestOperation(StorageInternal* storage_internal,
                              const StorageReference& storage_reference,
                              rest::Request* request, Notifier* request_notifier,
                              BlockingResponse* response, Listener* listener,
-                             FutureHandle handle, Controller* controller_out)
+                             FutureHandle handle, Controller* controller_out,
+                             rest::Transport* transport)
     : storage_internal_(storage_internal),
       request_(request),
       request_notifier_(request_notifier),
       response_(response),
       listener_(nullptr),
       handle_(handle),
+      transport_(transport),
       is_complete_(false) {
   // Notify this operation when the response reports progress and clean up if
   // the response completes.
@@ -71,11 +73,15 @@ RestOperation::RestOperation(StorageInternal* storage_internal,
 
   set_listener(listener);
 
-  transport_.set_is_async(true);
+  if (!transport_) {
+    rest::TransportCurl* transport_curl = new rest::TransportCurl();
+    transport_curl->set_is_async(true);
+    transport_.reset(transport_curl);
+  }
   // Acquire the mutex to prevent operation from being completed before
   // construction is finished.
   MutexLock lock(mutex_);
-  transport_.Perform(*request_, response_.get(), &rest_controller_);
+  transport_->Perform(request_.get(), response_.get(), &rest_controller_);
 
   // rest::TransportCurl owns the rest::Controller pointer so as long as this
   // object is alive and rest::Controller is valid.
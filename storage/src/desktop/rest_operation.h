@@ -22,6 +22,7 @@
 #include "app/rest/controller_interface.h"
 #include "app/rest/request.h"
 #include "app/rest/transport_curl.h"
+#include "app/rest/transport_interface.h"
 #include "app/src/cleanup_notifier.h"
 #include "app/src/include/firebase/internal/mutex.h"
 #include "storage/src/desktop/controller_desktop.h"
@@ -48,7 +49,8 @@ class RestOperation {
                 const StorageReference& storage_reference,
                 rest::Request* request, Notifier* request_notifier,
                 BlockingResponse* response, Listener* listener,
-                FutureHandle handle, Controller* controller_out);
+                FutureHandle handle, Controller* controller_out,
+                rest::Transport* transport);
 
  public:
   ~RestOperation();
@@ -87,14 +89,18 @@ class RestOperation {
   // object created by this method through its cleanup notifier.
   // If provided, controller_out is populated with the controller used to manage
   // the rest call.
+  // If provided, the request is performed with transport, which must be
+  // asynchronous, otherwise it's performed with an asynchronous TransportCurl.
+  // This object takes ownership of transport.
   static void Start(StorageInternal* storage_internal,
                     const StorageReference& storage_reference,
                     rest::Request* request, Notifier* request_notifier,
                     BlockingResponse* response, Listener* listener,
-                    FutureHandle handle, Controller* controller_out) {
+                    FutureHandle handle, Controller* controller_out,
+                    rest::Transport* transport = nullptr) {
     RestOperation* operation = new RestOperation(
         storage_internal, storage_reference, request, request_notifier,
-        response, listener, handle, controller_out);
+        response, listener, handle, controller_out, transport);
     (void)operation;  // After creation the operation is owned by
                       // storage_internal.
   }
@@ -109,7 +115,7 @@ class RestOperation {
   Listener* listener_;
   FutureHandle handle_;
   CleanupNotifier cleanup_;
-  rest::TransportCurl transport_;
+  flatbuffers::unique_ptr<rest::Transport> transport_;
   flatbuffers::unique_ptr<rest::Controller> rest_controller_;
   // Storage controller that delegates to this object.
   storage::Controller controller_;
@@ -0,0 +1,713 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "storage/src/desktop/resumable_upload.h"
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+
+#include "app/rest/request_binary.h"
+#include "app/rest/transport_builder.h"
+#include "app/rest/util.h"
+#include "app/src/filesystem.h"
+#include "app/src/include/firebase/internal/mutex.h"
+#include "app/src/include/firebase/internal/platform.h"
+#include "app/src/include/firebase/variant.h"
+#include "app/src/log.h"
+#include "app/src/semaphore.h"
+#include "app/src/thread.h"
+#include "app/src/time.h"
+#include "app/src/variant_util.h"
+#include "storage/src/desktop/curl_requests.h"
+#include "storage/src/desktop/file_util.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+namespace {
+
+const char kUploadProtocolHeader[] = "X-Goog-Upload-Protocol";
+const char kUploadCommandHeader[] = "X-Goog-Upload-Command";
+const char kUploadOffsetHeader[] = "X-Goog-Upload-Offset";
+const char kUploadContentLengthHeader[] = "X-Goog-Upload-Header-Content-Length";
+const char kUploadContentTypeHeader[] = "X-Goog-Upload-Header-Content-Type";
+// Response headers are matched in lower case as HTTP/2 servers send them that
+// way.
+const char kUploadUrlHeader[] = "x-goog-upload-url";
+const char kUploadStatusHeader[] = "x-goog-upload-status";
+const char kUploadSizeReceivedHeader[] = "x-goog-upload-size-received";
+
+const char kUploadProtocolResumable[] = "resumable";
+const char kUploadCommandStart[] = "start";
+const char kUploadCommandQuery[] = "query";
+const char kUploadCommandUpload[] = "upload";
+const char kUploadCommandUploadAndFinalize[] = "upload, finalize";
+const char kUploadStatusActive[] = "active";
+const char kUploadStatusFinal[] = "final";
+
+const char kUploadSessionDir[] = "storage_uploads";
+const char kUploadSessionFileExtension[] = ".session";
+
+const char kContentTypeHeader[] = "Content-Type";
+const char kJsonContentType[] = "application/json; charset=utf-8";
+
+// Response to a step of the upload protocol.
+class ProtocolResponse : public rest::Response {
+ public:
+  explicit ProtocolResponse(bool (*is_retryable)(int http_status))
+      : is_retryable_(is_retryable), failed_(false) {}
+
+  bool ProcessHeader(const char* buffer, size_t length) override {
+    std::string header(buffer, length);
+    size_t colon_index = header.find(rest::util::kHttpHeaderSeparator);
+    if (colon_index != std::string::npos) {
+      std::string key =
+          rest::util::TrimWhitespace(header.substr(0, colon_index));
+      std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+      upload_headers_[key] =
+          rest::util::TrimWhitespace(header.substr(colon_index + 1));
+    }
+    return rest::Response::ProcessHeader(buffer, length);
+  }
+
+  void MarkFailed() override {
+    failed_ = true;
+    rest::Response::MarkFailed();
+  }
+
+  // Get an upload protocol header by lower case name, or an empty string if
+  // it's not present.
+  std::string GetUploadHeader(const char* name) const {
+    auto it = upload_headers_.find(name);
+    return it != upload_headers_.end() ? it->second : std::string();
+  }
+
+  // Whether the server responded with a successful status.
+  bool succeeded() const {
+    return !failed_ && status() >= 200 && status() < 300;
+  }
+
+  // Whether the request should be sent again.
+  bool retryable() const {
+    return failed_ || is_retryable_(status());
+  }
+
+ private:
+  bool (*is_retryable_)(int http_status);
+  bool failed_;
+  std::map<std::string, std::string> upload_headers_;
+};
+
+}  // namespace
+
+// Runs the upload protocol for a ResumableUploadTransport.
+class ResumableUpload {
+ public:
+  ResumableUpload(const ResumableUploadOptions& options,
+                  Notifier* progress_notifier);
+  ~ResumableUpload();
+
+  // Start uploading the body of request, reporting the final result through
+  // response.
+  void Start(rest::Request* request, rest::Response* response);
+
+  bool Pause();
+  bool Resume();
+  bool Cancel();
+  bool is_paused() const;
+  int64_t total_size() const { return total_size_; }
+  int64_t bytes_transferred() const;
+
+  // Whether the request in flight should be aborted.
+  bool interrupted() const;
+
+  // Report data of the current chunk has been sent.
+  void AddBytesSent(size_t bytes_sent);
+
+ private:
+  // Outcome of a step of the protocol.
+  enum Step {
+    // Continue with the next step.
+    kStepContinue,
+    // The step failed and should be retried.
+    kStepRetry,
+    // The upload is complete with the response of the step.
+    kStepDone,
+    // The upload failed with the response of the step.
+    kStepFailed,
+  };
+
+  static void Run(ResumableUpload* upload) { upload->Upload(); }
+
+  // Perform the upload on the upload thread.
+  void Upload();
+
+  // Steps of the protocol. The response of the step is returned in response.
+  Step StartSession(ProtocolResponse* response);
+  Step QueryOffset(ProtocolResponse* response);
+  Step SendChunk(ProtocolResponse* response);
+
+  // Set up a request for a step of the protocol with the headers of the
+  // request being uploaded.
+  void InitializeRequest(rest::Request* request, const char* url,
+                         const char* command);
+
+  // Read from the request being uploaded so that the chunk buffer contains the
+  // committed offset. Returns false if the request could not be read.
+  bool FillChunk();
+
+  // Complete the response being uploaded with the response of a step.
+  void Complete(ProtocolResponse* response);
+
+  // Wait until the upload isn't paused. Returns false if it was canceled.
+  bool WaitWhilePaused(bool* waited);
+
+  // Access the persisted session.
+  void LoadSession();
+  void SaveSession();
+  void DeleteSession();
+
+  ResumableUploadOptions options_;
+  Notifier* progress_notifier_;
+  rest::Request* request_;
+  rest::Response* response_;
+  flatbuffers::unique_ptr<rest::Transport> transport_;
+  Thread thread_;
+  // Wakes the upload thread when the upload is paused, resumed or canceled.
+  Semaphore wake_;
+  std::minstd_rand random_;
+
+  // URL of the upload session.
+  std::string upload_url_;
+  // Data read from the request which starts at chunk_offset_.
+  std::string chunk_;
+  int64_t chunk_offset_;
+  // Whether all data has been read from the request.
+  bool source_exhausted_;
+  // Total size of the upload or -1 if it's unknown.
+  int64_t total_size_;
+
+  // Guards the following members.
+  mutable Mutex mutex_;
+  // Number of bytes the server has committed.
+  int64_t committed_;
+  // Number of bytes of the current chunk that have been sent.
+  int64_t chunk_bytes_sent_;
+  bool paused_;
+  bool canceled_;
+  bool complete_;
+};
+
+namespace {
+
+// Request that sends part of the chunk buffer, aborting if the upload is
+// paused or canceled.
+class ChunkRequest : public rest::RequestBinary {
+ public:
+  ChunkRequest(const char* data, size_t size, ResumableUpload* upload)
+      : rest::RequestBinary(data, size), upload_(upload) {}
+
+  size_t ReadBody(char* buffer, size_t length, bool* abort) override {
+    if (upload_->interrupted()) {
+      *abort = true;
+      return 0;
+    }
+    size_t read_size = rest::RequestBinary::ReadBody(buffer, length, abort);
+    upload_->AddBytesSent(read_size);
+    return read_size;
+  }
+
+ private:
+  ResumableUpload* upload_;
+};
+
+// Delegates to the upload for ResumableUploadTransport.
+class ResumableUploadController : public rest::Controller {
+ public:
+  explicit ResumableUploadController(ResumableUpload* upload)
+      : upload_(upload) {}
+
+  bool Pause() override { return upload_->Pause(); }
+  bool Resume() override { return upload_->Resume(); }
+  bool IsPaused() override { return upload_->is_paused(); }
+  bool Cancel() override { return upload_->Cancel(); }
+  float Progress() override {
+    int64_t total = upload_->total_size();
+    return total > 0 ? static_cast<float>(upload_->bytes_transferred()) /
+                           static_cast<float>(total)
+                     : 0.0f;
+  }
+  int64_t TransferSize() override { return upload_->total_size(); }
+  int64_t BytesTransferred() override { return upload_->bytes_transferred(); }
+
+ private:
+  ResumableUpload* upload_;
+};
+
+}  // namespace
+
+ResumableUpload::ResumableUpload(const ResumableUploadOptions& options,
+                                 Notifier* progress_notifier)
+    : options_(options),
+      progress_notifier_(progress_notifier),
+      request_(nullptr),
+      response_(nullptr),
+      wake_(0),
+      random_(std::random_device()()),
+      chunk_offset_(0),
+      source_exhausted_(false),
+      total_size_(-1),
+      committed_(0),
+      chunk_bytes_sent_(0),
+      paused_(false),
+      canceled_(false),
+      complete_(false) {
+  size_t granularity = kResumableUploadChunkGranularity;
+  options_.chunk_size =
+      (std::max)(granularity, (options_.chunk_size + granularity - 1) /
+                                  granularity * granularity);
+}
+
+ResumableUpload::~ResumableUpload() {
+  {
+    MutexLock lock(mutex_);
+    canceled_ = true;
+  }
+  wake_.Post();
+  if (thread_.Joinable()) thread_.Join();
+}
+
+void ResumableUpload::Start(rest::Request* request, rest::Response* response) {
+  request_ = request;
+  response_ = response;
+  size_t size = request->GetPostFieldsSize();
+  // A file that is not seekable reports a size of 0 and other streams of
+  // unknown size report ~0.
+  if (size != ~static_cast<size_t>(0) &&
+      (size || !request->options().stream_post_fields)) {
+    total_size_ = static_cast<int64_t>(size);
+  }
+  thread_ = Thread(Run, this);
+}
+
+bool ResumableUpload::Pause() {
+  {
+    MutexLock lock(mutex_);
+    if (complete_ || canceled_ || paused_) return false;
+    paused_ = true;
+  }
+  wake_.Post();
+  return true;
+}
+
+bool ResumableUpload::Resume() {
+  {
+    MutexLock lock(mutex_);
+    if (!paused_) return false;
+    paused_ = false;
+  }
+  wake_.Post();
+  return true;
+}
+
+bool ResumableUpload::Cancel() {
+  {
+    MutexLock lock(mutex_);
+    if (complete_ || canceled_) return false;
+    canceled_ = true;
+  }
+  wake_.Post();
+  return true;
+}
+
+bool ResumableUpload::is_paused() const {
+  MutexLock lock(mutex_);
+  return paused_;
+}
+
+int64_t ResumableUpload::bytes_transferred() const {
+  MutexLock lock(mutex_);
+  int64_t transferred = committed_ + chunk_bytes_sent_;
+  return total_size_ >= 0 ? (std::min)(transferred, total_size_)
+                          : transferred;
+}
+
+bool ResumableUpload::interrupted() const {
+  MutexLock lock(mutex_);
+  return paused_ || canceled_;
+}
+
+void ResumableUpload::AddBytesSent(size_t bytes_sent) {
+  {
+    MutexLock lock(mutex_);
+    chunk_bytes_sent_ += static_cast<int64_t>(bytes_sent);
+  }
+  if (progress_notifier_ && bytes_sent) progress_notifier_->NotifyProgress();
+}
+
+void ResumableUpload::Upload() {
+  transport_ = rest::CreateTransport();
+  const rest::RetryPolicy& policy = options_.retry_policy;
+
+  LoadSession();
+  // A restored session must be queried to find where to continue from.
+  bool query = !upload_url_.empty();
+  int retries = 0;
+  uint64_t last_progress_ms = ::firebase::internal::GetTimestamp();
+  for (;;) {
+    bool waited = false;
+    if (!WaitWhilePaused(&waited)) {
+      Complete(nullptr);
+      return;
+    }
+    if (waited && !upload_url_.empty()) query = true;
+
+    ProtocolResponse response(policy.is_retryable);
+    Step step;
+    if (upload_url_.empty()) {
+      step = StartSession(&response);
+    } else if (query) {
+      step = QueryOffset(&response);
+    } else {
+      step = SendChunk(&response);
+    }
+
+    switch (step) {
+      case kStepContinue:
+        query = false;
+        retries = 0;
+        last_progress_ms = ::firebase::internal::GetTimestamp();
+        break;
+      case kStepDone:
+      case kStepFailed:
+        Complete(&response);
+        return;
+      case kStepRetry: {
+        // Data may have been committed by a failed chunk.
+        query = !upload_url_.empty();
+        // A paused or canceled upload is handled at the start of the loop.
+        if (interrupted()) break;
+        int64_t delay_ms = policy.GetBackoffMilliseconds(
+            ++retries,
+            std::uniform_real_distribution<double>(0.0, 1.0)(random_));
+        int64_t elapsed_ms = static_cast<int64_t>(
+            ::firebase::internal::GetTimestamp() - last_progress_ms);
+        if (elapsed_ms + delay_ms > policy.max_retry_time_ms) {
+          Complete(&response);
+          return;
+        }
+        wake_.TimedWait(static_cast<int>(delay_ms));
+        break;
+      }
+    }
+  }
+}
+
+void ResumableUpload::InitializeRequest(rest::Request* request,
+                                        const char* url, const char* command) {
+  request->set_url(url);
+  request->set_method(rest::util::kPost);
+  request->options().category = request_->options().category;
+  request->options().timeout_ms = request_->options().timeout_ms;
+  for (const auto& header : request_->options().header) {
+    if (header.first != kContentTypeHeader) {
+      request->add_header(header.first.c_str(), header.second.c_str());
+    }
+  }
+  request->add_header(kUploadProtocolHeader, kUploadProtocolResumable);
+  request->add_header(kUploadCommandHeader, command);
+}
+
+ResumableUpload::Step ResumableUpload::StartSession(
+    ProtocolResponse* response) {
+  rest::Request request;
+  InitializeRequest(&request, request_->options().url.c_str(),
+                    kUploadCommandStart);
+  Variant metadata = Variant::EmptyMap();
+  auto content_type = request_->options().header.find(kContentTypeHeader);
+  if (content_type != request_->options().header.end()) {
+    request.add_header(kUploadContentTypeHeader, content_type->second.c_str());
+    metadata.map()["contentType"] = Variant(content_type->second);
+  }
+  if (total_size_ >= 0) {
+    request.add_header(kUploadContentLengthHeader,
+                       std::to_string(total_size_).c_str());
+  }
+  request.add_header(kContentTypeHeader, kJsonContentType);
+  if (options_.metadata_json.empty()) {
+    request.set_post_fields(util::VariantToJson(metadata).c_str());
+  } else {
+    request.set_post_fields(options_.metadata_json.c_str());
+  }
+  transport_->Perform(&request, response, nullptr);
+
+  if (response->succeeded()) {
+    upload_url_ = response->GetUploadHeader(kUploadUrlHeader);
+    if (!upload_url_.empty()) {
+      SaveSession();
+      return kStepContinue;
+    }
+    LogWarning("Storage upload session did not return an upload URL.");
+    response->set_status(rest::util::HttpInvalid);
+    return kStepRetry;
+  }
+  return response->retryable() ? kStepRetry : kStepFailed;
+}
+
+ResumableUpload::Step ResumableUpload::QueryOffset(
+    ProtocolResponse* response) {
+  rest::Request request;
+  InitializeRequest(&request, upload_url_.c_str(), kUploadCommandQuery);
+  transport_->Perform(&request, response, nullptr);
+
+  if (response->succeeded()) {
+    std::string status = response->GetUploadHeader(kUploadStatusHeader);
+    if (status == kUploadStatusFinal) return kStepDone;
+    std::string received =
+        response->GetUploadHeader(kUploadSizeReceivedHeader);
+    if (status != kUploadStatusActive || received.empty()) {
+      response->set_status(rest::util::HttpInvalid);
+      return kStepRetry;
+    }
+    int64_t offset = strtoll(received.c_str(), nullptr, 10);
+    // Data before the chunk buffer can't be sent again.
+    if (offset < chunk_offset_ ||
+        (total_size_ >= 0 && offset > total_size_)) {
+      LogError("Storage upload session committed an unexpected offset %s.",
+               received.c_str());
+      DeleteSession();
+      response->set_status(rest::util::HttpBadRequest);
+      return kStepFailed;
+    }
+    MutexLock lock(mutex_);
+    committed_ = offset;
+    chunk_bytes_sent_ = 0;
+    return kStepContinue;
+  }
+  if (response->retryable()) return kStepRetry;
+  if (chunk_offset_ == 0 && chunk_.empty() && !source_exhausted_) {
+    // The persisted session has expired and no data has been read yet, so
+    // start a new session.
+    DeleteSession();
+    upload_url_.clear();
+    return kStepContinue;
+  }
+  return kStepFailed;
+}
+
+bool ResumableUpload::FillChunk() {
+  int64_t committed;
+  {
+    MutexLock lock(mutex_);
+    committed = committed_;
+  }
+  while (committed >= chunk_offset_ + static_cast<int64_t>(chunk_.size()) &&
+         !source_exhausted_) {
+    chunk_offset_ += chunk_.size();
+    chunk_.resize(options_.chunk_size);
+    size_t chunk_read = 0;
+    while (chunk_read < chunk_.size()) {
+      bool abort = false;
+      size_t read_size = request_->ReadBody(&chunk_[chunk_read],
+                                            chunk_.size() - chunk_read, &abort);
+      if (abort) return false;
+      if (!read_size) {
+        source_exhausted_ = true;
+        break;
+      }
+      chunk_read += read_size;
+    }
+    chunk_.resize(chunk_read);
+    if (total_size_ >= 0 &&
+        chunk_offset_ + static_cast<int64_t>(chunk_.size()) >= total_size_) {
+      source_exhausted_ = true;
+    }
+  }
+  return true;
+}
+
+ResumableUpload::Step ResumableUpload::SendChunk(ProtocolResponse* response) {
+  if (!FillChunk()) {
+    LogError("Failed to read data to upload to storage.");
+    response->set_status(rest::util::HttpBadRequest);
+    return kStepFailed;
+  }
+  int64_t offset;
+  {
+    MutexLock lock(mutex_);
+    offset = committed_;
+    chunk_bytes_sent_ = 0;
+  }
+  int64_t chunk_end = chunk_offset_ + static_cast<int64_t>(chunk_.size());
+  bool finalize = source_exhausted_;
+  size_t chunk_start = static_cast<size_t>(offset - chunk_offset_);
+  ChunkRequest request(chunk_.data() + chunk_start, chunk_.size() - chunk_start,
+                       this);
+  InitializeRequest(
+      &request, upload_url_.c_str(),
+      finalize ? kUploadCommandUploadAndFinalize : kUploadCommandUpload);
+  request.add_header(kUploadOffsetHeader, std::to_string(offset).c_str());
+  transport_->Perform(&request, response, nullptr);
+
+  if (response->succeeded()) {
+    if (finalize ||
+        response->GetUploadHeader(kUploadStatusHeader) == kUploadStatusFinal) {
+      return kStepDone;
+    }
+    std::string received =
+        response->GetUploadHeader(kUploadSizeReceivedHeader);
+    MutexLock lock(mutex_);
+    committed_ = received.empty() ? chunk_end
+                                  : strtoll(received.c_str(), nullptr, 10);
+    chunk_bytes_sent_ = 0;
+    return kStepContinue;
+  }
+  return response->retryable() ? kStepRetry : kStepFailed;
+}
+
+void ResumableUpload::Complete(ProtocolResponse* response) {
+  bool canceled;
+  {
+    MutexLock lock(mutex_);
+    canceled = canceled_;
+    complete_ = true;
+  }
+  if (!response || canceled) {
+    response_->set_status(rest::util::HttpNoContent);
+    request_->MarkFailed();
+    response_->MarkFailed();
+  } else if (response->retryable()) {
+    // Keep the session so the upload can be resumed later.
+    response_->set_status(rest::util::HttpRequestTimeout);
+    request_->MarkFailed();
+    response_->MarkFailed();
+  } else {
+    DeleteSession();
+    if (response->succeeded()) {
+      MutexLock lock(mutex_);
+      if (total_size_ >= 0) committed_ = total_size_;
+      chunk_bytes_sent_ = 0;
+    }
+    const char* body;
+    size_t body_size;
+    response->GetBody(&body, &body_size);
+    response_->set_status(response->status());
+    if (body_size) response_->ProcessBody(body, body_size);
+    request_->MarkCompleted();
+    response_->MarkCompleted();
+  }
+}
+
+bool ResumableUpload::WaitWhilePaused(bool* waited) {
+  for (;;) {
+    {
+      MutexLock lock(mutex_);
+      if (canceled_) return false;
+      if (!paused_) return true;
+    }
+    *waited = true;
+    wake_.Wait();
+  }
+}
+
+void ResumableUpload::LoadSession() {
+  if (options_.session_file.empty() || options_.session_key.empty()) return;
+  std::ifstream file(ToFilePath(options_.session_file),
+                     std::ios::in | std::ios::binary);
+  if (!file) return;
+  std::string key;
+  std::string url;
+  if (std::getline(file, key) && std::getline(file, url) &&
+      key == options_.session_key) {
+    upload_url_ = url;
+  }
+}
+
+void ResumableUpload::SaveSession() {
+  if (options_.session_file.empty() || options_.session_key.empty()) return;
+  std::ofstream file(ToFilePath(options_.session_file),
+                     std::ios::out | std::ios::binary | std::ios::trunc);
+  file << options_.session_key << "\n" << upload_url_ << "\n";
+  if (!file) {
+    LogWarning("Failed to save storage upload session to %s",
+               options_.session_file.c_str());
+  }
+}
+
+void ResumableUpload::DeleteSession() {
+  if (options_.session_file.empty() || options_.session_key.empty()) return;
+  RemoveFile(options_.session_file);
+}
+
+ResumableUploadTransport::ResumableUploadTransport(
+    const ResumableUploadOptions& options, Notifier* progress_notifier)
+    : upload_(new ResumableUpload(options, progress_notifier)) {}
+
+ResumableUploadTransport::~ResumableUploadTransport() {}
+
+void ResumableUploadTransport::PerformInternal(
+    rest::Request* request, rest::Response* response,
+    flatbuffers::unique_ptr<rest::Controller>* controller_out) {
+  if (controller_out) {
+    controller_out->reset(new ResumableUploadController(upload_.get()));
+  }
+  upload_->Start(request, response);
+}
+
+std::string GetFileUploadSessionKey(const char* path, const std::string& url) {
+#if FIREBASE_PLATFORM_WINDOWS
+  struct _stat64 info;
+  if (_wstat64(ToFilePath(path).c_str(), &info) != 0) return std::string();
+#else
+  struct stat info;
+  if (stat(path, &info) != 0) return std::string();
+#endif  // FIREBASE_PLATFORM_WINDOWS
+  std::stringstream key;
+  key << url << '\n'
+      << path << '\n'
+      << static_cast<int64_t>(info.st_size) << '\n'
+      << static_cast<int64_t>(info.st_mtime);
+  char hash[17];
+  snprintf(hash, sizeof(hash), "%016llx",
+           static_cast<unsigned long long>(HashString(key.str())));  // NOLINT
+  return std::string(hash);
+}
+
+std::string GetUploadSessionFile(const char* package_name,
+                                 const std::string& session_key) {
+  if (session_key.empty()) return std::string();
+  std::string app_data_prefix =
+      (package_name && package_name[0] != '\0')
+          ? std::string(package_name) + "/" + kUploadSessionDir
+          : kUploadSessionDir;
+  std::string error;
+  std::string app_dir =
+      AppDataDir(app_data_prefix.c_str(), /*should_create=*/true, &error);
+  if (!error.empty() || app_dir.empty()) return std::string();
+  return app_dir + "/" + session_key + kUploadSessionFileExtension;
+}
+
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
@@ -0,0 +1,115 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_STORAGE_SRC_DESKTOP_RESUMABLE_UPLOAD_H_
+#define FIREBASE_STORAGE_SRC_DESKTOP_RESUMABLE_UPLOAD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "app/rest/controller_interface.h"
+#include "app/rest/request.h"
+#include "app/rest/response.h"
+#include "app/rest/retry_policy.h"
+#include "app/rest/transport_interface.h"
+#include "flatbuffers/stl_emulation.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+
+class Notifier;
+class ResumableUpload;
+
+// Every chunk of a resumable upload except the last must be a multiple of
+// this size.
+const size_t kResumableUploadChunkGranularity = 256 * 1024;
+
+// Default size of each chunk of a resumable upload.
+const size_t kDefaultUploadChunkSize = 32 * kResumableUploadChunkGranularity;
+
+// Configures a resumable upload.
+struct ResumableUploadOptions {
+  ResumableUploadOptions() : chunk_size(kDefaultUploadChunkSize) {
+    retry_policy.initial_backoff_ms = 1000;
+    retry_policy.max_backoff_ms = 30000;
+    retry_policy.max_retry_time_ms = 600000;
+  }
+
+  // Number of bytes sent by each request. This is rounded up to a multiple of
+  // kResumableUploadChunkGranularity.
+  size_t chunk_size;
+  // How failed requests are retried. max_retry_time_ms is measured from the
+  // last time the upload made progress rather than from the start of the
+  // upload.
+  rest::RetryPolicy retry_policy;
+  // File used to persist the session URL so that an interrupted upload can be
+  // resumed by a later process. Empty to disable persistence.
+  std::string session_file;
+  // Identifies the data being uploaded and its destination. A persisted
+  // session is only resumed if its key matches this value.
+  std::string session_key;
+  // JSON metadata of the object, sent when the session is started. If empty
+  // only the content type of the request is sent.
+  std::string metadata_json;
+};
+
+// Uploads the body of a request using the Cloud Storage resumable upload
+// protocol. The request passed to Perform() is sent to its URL to start an
+// upload session and its body is then sent to the session in chunks. If a
+// chunk fails, the offset the server has committed is queried and the upload
+// continues from there, so only the current chunk is sent again.
+//
+// The upload runs on a thread owned by this object. Each step of the protocol
+// is sent using a synchronous transport from rest::CreateTransport().
+// The returned controller pauses the upload between requests and aborts the
+// chunk in flight, resuming queries the committed offset before continuing.
+// Canceling stops the upload but leaves the session intact, so the same data
+// can resume the upload later.
+//
+// Only one request can be performed by each instance.
+class ResumableUploadTransport : public rest::Transport {
+ public:
+  // progress_notifier is optional and is notified as data is sent.
+  ResumableUploadTransport(const ResumableUploadOptions& options,
+                           Notifier* progress_notifier);
+  // Waits for the upload thread to finish.
+  ~ResumableUploadTransport() override;
+
+ private:
+  void PerformInternal(
+      rest::Request* request, rest::Response* response,
+      flatbuffers::unique_ptr<rest::Controller>* controller_out) override;
+
+  std::unique_ptr<ResumableUpload> upload_;
+};
+
+// Build a key that identifies the upload of a file to url, or an empty string
+// if the file can't be accessed. The key changes if the file is modified.
+std::string GetFileUploadSessionKey(const char* path, const std::string& url);
+
+// Get the path of the file used to persist the upload session identified by
+// session_key, creating the directory it's stored in if required. Returns an
+// empty string if the directory isn't available.
+std::string GetUploadSessionFile(const char* package_name,
+                                 const std::string& session_key);
+
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
+
+#endif  // FIREBASE_STORAGE_SRC_DESKTOP_RESUMABLE_UPLOAD_H_
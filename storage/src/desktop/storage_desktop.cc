@@ -24,6 +24,10 @@
 #include "app/src/function_registry.h"
 #include "app/src/include/firebase/app.h"
 #include "app/src/log.h"
+#include "storage/src/desktop/bulk_operation.h"
+#include "storage/src/desktop/download_cache.h"
+#include "storage/src/desktop/parallel_download.h"
+#include "storage/src/desktop/resumable_upload.h"
 #include "storage/src/desktop/rest_operation.h"
 #include "storage/src/desktop/storage_reference_desktop.h"
 
@@ -51,6 +55,12 @@ StorageInternal::StorageInternal(App* app, const char* url) {
   //            storage/FirebaseStorage.java,
   //         //depot_firebase_ios_Releases/FirebaseStorage/\
   //            Library/FIRStorage.m)
+  upload_chunk_size_ = kDefaultUploadChunkSize;
+  max_parallel_download_parts_ = 1;
+  download_part_size_ = kDefaultDownloadPartSize;
+  direct_io_download_size_ = 0;
+  retry_scheduler_ = std::make_shared<rest::RetryScheduler>();
+  future_manager_.AllocFutureApi(this, kStorageFnCount);
 
   firebase::rest::util::Initialize();
   firebase::rest::InitTransportCurl();
@@ -67,7 +77,11 @@ StorageInternal::StorageInternal(App* app, const char* url) {
 }
 
 StorageInternal::~StorageInternal() {
+  // Complete the futures of requests waiting to be retried as cancelled while
+  // their future APIs are still valid.
+  retry_scheduler_->Shutdown();
   cleanup().CleanupAll();
+  future_manager_.ReleaseFutureApi(this);
   firebase::rest::CleanupTransportCurl();
   firebase::rest::util::Terminate();
   // Stop the token auto-update thread in Auth.
@@ -96,6 +110,63 @@ StorageReferenceInternal* StorageInternal::GetReferenceFromUrl(
   return new StorageReferenceInternal(url, const_cast<StorageInternal*>(this));
 }
 
+Future<BulkResult> StorageInternal::RunBulkOperation(
+    BulkOperation operation, const std::vector<StorageReference>& references,
+    const BulkOptions& options) {
+  auto handle = future()->SafeAlloc<BulkResult>(kStorageFnRunBulkOperation);
+  BulkOperationRunner::Start(operation, references, options, &cleanup(),
+                             future(), handle);
+  return RunBulkOperationLastResult();
+}
+
+Future<BulkResult> StorageInternal::RunBulkOperation(
+    BulkOperation operation, const StorageReference& prefix,
+    const BulkOptions& options) {
+  auto handle = future()->SafeAlloc<BulkResult>(kStorageFnRunBulkOperation);
+  BulkOperationRunner::Start(operation, prefix, options, &cleanup(), future(),
+                             handle);
+  return RunBulkOperationLastResult();
+}
+
+Future<BulkResult> StorageInternal::RunBulkOperationLastResult() {
+  return static_cast<const Future<BulkResult>&>(
+      future()->LastResult(kStorageFnRunBulkOperation));
+}
+
+ReferenceCountedFutureImpl* StorageInternal::future() {
+  return future_manager_.GetFutureApi(this);
+}
+
+std::shared_ptr<DownloadCache> StorageInternal::download_cache() {
+  MutexLock lock(download_cache_mutex_);
+  return download_cache_;
+}
+
+uint64_t StorageInternal::download_cache_size() {
+  MutexLock lock(download_cache_mutex_);
+  return download_cache_ ? download_cache_->max_size() : 0;
+}
+
+void StorageInternal::set_download_cache_size(uint64_t download_cache_size) {
+  MutexLock lock(download_cache_mutex_);
+  if (download_cache_size == 0) {
+    download_cache_.reset();
+    return;
+  }
+  if (download_cache_) {
+    download_cache_->set_max_size(download_cache_size);
+    return;
+  }
+  std::string directory = GetDownloadCacheDirectory(
+      app_->options().package_name(), root_.GetBucket());
+  if (directory.empty()) {
+    LogWarning("Unable to create a directory to cache storage downloads.");
+    return;
+  }
+  download_cache_ =
+      std::make_shared<DownloadCache>(directory, download_cache_size);
+}
+
 // Returns the auth token for the current user, if there is a current user,
 // and they have a token, and auth exists as part of the app.
 // Otherwise, returns an empty string.
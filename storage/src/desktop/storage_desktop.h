@@ -15,21 +15,33 @@
 #ifndef FIREBASE_STORAGE_SRC_DESKTOP_STORAGE_DESKTOP_H_
 #define FIREBASE_STORAGE_SRC_DESKTOP_STORAGE_DESKTOP_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "app/rest/retry_policy.h"
 #include "app/src/future_manager.h"
 #include "app/src/include/firebase/internal/mutex.h"
 #include "storage/src/desktop/storage_path.h"
 #include "storage/src/desktop/storage_reference_desktop.h"
+#include "storage/src/include/firebase/storage/bulk.h"
 #include "storage/src/include/firebase/storage/common.h"
 
 namespace firebase {
 namespace storage {
 namespace internal {
 
+class DownloadCache;
 class RestOperation;
 
+enum StorageFn {
+  kStorageFnRunBulkOperation = 0,
+  kStorageFnCount,
+};
+
 class StorageInternal {
  public:
   // Build a Storage. A nullptr or empty url uses the default getInstance.
@@ -51,6 +63,19 @@ class StorageInternal {
   // Get a StorageReference for the provided URL.
   StorageReferenceInternal* GetReferenceFromUrl(const char* url);
 
+  // Asynchronously performs operation on each object in references.
+  Future<BulkResult> RunBulkOperation(
+      BulkOperation operation, const std::vector<StorageReference>& references,
+      const BulkOptions& options);
+
+  // Asynchronously performs operation on each object under prefix.
+  Future<BulkResult> RunBulkOperation(BulkOperation operation,
+                                      const StorageReference& prefix,
+                                      const BulkOptions& options);
+
+  // Returns the result of the most recent call to RunBulkOperation();
+  Future<BulkResult> RunBulkOperationLastResult();
+
   // Returns the maximum time (in seconds) to retry a download if a failure
   // occurs.
   double max_download_retry_time() { return max_download_retry_time_; }
@@ -69,6 +94,55 @@ class StorageInternal {
     max_upload_retry_time_ = max_upload_retry_time;
   }
 
+  // Returns the size of each chunk sent by a resumable upload. Uploads larger
+  // than one chunk use the resumable upload protocol.
+  size_t upload_chunk_size() { return upload_chunk_size_; }
+
+  // Sets the size of each chunk sent by a resumable upload. This is rounded up
+  // to a multiple of 256 KiB.
+  void set_upload_chunk_size(size_t upload_chunk_size) {
+    upload_chunk_size_ = upload_chunk_size;
+  }
+
+  // Returns the number of parts of an object GetFile() downloads at the same
+  // time. Objects are downloaded with a single request if this is 1.
+  int max_parallel_download_parts() { return max_parallel_download_parts_; }
+
+  // Sets the number of parts of an object GetFile() downloads at the same
+  // time, values greater than 1 enable parallel ranged downloads.
+  void set_max_parallel_download_parts(int max_parallel_download_parts) {
+    max_parallel_download_parts_ = max_parallel_download_parts;
+  }
+
+  // Returns the size of each part of a parallel download.
+  size_t download_part_size() { return download_part_size_; }
+
+  // Sets the size of each part of a parallel download.
+  void set_download_part_size(size_t download_part_size) {
+    download_part_size_ = download_part_size;
+  }
+
+  // Returns the size of the smallest object GetFile() writes with direct I/O,
+  // bypassing the page cache, or 0 if direct I/O isn't used.
+  uint64_t direct_io_download_size() { return direct_io_download_size_; }
+
+  // Sets the size of the smallest object GetFile() writes with direct I/O, 0
+  // disables direct I/O. Not supported on Windows.
+  void set_direct_io_download_size(uint64_t direct_io_download_size) {
+    direct_io_download_size_ = direct_io_download_size;
+  }
+
+  // Returns the cache of downloaded objects used by GetFile() and GetBytes(),
+  // or null if downloads aren't cached.
+  std::shared_ptr<DownloadCache> download_cache();
+
+  // Returns the maximum number of bytes of downloaded objects kept on disk.
+  uint64_t download_cache_size();
+
+  // Sets the maximum number of bytes of downloaded objects kept on disk, 0
+  // disables the cache.
+  void set_download_cache_size(uint64_t download_cache_size);
+
   // Returns the maximum time (in seconds) to retry operations other than upload
   // and download if a failure occurs.
   double max_operation_retry_time() { return max_operation_retry_time_; }
@@ -106,6 +180,11 @@ class StorageInternal {
   // Returns the Host for the storage backend
   std::string get_host() { return host_; }
 
+  // Returns the scheduler that times the retries of this storage's requests.
+  const std::shared_ptr<rest::RetryScheduler>& retry_scheduler() const {
+    return retry_scheduler_;
+  }
+
   // Returns the Port for the storage backend
   int get_port() { return port_; }
 
@@ -116,6 +195,8 @@ class StorageInternal {
   // Clean up completed operations.
   void CleanupCompletedOperations();
 
+  ReferenceCountedFutureImpl* future();
+
  private:
   App* app_;
 
@@ -126,8 +207,21 @@ class StorageInternal {
   double max_download_retry_time_;
   double max_operation_retry_time_;
   double max_upload_retry_time_;
+  size_t upload_chunk_size_;
+  int max_parallel_download_parts_;
+  size_t download_part_size_;
+  uint64_t direct_io_download_size_;
   StoragePath root_;
 
+  Mutex download_cache_mutex_;
+  // Shared with the downloads using it, so it outlives them if the cache is
+  // disabled while they are in progress.
+  std::shared_ptr<DownloadCache> download_cache_;
+
+  // Shared with the retrying requests, which are aborted when the storage is
+  // destroyed.
+  std::shared_ptr<rest::RetryScheduler> retry_scheduler_;
+
   CleanupNotifier cleanup_;
   std::string user_agent_;
   Mutex operations_mutex_;
@@ -14,24 +14,30 @@
 
 #include "storage/src/desktop/storage_reference_desktop.h"
 
-#include <chrono>  // NOLINT
+#include <functional>
 #include <limits>
 #include <memory>
-#include <thread>  // NOLINT
+#include <string>
+#include <type_traits>
 
 #include "app/rest/request.h"
 #include "app/rest/request_binary.h"
 #include "app/rest/request_file.h"
+#include "app/rest/retry_policy.h"
 #include "app/rest/transport_curl.h"
 #include "app/rest/util.h"
 #include "app/src/app_common.h"
 #include "app/src/function_registry.h"
 #include "app/src/include/firebase/app.h"
+#include "app/src/log.h"
 #include "app/src/thread.h"
 #include "app/src/variant_util.h"
 #include "storage/src/common/common_internal.h"
 #include "storage/src/desktop/controller_desktop.h"
+#include "storage/src/desktop/download_cache.h"
 #include "storage/src/desktop/metadata_desktop.h"
+#include "storage/src/desktop/parallel_download.h"
+#include "storage/src/desktop/resumable_upload.h"
 #include "storage/src/desktop/storage_desktop.h"
 #include "storage/src/include/firebase/storage.h"
 #include "storage/src/include/firebase/storage/common.h"
@@ -104,10 +110,11 @@ void StorageReferenceInternal::RestCall(rest::Request* request,
                                         Notifier* request_notifier,
                                         BlockingResponse* response,
                                         FutureHandle handle, Listener* listener,
-                                        Controller* controller_out) {
+                                        Controller* controller_out,
+                                        rest::Transport* transport) {
   RestOperation::Start(storage_, AsStorageReference(), request,
                        request_notifier, response, listener, handle,
-                       controller_out);
+                       controller_out, transport);
 }
 
 const char kFileProtocol[] = "file://";
@@ -122,6 +129,15 @@ std::string StripProtocol(std::string s) {
   return s;
 }
 
+// Returns a checksum to add the data of an upload to. Both hashes are
+// computed as the server may not report the CRC32C of the object.
+static std::shared_ptr<TransferChecksum> NewUploadChecksum() {
+  std::shared_ptr<TransferChecksum> checksum =
+      std::make_shared<TransferChecksum>();
+  checksum->Start(TransferChecksum::kTypeCrc32c | TransferChecksum::kTypeMd5);
+  return checksum;
+}
+
 // Data structure used by SetupMetadataChain.  (See below.)  Basically all the
 // data that needs to be preserved throughout the chain of OnCompletion calls.
 // Is deleted by the final call.
@@ -148,6 +164,12 @@ struct MetadataChainData {
   // The future implementation of the original caller.  Needed to complete
   // the future returned to the user.
   ReferenceCountedFutureImpl* original_future;
+  // Metadata encoded as JSON, sent with the data when it's uploaded.
+  std::string metadata_json;
+  // Set if the backend rejected the upload of the data with metadata_json.
+  bool metadata_rejected = false;
+  // Uploads the data without metadata, used by SetupMetadataFallback.
+  std::function<Future<Metadata>()> upload_without_metadata;
 };
 
 // Convenience function for handling operations that need to update a file
@@ -202,6 +224,39 @@ void StorageReferenceInternal::SetupMetadataChain(
       data);
 }
 
+// Completes the future of an upload that sent the metadata along with the
+// data.  If the backend rejected the metadata, this falls back to uploading
+// the data and then updating the metadata using SetupMetadataChain.
+void StorageReferenceInternal::SetupMetadataFallback(
+    Future<Metadata> starting_future, MetadataChainData* data) {
+  data->inner_future = starting_future;
+  starting_future.OnCompletion(
+      [](const Future<Metadata>& result, void* data) {
+        MetadataChainData* on_completion_data =
+            static_cast<MetadataChainData*>(data);
+        if (result.error() != 0 && on_completion_data->metadata_rejected &&
+            on_completion_data->storage_ref.is_valid()) {
+          LogDebug(
+              "Upload with metadata was rejected, uploading data and "
+              "metadata separately.");
+          on_completion_data->storage_ref.internal_->SetupMetadataChain(
+              on_completion_data->upload_without_metadata(),
+              on_completion_data);
+        } else {
+          if (result.error() != 0) {
+            on_completion_data->original_future->Complete(
+                on_completion_data->handle, result.error(),
+                result.error_message());
+          } else {
+            on_completion_data->original_future->CompleteWithResult(
+                on_completion_data->handle, kErrorNone, *(result.result()));
+          }
+          delete on_completion_data;
+        }
+      },
+      data);
+}
+
 // Deletes the object at the current path.
 Future<void> StorageReferenceInternal::Delete() {
   auto* future_api = future();
@@ -239,6 +294,7 @@ void StorageReferenceInternal::PrepareRequestBlocking(
     const char* content_type) {
   request->set_url(url);
   request->set_method(method);
+  request->options().category = rest::kTransferCategoryStorage;
 
   // Set this request to have no timeout.
   request->options().timeout_ms = 0;
@@ -280,6 +336,10 @@ Future<size_t> StorageReferenceInternal::GetFile(const char* path,
                                                  Controller* controller_out) {
   auto handle = future()->SafeAlloc<size_t>(kStorageReferenceFnGetFile);
   std::string final_path = StripProtocol(path);
+  if (storage_->max_parallel_download_parts() > 1) {
+    GetFileParallel(final_path, handle, listener, controller_out);
+    return GetFileLastResult();
+  }
   auto send_request_funct{
       [&, final_path, listener, controller_out]() -> BlockingResponse* {
         auto* future_api = future();
@@ -288,8 +348,10 @@ Future<size_t> StorageReferenceInternal::GetFile(const char* path,
         storage::internal::Request* request = new storage::internal::Request();
         PrepareRequestBlocking(request, storageUri_.AsHttpUrl().c_str(),
                                rest::util::kGet);
-        GetFileResponse* response =
-            new GetFileResponse(final_path.c_str(), handle, future_api);
+        GetFileResponse* response = new GetFileResponse(
+            final_path.c_str(), handle, future_api,
+            PrepareDownloadCacheRequest(request),
+            storage_->direct_io_download_size());
         RestCall(request, request->notifier(), response, handle.get(), listener,
                  controller_out);
         return response;
@@ -300,6 +362,43 @@ Future<size_t> StorageReferenceInternal::GetFile(const char* path,
   return GetFileLastResult();
 }
 
+void StorageReferenceInternal::GetFileParallel(const std::string& path,
+                                               SafeFutureHandle<size_t> handle,
+                                               Listener* listener,
+                                               Controller* controller_out) {
+  storage::internal::Request* request = new storage::internal::Request();
+  PrepareRequestBlocking(request, storageUri_.AsHttpUrl().c_str(),
+                         rest::util::kGet);
+  ParallelDownloadOptions options;
+  options.path = path;
+  options.part_size = storage_->download_part_size();
+  options.max_parallel_parts = storage_->max_parallel_download_parts();
+  options.retry_policy.max_retry_time_ms =
+      static_cast<int64_t>(storage_->max_download_retry_time() * 1000.0);
+  options.retry_policy.is_retryable = IsRetryableFailure;
+  RestCall(request, request->notifier(),
+           new DownloadedFileResponse(handle, future()), handle.get(), listener,
+           controller_out,
+           new ParallelDownloadTransport(options, request->notifier()));
+}
+
+DownloadCacheRequest StorageReferenceInternal::PrepareDownloadCacheRequest(
+    rest::Request* request) {
+  DownloadCacheRequest cache_request;
+  cache_request.cache = storage_->download_cache();
+  if (!cache_request.cache) return cache_request;
+  cache_request.key = DownloadCache::GetKey(storageUri_.GetBucket(),
+                                            storageUri_.GetPath().str());
+  DownloadCache::Entry entry;
+  if (cache_request.cache->Lookup(cache_request.key, &entry)) {
+    // The server responds with 304 (Not Modified) if the cached version is
+    // still current.
+    cache_request.etag = entry.etag;
+    request->add_header("If-None-Match", entry.etag.c_str());
+  }
+  return cache_request;
+}
+
 Future<size_t> StorageReferenceInternal::GetFileLastResult() {
   return static_cast<const Future<size_t>&>(
       future()->LastResult(kStorageReferenceFnGetFile));
@@ -320,7 +419,8 @@ Future<size_t> StorageReferenceInternal::GetBytes(void* buffer,
     PrepareRequestBlocking(request, storageUri_.AsHttpUrl().c_str(),
                            rest::util::kGet);
     GetBytesResponse* response =
-        new GetBytesResponse(buffer, buffer_size, handle, future_api);
+        new GetBytesResponse(buffer, buffer_size, handle, future_api,
+                             PrepareDownloadCacheRequest(request));
     RestCall(request, request->notifier(), response, handle.get(), listener,
              controller_out);
     return response;
@@ -330,77 +430,124 @@ Future<size_t> StorageReferenceInternal::GetBytes(void* buffer,
   return GetBytesLastResult();
 }
 
-// Sends a rest request, and creates a separate thread to retry failures.
-template <typename FutureType>
-void StorageReferenceInternal::SendRequestWithRetry(
-    StorageReferenceFn internal_function_reference,
-    SendRequestFunct send_request_funct,
-    SafeFutureHandle<FutureType> final_handle, double max_retry_time_seconds) {
-  BlockingResponse* first_response = send_request_funct();
-  std::thread async_retry_thread(
-      &StorageReferenceInternal::AsyncSendRequestWithRetry<FutureType>, this,
-      internal_function_reference, send_request_funct, final_handle,
-      first_response, max_retry_time_seconds);
-  async_retry_thread.detach();
+// Asynchronously downloads the object from this StorageReference, passing
+// the data to sink as it arrives.
+Future<size_t> StorageReferenceInternal::GetStream(DownloadSink* sink,
+                                                   Listener* listener,
+                                                   Controller* controller_out) {
+  auto handle = future()->SafeAlloc<size_t>(kStorageReferenceFnGetStream);
+  // Data already passed to the sink isn't requested again when retrying.
+  std::shared_ptr<size_t> bytes_delivered = std::make_shared<size_t>(0);
+  auto send_request_funct{[&, sink, bytes_delivered, listener,
+                           controller_out]() -> BlockingResponse* {
+    auto* future_api = future();
+    auto handle =
+        future_api->SafeAlloc<size_t>(kStorageReferenceFnGetStreamInternal);
+    storage::internal::Request* request = new storage::internal::Request();
+    PrepareRequestBlocking(request, storageUri_.AsHttpUrl().c_str(),
+                           rest::util::kGet);
+    if (*bytes_delivered) {
+      std::string range = "bytes=" + std::to_string(*bytes_delivered) + "-";
+      request->add_header("Range", range.c_str());
+    }
+    DownloadSinkResponse* response =
+        new DownloadSinkResponse(sink, bytes_delivered, handle, future_api);
+    RestCall(request, request->notifier(), response, handle.get(), listener,
+             controller_out);
+    return response;
+  }};
+  SendRequestWithRetry(kStorageReferenceFnGetStreamInternal,
+                       send_request_funct, handle,
+                       storage_->max_download_retry_time());
+  return GetStreamLastResult();
+}
+
+Future<size_t> StorageReferenceInternal::GetStreamLastResult() {
+  return static_cast<const Future<size_t>&>(
+      future()->LastResult(kStorageReferenceFnGetStream));
 }
 
 const int kInitialSleepTimeMillis = 1000;
 const int kMaxSleepTimeMillis = 30000;
 
-// In a separate thread, repeatedly send Rest requests until one succeeds or a
-// maximum amount of time has passed.
+// Sends a rest request, retrying failures on the storage's retry scheduler
+// until one succeeds or a maximum amount of time has passed.
 template <typename FutureType>
-void StorageReferenceInternal::AsyncSendRequestWithRetry(
+void StorageReferenceInternal::SendRequestWithRetry(
     StorageReferenceFn internal_function_reference,
     SendRequestFunct send_request_funct,
-    SafeFutureHandle<FutureType> final_handle, BlockingResponse* response,
-    double max_retry_time_seconds) {
+    SafeFutureHandle<FutureType> final_handle, double max_retry_time_seconds) {
+  rest::RetryPolicy policy;
+  policy.initial_backoff_ms = kInitialSleepTimeMillis;
+  policy.max_backoff_ms = kMaxSleepTimeMillis;
+  policy.max_retry_time_ms =
+      static_cast<int64_t>(max_retry_time_seconds * 1000.0);
+  policy.is_retryable = IsRetryableFailure;
+
+  // Future of the most recently completed attempt.
+  struct RetryState {
+    Mutex mutex;
+    FutureBase internal_future;
+  };
+  std::shared_ptr<RetryState> state = std::make_shared<RetryState>();
   auto* future_api = future();
-  firebase::FutureBase internal_future;
-  auto end_time = std::chrono::steady_clock::now() +
-                  std::chrono::duration<double>(max_retry_time_seconds);
-  auto current_sleep_time = std::chrono::milliseconds(kInitialSleepTimeMillis);
-  auto max_sleep_time = std::chrono::milliseconds(kMaxSleepTimeMillis);
-  while (true) {
-    internal_future = future_api->LastResult(internal_function_reference);
-    // Wait for completion, then check status and error.
-    while (internal_future.status() == firebase::kFutureStatusPending) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
-    // For any request that succeeds or fails in a non-retryable way, don't
-    // bother retrying. Response can be null if the request failed to create.
-    int httpStatus = response == nullptr ? 400 : response->status();
-    if (internal_future.status() != firebase::kFutureStatusComplete ||
-        !IsRetryableFailure(httpStatus)) {
-      break;
-    }
-    // Interrupt the loop if the retry deadline has been reached
-    auto current_time = std::chrono::steady_clock::now();
-    if (current_time + current_sleep_time > end_time) {
-      break;
+
+  auto start_attempt = [this, state, internal_function_reference,
+                        send_request_funct](
+                           const std::shared_ptr<rest::RetryCall>& call,
+                           int attempt) {
+    // Response can be null if the request failed to create, in which case the
+    // internal future is already complete.
+    BlockingResponse* response = send_request_funct();
+    FutureBase internal_future =
+        future()->LastResult(internal_function_reference);
+    internal_future.OnCompletion(
+        [state, call, response, attempt](const FutureBase& result) {
+          {
+            MutexLock lock(state->mutex);
+            state->internal_future = result;
+          }
+          // For any request that succeeds or fails in a non-retryable way,
+          // don't bother retrying.
+          int http_status = rest::util::HttpBadRequest;
+          const char* retry_after = nullptr;
+          if (response != nullptr && result.status() == kFutureStatusComplete) {
+            http_status = response->status();
+            retry_after = response->GetHeader("Retry-After");
+          }
+          call->AttemptComplete(attempt, http_status, retry_after);
+        });
+  };
+
+  auto complete = [state, future_api, final_handle](int attempt, int) {
+    if (attempt == rest::RetryCall::kAbortedAttempt) {
+      future_api->Complete(final_handle, kErrorCancelled,
+                           GetErrorMessage(kErrorCancelled));
+      return;
     }
-    // Sleep for an exponentially increasing duration, then retry the request.
-    std::this_thread::sleep_for(current_sleep_time);
-    current_sleep_time *= 2;
-    if (current_sleep_time > max_sleep_time) {
-      current_sleep_time = max_sleep_time;
+    FutureBase internal_future;
+    {
+      MutexLock lock(state->mutex);
+      internal_future = state->internal_future;
     }
-    response = send_request_funct();
-  }
-  // Copy from the internal future to the final future.
-  Future<FutureType> typed_future =
-      static_cast<const Future<FutureType>&>(internal_future);
-  if (typed_future.result() != nullptr) {
-    if constexpr (std::is_void<FutureType>::value) {
-      future_api->Complete(final_handle, internal_future.error());
+    // Copy from the internal future to the final future.
+    Future<FutureType> typed_future =
+        static_cast<const Future<FutureType>&>(internal_future);
+    if (typed_future.result() != nullptr) {
+      if constexpr (std::is_void<FutureType>::value) {
+        future_api->Complete(final_handle, internal_future.error());
+      } else {
+        future_api->CompleteWithResult(final_handle, internal_future.error(),
+                                       *(typed_future.result()));
+      }
     } else {
-      future_api->CompleteWithResult(final_handle, internal_future.error(),
-                                     *(typed_future.result()));
+      future_api->Complete(final_handle, internal_future.error(),
+                           internal_future.error_message());
     }
-  } else {
-    future_api->Complete(final_handle, internal_future.error(),
-                         internal_future.error_message());
-  }
+  };
+
+  rest::RetryCall::Start(policy, storage_->retry_scheduler(), start_attempt,
+                         complete);
 }
 
 // Can be set in tests to retry all types of errors.
@@ -431,24 +578,46 @@ Future<Metadata> StorageReferenceInternal::PutBytes(
 
 Future<Metadata> StorageReferenceInternal::PutBytesInternal(
     const void* buffer, size_t buffer_size, Listener* listener,
-    Controller* controller_out, const char* content_type) {
+    Controller* controller_out, const char* content_type,
+    const char* metadata_json, bool* metadata_rejected) {
   auto* future_api = future();
   auto handle = future_api->SafeAlloc<Metadata>(kStorageReferenceFnPutBytes);
 
+  if (UseResumableUpload(buffer_size)) {
+    storage::internal::RequestBinary* request =
+        new storage::internal::RequestBinary(static_cast<const char*>(buffer),
+                                             buffer_size);
+    std::shared_ptr<TransferChecksum> checksum = NewUploadChecksum();
+    request->set_checksum(checksum);
+    PutResumable(request, request->notifier(), GetUploadUrl("resumable"),
+                 content_type, handle, listener, controller_out, std::string(),
+                 metadata_json, metadata_rejected, checksum);
+    return PutBytesLastResult();
+  }
+
   std::string content_type_str = content_type ? content_type : "";
-  auto send_request_funct{[&, content_type_str, buffer, buffer_size, listener,
-                           controller_out]() -> BlockingResponse* {
+  std::string metadata_json_str = metadata_json ? metadata_json : "";
+  auto send_request_funct{[&, content_type_str, metadata_json_str, buffer,
+                           buffer_size, listener, controller_out,
+                           metadata_rejected]() -> BlockingResponse* {
     auto* future_api = future();
     auto handle =
         future_api->SafeAlloc<Metadata>(kStorageReferenceFnPutBytesInternal);
 
+    std::shared_ptr<TransferChecksum> checksum = NewUploadChecksum();
     storage::internal::RequestBinary* request =
         new storage::internal::RequestBinary(static_cast<const char*>(buffer),
                                              buffer_size);
+    request->set_checksum(checksum);
+    if (!metadata_json_str.empty()) {
+      return PutMultipart(request, content_type_str.c_str(), metadata_json_str,
+                          handle, listener, controller_out, metadata_rejected,
+                          checksum);
+    }
     PrepareRequestBlocking(request, storageUri_.AsHttpUrl().c_str(),
                            rest::util::kPost, content_type_str.c_str());
-    ReturnedMetadataResponse* response =
-        new ReturnedMetadataResponse(handle, future_api, AsStorageReference());
+    ReturnedMetadataResponse* response = new ReturnedMetadataResponse(
+        handle, future_api, AsStorageReference(), checksum);
     RestCall(request, request->notifier(), response, handle.get(), listener,
              controller_out);
     return response;
@@ -468,15 +637,23 @@ Future<Metadata> StorageReferenceInternal::PutBytes(
   auto handle = future_api->SafeAlloc<Metadata>(kStorageReferenceFnPutBytes);
   MetadataChainData* data =
       new MetadataChainData(handle, metadata, AsStorageReference(), future_api);
-  // This is the future to do the actual putfile.  Note that it is on a
+  data->metadata_json = data->metadata.internal_->ExportAsJson();
+  data->upload_without_metadata = [data, buffer, buffer_size, listener,
+                                   controller_out]() {
+    return data->storage_ref.internal_->PutBytesInternal(
+        buffer, buffer_size, listener, controller_out,
+        data->metadata.content_type());
+  };
+  // This is the future to do the actual putbytes.  Note that it is on a
   // different storage reference than the original, so the caller of this
-  // function can't access it via PutFileLastResult.
+  // function can't access it via PutBytesLastResult.
   Future<Metadata> putbytes_internal =
       data->storage_ref.internal_->PutBytesInternal(
           buffer, buffer_size, listener, controller_out,
-          metadata ? metadata->content_type() : nullptr);
+          data->metadata.content_type(), data->metadata_json.c_str(),
+          &data->metadata_rejected);
 
-  SetupMetadataChain(putbytes_internal, data);
+  SetupMetadataFallback(putbytes_internal, data);
 
   return PutBytesLastResult();
 }
@@ -498,14 +675,33 @@ Future<Metadata> StorageReferenceInternal::PutFile(const char* path,
 
 Future<Metadata> StorageReferenceInternal::PutFileInternal(
     const char* path, Listener* listener, Controller* controller_out,
-    const char* content_type) {
+    const char* content_type, const char* metadata_json,
+    bool* metadata_rejected) {
   auto* future_api = future();
   auto handle = future_api->SafeAlloc<Metadata>(kStorageReferenceFnPutFile);
 
   std::string final_path = StripProtocol(path);
+  std::unique_ptr<storage::internal::RequestFile> resumable_request(
+      new storage::internal::RequestFile(final_path.c_str(), 0));
+  if (resumable_request->IsFileOpen() &&
+      UseResumableUpload(resumable_request->file_size())) {
+    std::string url = GetUploadUrl("resumable");
+    storage::internal::RequestFile* request = resumable_request.release();
+    std::shared_ptr<TransferChecksum> checksum = NewUploadChecksum();
+    request->set_checksum(checksum);
+    PutResumable(request, request->notifier(), url, content_type, handle,
+                 listener, controller_out,
+                 GetFileUploadSessionKey(final_path.c_str(), url),
+                 metadata_json, metadata_rejected, checksum);
+    return PutFileLastResult();
+  }
+  resumable_request.reset();
+
   std::string content_type_str = content_type ? content_type : "";
-  auto send_request_funct{[&, final_path, content_type_str, listener,
-                           controller_out]() -> BlockingResponse* {
+  std::string metadata_json_str = metadata_json ? metadata_json : "";
+  auto send_request_funct{[&, final_path, content_type_str, metadata_json_str,
+                           listener, controller_out,
+                           metadata_rejected]() -> BlockingResponse* {
     auto* future_api = future();
     auto handle =
         future_api->SafeAlloc<Metadata>(kStorageReferenceFnPutFileInternal);
@@ -518,9 +714,16 @@ Future<Metadata> StorageReferenceInternal::PutFileInternal(
       future_api->Complete(handle, kErrorUnknown, "Could not read file.");
       return nullptr;
     } else {
+      std::shared_ptr<TransferChecksum> checksum = NewUploadChecksum();
+      request->set_checksum(checksum);
+      if (!metadata_json_str.empty()) {
+        return PutMultipart(request, content_type_str.c_str(),
+                            metadata_json_str, handle, listener,
+                            controller_out, metadata_rejected, checksum);
+      }
       // Everything is good.  Fire off the request.
       ReturnedMetadataResponse* response = new ReturnedMetadataResponse(
-          handle, future_api, AsStorageReference());
+          handle, future_api, AsStorageReference(), checksum);
 
       PrepareRequestBlocking(request, storageUri_.AsHttpUrl().c_str(),
                              rest::util::kPost, content_type_str.c_str());
@@ -534,6 +737,82 @@ Future<Metadata> StorageReferenceInternal::PutFileInternal(
   return PutFileLastResult();
 }
 
+bool StorageReferenceInternal::UseResumableUpload(size_t upload_size) const {
+  return upload_size > storage_->upload_chunk_size();
+}
+
+std::string StorageReferenceInternal::GetUploadUrl(
+    const char* upload_type) const {
+  // [scheme]://[host]:[port]/v0/b/[bucket]/o?name=[path]&uploadType=[type]
+  std::string url = storage_->get_scheme();
+  url += "://";
+  url += storage_->get_host();
+  url += ":";
+  url += std::to_string(storage_->get_port());
+  url += "/v0/b/";
+  url += bucket();
+  url += "/o?name=";
+  url += rest::util::EncodeUrl(storageUri_.GetPath().str());
+  if (upload_type) {
+    url += "&uploadType=";
+    url += upload_type;
+  }
+  return url;
+}
+
+BlockingResponse* StorageReferenceInternal::PutMultipart(
+    rest::Request* content, const char* content_type,
+    const std::string& metadata_json, SafeFutureHandle<Metadata> handle,
+    Listener* listener, Controller* controller_out, bool* metadata_rejected,
+    const std::shared_ptr<TransferChecksum>& upload_checksum) {
+  storage::internal::RequestMultipart* request =
+      new storage::internal::RequestMultipart(metadata_json, content_type,
+                                              content);
+  PrepareRequestBlocking(request, GetUploadUrl(nullptr).c_str(),
+                         rest::util::kPost, request->GetContentType().c_str());
+  request->add_header("X-Goog-Upload-Protocol", "multipart");
+  UploadWithMetadataResponse* response =
+      new UploadWithMetadataResponse(handle, future(), AsStorageReference(),
+                                     metadata_rejected, upload_checksum);
+  RestCall(request, request->notifier(), response, handle.get(), listener,
+           controller_out);
+  return response;
+}
+
+void StorageReferenceInternal::PutResumable(
+    rest::Request* request, internal::Notifier* request_notifier,
+    const std::string& url, const char* content_type,
+    SafeFutureHandle<Metadata> handle, Listener* listener,
+    Controller* controller_out, const std::string& session_key,
+    const char* metadata_json, bool* metadata_rejected,
+    const std::shared_ptr<TransferChecksum>& upload_checksum) {
+  PrepareRequestBlocking(request, url.c_str(), rest::util::kPost,
+                         content_type);
+  ResumableUploadOptions options;
+  options.chunk_size = storage_->upload_chunk_size();
+  options.retry_policy.max_retry_time_ms =
+      static_cast<int64_t>(storage_->max_upload_retry_time() * 1000.0);
+  if (!session_key.empty()) {
+    options.session_key = session_key;
+    options.session_file = GetUploadSessionFile(
+        storage_->app()->options().package_name(), session_key);
+  }
+  ReturnedMetadataResponse* response;
+  if (metadata_json) {
+    options.metadata_json = metadata_json;
+    response =
+        new UploadWithMetadataResponse(handle, future(), AsStorageReference(),
+                                       metadata_rejected, upload_checksum);
+  } else {
+    response = new ReturnedMetadataResponse(handle, future(),
+                                            AsStorageReference(),
+                                            upload_checksum);
+  }
+  RestCall(request, request_notifier, response, handle.get(), listener,
+           controller_out,
+           new ResumableUploadTransport(options, request_notifier));
+}
+
 // Asynchronously uploads data to the currently specified StorageReference,
 // without additional metadata.
 Future<Metadata> StorageReferenceInternal::PutFile(const char* path,
@@ -545,15 +824,23 @@ Future<Metadata> StorageReferenceInternal::PutFile(const char* path,
   auto handle = future_api->SafeAlloc<Metadata>(kStorageReferenceFnPutFile);
   MetadataChainData* data =
       new MetadataChainData(handle, metadata, AsStorageReference(), future_api);
+  data->metadata_json = data->metadata.internal_->ExportAsJson();
+  std::string path_str = path;
+  data->upload_without_metadata = [data, path_str, listener,
+                                   controller_out]() {
+    return data->storage_ref.internal_->PutFileInternal(
+        path_str.c_str(), listener, controller_out,
+        data->metadata.content_type());
+  };
   // This is the future to do the actual putfile.  Note that it is on a
   // different storage reference than the original, so the caller of this
   // function can't access it via PutFileLastResult.
   Future<Metadata> putfile_internal =
       data->storage_ref.internal_->PutFileInternal(
-          path, listener, controller_out,
-          metadata ? metadata->content_type() : nullptr);
+          path, listener, controller_out, data->metadata.content_type(),
+          data->metadata_json.c_str(), &data->metadata_rejected);
 
-  SetupMetadataChain(putfile_internal, data);
+  SetupMetadataFallback(putfile_internal, data);
 
   return PutFileLastResult();
 }
@@ -564,6 +851,52 @@ Future<Metadata> StorageReferenceInternal::PutFileLastResult() {
       future()->LastResult(kStorageReferenceFnPutFile));
 }
 
+// Asynchronously uploads data read from source to the currently specified
+// StorageReference, without additional metadata.
+Future<Metadata> StorageReferenceInternal::PutStream(
+    UploadSource* source, Listener* listener, Controller* controller_out) {
+  return PutStream(source, nullptr, listener, controller_out);
+}
+
+// The data is always sent using the resumable upload protocol, which only
+// buffers one chunk of the source at a time and can retry a failed chunk
+// without reading the source again.
+Future<Metadata> StorageReferenceInternal::PutStreamInternal(
+    UploadSource* source, Listener* listener, Controller* controller_out,
+    const char* content_type, const char* metadata_json,
+    bool* metadata_rejected) {
+  auto handle = future()->SafeAlloc<Metadata>(kStorageReferenceFnPutStream);
+  storage::internal::RequestUploadSource* request =
+      new storage::internal::RequestUploadSource(source);
+  std::shared_ptr<TransferChecksum> checksum = NewUploadChecksum();
+  request->set_checksum(checksum);
+  PutResumable(request, request->notifier(), GetUploadUrl("resumable"),
+               content_type, handle, listener, controller_out, std::string(),
+               metadata_json, metadata_rejected, checksum);
+  return PutStreamLastResult();
+}
+
+// Asynchronously uploads data read from source to the currently specified
+// StorageReference, with metadata included.
+Future<Metadata> StorageReferenceInternal::PutStream(
+    UploadSource* source, const Metadata* metadata, Listener* listener,
+    Controller* controller_out) {
+  if (!metadata) return PutStreamInternal(source, listener, controller_out);
+  Metadata stream_metadata(*metadata);
+  MetadataSetDefaults(&stream_metadata);
+  std::string metadata_json = stream_metadata.internal_->ExportAsJson();
+  // Unlike PutBytes() and PutFile() there is no fallback to uploading the
+  // data and metadata separately, as the source can't be read again.
+  return PutStreamInternal(source, listener, controller_out,
+                           stream_metadata.content_type(),
+                           metadata_json.c_str());
+}
+
+Future<Metadata> StorageReferenceInternal::PutStreamLastResult() {
+  return static_cast<const Future<Metadata>&>(
+      future()->LastResult(kStorageReferenceFnPutStream));
+}
+
 // Retrieves metadata associated with an object at this StorageReference.
 Future<Metadata> StorageReferenceInternal::GetMetadata() {
   auto* future_api = future();
@@ -15,12 +15,16 @@
 #ifndef FIREBASE_STORAGE_SRC_DESKTOP_STORAGE_REFERENCE_DESKTOP_H_
 #define FIREBASE_STORAGE_SRC_DESKTOP_STORAGE_REFERENCE_DESKTOP_H_
 
+#include <memory>
 #include <string>
 
+#include "app/rest/transport_interface.h"
 #include "app/src/include/firebase/app.h"
 #include "app/src/include/firebase/future.h"
 #include "app/src/reference_counted_future_impl.h"
+#include "storage/src/desktop/checksum.h"
 #include "storage/src/desktop/curl_requests.h"
+#include "storage/src/desktop/download_cache.h"
 #include "storage/src/desktop/storage_path.h"
 #include "storage/src/include/firebase/storage/storage_reference.h"
 
@@ -46,6 +50,9 @@ enum StorageReferenceFn {
   kStorageReferenceFnPutFileInternal,
   kStorageReferenceFnList,
   kStorageReferenceFnListInternal,
+  kStorageReferenceFnGetStream,
+  kStorageReferenceFnGetStreamInternal,
+  kStorageReferenceFnPutStream,
   kStorageReferenceFnCount,
 };
 
@@ -102,6 +109,14 @@ class StorageReferenceInternal {
   // Returns the result of the most recent call to GetBytes();
   Future<size_t> GetBytesLastResult();
 
+  // Asynchronously downloads the object from this StorageReference, passing
+  // the data to sink as it arrives.
+  Future<size_t> GetStream(DownloadSink* sink, Listener* listener,
+                           Controller* controller_out);
+
+  // Returns the result of the most recent call to GetStream();
+  Future<size_t> GetStreamLastResult();
+
   // Asynchronously retrieves a long lived download URL with a revokable token.
   Future<std::string> GetDownloadUrl();
 
@@ -147,6 +162,19 @@ class StorageReferenceInternal {
   // Returns the result of the most recent call to Write();
   Future<Metadata> PutFileLastResult();
 
+  // Asynchronously uploads data read from source to the currently specified
+  // StorageReference, without additional metadata.
+  Future<Metadata> PutStream(UploadSource* source, Listener* listener,
+                             Controller* controller_out);
+
+  // Asynchronously uploads data read from source to the currently specified
+  // StorageReference, with metadata.
+  Future<Metadata> PutStream(UploadSource* source, const Metadata* metadata,
+                             Listener* listener, Controller* controller_out);
+
+  // Returns the result of the most recent call to PutStream();
+  Future<Metadata> PutStreamLastResult();
+
   // List items (files) and prefixes (folders) under this StorageReference.
   Future<StorageListResult> List(int max_results_per_page,
                                  const char* page_token);
@@ -171,30 +199,83 @@ class StorageReferenceInternal {
                             SafeFutureHandle<FutureType> final_handle,
                             double max_retry_time_seconds);
 
-  template <typename FutureType>
-  void AsyncSendRequestWithRetry(StorageReferenceFn internal_function_reference,
-                                 SendRequestFunct send_request_funct,
-                                 SafeFutureHandle<FutureType> final_handle,
-                                 BlockingResponse* response,
-                                 double max_retry_time_seconds);
-
   // Returns whether or not an HTTP status or future error indicates a retryable
   // failure.
   static bool IsRetryableFailure(int httpStatus);
 
-  // Upload data without metadata.
+  // Upload data without metadata, or with metadata_json in the same request
+  // if it's not null. If the backend rejects the request with metadata,
+  // *metadata_rejected is set before the future completes.
   Future<Metadata> PutBytesInternal(const void* buffer, size_t buffer_size,
                                     Listener* listener,
                                     Controller* controller_out,
-                                    const char* content_type = nullptr);
-  // Upload file without metadata.
+                                    const char* content_type = nullptr,
+                                    const char* metadata_json = nullptr,
+                                    bool* metadata_rejected = nullptr);
+  // Upload file without metadata, or with metadata_json in the same request
+  // if it's not null. If the backend rejects the request with metadata,
+  // *metadata_rejected is set before the future completes.
   Future<Metadata> PutFileInternal(const char* path, Listener* listener,
                                    Controller* controller_out,
-                                   const char* content_type = nullptr);
+                                   const char* content_type = nullptr,
+                                   const char* metadata_json = nullptr,
+                                   bool* metadata_rejected = nullptr);
+
+  // Upload data read from source without metadata, or with metadata_json
+  // when the upload session is started if it's not null. If the backend
+  // rejects the metadata, *metadata_rejected is set before the future
+  // completes.
+  Future<Metadata> PutStreamInternal(UploadSource* source, Listener* listener,
+                                     Controller* controller_out,
+                                     const char* content_type = nullptr,
+                                     const char* metadata_json = nullptr,
+                                     bool* metadata_rejected = nullptr);
 
   void RestCall(rest::Request* request, internal::Notifier* request_notifier,
                 BlockingResponse* response, FutureHandle handle,
-                Listener* listener, Controller* controller_out);
+                Listener* listener, Controller* controller_out,
+                rest::Transport* transport = nullptr);
+
+  // Downloads this object to path using parallel ranged requests, completing
+  // the future of handle.
+  void GetFileParallel(const std::string& path, SafeFutureHandle<size_t> handle,
+                       Listener* listener, Controller* controller_out);
+
+  // Returns how a download of this object uses the download cache, adding an
+  // If-None-Match header to request if the object is cached.
+  DownloadCacheRequest PrepareDownloadCacheRequest(rest::Request* request);
+
+  // Returns whether an upload of upload_size bytes should use the resumable
+  // upload protocol.
+  bool UseResumableUpload(size_t upload_size) const;
+
+  // Returns the URL used to upload this object with the specified
+  // uploadType, or no uploadType if upload_type is null.
+  std::string GetUploadUrl(const char* upload_type) const;
+
+  // Uploads the body of content and metadata_json in a single multipart
+  // request, completing the future of handle. Takes ownership of content.
+  // metadata_rejected is as described by PutBytesInternal(). upload_checksum
+  // is the checksum content adds its body to, which is verified against the
+  // returned metadata.
+  BlockingResponse* PutMultipart(
+      rest::Request* content, const char* content_type,
+      const std::string& metadata_json, SafeFutureHandle<Metadata> handle,
+      Listener* listener, Controller* controller_out, bool* metadata_rejected,
+      const std::shared_ptr<TransferChecksum>& upload_checksum);
+
+  // Uploads the body of request with the resumable upload protocol, completing
+  // the future of handle. Takes ownership of request. If session_key is not
+  // empty the upload session is persisted so the upload can be resumed by a
+  // later process. metadata_json and metadata_rejected are as described by
+  // PutBytesInternal() and upload_checksum as described by PutMultipart().
+  void PutResumable(rest::Request* request,
+                    internal::Notifier* request_notifier,
+                    const std::string& url, const char* content_type,
+                    SafeFutureHandle<Metadata> handle, Listener* listener,
+                    Controller* controller_out, const std::string& session_key,
+                    const char* metadata_json, bool* metadata_rejected,
+                    const std::shared_ptr<TransferChecksum>& upload_checksum);
 
   void PrepareRequestBlocking(rest::Request* request, const char* url,
                               const char* method,
@@ -203,6 +284,9 @@ class StorageReferenceInternal {
   void SetupMetadataChain(Future<Metadata> starting_future,
                           MetadataChainData* data);
 
+  void SetupMetadataFallback(Future<Metadata> starting_future,
+                             MetadataChainData* data);
+
   ReferenceCountedFutureImpl* future();
 
   // Storage references are frequently duplicated.  Please avoid storing any
@@ -16,14 +16,18 @@
 #define FIREBASE_STORAGE_SRC_INCLUDE_FIREBASE_STORAGE_H_
 
 #include <string>
+#include <vector>
 
 #include "firebase/app.h"
 #include "firebase/internal/common.h"
+#include "firebase/internal/platform.h"
+#include "firebase/storage/bulk.h"
 #include "firebase/storage/common.h"
 #include "firebase/storage/controller.h"
 #include "firebase/storage/listener.h"
 #include "firebase/storage/metadata.h"
 #include "firebase/storage/storage_reference.h"
+#include "firebase/storage/stream.h"
 
 #if !defined(DOXYGEN)
 #ifndef SWIG
@@ -139,6 +143,52 @@ class Storage {
   /// download if a failure occurs. Defaults to 120 seconds (2 minutes).
   void set_max_operation_retry_time(double max_transfer_retry_seconds);
 
+#if FIREBASE_PLATFORM_DESKTOP && !defined(SWIG)
+  /// @brief Asynchronously performs an operation on each object in a list of
+  /// references.
+  ///
+  /// Up to options.max_concurrent_operations objects are operated on at the
+  /// same time, the rest wait until an earlier operation completes. Only
+  /// supported on desktop.
+  ///
+  /// @param[in] operation Operation to perform on each object.
+  /// @param[in] references Objects to operate on.
+  /// @param[in] options Configures the operation.
+  ///
+  /// @returns A future that returns the result for each object once every
+  /// operation is complete. If any of them failed, the future completes with
+  /// the error of the first failure.
+  Future<BulkResult> RunBulkOperation(
+      BulkOperation operation, const std::vector<StorageReference>& references,
+      const BulkOptions& options = BulkOptions());
+
+  /// @brief Asynchronously performs an operation on each object under a
+  /// prefix.
+  ///
+  /// The objects are found by listing the prefix a page at a time, the next
+  /// page is requested while the objects of earlier pages are operated on. Up
+  /// to options.max_concurrent_operations objects are operated on at the same
+  /// time. Only supported on desktop.
+  ///
+  /// @param[in] operation Operation to perform on each object.
+  /// @param[in] prefix Folder containing the objects to operate on.
+  /// @param[in] options Configures the operation.
+  ///
+  /// @returns A future that returns the result for each object once every
+  /// operation is complete. If any of them failed, the future completes with
+  /// the error of the first failure. If the prefix could not be listed, the
+  /// future completes with the error of the listing and the results of the
+  /// objects that were listed before it failed.
+  Future<BulkResult> RunBulkOperation(
+      BulkOperation operation, const StorageReference& prefix,
+      const BulkOptions& options = BulkOptions());
+
+  /// @brief Returns the result of the most recent call to RunBulkOperation();
+  ///
+  /// @returns The result of the most recent call to RunBulkOperation();
+  Future<BulkResult> RunBulkOperationLastResult();
+#endif  // FIREBASE_PLATFORM_DESKTOP && !defined(SWIG)
+
   /// @brief Configures the Storage SDK to use an emulated backend instead of
   /// the default remote backend. This method should be called before invoking
   /// any other methods on a new instance of Storage
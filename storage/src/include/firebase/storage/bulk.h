@@ -0,0 +1,102 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_STORAGE_SRC_INCLUDE_FIREBASE_STORAGE_BULK_H_
+#define FIREBASE_STORAGE_SRC_INCLUDE_FIREBASE_STORAGE_BULK_H_
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "firebase/storage/common.h"
+#include "firebase/storage/metadata.h"
+#include "firebase/storage/storage_reference.h"
+
+namespace firebase {
+namespace storage {
+
+/// @brief Operation performed on each object by Storage::RunBulkOperation().
+enum BulkOperation {
+  /// Delete the object.
+  kBulkOperationDelete = 0,
+  /// Retrieve the metadata of the object.
+  kBulkOperationGetMetadata,
+  /// Download the object to a file in BulkOptions::destination_directory.
+  kBulkOperationGetFile,
+};
+
+/// @brief Configures Storage::RunBulkOperation().
+struct BulkOptions {
+  BulkOptions()
+      : max_concurrent_operations(8),
+        max_results_per_page(1000),
+        recursive(true),
+        destination_directory(nullptr) {}
+
+  /// Maximum number of objects operated on at the same time.
+  int max_concurrent_operations;
+
+  /// Number of objects requested by each page of a listing of a prefix. The
+  /// next page is requested while the objects of the current page are
+  /// processed.
+  int max_results_per_page;
+
+  /// Whether objects under the folders of a prefix are included, otherwise
+  /// only the objects directly under the prefix are.
+  bool recursive;
+
+  /// Directory kBulkOperationGetFile writes objects to. Each object is written
+  /// to its path relative to the prefix, or to its full path when a list of
+  /// references is given, creating directories as needed.
+  const char* destination_directory;
+};
+
+/// @brief Result of the operation on one object of a bulk operation.
+struct BulkItemResult {
+  BulkItemResult() : error(kErrorNone), bytes_downloaded(0) {}
+
+  /// The object that was operated on.
+  StorageReference reference;
+
+  /// Error the operation failed with, or kErrorNone if it succeeded.
+  Error error;
+
+  /// Description of the error, empty if the operation succeeded.
+  std::string error_message;
+
+  /// Metadata of the object, only valid for kBulkOperationGetMetadata.
+  Metadata metadata;
+
+  /// Number of bytes written to the file, only valid for
+  /// kBulkOperationGetFile.
+  size_t bytes_downloaded;
+};
+
+/// @brief Results of a bulk operation.
+struct BulkResult {
+  BulkResult() : failure_count(0) {}
+
+  /// Result for each object, in the order of the list of references or the
+  /// order the objects under a prefix were listed.
+  std::vector<BulkItemResult> items;
+
+  /// Number of items whose operation failed.
+  int failure_count;
+};
+
+}  // namespace storage
+}  // namespace firebase
+
+#endif  // FIREBASE_STORAGE_SRC_INCLUDE_FIREBASE_STORAGE_BULK_H_
@@ -20,8 +20,10 @@
 
 #include "firebase/future.h"
 #include "firebase/internal/common.h"
+#include "firebase/internal/platform.h"
 #include "firebase/storage/list_result.h"
 #include "firebase/storage/metadata.h"
+#include "firebase/storage/stream.h"
 
 namespace firebase {
 namespace storage {
@@ -187,6 +189,35 @@ class StorageReference {
   /// @returns The result of the most recent call to GetBytes();
   Future<size_t> GetBytesLastResult();
 
+#if FIREBASE_PLATFORM_DESKTOP && !defined(SWIG)
+  /// @brief Asynchronously downloads the object from this StorageReference,
+  /// passing the data to a sink as it arrives.
+  ///
+  /// The object is never held in memory as a whole, so this can be used to
+  /// process downloads of any size in constant memory. Only supported on
+  /// desktop.
+  ///
+  /// @param[in] sink Receives the data of the object. The sink must be valid
+  /// until the returned future completes.
+  /// @param[in] listener A listener that will respond to events on this read
+  /// operation. If not nullptr, a listener that will respond to events on this
+  /// read operation. The caller is responsible for allocating and deallocating
+  /// the listener. The same listener can be used for multiple operations.
+  /// @param[out] controller_out Controls the read operation, providing the
+  /// ability to pause, resume or cancel an ongoing read operation. If not
+  /// nullptr, this method will output a Controller here that you can use to
+  /// control the read operation.
+  ///
+  /// @returns A future that returns the number of bytes passed to the sink.
+  Future<size_t> GetStream(DownloadSink* sink, Listener* listener = nullptr,
+                           Controller* controller_out = nullptr);
+
+  /// @brief Returns the result of the most recent call to GetStream();
+  ///
+  /// @returns The result of the most recent call to GetStream();
+  Future<size_t> GetStreamLastResult();
+#endif  // FIREBASE_PLATFORM_DESKTOP && !defined(SWIG)
+
   /// @brief Asynchronously retrieves a long lived download URL with a revokable
   /// token.
   ///
@@ -354,6 +385,55 @@ class StorageReference {
   /// @returns The result of the most recent call to PutFile();
   Future<Metadata> PutFileLastResult();
 
+#if FIREBASE_PLATFORM_DESKTOP && !defined(SWIG)
+  /// @brief Asynchronously uploads data read from a source to the currently
+  /// specified StorageReference, without additional metadata.
+  ///
+  /// The data is read from the source as it's sent, so only a small part of
+  /// it is held in memory at a time. Only supported on desktop.
+  ///
+  /// @param[in] source Supplies the data to upload. The source must be valid
+  /// until the returned future completes.
+  /// @param[in] listener A listener that will respond to events on this write
+  /// operation. If not nullptr, a listener that will respond to events on this
+  /// write operation. The caller is responsible for allocating and deallocating
+  /// the listener. The same listener can be used for multiple operations.
+  /// @param[out] controller_out Controls the write operation, providing the
+  /// ability to pause, resume or cancel an ongoing write operation. If not
+  /// nullptr, this method will output a Controller here that you can use to
+  /// control the write operation.
+  ///
+  /// @returns A future that returns the Metadata.
+  Future<Metadata> PutStream(UploadSource* source, Listener* listener = nullptr,
+                             Controller* controller_out = nullptr);
+
+  /// @brief Asynchronously uploads data read from a source to the currently
+  /// specified StorageReference, with metadata.
+  ///
+  /// @param[in] source Supplies the data to upload. The source must be valid
+  /// until the returned future completes.
+  /// @param[in] metadata Metadata containing additional information (MIME type,
+  /// etc.) about the object being uploaded.
+  /// @param[in] listener A listener that will respond to events on this write
+  /// operation. If not nullptr, a listener that will respond to events on this
+  /// write operation. The caller is responsible for allocating and deallocating
+  /// the listener. The same listener can be used for multiple operations.
+  /// @param[out] controller_out Controls the write operation, providing the
+  /// ability to pause, resume or cancel an ongoing write operation. If not
+  /// nullptr, this method will output a Controller here that you can use to
+  /// control the write operation.
+  ///
+  /// @returns A future that returns the Metadata.
+  Future<Metadata> PutStream(UploadSource* source, const Metadata& metadata,
+                             Listener* listener = nullptr,
+                             Controller* controller_out = nullptr);
+
+  /// @brief Returns the result of the most recent call to PutStream();
+  ///
+  /// @returns The result of the most recent call to PutStream();
+  Future<Metadata> PutStreamLastResult();
+#endif  // FIREBASE_PLATFORM_DESKTOP && !defined(SWIG)
+
   /// @brief Returns true if this StorageReference is valid, false if it is not
   /// valid. An invalid StorageReference indicates that the reference is
   /// uninitialized (created with the default constructor) or that there was an
@@ -0,0 +1,77 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_STORAGE_SRC_INCLUDE_FIREBASE_STORAGE_STREAM_H_
+#define FIREBASE_STORAGE_SRC_INCLUDE_FIREBASE_STORAGE_STREAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace firebase {
+namespace storage {
+
+/// @brief Base class used to supply the data of an upload as it is sent.
+///
+/// Pass a subclass to StorageReference::PutStream() to upload data that is
+/// produced incrementally, without holding all of it in memory. The data is
+/// pulled from the source by a background thread as the upload progresses.
+class UploadSource {
+ public:
+  /// @brief Virtual destructor.
+  virtual ~UploadSource() {}
+
+  /// @brief Reads the next part of the data to upload.
+  ///
+  /// Called on a background thread, never concurrently with itself.
+  ///
+  /// @param[out] buffer Buffer to copy the data to.
+  /// @param[in] buffer_size Maximum number of bytes to copy to buffer.
+  /// @param[out] bytes_read Number of bytes copied to buffer, 0 once all of
+  /// the data has been read.
+  ///
+  /// @returns false if the data could not be read, which fails the upload.
+  virtual bool Read(void* buffer, size_t buffer_size, size_t* bytes_read) = 0;
+
+  /// @brief Returns the total number of bytes that will be read, or -1 if it
+  /// isn't known in advance.
+  virtual int64_t TotalByteCount() const { return -1; }
+};
+
+/// @brief Base class used to consume the data of a download as it arrives.
+///
+/// Pass a subclass to StorageReference::GetStream() to process a download
+/// incrementally rather than allocating a buffer large enough for the whole
+/// object.
+class DownloadSink {
+ public:
+  /// @brief Virtual destructor.
+  virtual ~DownloadSink() {}
+
+  /// @brief Receives the next part of the object.
+  ///
+  /// Called on a background thread, never concurrently with itself. Each byte
+  /// of the object is passed to the sink exactly once, in order, even if the
+  /// download is retried.
+  ///
+  /// @param[in] data Data received, only valid for the duration of the call.
+  /// @param[in] size Number of bytes of data.
+  ///
+  /// @returns false to stop the download, which fails with kErrorCancelled.
+  virtual bool Write(const void* data, size_t size) = 0;
+};
+
+}  // namespace storage
+}  // namespace firebase
+
+#endif  // FIREBASE_STORAGE_SRC_INCLUDE_FIREBASE_STORAGE_STREAM_H_
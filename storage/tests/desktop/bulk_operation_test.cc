@@ -0,0 +1,230 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "storage/src/desktop/bulk_operation.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "app/src/cleanup_notifier.h"
+#include "app/src/reference_counted_future_impl.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+namespace {
+
+// Runner whose operations and listings complete when the test completes them.
+class FakeRunner : public BulkOperationRunner {
+ public:
+  FakeRunner(const BulkOptions& options, CleanupNotifier* cleanup,
+             ReferenceCountedFutureImpl* future_api,
+             SafeFutureHandle<BulkResult> handle)
+      : BulkOperationRunner(kBulkOperationDelete, options, cleanup, future_api,
+                            handle),
+        complete_immediately(false),
+        active(0),
+        max_active(0),
+        depth(0),
+        max_depth(0) {}
+
+  using BulkOperationRunner::AddPrefix;
+  using BulkOperationRunner::AddReferences;
+  using BulkOperationRunner::Begin;
+  using BulkOperationRunner::PageComplete;
+
+  void Complete(size_t index) {
+    --active;
+    ItemComplete(index, nullptr, kErrorNone, nullptr);
+  }
+
+  void StartItem(size_t index) override {
+    started.push_back(index);
+    max_active = (std::max)(++active, max_active);
+    max_depth = (std::max)(++depth, max_depth);
+    if (complete_immediately) Complete(index);
+    --depth;
+  }
+
+  void ListNextPage(StorageReference* prefix,
+                    const std::string& page_token) override {
+    page_tokens.push_back(page_token);
+  }
+
+  bool complete_immediately;
+  std::vector<size_t> started;
+  std::vector<std::string> page_tokens;
+  int active;
+  int max_active;
+  int depth;
+  int max_depth;
+};
+
+class BulkOperationTest : public ::testing::Test {
+ protected:
+  BulkOperationTest() : future_impl_(1) {}
+
+  std::shared_ptr<FakeRunner> CreateRunner(const BulkOptions& options) {
+    auto handle = future_impl_.SafeAlloc<BulkResult>(0);
+    return std::make_shared<FakeRunner>(options, &cleanup_, &future_impl_,
+                                        handle);
+  }
+
+  const Future<BulkResult>& result() {
+    return static_cast<const Future<BulkResult>&>(future_impl_.LastResult(0));
+  }
+
+  CleanupNotifier cleanup_;
+  ReferenceCountedFutureImpl future_impl_;
+};
+
+TEST_F(BulkOperationTest, LimitsConcurrentOperations) {
+  BulkOptions options;
+  options.max_concurrent_operations = 3;
+  std::shared_ptr<FakeRunner> runner = CreateRunner(options);
+  runner->AddReferences(std::vector<StorageReference>(10));
+  runner->Begin();
+  EXPECT_THAT(runner->started, ::testing::ElementsAre(0, 1, 2));
+
+  for (size_t index = 0; index < 10; ++index) {
+    EXPECT_EQ(result().status(), kFutureStatusPending);
+    runner->Complete(index);
+    EXPECT_EQ(runner->started.size(), std::min<size_t>(index + 4, 10));
+  }
+  EXPECT_EQ(runner->max_active, 3);
+  ASSERT_EQ(result().status(), kFutureStatusComplete);
+  EXPECT_EQ(result().error(), kErrorNone);
+  EXPECT_EQ(result().result()->items.size(), 10);
+  EXPECT_EQ(result().result()->failure_count, 0);
+}
+
+TEST_F(BulkOperationTest, HandlesSynchronousCompletionWithoutRecursion) {
+  BulkOptions options;
+  options.max_concurrent_operations = 1;
+  std::shared_ptr<FakeRunner> runner = CreateRunner(options);
+  runner->complete_immediately = true;
+  runner->AddReferences(std::vector<StorageReference>(1000));
+  runner->Begin();
+  EXPECT_EQ(runner->started.size(), 1000);
+  EXPECT_EQ(runner->max_depth, 1);
+  ASSERT_EQ(result().status(), kFutureStatusComplete);
+  EXPECT_EQ(result().result()->items.size(), 1000);
+}
+
+TEST_F(BulkOperationTest, ListsOnePageAhead) {
+  BulkOptions options;
+  options.max_concurrent_operations = 2;
+  options.max_results_per_page = 2;
+  std::shared_ptr<FakeRunner> runner = CreateRunner(options);
+  runner->AddPrefix(StorageReference());
+  runner->Begin();
+  EXPECT_THAT(runner->page_tokens, ::testing::ElementsAre(""));
+
+  // The next page is requested as soon as the objects of the first are
+  // started.
+  std::vector<StorageReference> page(2);
+  std::vector<StorageReference> no_prefixes;
+  runner->PageComplete(kErrorNone, nullptr, page, no_prefixes, "2");
+  EXPECT_THAT(runner->started, ::testing::ElementsAre(0, 1));
+  EXPECT_THAT(runner->page_tokens, ::testing::ElementsAre("", "2"));
+
+  // One page of objects can wait for the operations in progress.
+  runner->PageComplete(kErrorNone, nullptr, page, no_prefixes, "3");
+  EXPECT_EQ(runner->started.size(), 2);
+  EXPECT_EQ(runner->page_tokens.size(), 3);
+
+  // Listing stops while more objects are waiting...
+  runner->PageComplete(kErrorNone, nullptr, page, no_prefixes, "4");
+  EXPECT_EQ(runner->page_tokens.size(), 3);
+
+  // ...until operations complete.
+  runner->Complete(0);
+  runner->Complete(1);
+  EXPECT_EQ(runner->started.size(), 4);
+  EXPECT_THAT(runner->page_tokens, ::testing::ElementsAre("", "2", "3", "4"));
+
+  runner->PageComplete(kErrorNone, nullptr, page, no_prefixes, "");
+  EXPECT_EQ(runner->page_tokens.size(), 4);
+  for (size_t index = 2; index < 8; ++index) runner->Complete(index);
+  EXPECT_EQ(runner->max_active, 2);
+  ASSERT_EQ(result().status(), kFutureStatusComplete);
+  EXPECT_EQ(result().error(), kErrorNone);
+  EXPECT_EQ(result().result()->items.size(), 8);
+}
+
+TEST_F(BulkOperationTest, FailedListingCompletesWithError) {
+  BulkOptions options;
+  std::shared_ptr<FakeRunner> runner = CreateRunner(options);
+  runner->AddPrefix(StorageReference());
+  runner->Begin();
+  std::vector<StorageReference> none;
+  runner->PageComplete(kErrorUnauthorized, "Unauthorized", none, none, "");
+  ASSERT_EQ(result().status(), kFutureStatusComplete);
+  EXPECT_EQ(result().error(), kErrorUnauthorized);
+  EXPECT_STREQ(result().error_message(), "Unauthorized");
+}
+
+TEST_F(BulkOperationTest, CleanupCancelsRunner) {
+  BulkOptions options;
+  options.max_concurrent_operations = 1;
+  std::shared_ptr<FakeRunner> runner = CreateRunner(options);
+  std::weak_ptr<FakeRunner> weak_runner = runner;
+  runner->AddReferences(std::vector<StorageReference>(3));
+  runner->Begin();
+  runner.reset();
+  // The runner keeps itself alive while it's in progress.
+  ASSERT_FALSE(weak_runner.expired());
+
+  cleanup_.CleanupAll();
+  ASSERT_EQ(result().status(), kFutureStatusComplete);
+  EXPECT_EQ(result().error(), kErrorCancelled);
+  EXPECT_TRUE(weak_runner.expired());
+}
+
+TEST_F(BulkOperationTest, OperationsCompletingAfterCleanupAreIgnored) {
+  BulkOptions options;
+  options.max_concurrent_operations = 1;
+  std::shared_ptr<FakeRunner> runner = CreateRunner(options);
+  runner->AddReferences(std::vector<StorageReference>(3));
+  runner->Begin();
+  cleanup_.CleanupAll();
+  runner->Complete(0);
+  EXPECT_EQ(runner->started.size(), 1);
+  EXPECT_EQ(result().error(), kErrorCancelled);
+}
+
+TEST_F(BulkOperationTest, UnregistersOnceComplete) {
+  BulkOptions options;
+  std::shared_ptr<FakeRunner> runner = CreateRunner(options);
+  std::weak_ptr<FakeRunner> weak_runner = runner;
+  runner->AddReferences(std::vector<StorageReference>(1));
+  runner->Begin();
+  runner->Complete(0);
+  runner.reset();
+  EXPECT_TRUE(weak_runner.expired());
+  ASSERT_EQ(result().status(), kFutureStatusComplete);
+  EXPECT_EQ(result().error(), kErrorNone);
+  // Cleanup doesn't touch the deleted runner.
+  cleanup_.CleanupAll();
+  EXPECT_EQ(result().error(), kErrorNone);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
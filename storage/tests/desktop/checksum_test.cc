@@ -0,0 +1,228 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "storage/src/desktop/checksum.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "app/rest/util.h"
+#include "app/src/base64.h"
+#include "app/src/reference_counted_future_impl.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "storage/src/desktop/curl_requests.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+namespace {
+
+std::string Md5Hex(const std::string& data) {
+  Md5 md5;
+  md5.Update(data.data(), data.size());
+  uint8_t digest[Md5::kDigestSize];
+  md5.Finish(digest);
+  std::string hex;
+  for (uint8_t byte : digest) {
+    char digits[3];
+    snprintf(digits, sizeof(digits), "%02x", byte);
+    hex += digits;
+  }
+  return hex;
+}
+
+// Returns the base64 encoded hashes of data, as reported by the server.
+void GetHashes(const std::string& data, std::string* crc32c,
+               std::string* md5) {
+  uint32_t crc = Crc32c(0, data.data(), data.size());
+  std::string crc_bytes = {static_cast<char>(crc >> 24),
+                           static_cast<char>(crc >> 16),
+                           static_cast<char>(crc >> 8), static_cast<char>(crc)};
+  firebase::internal::Base64EncodeWithPadding(crc_bytes, crc32c);
+  Md5 hash;
+  hash.Update(data.data(), data.size());
+  uint8_t digest[Md5::kDigestSize];
+  hash.Finish(digest);
+  firebase::internal::Base64EncodeWithPadding(
+      std::string(reinterpret_cast<char*>(digest), sizeof(digest)), md5);
+}
+
+TEST(ChecksumTest, Crc32cMatchesKnownValues) {
+  EXPECT_EQ(Crc32c(0, "", 0), 0u);
+  EXPECT_EQ(Crc32c(0, "123456789", 9), 0xe3069283u);
+  std::vector<uint8_t> zeros(32, 0);
+  EXPECT_EQ(Crc32c(0, zeros.data(), zeros.size()), 0x8a9136aau);
+  std::vector<uint8_t> ones(32, 0xff);
+  EXPECT_EQ(Crc32c(0, ones.data(), ones.size()), 0x62a8ab43u);
+}
+
+TEST(ChecksumTest, Crc32cCanBeComputedIncrementally) {
+  std::string data;
+  for (int i = 0; i < 1000; ++i) data += static_cast<char>(i * 7 + i / 13);
+  uint32_t expected = Crc32c(0, data.data(), data.size());
+  for (size_t split : {1, 3, 8, 9, 500, 999}) {
+    uint32_t crc = Crc32c(0, data.data(), split);
+    crc = Crc32c(crc, data.data() + split, data.size() - split);
+    EXPECT_EQ(crc, expected) << split;
+  }
+}
+
+TEST(ChecksumTest, Md5MatchesKnownValues) {
+  EXPECT_EQ(Md5Hex(""), "d41d8cd98f00b204e9800998ecf8427e");
+  EXPECT_EQ(Md5Hex("abc"), "900150983cd24fb0d6963f7d28e17f72");
+  EXPECT_EQ(Md5Hex("The quick brown fox jumps over the lazy dog"),
+            "9e107d9d372bb6826bd81d3542a419d6");
+  EXPECT_EQ(Md5Hex(std::string(1000000, 'a')),
+            "7707d6ae4e027c70eea2a935c2296f21");
+}
+
+TEST(ChecksumTest, Md5CanBeComputedIncrementally) {
+  std::string data(200, 'x');
+  for (size_t split : {1, 55, 56, 63, 64, 65, 128, 199}) {
+    Md5 md5;
+    md5.Update(data.data(), split);
+    md5.Update(data.data() + split, data.size() - split);
+    uint8_t digest[Md5::kDigestSize];
+    md5.Finish(digest);
+    Md5 expected;
+    expected.Update(data.data(), data.size());
+    uint8_t expected_digest[Md5::kDigestSize];
+    expected.Finish(expected_digest);
+    EXPECT_EQ(std::string(digest, digest + sizeof(digest)),
+              std::string(expected_digest,
+                          expected_digest + sizeof(expected_digest)))
+        << split;
+  }
+}
+
+TEST(ChecksumTest, TransferChecksumComparesComputedHashes) {
+  std::string data = "some object data";
+  std::string crc32c, md5;
+  GetHashes(data, &crc32c, &md5);
+  std::string other_crc32c, other_md5;
+  GetHashes("other data", &other_crc32c, &other_md5);
+
+  TransferChecksum checksum;
+  EXPECT_FALSE(checksum.active());
+  EXPECT_TRUE(checksum.Matches(other_crc32c, other_md5));
+
+  checksum.Start(TransferChecksum::kTypeCrc32c);
+  EXPECT_TRUE(checksum.active());
+  checksum.Update(data.data(), 4);
+  checksum.Update(data.data() + 4, data.size() - 4);
+  EXPECT_TRUE(checksum.Matches(crc32c, other_md5));
+  EXPECT_FALSE(checksum.Matches(other_crc32c, md5));
+  EXPECT_TRUE(checksum.Matches("", ""));
+
+  checksum.Start(TransferChecksum::kTypeCrc32c | TransferChecksum::kTypeMd5);
+  checksum.Update(data.data(), data.size());
+  EXPECT_TRUE(checksum.Matches(crc32c, md5));
+  EXPECT_TRUE(checksum.Matches("", md5));
+  EXPECT_FALSE(checksum.Matches(crc32c, other_md5));
+  EXPECT_FALSE(checksum.Matches("not base64!", md5));
+}
+
+class ChecksumResponseTest : public ::testing::Test {
+ protected:
+  ChecksumResponseTest() : future_impl_(1) {}
+
+  // Complete response as if it received a response with status, headers and
+  // body.
+  static void Receive(rest::Response* response, int status,
+                      const std::vector<std::string>& headers,
+                      const std::string& body) {
+    std::string status_line =
+        "HTTP/1.1 " + std::to_string(status) + " Status\r\n";
+    response->ProcessHeader(status_line.c_str(), status_line.size());
+    for (const std::string& header : headers) {
+      std::string line = header + "\r\n";
+      response->ProcessHeader(line.c_str(), line.size());
+    }
+    response->ProcessHeader("\r\n", 2);
+    response->ProcessBody(body.data(), body.size());
+    response->MarkCompleted();
+  }
+
+  // Download data with the hashes of hashed_data, returning the error of the
+  // download.
+  int GetBytes(const std::string& data, const std::string& hashed_data,
+               const std::string& extra_header = std::string()) {
+    std::string crc32c, md5;
+    GetHashes(hashed_data, &crc32c, &md5);
+    std::vector<std::string> headers = {
+        "Content-Length: " + std::to_string(data.size()),
+        "x-goog-hash: crc32c=" + crc32c + ",md5=" + md5};
+    if (!extra_header.empty()) headers.push_back(extra_header);
+    std::vector<char> buffer(1024);
+    auto handle = future_impl_.SafeAlloc<size_t>(0);
+    GetBytesResponse response(buffer.data(), buffer.size(), handle,
+                              &future_impl_);
+    Receive(&response, rest::util::HttpSuccess, headers, data);
+    return future_impl_.LastResult(0).error();
+  }
+
+  ReferenceCountedFutureImpl future_impl_;
+};
+
+TEST_F(ChecksumResponseTest, DownloadMatchingHashSucceeds) {
+  EXPECT_EQ(GetBytes("object data", "object data"), kErrorNone);
+}
+
+TEST_F(ChecksumResponseTest, DownloadNotMatchingHashFails) {
+  EXPECT_EQ(GetBytes("object dat4", "object data"), kErrorNonMatchingChecksum);
+}
+
+TEST_F(ChecksumResponseTest, TranscodedDownloadIsNotVerified) {
+  EXPECT_EQ(GetBytes("object data", "compressed data",
+                     "X-Goog-Stored-Content-Encoding: gzip"),
+            kErrorNone);
+}
+
+TEST_F(ChecksumResponseTest, UploadIsVerifiedAgainstMetadata) {
+  std::string data = "uploaded data";
+  std::string crc32c, md5;
+  GetHashes(data, &crc32c, &md5);
+  std::string other_crc32c, other_md5;
+  GetHashes("other data", &other_crc32c, &other_md5);
+  struct {
+    std::string metadata;
+    int expected_error;
+  } cases[] = {
+      {"{\"crc32c\": \"" + crc32c + "\", \"md5Hash\": \"" + md5 + "\"}",
+       kErrorNone},
+      {"{\"md5Hash\": \"" + md5 + "\"}", kErrorNone},
+      {"{\"crc32c\": \"" + other_crc32c + "\", \"md5Hash\": \"" + md5 + "\"}",
+       kErrorNonMatchingChecksum},
+      {"{\"md5Hash\": \"" + other_md5 + "\"}", kErrorNonMatchingChecksum},
+  };
+  for (const auto& test_case : cases) {
+    std::shared_ptr<TransferChecksum> checksum =
+        std::make_shared<TransferChecksum>();
+    checksum->Start(TransferChecksum::kTypeCrc32c | TransferChecksum::kTypeMd5);
+    checksum->Update(data.data(), data.size());
+    auto handle = future_impl_.SafeAlloc<Metadata>(0);
+    ReturnedMetadataResponse response(handle, &future_impl_,
+                                      StorageReference(), checksum);
+    Receive(&response, rest::util::HttpSuccess, {}, test_case.metadata);
+    EXPECT_EQ(future_impl_.LastResult(0).error(), test_case.expected_error)
+        << test_case.metadata;
+  }
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
@@ -0,0 +1,419 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "storage/src/desktop/download_cache.h"
+
+#include <stdio.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "app/rest/util.h"
+#include "app/src/base64.h"
+#include "app/src/reference_counted_future_impl.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "storage/src/desktop/checksum.h"
+#include "storage/src/desktop/curl_requests.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+namespace {
+
+const uint64_t kMaxCacheSize = 1024;
+const char kBucket[] = "bucket";
+
+class DownloadCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    const char* temp_dir = getenv("TEST_TMPDIR");
+    directory_ = std::string(temp_dir ? temp_dir : ".");
+    file_path_ = directory_ + "/download_cache_object.bin";
+    CreateCache(kMaxCacheSize);
+  }
+
+  void TearDown() override {
+    for (const std::string& key : keys_) cache_->Remove(key);
+    cache_.reset();
+    remove((directory_ + "/index").c_str());
+    remove(file_path_.c_str());
+  }
+
+  void CreateCache(uint64_t max_size) {
+    cache_.reset();
+    cache_.reset(new DownloadCache(directory_, max_size));
+  }
+
+  std::string Key(const char* path) {
+    std::string key = DownloadCache::GetKey(kBucket, path);
+    keys_.push_back(key);
+    return key;
+  }
+
+  static DownloadCache::Entry MakeEntry(const std::string& data,
+                                        const char* etag,
+                                        const char* md5_hash) {
+    DownloadCache::Entry entry;
+    entry.etag = etag;
+    entry.md5_hash = md5_hash;
+    entry.generation = 1;
+    entry.size = data.size();
+    return entry;
+  }
+
+  // Read up to max_size bytes of the object with key and etag from the cache,
+  // returning an empty string if it isn't cached.
+  std::string ReadCached(const std::string& key, const char* etag,
+                         size_t max_size = 4096) {
+    std::vector<char> buffer(max_size);
+    uint64_t size = 0;
+    if (!cache_->CopyToBuffer(key, etag, buffer.data(), buffer.size(),
+                              &size)) {
+      return std::string();
+    }
+    return std::string(buffer.data(), static_cast<size_t>(size));
+  }
+
+  std::string ReadFile() {
+    std::ifstream file(file_path_, std::ios::in | std::ios::binary);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+  }
+
+  void WriteFile(const std::string& data) {
+    std::ofstream file(file_path_, std::ios::out | std::ios::binary);
+    file << data;
+  }
+
+  std::string directory_;
+  std::string file_path_;
+  std::vector<std::string> keys_;
+  std::unique_ptr<DownloadCache> cache_;
+};
+
+TEST_F(DownloadCacheTest, StoresAndCopiesBuffer) {
+  std::string key = Key("a");
+  std::string data(300, 'a');
+  EXPECT_TRUE(cache_->StoreBuffer(key, MakeEntry(data, "\"1\"", "md5a"),
+                                  data.data(), data.size()));
+  DownloadCache::Entry entry;
+  ASSERT_TRUE(cache_->Lookup(key, &entry));
+  EXPECT_EQ(entry.etag, "\"1\"");
+  EXPECT_EQ(entry.md5_hash, "md5a");
+  EXPECT_EQ(entry.generation, 1);
+  EXPECT_EQ(entry.size, data.size());
+  EXPECT_EQ(cache_->size(), data.size());
+  EXPECT_EQ(ReadCached(key, "\"1\""), data);
+  EXPECT_EQ(ReadCached(key, "\"1\"", 10), data.substr(0, 10));
+  // A different version of the object isn't returned.
+  EXPECT_EQ(ReadCached(key, "\"2\""), "");
+}
+
+TEST_F(DownloadCacheTest, StoresAndCopiesFile) {
+  std::string key = Key("a");
+  std::string data(500, 'f');
+  WriteFile(data);
+  EXPECT_TRUE(
+      cache_->StoreFile(key, MakeEntry(data, "\"1\"", "md5f"), file_path_));
+  remove(file_path_.c_str());
+  uint64_t size = 0;
+  EXPECT_TRUE(cache_->CopyToFile(key, "\"1\"", file_path_, &size));
+  EXPECT_EQ(size, data.size());
+  EXPECT_EQ(ReadFile(), data);
+}
+
+TEST_F(DownloadCacheTest, ReplacesOlderVersion) {
+  std::string key = Key("a");
+  std::string old_data(200, 'o');
+  std::string new_data(100, 'n');
+  cache_->StoreBuffer(key, MakeEntry(old_data, "\"1\"", "md5o"),
+                      old_data.data(), old_data.size());
+  cache_->StoreBuffer(key, MakeEntry(new_data, "\"2\"", "md5n"),
+                      new_data.data(), new_data.size());
+  EXPECT_EQ(ReadCached(key, "\"1\""), "");
+  EXPECT_EQ(ReadCached(key, "\"2\""), new_data);
+  EXPECT_EQ(cache_->size(), new_data.size());
+}
+
+TEST_F(DownloadCacheTest, SharesDataOfIdenticalObjects) {
+  std::string key_a = Key("a");
+  std::string key_b = Key("b");
+  std::string data(400, 's');
+  cache_->StoreBuffer(key_a, MakeEntry(data, "\"a\"", "md5s"), data.data(),
+                      data.size());
+  cache_->StoreBuffer(key_b, MakeEntry(data, "\"b\"", "md5s"), data.data(),
+                      data.size());
+  EXPECT_EQ(cache_->size(), data.size());
+  cache_->Remove(key_a);
+  EXPECT_EQ(ReadCached(key_a, "\"a\""), "");
+  EXPECT_EQ(ReadCached(key_b, "\"b\""), data);
+  cache_->Remove(key_b);
+  EXPECT_EQ(cache_->size(), 0);
+}
+
+TEST_F(DownloadCacheTest, EvictsLeastRecentlyUsed) {
+  std::string key_a = Key("a");
+  std::string key_b = Key("b");
+  std::string key_c = Key("c");
+  std::string data_a(400, 'a');
+  std::string data_b(400, 'b');
+  std::string data_c(400, 'c');
+  cache_->StoreBuffer(key_a, MakeEntry(data_a, "\"a\"", "md5a"),
+                      data_a.data(), data_a.size());
+  cache_->StoreBuffer(key_b, MakeEntry(data_b, "\"b\"", "md5b"),
+                      data_b.data(), data_b.size());
+  // Use a so b is the least recently used.
+  EXPECT_EQ(ReadCached(key_a, "\"a\""), data_a);
+  cache_->StoreBuffer(key_c, MakeEntry(data_c, "\"c\"", "md5c"),
+                      data_c.data(), data_c.size());
+  DownloadCache::Entry entry;
+  EXPECT_TRUE(cache_->Lookup(key_a, &entry));
+  EXPECT_FALSE(cache_->Lookup(key_b, &entry));
+  EXPECT_TRUE(cache_->Lookup(key_c, &entry));
+  EXPECT_EQ(cache_->size(), 800);
+
+  cache_->set_max_size(500);
+  EXPECT_FALSE(cache_->Lookup(key_a, &entry));
+  EXPECT_TRUE(cache_->Lookup(key_c, &entry));
+  EXPECT_EQ(cache_->size(), 400);
+}
+
+TEST_F(DownloadCacheTest, DoesNotCacheUnusableObjects) {
+  std::string key = Key("a");
+  std::string data(100, 'a');
+  cache_->StoreBuffer(key, MakeEntry(data, "\"1\"", "md5a"), data.data(),
+                      data.size());
+  // An object without an ETag can't be revalidated, and replaces the cached
+  // version.
+  EXPECT_FALSE(cache_->StoreBuffer(key, MakeEntry(data, "", "md5a"),
+                                   data.data(), data.size()));
+  DownloadCache::Entry entry;
+  EXPECT_FALSE(cache_->Lookup(key, &entry));
+
+  std::string large_data(kMaxCacheSize + 1, 'l');
+  EXPECT_FALSE(cache_->StoreBuffer(key, MakeEntry(large_data, "\"2\"", "md5l"),
+                                   large_data.data(), large_data.size()));
+  EXPECT_FALSE(cache_->Lookup(key, &entry));
+  EXPECT_EQ(cache_->size(), 0);
+}
+
+TEST_F(DownloadCacheTest, PersistsEntries) {
+  std::string key_a = Key("a");
+  std::string key_b = Key("path/with spaces");
+  std::string data_a(400, 'a');
+  std::string data_b(400, 'b');
+  cache_->StoreBuffer(key_a, MakeEntry(data_a, "\"a\"", "md5a"),
+                      data_a.data(), data_a.size());
+  cache_->StoreBuffer(key_b, MakeEntry(data_b, "\"b\"", "md5b"),
+                      data_b.data(), data_b.size());
+  EXPECT_EQ(ReadCached(key_a, "\"a\""), data_a);
+
+  CreateCache(kMaxCacheSize);
+  EXPECT_EQ(cache_->size(), 800);
+  EXPECT_EQ(ReadCached(key_b, "\"b\""), data_b);
+  DownloadCache::Entry entry;
+  ASSERT_TRUE(cache_->Lookup(key_a, &entry));
+  EXPECT_EQ(entry.md5_hash, "md5a");
+  EXPECT_EQ(entry.generation, 1);
+
+  // The least recently used order is preserved.
+  CreateCache(500);
+  EXPECT_FALSE(cache_->Lookup(key_a, &entry));
+  EXPECT_TRUE(cache_->Lookup(key_b, &entry));
+}
+
+TEST_F(DownloadCacheTest, CompactsIndex) {
+  std::string key = Key("a");
+  const int kVersions = 1000;
+  for (int i = 0; i < kVersions; ++i) {
+    std::string data(10, 'a' + i % 26);
+    std::string etag = "\"" + std::to_string(i) + "\"";
+    std::string md5_hash = "md5" + std::to_string(i);
+    cache_->StoreBuffer(key, MakeEntry(data, etag.c_str(), md5_hash.c_str()),
+                        data.data(), data.size());
+  }
+  // Each version is recorded in the index, which is rewritten as it fills up
+  // with records of replaced versions.
+  std::ifstream index(directory_ + "/index", std::ios::in | std::ios::binary);
+  int records = 0;
+  for (std::string line; std::getline(index, line);) {
+    if (line == "+" || line == "-") records++;
+  }
+  EXPECT_GT(records, 0);
+  EXPECT_LT(records, kVersions / 2);
+
+  CreateCache(kMaxCacheSize);
+  std::string last_etag = "\"" + std::to_string(kVersions - 1) + "\"";
+  DownloadCache::Entry entry;
+  ASSERT_TRUE(cache_->Lookup(key, &entry));
+  EXPECT_EQ(entry.etag, last_etag);
+  EXPECT_EQ(ReadCached(key, last_etag.c_str()), std::string(10, 'l'));
+  EXPECT_EQ(cache_->size(), 10);
+}
+
+class DownloadCacheResponseTest : public DownloadCacheTest {
+ protected:
+  DownloadCacheResponseTest() : future_impl_(1) {}
+
+  // Complete response as if it received a response with status, headers and
+  // body.
+  static void Receive(rest::Response* response, int status,
+                      const std::vector<std::string>& headers,
+                      const std::string& body) {
+    std::string status_line =
+        "HTTP/1.1 " + std::to_string(status) + " Status\r\n";
+    response->ProcessHeader(status_line.c_str(), status_line.size());
+    for (const std::string& header : headers) {
+      std::string line = header + "\r\n";
+      response->ProcessHeader(line.c_str(), line.size());
+    }
+    response->ProcessHeader("\r\n", 2);
+    if (!body.empty()) response->ProcessBody(body.data(), body.size());
+    response->MarkCompleted();
+  }
+
+  // Returns the base64 encoded MD5 hash of data.
+  static std::string Md5Hash(const std::string& data) {
+    Md5 md5;
+    md5.Update(data.data(), data.size());
+    uint8_t digest[Md5::kDigestSize];
+    md5.Finish(digest);
+    std::string encoded;
+    firebase::internal::Base64EncodeWithPadding(
+        std::string(reinterpret_cast<char*>(digest), sizeof(digest)),
+        &encoded);
+    return encoded;
+  }
+
+  static std::vector<std::string> Headers(const std::string& data,
+                                          const char* etag) {
+    return {"Content-Length: " + std::to_string(data.size()),
+            std::string("ETag: ") + etag, "X-Goog-Generation: 7",
+            "X-Goog-Hash: md5=" + Md5Hash(data)};
+  }
+
+  DownloadCacheRequest MakeRequest(const std::string& key,
+                                   const char* etag) {
+    DownloadCacheRequest request;
+    request.cache = std::shared_ptr<DownloadCache>(cache_.get(),
+                                                   [](DownloadCache*) {});
+    request.key = key;
+    request.etag = etag;
+    return request;
+  }
+
+  ReferenceCountedFutureImpl future_impl_;
+};
+
+TEST_F(DownloadCacheResponseTest, GetBytesCachesAndRevalidates) {
+  std::string key = Key("a");
+  std::string data(256, 'g');
+  std::vector<char> buffer(1024);
+  {
+    auto handle = future_impl_.SafeAlloc<size_t>(0);
+    GetBytesResponse response(buffer.data(), buffer.size(), handle,
+                              &future_impl_, MakeRequest(key, ""));
+    Receive(&response, rest::util::HttpSuccess, Headers(data, "\"1\""), data);
+  }
+  DownloadCache::Entry entry;
+  ASSERT_TRUE(cache_->Lookup(key, &entry));
+  EXPECT_EQ(entry.etag, "\"1\"");
+  EXPECT_EQ(entry.generation, 7);
+  EXPECT_EQ(entry.md5_hash, Md5Hash(data));
+
+  std::fill(buffer.begin(), buffer.end(), 0);
+  auto handle = future_impl_.SafeAlloc<size_t>(0);
+  GetBytesResponse response(buffer.data(), buffer.size(), handle,
+                            &future_impl_, MakeRequest(key, "\"1\""));
+  Receive(&response, 304, {}, "");
+  const Future<size_t>& future = static_cast<const Future<size_t>&>(
+      future_impl_.LastResult(0));
+  EXPECT_EQ(future.error(), kErrorNone);
+  ASSERT_NE(future.result(), nullptr);
+  EXPECT_EQ(*future.result(), data.size());
+  EXPECT_EQ(std::string(buffer.data(), data.size()), data);
+}
+
+TEST_F(DownloadCacheResponseTest, GetBytesDoesNotCacheTruncatedObject) {
+  std::string key = Key("a");
+  std::string data(256, 'g');
+  std::vector<char> buffer(100);
+  auto handle = future_impl_.SafeAlloc<size_t>(0);
+  GetBytesResponse response(buffer.data(), buffer.size(), handle,
+                            &future_impl_, MakeRequest(key, ""));
+  Receive(&response, rest::util::HttpSuccess, Headers(data, "\"1\""), data);
+  DownloadCache::Entry entry;
+  EXPECT_FALSE(cache_->Lookup(key, &entry));
+}
+
+TEST_F(DownloadCacheResponseTest, GetFileCachesAndRevalidates) {
+  std::string key = Key("a");
+  std::string data(300, 'f');
+  {
+    auto handle = future_impl_.SafeAlloc<size_t>(0);
+    GetFileResponse response(file_path_.c_str(), handle, &future_impl_,
+                             MakeRequest(key, ""));
+    Receive(&response, rest::util::HttpSuccess, Headers(data, "\"1\""), data);
+  }
+  DownloadCache::Entry entry;
+  ASSERT_TRUE(cache_->Lookup(key, &entry));
+  remove(file_path_.c_str());
+
+  auto handle = future_impl_.SafeAlloc<size_t>(0);
+  GetFileResponse response(file_path_.c_str(), handle, &future_impl_,
+                           MakeRequest(key, "\"1\""));
+  Receive(&response, 304, {}, "");
+  const Future<size_t>& future = static_cast<const Future<size_t>&>(
+      future_impl_.LastResult(0));
+  EXPECT_EQ(future.error(), kErrorNone);
+  ASSERT_NE(future.result(), nullptr);
+  EXPECT_EQ(*future.result(), data.size());
+  EXPECT_EQ(ReadFile(), data);
+}
+
+TEST_F(DownloadCacheResponseTest, RetriesWhenCachedObjectIsGone) {
+  std::string key = Key("a");
+  std::vector<char> buffer(100);
+  auto handle = future_impl_.SafeAlloc<size_t>(0);
+  GetBytesResponse response(buffer.data(), buffer.size(), handle,
+                            &future_impl_, MakeRequest(key, "\"1\""));
+  Receive(&response, 304, {}, "");
+  EXPECT_EQ(response.status(), rest::util::HttpRequestTimeout);
+}
+
+TEST_F(DownloadCacheResponseTest, RemovesDeletedObject) {
+  std::string key = Key("a");
+  std::string data(10, 'd');
+  cache_->StoreBuffer(key, MakeEntry(data, "\"1\"", "md5d"), data.data(),
+                      data.size());
+  std::vector<char> buffer(100);
+  auto handle = future_impl_.SafeAlloc<size_t>(0);
+  GetBytesResponse response(buffer.data(), buffer.size(), handle,
+                            &future_impl_, MakeRequest(key, "\"1\""));
+  Receive(&response, rest::util::HttpNotFound, {}, "{}");
+  DownloadCache::Entry entry;
+  EXPECT_FALSE(cache_->Lookup(key, &entry));
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
@@ -0,0 +1,220 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "storage/src/desktop/download_file.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "app/rest/util.h"
+#include "app/src/reference_counted_future_impl.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "storage/src/desktop/curl_requests.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+namespace {
+
+class DownloadFileTest : public ::testing::Test {
+ protected:
+  DownloadFileTest() : future_impl_(1) {}
+
+  void SetUp() override {
+    const char* temp_dir = getenv("TEST_TMPDIR");
+    path_ = std::string(temp_dir ? temp_dir : ".") + "/download_file.bin";
+    remove(path_.c_str());
+  }
+
+  void TearDown() override { remove(path_.c_str()); }
+
+  static bool Exists(const std::string& path) {
+    return std::ifstream(path, std::ios::in | std::ios::binary).is_open();
+  }
+
+  static std::string ReadFile(const std::string& path) {
+    std::ifstream input(path, std::ios::in | std::ios::binary);
+    std::stringstream contents;
+    contents << input.rdbuf();
+    return contents.str();
+  }
+
+  static void WriteFile(const std::string& path, const std::string& data) {
+    std::ofstream output(path, std::ios::out | std::ios::binary);
+    output << data;
+  }
+
+  // Data that spans several buffers and doesn't end at a block boundary.
+  static std::string LargeData() {
+    std::string data(kDownloadFileBufferSize * 2 + 12345, '\0');
+    for (size_t i = 0; i < data.size(); ++i) {
+      data[i] = static_cast<char>(i * 31 + i / 4096);
+    }
+    return data;
+  }
+
+  // Write data to file in chunks like those received from the network.
+  static bool WriteChunks(DownloadFile* file, const std::string& data) {
+    const size_t kChunkSize = 16 * 1024 + 7;
+    for (size_t offset = 0; offset < data.size(); offset += kChunkSize) {
+      size_t size = std::min(kChunkSize, data.size() - offset);
+      if (!file->Write(data.data() + offset, size)) return false;
+    }
+    return true;
+  }
+
+  // Complete response as if it received a response with status, headers and
+  // body.
+  static void Receive(rest::Response* response, int status,
+                      const std::vector<std::string>& headers,
+                      const std::string& body) {
+    std::string status_line =
+        "HTTP/1.1 " + std::to_string(status) + " Status\r\n";
+    response->ProcessHeader(status_line.c_str(), status_line.size());
+    for (const std::string& header : headers) {
+      std::string line = header + "\r\n";
+      response->ProcessHeader(line.c_str(), line.size());
+    }
+    response->ProcessHeader("\r\n", 2);
+    if (!body.empty()) response->ProcessBody(body.data(), body.size());
+    response->MarkCompleted();
+  }
+
+  std::string path_;
+  ReferenceCountedFutureImpl future_impl_;
+};
+
+TEST_F(DownloadFileTest, ReplacesDestinationOnCommit) {
+  WriteFile(path_, "old contents");
+  std::string data = LargeData();
+  DownloadFile file(path_);
+  ASSERT_TRUE(file.Open(static_cast<int64_t>(data.size())));
+  ASSERT_TRUE(WriteChunks(&file, data));
+  EXPECT_EQ(file.size(), data.size());
+  EXPECT_EQ(ReadFile(path_), "old contents");
+  ASSERT_TRUE(file.Commit());
+  EXPECT_EQ(ReadFile(path_), data);
+  EXPECT_FALSE(Exists(file.temp_path()));
+}
+
+TEST_F(DownloadFileTest, DiscardLeavesDestinationUntouched) {
+  WriteFile(path_, "old contents");
+  std::string temp_path;
+  {
+    DownloadFile file(path_);
+    ASSERT_TRUE(file.Open(-1));
+    ASSERT_TRUE(WriteChunks(&file, LargeData()));
+    EXPECT_TRUE(Exists(file.temp_path()));
+    file.Discard();
+    EXPECT_FALSE(Exists(file.temp_path()));
+  }
+  {
+    // Destroying a file that wasn't committed discards it.
+    DownloadFile file(path_);
+    temp_path = file.temp_path();
+    ASSERT_TRUE(file.Open(-1));
+    ASSERT_TRUE(file.Write("new", 3));
+  }
+  EXPECT_EQ(ReadFile(path_), "old contents");
+  EXPECT_FALSE(Exists(temp_path));
+}
+
+TEST_F(DownloadFileTest, DownloadsToTheSamePathUseSeparateFiles) {
+  DownloadFile first(path_);
+  DownloadFile second(path_);
+  EXPECT_NE(first.temp_path(), second.temp_path());
+  ASSERT_TRUE(first.Open(-1));
+  ASSERT_TRUE(second.Open(-1));
+  ASSERT_TRUE(first.Write("first", 5));
+  ASSERT_TRUE(second.Write("second", 6));
+  ASSERT_TRUE(second.Commit());
+  EXPECT_EQ(ReadFile(path_), "second");
+  ASSERT_TRUE(first.Commit());
+  EXPECT_EQ(ReadFile(path_), "first");
+}
+
+TEST_F(DownloadFileTest, ReopeningDiscardsEarlierData) {
+  DownloadFile file(path_);
+  ASSERT_TRUE(file.Open(-1));
+  ASSERT_TRUE(WriteChunks(&file, LargeData()));
+  ASSERT_TRUE(file.Open(5));
+  ASSERT_TRUE(file.Write("retry", 5));
+  ASSERT_TRUE(file.Commit());
+  EXPECT_EQ(ReadFile(path_), "retry");
+}
+
+TEST_F(DownloadFileTest, WritesLargeFilesWithDirectIo) {
+  std::string data = LargeData();
+  DownloadFile file(path_);
+  // Falls back to buffered I/O where the file system doesn't support direct
+  // I/O.
+  ASSERT_TRUE(file.Open(static_cast<int64_t>(data.size()), data.size()));
+  ASSERT_TRUE(WriteChunks(&file, data));
+  ASSERT_TRUE(file.Commit());
+  EXPECT_EQ(ReadFile(path_), data);
+}
+
+TEST_F(DownloadFileTest, DoesNotUseDirectIoForSmallFiles) {
+  DownloadFile file(path_);
+  ASSERT_TRUE(file.Open(100, 1000));
+  EXPECT_FALSE(file.direct_io());
+}
+
+TEST_F(DownloadFileTest, CommitsFileWrittenToTempPath) {
+  DownloadFile file(path_);
+  WriteFile(file.temp_path(), "copied");
+  ASSERT_TRUE(file.Commit());
+  EXPECT_EQ(ReadFile(path_), "copied");
+  EXPECT_FALSE(Exists(file.temp_path()));
+}
+
+TEST_F(DownloadFileTest, GetFileResponseWritesEmptyObject) {
+  auto handle = future_impl_.SafeAlloc<size_t>(0);
+  GetFileResponse response(path_.c_str(), handle, &future_impl_);
+  Receive(&response, rest::util::HttpSuccess, {"Content-Length: 0"}, "");
+  EXPECT_EQ(future_impl_.LastResult(0).error(), kErrorNone);
+  EXPECT_TRUE(Exists(path_));
+  EXPECT_EQ(ReadFile(path_), "");
+}
+
+TEST_F(DownloadFileTest, GetFileResponseRetriesTruncatedObject) {
+  WriteFile(path_, "old contents");
+  auto handle = future_impl_.SafeAlloc<size_t>(0);
+  GetFileResponse response(path_.c_str(), handle, &future_impl_);
+  Receive(&response, rest::util::HttpSuccess, {"Content-Length: 100"},
+          "only part of the object");
+  EXPECT_EQ(response.status(), rest::util::HttpRequestTimeout);
+  EXPECT_EQ(ReadFile(path_), "old contents");
+  EXPECT_FALSE(Exists(response.file().temp_path()));
+}
+
+TEST_F(DownloadFileTest, GetFileResponseFailsIfFileCannotBeWritten) {
+  std::string path = path_ + ".missing/object.bin";
+  auto handle = future_impl_.SafeAlloc<size_t>(0);
+  GetFileResponse response(path.c_str(), handle, &future_impl_);
+  Receive(&response, rest::util::HttpSuccess, {"Content-Length: 4"}, "data");
+  EXPECT_EQ(future_impl_.LastResult(0).error(), kErrorUnknown);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
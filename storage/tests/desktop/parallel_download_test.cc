@@ -0,0 +1,475 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "storage/src/desktop/parallel_download.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "app/rest/transport_builder.h"
+#include "app/rest/util.h"
+#include "app/src/include/firebase/internal/mutex.h"
+#include "app/src/semaphore.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+namespace {
+
+const char kObjectUrl[] =
+    "http://localhost:9199/v0/b/bucket/o/object?alt=media";
+const size_t kPartSize = 1024;
+
+// Stands in for the storage backend, serving ranges of an object to requests
+// performed by FakeRangeTransport.
+class FakeRangeServer {
+ public:
+  void Reset(const std::string& data, const std::string& etag) {
+    MutexLock lock(mutex_);
+    data_ = data;
+    etag_ = etag;
+    ranges_.clear();
+    ignore_ranges_ = false;
+    fail_offset_ = -1;
+    fail_status_ = 0;
+    fail_count_ = 0;
+    truncate_offset_ = -1;
+    truncate_size_ = 0;
+    on_offset_ = -1;
+    on_offset_function_ = nullptr;
+  }
+
+  // Handle a request, writing the result to response.
+  void Perform(rest::Request* request, rest::Response* response) {
+    const std::map<std::string, std::string>& headers =
+        request->options().header;
+    auto range_it = headers.find("Range");
+    long long first = -1, last = -1;  // NOLINT
+    if (range_it != headers.end()) {
+      sscanf(range_it->second.c_str(), "bytes=%lld-%lld", &first,  // NOLINT
+             &last);
+    }
+    std::function<void()> on_offset;
+    std::string body;
+    int status;
+    std::vector<std::string> response_headers;
+    {
+      MutexLock lock(mutex_);
+      ranges_.push_back(first);
+      if (first == on_offset_) {
+        on_offset = on_offset_function_;
+        on_offset_ = -1;
+      }
+      if (request->options().url != kObjectUrl ||
+          request->options().method != rest::util::kGet) {
+        status = 404;
+        body = "{\"error\":{\"code\":404,\"message\":\"Not Found\"}}";
+      } else if (first == fail_offset_ && fail_count_ != 0) {
+        if (fail_count_ > 0) --fail_count_;
+        status = fail_status_;
+        body = "{\"error\":{\"code\":" + std::to_string(fail_status_) +
+               ",\"message\":\"Failed\"}}";
+      } else if (first < 0 || ignore_ranges_) {
+        status = 200;
+        body = data_;
+        response_headers.push_back("Content-Length: " +
+                                   std::to_string(data_.size()));
+      } else if (first >= static_cast<long long>(data_.size())) {  // NOLINT
+        status = 416;
+      } else {
+        last = (std::min)(last, static_cast<long long>(data_.size()) - 1);
+        status = 206;
+        body = data_.substr(first, last - first + 1);
+        response_headers.push_back("Content-Range: bytes " +
+                                   std::to_string(first) + "-" +
+                                   std::to_string(last) + "/" +
+                                   std::to_string(data_.size()));
+        if (first == truncate_offset_) {
+          // The connection drops part way through the body.
+          truncate_offset_ = -1;
+          body.resize(truncate_size_);
+        }
+      }
+      if (!etag_.empty()) response_headers.push_back("ETag: " + etag_);
+    }
+    if (on_offset) on_offset();
+    Respond(response, status, response_headers, body);
+  }
+
+  // Start offsets of the requested ranges, -1 for requests without a range.
+  std::vector<long long> ranges() {  // NOLINT
+    MutexLock lock(mutex_);
+    return ranges_;
+  }
+
+  void set_ignore_ranges(bool ignore_ranges) {
+    MutexLock lock(mutex_);
+    ignore_ranges_ = ignore_ranges;
+  }
+
+  // Fail count requests for the range starting at offset with status, or all
+  // of them if count is negative.
+  void FailRange(long long offset, int status, int count) {  // NOLINT
+    MutexLock lock(mutex_);
+    fail_offset_ = offset;
+    fail_status_ = status;
+    fail_count_ = count;
+  }
+
+  // Send only size bytes of the range starting at offset once.
+  void TruncateRange(long long offset, size_t size) {  // NOLINT
+    MutexLock lock(mutex_);
+    truncate_offset_ = offset;
+    truncate_size_ = size;
+  }
+
+  // Wait for a response to abort the transfer of its body.
+  bool WaitForAbortedRequest() { return aborted_.TimedWait(10000); }
+
+  // Call function before sending the body of the next request for the range
+  // starting at offset.
+  void OnRange(long long offset, std::function<void()> function) {  // NOLINT
+    MutexLock lock(mutex_);
+    on_offset_ = offset;
+    on_offset_function_ = function;
+  }
+
+ private:
+  void Respond(rest::Response* response, int status,
+               const std::vector<std::string>& headers,
+               const std::string& body) {
+    std::string status_line =
+        "HTTP/1.1 " + std::to_string(status) + " Status\r\n";
+    response->ProcessHeader(status_line.c_str(), status_line.size());
+    for (const std::string& header : headers) {
+      std::string line = header + rest::util::kCrLf;
+      response->ProcessHeader(line.c_str(), line.size());
+    }
+    response->ProcessHeader(rest::util::kCrLf, strlen(rest::util::kCrLf));
+    // Deliver the body in pieces as the network would, stopping if the
+    // response aborts the transfer.
+    for (size_t offset = 0; offset < body.size(); offset += 256) {
+      size_t size = (std::min)(body.size() - offset, static_cast<size_t>(256));
+      if (!response->ProcessBody(body.data() + offset, size)) {
+        aborted_.Post();
+        break;
+      }
+    }
+    response->MarkCompleted();
+  }
+
+  Mutex mutex_;
+  std::string data_;
+  std::string etag_;
+  std::vector<long long> ranges_;  // NOLINT
+  bool ignore_ranges_ = false;
+  long long fail_offset_ = -1;  // NOLINT
+  int fail_status_ = 0;
+  int fail_count_ = 0;
+  long long truncate_offset_ = -1;  // NOLINT
+  size_t truncate_size_ = 0;
+  long long on_offset_ = -1;  // NOLINT
+  std::function<void()> on_offset_function_;
+  Semaphore aborted_{0};
+};
+
+FakeRangeServer* g_server = nullptr;
+
+// Synchronous transport that sends requests to g_server.
+class FakeRangeTransport : public rest::Transport {
+ private:
+  void PerformInternal(rest::Request* request, rest::Response* response,
+                       flatbuffers::unique_ptr<rest::Controller>*) override {
+    g_server->Perform(request, response);
+  }
+};
+
+flatbuffers::unique_ptr<rest::Transport> CreateFakeRangeTransport() {
+  return flatbuffers::unique_ptr<rest::Transport>(new FakeRangeTransport());
+}
+
+// Response which signals when it's complete.
+class CompletionResponse : public rest::Response {
+ public:
+  CompletionResponse() : failed_(false), complete_(0) {}
+
+  void MarkCompleted() override {
+    rest::Response::MarkCompleted();
+    complete_.Post();
+  }
+  void MarkFailed() override {
+    failed_ = true;
+    rest::Response::MarkFailed();
+    complete_.Post();
+  }
+
+  bool WaitForCompletion() { return complete_.TimedWait(10000); }
+  bool failed() const { return failed_; }
+
+ private:
+  bool failed_;
+  Semaphore complete_;
+};
+
+class ParallelDownloadTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    data_.resize(10 * kPartSize + 123);
+    for (size_t i = 0; i < data_.size(); ++i) {
+      data_[i] = static_cast<char>(i * 7);
+    }
+    server_.Reset(data_, "\"etag1\"");
+    g_server = &server_;
+    rest::SetTransportBuilder(CreateFakeRangeTransport);
+    const char* temp_dir = getenv("TEST_TMPDIR");
+    options_.path =
+        std::string(temp_dir ? temp_dir : ".") + "/parallel_download.bin";
+    options_.part_size = kPartSize;
+    options_.max_parallel_parts = 4;
+    options_.retry_policy.initial_backoff_ms = 1;
+    options_.retry_policy.max_backoff_ms = 10;
+    options_.retry_policy.max_retry_time_ms = 5000;
+    remove(options_.path.c_str());
+    remove(GetDownloadStateFile(options_.path).c_str());
+    request_.set_url(kObjectUrl);
+    request_.set_method(rest::util::kGet);
+    request_.add_header("Authorization", "Bearer token");
+  }
+
+  void TearDown() override {
+    remove(options_.path.c_str());
+    remove(GetDownloadStateFile(options_.path).c_str());
+    rest::SetTransportBuilder(nullptr);
+    g_server = nullptr;
+  }
+
+  // Download the object with a new transport and wait for it to complete.
+  void Download(CompletionResponse* response,
+                flatbuffers::unique_ptr<rest::Controller>* controller) {
+    transport_.reset(new ParallelDownloadTransport(options_, nullptr));
+    transport_->Perform(&request_, response, controller);
+    ASSERT_TRUE(response->WaitForCompletion());
+  }
+
+  std::string ReadFile() {
+    std::ifstream file(options_.path, std::ios::in | std::ios::binary);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+  }
+
+  bool StateFileExists() {
+    return std::ifstream(GetDownloadStateFile(options_.path)).good();
+  }
+
+  // Get the offsets of the parts of data_ starting with part first.
+  std::vector<long long> PartOffsets(int first) {  // NOLINT
+    std::vector<long long> offsets;  // NOLINT
+    for (size_t offset = first * kPartSize; offset < data_.size();
+         offset += kPartSize) {
+      offsets.push_back(offset);
+    }
+    return offsets;
+  }
+
+  FakeRangeServer server_;
+  ParallelDownloadOptions options_;
+  std::string data_;
+  rest::Request request_;
+  std::unique_ptr<ParallelDownloadTransport> transport_;
+};
+
+TEST_F(ParallelDownloadTest, DownloadsPartsInParallel) {
+  CompletionResponse response;
+  ParallelDownloadTransport transport(options_, nullptr);
+  flatbuffers::unique_ptr<rest::Controller> controller;
+  transport.Perform(&request_, &response, &controller);
+  ASSERT_TRUE(response.WaitForCompletion());
+
+  EXPECT_FALSE(response.failed());
+  EXPECT_EQ(200, response.status());
+  EXPECT_STREQ(std::to_string(data_.size()).c_str(),
+               response.GetHeader("Content-Length"));
+  EXPECT_EQ(data_, ReadFile());
+  std::vector<long long> ranges = server_.ranges();  // NOLINT
+  std::sort(ranges.begin(), ranges.end());
+  EXPECT_EQ(PartOffsets(0), ranges);
+  EXPECT_EQ(static_cast<int64_t>(data_.size()), controller->TransferSize());
+  EXPECT_EQ(static_cast<int64_t>(data_.size()),
+            controller->BytesTransferred());
+  EXPECT_FALSE(StateFileExists());
+}
+
+TEST_F(ParallelDownloadTest, DownloadsSmallObjectWithOneRequest) {
+  data_.resize(kPartSize / 2);
+  server_.Reset(data_, "\"etag1\"");
+  CompletionResponse response;
+  Download(&response, nullptr);
+
+  EXPECT_EQ(200, response.status());
+  EXPECT_EQ(data_, ReadFile());
+  EXPECT_THAT(server_.ranges(), ::testing::ElementsAre(0));
+}
+
+TEST_F(ParallelDownloadTest, DownloadsEmptyObject) {
+  server_.Reset("", "\"etag1\"");
+  CompletionResponse response;
+  Download(&response, nullptr);
+
+  EXPECT_EQ(200, response.status());
+  EXPECT_STREQ("0", response.GetHeader("Content-Length"));
+  EXPECT_EQ("", ReadFile());
+  EXPECT_THAT(server_.ranges(), ::testing::ElementsAre(0, -1));
+}
+
+TEST_F(ParallelDownloadTest, DownloadsWholeObjectWhenRangesAreIgnored) {
+  server_.set_ignore_ranges(true);
+  CompletionResponse response;
+  Download(&response, nullptr);
+
+  EXPECT_EQ(200, response.status());
+  EXPECT_EQ(data_, ReadFile());
+  EXPECT_THAT(server_.ranges(), ::testing::ElementsAre(0));
+}
+
+TEST_F(ParallelDownloadTest, RetriesRemainderOfTruncatedPart) {
+  options_.max_parallel_parts = 1;
+  server_.TruncateRange(3 * kPartSize, 512);
+  CompletionResponse response;
+  Download(&response, nullptr);
+
+  EXPECT_EQ(200, response.status());
+  EXPECT_EQ(data_, ReadFile());
+  std::vector<long long> expected = PartOffsets(0);  // NOLINT
+  expected.insert(expected.begin() + 4, 3 * kPartSize + 512);
+  EXPECT_EQ(expected, server_.ranges());
+}
+
+TEST_F(ParallelDownloadTest, FailsWithoutRetryingPermanentErrors) {
+  options_.max_parallel_parts = 1;
+  server_.FailRange(2 * kPartSize, 403, -1);
+  CompletionResponse response;
+  Download(&response, nullptr);
+
+  EXPECT_FALSE(response.failed());
+  EXPECT_EQ(403, response.status());
+  EXPECT_STREQ("{\"error\":{\"code\":403,\"message\":\"Failed\"}}",
+               response.GetBody());
+  EXPECT_THAT(server_.ranges(),
+              ::testing::ElementsAre(0, kPartSize, 2 * kPartSize));
+  EXPECT_FALSE(StateFileExists());
+}
+
+TEST_F(ParallelDownloadTest, ResumesFromStateFile) {
+  options_.max_parallel_parts = 1;
+  options_.retry_policy.max_retry_time_ms = 50;
+  server_.FailRange(5 * kPartSize, 503, -1);
+  CompletionResponse failed_response;
+  Download(&failed_response, nullptr);
+  EXPECT_TRUE(failed_response.failed());
+  EXPECT_EQ(rest::util::HttpRequestTimeout, failed_response.status());
+  EXPECT_TRUE(StateFileExists());
+
+  server_.Reset(data_, "\"etag1\"");
+  CompletionResponse response;
+  flatbuffers::unique_ptr<rest::Controller> controller;
+  Download(&response, &controller);
+
+  EXPECT_EQ(200, response.status());
+  EXPECT_EQ(data_, ReadFile());
+  EXPECT_EQ(PartOffsets(5), server_.ranges());
+  EXPECT_EQ(static_cast<int64_t>(data_.size()),
+            controller->BytesTransferred());
+  EXPECT_FALSE(StateFileExists());
+}
+
+TEST_F(ParallelDownloadTest, RestartsWhenObjectChanged) {
+  options_.max_parallel_parts = 1;
+  options_.retry_policy.max_retry_time_ms = 50;
+  server_.FailRange(5 * kPartSize, 503, -1);
+  CompletionResponse failed_response;
+  Download(&failed_response, nullptr);
+  EXPECT_TRUE(StateFileExists());
+
+  std::reverse(data_.begin(), data_.end());
+  server_.Reset(data_, "\"etag2\"");
+  CompletionResponse response;
+  Download(&response, nullptr);
+
+  EXPECT_EQ(200, response.status());
+  EXPECT_EQ(data_, ReadFile());
+  // The part fetched to check the object is kept.
+  std::vector<long long> expected = PartOffsets(0);  // NOLINT
+  expected.erase(expected.begin() + 5);
+  expected.insert(expected.begin(), 5 * kPartSize);
+  EXPECT_EQ(expected, server_.ranges());
+}
+
+TEST_F(ParallelDownloadTest, PauseAndResume) {
+  options_.max_parallel_parts = 1;
+  flatbuffers::unique_ptr<rest::Controller> controller;
+  Semaphore paused(0);
+  // Pause while the third part is being received, which aborts it.
+  server_.OnRange(2 * kPartSize, [&controller, &paused]() {
+    EXPECT_TRUE(controller->Pause());
+    paused.Post();
+  });
+  CompletionResponse response;
+  ParallelDownloadTransport transport(options_, nullptr);
+  transport.Perform(&request_, &response, &controller);
+  ASSERT_TRUE(paused.TimedWait(10000));
+  ASSERT_TRUE(server_.WaitForAbortedRequest());
+  EXPECT_TRUE(controller->IsPaused());
+  EXPECT_FALSE(controller->Pause());
+
+  EXPECT_TRUE(controller->Resume());
+  ASSERT_TRUE(response.WaitForCompletion());
+  EXPECT_EQ(200, response.status());
+  EXPECT_EQ(data_, ReadFile());
+  std::vector<long long> ranges = server_.ranges();  // NOLINT
+  EXPECT_EQ(PartOffsets(0).size() + 1, ranges.size());
+  EXPECT_EQ(2 * kPartSize, ranges[2]);
+  EXPECT_EQ(2 * kPartSize, ranges[3]);
+}
+
+TEST_F(ParallelDownloadTest, CancelKeepsState) {
+  options_.max_parallel_parts = 1;
+  flatbuffers::unique_ptr<rest::Controller> controller;
+  server_.OnRange(2 * kPartSize,
+                  [&controller]() { EXPECT_TRUE(controller->Cancel()); });
+  CompletionResponse response;
+  Download(&response, &controller);
+
+  EXPECT_TRUE(response.failed());
+  EXPECT_EQ(rest::util::HttpNoContent, response.status());
+  EXPECT_FALSE(controller->Cancel());
+  EXPECT_TRUE(StateFileExists());
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
@@ -0,0 +1,539 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "storage/src/desktop/resumable_upload.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "app/rest/request_binary.h"
+#include "app/rest/transport_builder.h"
+#include "app/rest/util.h"
+#include "app/src/include/firebase/internal/mutex.h"
+#include "app/src/semaphore.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace firebase {
+namespace storage {
+namespace internal {
+namespace {
+
+const char kStartUrl[] =
+    "http://localhost:9199/v0/b/bucket/o?name=object&uploadType=resumable";
+const char kSessionUrlPrefix[] = "http://localhost:9199/upload/";
+
+// Stands in for the storage backend, implementing the resumable upload
+// protocol for requests performed by FakeUploadTransport.
+class FakeUploadServer {
+ public:
+  struct Session {
+    std::string data;
+    bool final = false;
+  };
+
+  void Reset() {
+    MutexLock lock(mutex_);
+    sessions_.clear();
+    commands_.clear();
+    bytes_received_ = 0;
+    start_body_.clear();
+    start_status_ = 200;
+    fail_chunk_ = -1;
+    fail_chunk_commit_ = 0;
+    chunks_ = 0;
+    pause_chunk_ = -1;
+    on_pause_chunk_ = nullptr;
+  }
+
+  // Handle a request, writing the result to response.
+  void Perform(rest::Request* request, rest::Response* response) {
+    const std::map<std::string, std::string>& headers =
+        request->options().header;
+    auto command_it = headers.find("X-Goog-Upload-Command");
+    std::string command =
+        command_it != headers.end() ? command_it->second : std::string();
+    int chunk = -1;
+    std::function<void()> on_pause_chunk;
+    {
+      MutexLock lock(mutex_);
+      commands_.push_back(command);
+      if (command.compare(0, 6, "upload") == 0) {
+        chunk = chunks_++;
+        if (chunk == pause_chunk_) on_pause_chunk = on_pause_chunk_;
+      }
+    }
+    if (on_pause_chunk) on_pause_chunk();
+
+    std::string body;
+    bool aborted = false;
+    char buffer[4096];
+    while (request->GetPostFieldsSize()) {
+      size_t read_size = request->ReadBody(buffer, sizeof(buffer), &aborted);
+      if (aborted || !read_size) break;
+      body.append(buffer, read_size);
+    }
+    if (aborted) {
+      response->MarkFailed();
+      aborted_.Post();
+      return;
+    }
+
+    MutexLock lock(mutex_);
+    if (chunk >= 0) bytes_received_ += body.size();
+    const std::string& url = request->options().url;
+    if (command == "start") {
+      start_body_ = body;
+      if (url != kStartUrl || start_status_ != 200) {
+        Respond(response, url != kStartUrl ? 404 : start_status_, {}, "");
+        return;
+      }
+      std::string session_url =
+          kSessionUrlPrefix + std::to_string(sessions_.size());
+      sessions_[session_url] = Session();
+      Respond(response, 200,
+              {"X-Goog-Upload-Status: active",
+               "X-Goog-Upload-URL: " + session_url},
+              "");
+      return;
+    }
+    auto session_it = sessions_.find(url);
+    if (session_it == sessions_.end()) {
+      Respond(response, 404, {}, "");
+      return;
+    }
+    Session& session = session_it->second;
+    if (command == "query") {
+      Respond(response, 200,
+              {session.final ? "x-goog-upload-status: final"
+                             : "x-goog-upload-status: active",
+               "x-goog-upload-size-received: " +
+                   std::to_string(session.data.size())},
+              session.final ? "{\"name\":\"object\"}" : "");
+      return;
+    }
+    auto offset_it = headers.find("X-Goog-Upload-Offset");
+    if (session.final || offset_it == headers.end() ||
+        std::strtoull(offset_it->second.c_str(), nullptr, 10) !=
+            session.data.size()) {
+      Respond(response, 400, {}, "");
+      return;
+    }
+    if (chunk == fail_chunk_) {
+      // Commit part of the chunk before the connection fails.
+      session.data.append(body, 0, fail_chunk_commit_);
+      Respond(response, 503, {}, "");
+      return;
+    }
+    session.data += body;
+    if (command == "upload, finalize") {
+      session.final = true;
+      Respond(response, 200, {"X-Goog-Upload-Status: final"},
+              "{\"name\":\"object\"}");
+    } else {
+      Respond(response, 200, {"X-Goog-Upload-Status: active"}, "");
+    }
+  }
+
+  // Add a session that has received data.
+  std::string AddSession(const std::string& data) {
+    MutexLock lock(mutex_);
+    std::string session_url =
+        kSessionUrlPrefix + std::to_string(sessions_.size());
+    sessions_[session_url].data = data;
+    return session_url;
+  }
+
+  Session GetSession(const std::string& url) {
+    MutexLock lock(mutex_);
+    return sessions_[url];
+  }
+
+  std::vector<std::string> commands() {
+    MutexLock lock(mutex_);
+    return commands_;
+  }
+
+  // Body of the most recent start command.
+  std::string start_body() {
+    MutexLock lock(mutex_);
+    return start_body_;
+  }
+
+  // Number of bytes received by upload commands.
+  size_t bytes_received() {
+    MutexLock lock(mutex_);
+    return bytes_received_;
+  }
+
+  void set_start_status(int status) {
+    MutexLock lock(mutex_);
+    start_status_ = status;
+  }
+
+  // Fail the chunk with index chunk after committing commit bytes of it.
+  void FailChunk(int chunk, size_t commit) {
+    MutexLock lock(mutex_);
+    fail_chunk_ = chunk;
+    fail_chunk_commit_ = commit;
+  }
+
+  // Wait for a request to be aborted while its body is read.
+  bool WaitForAbortedRequest() { return aborted_.TimedWait(10000); }
+
+  // Call function before reading the chunk with index chunk.
+  void OnChunk(int chunk, std::function<void()> function) {
+    MutexLock lock(mutex_);
+    pause_chunk_ = chunk;
+    on_pause_chunk_ = function;
+  }
+
+ private:
+  static void Respond(rest::Response* response, int status,
+                      const std::vector<std::string>& headers,
+                      const std::string& body) {
+    std::string status_line =
+        "HTTP/1.1 " + std::to_string(status) + " Status\r\n";
+    response->ProcessHeader(status_line.c_str(), status_line.size());
+    for (const std::string& header : headers) {
+      std::string line = header + rest::util::kCrLf;
+      response->ProcessHeader(line.c_str(), line.size());
+    }
+    response->ProcessHeader(rest::util::kCrLf, strlen(rest::util::kCrLf));
+    if (!body.empty()) response->ProcessBody(body.c_str(), body.size());
+    response->MarkCompleted();
+  }
+
+  Mutex mutex_;
+  std::map<std::string, Session> sessions_;
+  std::vector<std::string> commands_;
+  size_t bytes_received_ = 0;
+  std::string start_body_;
+  int start_status_ = 200;
+  int fail_chunk_ = -1;
+  size_t fail_chunk_commit_ = 0;
+  int chunks_ = 0;
+  int pause_chunk_ = -1;
+  std::function<void()> on_pause_chunk_;
+  Semaphore aborted_{0};
+};
+
+FakeUploadServer* g_server = nullptr;
+
+// Synchronous transport that sends requests to g_server.
+class FakeUploadTransport : public rest::Transport {
+ private:
+  void PerformInternal(rest::Request* request, rest::Response* response,
+                       flatbuffers::unique_ptr<rest::Controller>*) override {
+    g_server->Perform(request, response);
+  }
+};
+
+flatbuffers::unique_ptr<rest::Transport> CreateFakeUploadTransport() {
+  return flatbuffers::unique_ptr<rest::Transport>(new FakeUploadTransport());
+}
+
+// Response which signals when it's complete.
+class CompletionResponse : public rest::Response {
+ public:
+  CompletionResponse() : failed_(false), complete_(0) {}
+
+  void MarkCompleted() override {
+    rest::Response::MarkCompleted();
+    complete_.Post();
+  }
+  void MarkFailed() override {
+    failed_ = true;
+    rest::Response::MarkFailed();
+    complete_.Post();
+  }
+
+  bool WaitForCompletion() { return complete_.TimedWait(10000); }
+  bool failed() const { return failed_; }
+
+ private:
+  bool failed_;
+  Semaphore complete_;
+};
+
+// Request whose body is read in small pieces from a stream of unknown size.
+class UnknownSizeRequest : public rest::Request {
+ public:
+  explicit UnknownSizeRequest(const std::string& data)
+      : data_(data), offset_(0) {
+    options_.stream_post_fields = true;
+  }
+
+  size_t GetPostFieldsSize() const override { return ~static_cast<size_t>(0); }
+
+  size_t ReadBody(char* buffer, size_t length, bool* abort) override {
+    *abort = false;
+    size_t read_size = (std::min)(length, (std::min)(data_.size() - offset_,
+                                                     static_cast<size_t>(1000)));
+    memcpy(buffer, data_.data() + offset_, read_size);
+    offset_ += read_size;
+    return read_size;
+  }
+
+ private:
+  std::string data_;
+  size_t offset_;
+};
+
+class ResumableUploadTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    server_.Reset();
+    g_server = &server_;
+    rest::SetTransportBuilder(CreateFakeUploadTransport);
+    options_.chunk_size = kResumableUploadChunkGranularity;
+    options_.retry_policy.initial_backoff_ms = 1;
+    options_.retry_policy.max_backoff_ms = 10;
+    options_.retry_policy.max_retry_time_ms = 5000;
+    data_.resize(2 * kResumableUploadChunkGranularity + 1000);
+    for (size_t i = 0; i < data_.size(); ++i) {
+      data_[i] = static_cast<char>(i * 7);
+    }
+    request_.reset(new rest::RequestBinary(data_.data(), data_.size()));
+    request_->set_url(kStartUrl);
+    request_->set_method(rest::util::kPost);
+    request_->add_header("Authorization", "Bearer token");
+  }
+
+  void TearDown() override {
+    rest::SetTransportBuilder(nullptr);
+    g_server = nullptr;
+  }
+
+  // Get the URL of the session started by the test.
+  static std::string SessionUrl(int session) {
+    return kSessionUrlPrefix + std::to_string(session);
+  }
+
+  FakeUploadServer server_;
+  ResumableUploadOptions options_;
+  std::string data_;
+  std::unique_ptr<rest::Request> request_;
+  CompletionResponse response_;
+};
+
+TEST_F(ResumableUploadTest, UploadsInChunks) {
+  flatbuffers::unique_ptr<rest::Controller> controller;
+  ResumableUploadTransport transport(options_, nullptr);
+  transport.Perform(request_.get(), &response_, &controller);
+  ASSERT_TRUE(response_.WaitForCompletion());
+
+  EXPECT_FALSE(response_.failed());
+  EXPECT_EQ(200, response_.status());
+  EXPECT_STREQ("{\"name\":\"object\"}", response_.GetBody());
+  EXPECT_THAT(server_.commands(),
+              ::testing::ElementsAre("start", "upload", "upload",
+                                     "upload, finalize"));
+  FakeUploadServer::Session session = server_.GetSession(SessionUrl(0));
+  EXPECT_TRUE(session.final);
+  EXPECT_EQ(data_, session.data);
+  EXPECT_EQ(static_cast<int64_t>(data_.size()), controller->TransferSize());
+  EXPECT_EQ(static_cast<int64_t>(data_.size()),
+            controller->BytesTransferred());
+}
+
+TEST_F(ResumableUploadTest, UploadsStreamOfUnknownSize) {
+  request_.reset(new UnknownSizeRequest(data_));
+  request_->set_url(kStartUrl);
+  request_->set_method(rest::util::kPost);
+  flatbuffers::unique_ptr<rest::Controller> controller;
+  ResumableUploadTransport transport(options_, nullptr);
+  transport.Perform(request_.get(), &response_, &controller);
+  ASSERT_TRUE(response_.WaitForCompletion());
+
+  EXPECT_EQ(200, response_.status());
+  EXPECT_THAT(server_.commands(),
+              ::testing::ElementsAre("start", "upload", "upload",
+                                     "upload, finalize"));
+  EXPECT_EQ(data_, server_.GetSession(SessionUrl(0)).data);
+  EXPECT_EQ(-1, controller->TransferSize());
+}
+
+TEST_F(ResumableUploadTest, SendsMetadataWhenStartingSession) {
+  options_.metadata_json = "{\"contentType\":\"text/plain\"}";
+  ResumableUploadTransport transport(options_, nullptr);
+  transport.Perform(request_.get(), &response_, nullptr);
+  ASSERT_TRUE(response_.WaitForCompletion());
+
+  EXPECT_EQ(200, response_.status());
+  EXPECT_EQ(options_.metadata_json, server_.start_body());
+}
+
+TEST_F(ResumableUploadTest, ResendsOnlyUncommittedDataAfterFailure) {
+  server_.FailChunk(1, 1000);
+  ResumableUploadTransport transport(options_, nullptr);
+  transport.Perform(request_.get(), &response_, nullptr);
+  ASSERT_TRUE(response_.WaitForCompletion());
+
+  EXPECT_EQ(200, response_.status());
+  EXPECT_THAT(server_.commands(),
+              ::testing::ElementsAre("start", "upload", "upload", "query",
+                                     "upload", "upload, finalize"));
+  EXPECT_EQ(data_, server_.GetSession(SessionUrl(0)).data);
+  // Only the data of the failed chunk that was not committed is sent again.
+  EXPECT_EQ(data_.size() + kResumableUploadChunkGranularity - 1000,
+            server_.bytes_received());
+}
+
+TEST_F(ResumableUploadTest, FailsWithoutRetryingPermanentErrors) {
+  server_.set_start_status(403);
+  ResumableUploadTransport transport(options_, nullptr);
+  transport.Perform(request_.get(), &response_, nullptr);
+  ASSERT_TRUE(response_.WaitForCompletion());
+
+  EXPECT_FALSE(response_.failed());
+  EXPECT_EQ(403, response_.status());
+  EXPECT_THAT(server_.commands(), ::testing::ElementsAre("start"));
+}
+
+TEST_F(ResumableUploadTest, FailsAfterMaxRetryTime) {
+  server_.set_start_status(503);
+  options_.retry_policy.initial_backoff_ms = 20;
+  options_.retry_policy.max_retry_time_ms = 100;
+  ResumableUploadTransport transport(options_, nullptr);
+  transport.Perform(request_.get(), &response_, nullptr);
+  ASSERT_TRUE(response_.WaitForCompletion());
+
+  EXPECT_TRUE(response_.failed());
+  EXPECT_EQ(rest::util::HttpRequestTimeout, response_.status());
+}
+
+class ResumableUploadSessionTest : public ResumableUploadTest {
+ protected:
+  void SetUp() override {
+    ResumableUploadTest::SetUp();
+    const char* temp_dir = getenv("TEST_TMPDIR");
+    options_.session_file =
+        std::string(temp_dir ? temp_dir : ".") + "/resumable_upload.session";
+    options_.session_key = "key";
+    remove(options_.session_file.c_str());
+  }
+
+  void TearDown() override {
+    remove(options_.session_file.c_str());
+    ResumableUploadTest::TearDown();
+  }
+
+  void WriteSession(const std::string& key, const std::string& url) {
+    std::ofstream file(options_.session_file, std::ios::out | std::ios::binary);
+    file << key << "\n" << url << "\n";
+  }
+
+  bool SessionFileExists() {
+    return std::ifstream(options_.session_file).good();
+  }
+};
+
+TEST_F(ResumableUploadSessionTest, ResumesPersistedSession) {
+  std::string committed = data_.substr(0, kResumableUploadChunkGranularity + 10);
+  std::string url = server_.AddSession(committed);
+  WriteSession(options_.session_key, url);
+
+  ResumableUploadTransport transport(options_, nullptr);
+  transport.Perform(request_.get(), &response_, nullptr);
+  ASSERT_TRUE(response_.WaitForCompletion());
+
+  EXPECT_EQ(200, response_.status());
+  EXPECT_THAT(server_.commands(),
+              ::testing::ElementsAre("query", "upload", "upload, finalize"));
+  EXPECT_EQ(data_, server_.GetSession(url).data);
+  EXPECT_EQ(data_.size() - committed.size(), server_.bytes_received());
+  EXPECT_FALSE(SessionFileExists());
+}
+
+TEST_F(ResumableUploadSessionTest, StartsNewSessionWhenPersistedSessionIsGone) {
+  WriteSession(options_.session_key, SessionUrl(10));
+
+  ResumableUploadTransport transport(options_, nullptr);
+  transport.Perform(request_.get(), &response_, nullptr);
+  ASSERT_TRUE(response_.WaitForCompletion());
+
+  EXPECT_EQ(200, response_.status());
+  EXPECT_THAT(server_.commands(),
+              ::testing::ElementsAre("query", "start", "upload", "upload",
+                                     "upload, finalize"));
+  EXPECT_EQ(data_, server_.GetSession(SessionUrl(0)).data);
+}
+
+TEST_F(ResumableUploadSessionTest, IgnoresSessionForDifferentData) {
+  std::string url = server_.AddSession(data_.substr(0, 10));
+  WriteSession("other key", url);
+
+  ResumableUploadTransport transport(options_, nullptr);
+  transport.Perform(request_.get(), &response_, nullptr);
+  ASSERT_TRUE(response_.WaitForCompletion());
+
+  EXPECT_EQ(200, response_.status());
+  EXPECT_EQ("start", server_.commands()[0]);
+  EXPECT_EQ(data_, server_.GetSession(SessionUrl(1)).data);
+}
+
+TEST_F(ResumableUploadSessionTest, PauseAndResume) {
+  flatbuffers::unique_ptr<rest::Controller> controller;
+  Semaphore paused(0);
+  // Pause while the second chunk is being sent, which aborts it.
+  server_.OnChunk(1, [&controller, &paused]() {
+    EXPECT_TRUE(controller->Pause());
+    paused.Post();
+  });
+  ResumableUploadTransport transport(options_, nullptr);
+  transport.Perform(request_.get(), &response_, &controller);
+  ASSERT_TRUE(paused.TimedWait(10000));
+  ASSERT_TRUE(server_.WaitForAbortedRequest());
+  EXPECT_TRUE(controller->IsPaused());
+  EXPECT_FALSE(controller->Pause());
+  EXPECT_EQ(static_cast<int64_t>(kResumableUploadChunkGranularity),
+            controller->BytesTransferred());
+  EXPECT_TRUE(SessionFileExists());
+
+  EXPECT_TRUE(controller->Resume());
+  ASSERT_TRUE(response_.WaitForCompletion());
+  EXPECT_EQ(200, response_.status());
+  EXPECT_THAT(server_.commands(),
+              ::testing::ElementsAre("start", "upload", "upload", "query",
+                                     "upload", "upload, finalize"));
+  EXPECT_EQ(data_, server_.GetSession(SessionUrl(0)).data);
+  EXPECT_FALSE(SessionFileExists());
+}
+
+TEST_F(ResumableUploadSessionTest, CancelKeepsSession) {
+  flatbuffers::unique_ptr<rest::Controller> controller;
+  server_.OnChunk(1, [&controller]() { EXPECT_TRUE(controller->Cancel()); });
+  ResumableUploadTransport transport(options_, nullptr);
+  transport.Perform(request_.get(), &response_, &controller);
+  ASSERT_TRUE(response_.WaitForCompletion());
+
+  EXPECT_TRUE(response_.failed());
+  EXPECT_EQ(rest::util::HttpNoContent, response_.status());
+  EXPECT_FALSE(controller->Cancel());
+  EXPECT_TRUE(SessionFileExists());
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace storage
+}  // namespace firebase
@@ -0,0 +1,149 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "testing/fake_http_server.h"
+
+#ifndef _WIN32
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <utility>
+
+namespace firebase {
+namespace testing {
+namespace cppsdk {
+
+FakeHttpServer::FakeHttpServer(Handler handler)
+    : handler_(std::move(handler)), requests_(0) {
+  last_request_.index = -1;
+  socket_ = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+  bind(socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+  listen(socket_, 64);
+  socklen_t length = sizeof(address);
+  getsockname(socket_, reinterpret_cast<sockaddr*>(&address), &length);
+  port_ = ntohs(address.sin_port);
+  accept_thread_ = std::thread([this]() { Accept(); });
+}
+
+FakeHttpServer::~FakeHttpServer() {
+  shutdown(socket_, SHUT_RDWR);
+  close(socket_);
+  accept_thread_.join();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int connection : connections_) shutdown(connection, SHUT_RDWR);
+  }
+  for (std::thread& thread : connection_threads_) thread.join();
+  for (int connection : connections_) close(connection);
+}
+
+std::string FakeHttpServer::url(const std::string& path) const {
+  return "http://127.0.0.1:" + std::to_string(port_) + path;
+}
+
+int FakeHttpServer::requests() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return requests_;
+}
+
+int FakeHttpServer::connections() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return static_cast<int>(connections_.size());
+}
+
+FakeHttpServer::Request FakeHttpServer::last_request() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return last_request_;
+}
+
+void FakeHttpServer::Send(int connection, const std::string& data) {
+  send(connection, data.data(), data.size(), MSG_NOSIGNAL);
+}
+
+std::string FakeHttpServer::Response(int status,
+                                     const std::string& content_type,
+                                     const std::string& body) {
+  return "HTTP/1.1 " + std::to_string(status) +
+         " Status\r\nContent-Type: " + content_type +
+         "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" +
+         body;
+}
+
+void FakeHttpServer::Accept() {
+  for (;;) {
+    int connection = accept(socket_, nullptr, nullptr);
+    if (connection < 0) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    connections_.push_back(connection);
+    connection_threads_.push_back(
+        std::thread([this, connection]() { Serve(connection); }));
+  }
+}
+
+void FakeHttpServer::Serve(int connection) {
+  std::string buffer;
+  Request request;
+  while (ReadRequest(connection, &buffer, &request)) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      request.index = requests_++;
+      last_request_ = request;
+    }
+    if (!handler_(request, connection)) break;
+  }
+  // The descriptor stays open until the server is destroyed so it isn't
+  // reused while the destructor may still shut it down.
+  shutdown(connection, SHUT_RDWR);
+}
+
+bool FakeHttpServer::ReadRequest(int connection, std::string* buffer,
+                                 Request* request) {
+  char data[4096];
+  size_t header_end;
+  while ((header_end = buffer->find("\r\n\r\n")) == std::string::npos) {
+    ssize_t received = recv(connection, data, sizeof(data), 0);
+    if (received <= 0) return false;
+    buffer->append(data, received);
+  }
+  size_t content_length = 0;
+  size_t field = buffer->find("Content-Length: ");
+  if (field == std::string::npos) field = buffer->find("content-length: ");
+  if (field != std::string::npos && field < header_end) {
+    content_length = strtoul(buffer->c_str() + field + 16, nullptr, 10);
+  }
+  size_t request_end = header_end + 4 + content_length;
+  while (buffer->size() < request_end) {
+    ssize_t received = recv(connection, data, sizeof(data), 0);
+    if (received <= 0) return false;
+    buffer->append(data, received);
+  }
+  request->headers.assign(*buffer, 0, header_end);
+  request->body.assign(*buffer, header_end + 4, content_length);
+  buffer->erase(0, request_end);
+  return true;
+}
+
+}  // namespace cppsdk
+}  // namespace testing
+}  // namespace firebase
+
+#endif  // !_WIN32
@@ -0,0 +1,100 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FIREBASE_TESTING_CPPSDK_FAKE_HTTP_SERVER_H_
+#define FIREBASE_TESTING_CPPSDK_FAKE_HTTP_SERVER_H_
+
+#ifndef _WIN32
+
+#include <functional>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+namespace firebase {
+namespace testing {
+namespace cppsdk {
+
+// HTTP server on the loopback interface for tests of code that makes requests
+// with app/rest. Each connection is served by its own thread, which reads
+// requests one after another and passes each to a handler that writes the
+// response. Not available on Windows.
+class FakeHttpServer {
+ public:
+  // A request received by the server.
+  struct Request {
+    // Number of requests received before this one.
+    int index;
+    // Request line and headers, without the blank line that ends them.
+    std::string headers;
+    // Body of Content-Length bytes.
+    std::string body;
+  };
+
+  // Answers request by sending data to connection with Send(). Returns
+  // whether the connection is kept open for another request, otherwise it's
+  // closed, which also ends a response without a Content-Length.
+  typedef std::function<bool(const Request& request, int connection)> Handler;
+
+  // Start the server on a free port.
+  explicit FakeHttpServer(Handler handler);
+  // Close the connections and stop the server.
+  ~FakeHttpServer();
+
+  // Returns the URL of path on the server.
+  std::string url(const std::string& path) const;
+
+  // Number of requests received.
+  int requests();
+  // Number of connections accepted.
+  int connections();
+  // The last request received.
+  Request last_request();
+
+  // Send data to connection, ignoring errors as the client may have closed
+  // it.
+  static void Send(int connection, const std::string& data);
+
+  // Returns a response with status and body that keeps the connection open.
+  static std::string Response(int status, const std::string& content_type,
+                              const std::string& body);
+
+ private:
+  void Accept();
+  void Serve(int connection);
+
+  // Read a request from connection, leaving any data of the next request in
+  // buffer. Returns false if the connection is closed first.
+  static bool ReadRequest(int connection, std::string* buffer,
+                          Request* request);
+
+  Handler handler_;
+  int socket_;
+  int port_;
+  std::thread accept_thread_;
+  std::mutex mutex_;
+  std::vector<int> connections_;
+  std::vector<std::thread> connection_threads_;
+  int requests_;
+  Request last_request_;
+};
+
+}  // namespace cppsdk
+}  // namespace testing
+}  // namespace firebase
+
+#endif  // !_WIN32
+
+#endif  // FIREBASE_TESTING_CPPSDK_FAKE_HTTP_SERVER_H_